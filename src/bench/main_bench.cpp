@@ -0,0 +1,482 @@
+// src/bench/main_bench.cpp
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "core/backend.h"
+#include "core/cpu_features.h"
+#include "core/filter_chain.h"
+#include "core/image.h"
+#include "core/json.h"
+#include "core/thread_pool.h"
+
+namespace
+{
+// Regressions smaller than this are timer noise for the smallest frames, whatever the ratio.
+constexpr double kMinRegressionMs = 0.05;
+
+const char* const kDefaultFilters[] = {
+    "grayscale", "brightness:0.2", "contrast:1.5", "gamma:2.2", "invert", "levels:16:235", "threshold:128",
+    "blur:1",    "blur:16",        "gaussian:4",   "sobel",     "canny",  "levels:16:235,gamma:2.2,gaussian:2,sobel",
+    "sharpen",   "gaussian5",      "emboss:mirror", "autolevels", "equalize", "gamma:2.2,autolevels,contrast:1.2",
+};
+
+struct FrameSize
+{
+    int width = 0;
+    int height = 0;
+};
+
+struct BenchSettings
+{
+    std::vector<std::string> filters;
+    std::vector<FrameSize> sizes;
+    std::vector<std::string> contents{ "scene" };
+    std::vector<Backend> backends; // empty: every available one
+    int warmup = 2;
+    int repeat = 10;
+    double max_seconds = 2.0; // per case; stops repeating early (after at least 3 runs) once exceeded
+    std::string output_path = "bench_results.json";
+    std::string baseline_path;
+    double tolerance = 0.10;
+};
+
+struct BenchResult
+{
+    std::string filter;
+    std::string backend;
+    std::string content;
+    int width = 0;
+    int height = 0;
+    int runs = 0;
+    double median_ms = 0.0;
+    double p95_ms = 0.0;
+    double mpix_per_s = 0.0;
+};
+
+void print_usage()
+{
+    std::cout << "Usage: cuda_image_filters_bench [options]\n";
+    std::cout << "       cuda_image_filters_bench compare <results.json> <baseline.json> [--tolerance <fraction>]\n";
+    std::cout << "Runs every filter on every available backend over a grid of frame sizes and reports the\n";
+    std::cout << "median and p95 time per call and MPix/s. Options:\n";
+    std::cout << "  --filter <spec>      filter or chain to run; repeat for several (default: every filter and a chain)\n";
+    std::cout << "  --sizes <list>       e.g. 256,1024,1920x1080,4k,8k (default 256,512,1024,2048,4k,8k)\n";
+    std::cout << "  --content <list>     synthetic frames: scene, noise, gradient (default scene)\n";
+    std::cout << "  --backends <list>    cuda, cpu, cpu-serial (default: every available one)\n";
+    std::cout << "  --warmup <n>         untimed runs per case (default 2)\n";
+    std::cout << "  --repeat <n>         timed runs per case (default 10)\n";
+    std::cout << "  --max-seconds <s>    stop repeating a case after this long, keeping at least 3 runs (default 2)\n";
+    std::cout << "  --quick              256 and 1024 only, 3 runs\n";
+    std::cout << "  --out <file>         JSON results (default bench_results.json)\n";
+    std::cout << "  --baseline <file>    compare against earlier results when done; exits 1 on regressions\n";
+    std::cout << "  --tolerance <f>      slowdown that counts as a regression (default 0.10 = 10%)\n";
+}
+
+std::vector<std::string> split(const std::string& list, char separator)
+{
+    std::vector<std::string> parts;
+    std::stringstream ss(list);
+    std::string part;
+    while (std::getline(ss, part, separator))
+    {
+        if (!part.empty()) parts.push_back(part);
+    }
+    return parts;
+}
+
+// "256" (square), "1920x1080", "4k" (3840x2160) or "8k" (7680x4320).
+FrameSize parse_size(const std::string& spec)
+{
+    if (spec == "4k" || spec == "4K") return { 3840, 2160 };
+    if (spec == "8k" || spec == "8K") return { 7680, 4320 };
+    const size_t x = spec.find('x');
+    FrameSize size;
+    size.width = std::stoi(spec.substr(0, x));
+    size.height = x == std::string::npos ? size.width : std::stoi(spec.substr(x + 1));
+    if (size.width <= 0 || size.height <= 0) throw std::invalid_argument("Bad frame size: " + spec);
+    return size;
+}
+
+// Synthetic RGB content. "scene" mixes smooth gradients, hard-edged shapes and mild sensor noise,
+// roughly like a photo; "noise" is uniform random bytes (worst case for run-based work), "gradient"
+// is perfectly smooth.
+Image make_frame(const std::string& content, int width, int height)
+{
+    Image img;
+    img.width = width;
+    img.height = height;
+    img.pixels.resize(static_cast<size_t>(width) * height * 3);
+    std::mt19937 rng(12345);
+
+    if (content == "noise")
+    {
+        for (uint8_t& v : img.pixels) v = static_cast<uint8_t>(rng());
+        return img;
+    }
+    if (content != "gradient" && content != "scene") throw std::invalid_argument("Unknown content: " + content);
+
+    const bool scene = content == "scene";
+    std::uniform_int_distribution<int> noise(-6, 6);
+    for (int y = 0; y < height; ++y)
+    {
+        uint8_t* row = img.pixels.data() + static_cast<size_t>(y) * width * 3;
+        for (int x = 0; x < width; ++x)
+        {
+            int r = x * 255 / std::max(width - 1, 1);
+            int g = y * 255 / std::max(height - 1, 1);
+            int b = (x + y) * 255 / std::max(width + height - 2, 1);
+            if (scene)
+            {
+                // A grid of discs and bars at 1/8 of the frame size, then noise.
+                const int cell = std::max(std::min(width, height) / 8, 8);
+                const int cx = x % cell - cell / 2;
+                const int cy = y % cell - cell / 2;
+                if (cx * cx + cy * cy < cell * cell / 9)
+                {
+                    r = 255 - r;
+                    b = 40;
+                }
+                else if (std::abs(cy) < cell / 16)
+                {
+                    g = 230;
+                }
+                r += noise(rng);
+                g += noise(rng);
+                b += noise(rng);
+            }
+            row[x * 3 + 0] = static_cast<uint8_t>(std::clamp(r, 0, 255));
+            row[x * 3 + 1] = static_cast<uint8_t>(std::clamp(g, 0, 255));
+            row[x * 3 + 2] = static_cast<uint8_t>(std::clamp(b, 0, 255));
+        }
+    }
+    return img;
+}
+
+// Nearest-rank percentile of sorted samples.
+double percentile(const std::vector<double>& sorted, double p)
+{
+    const size_t rank = static_cast<size_t>(std::ceil(p * sorted.size()));
+    return sorted[std::min(std::max<size_t>(rank, 1), sorted.size()) - 1];
+}
+
+BenchResult run_case(const std::string& spec, Backend backend, const std::string& content, const Image& source,
+                     const BenchSettings& settings)
+{
+    using Clock = std::chrono::steady_clock;
+    const FilterChain chain = parse_filter_chain(spec);
+    Image work;
+
+    auto run_once = [&] {
+        work.width = source.width;
+        work.height = source.height;
+        work.channels = source.channels;
+        work.pixels.assign(source.pixels.begin(), source.pixels.end());
+        const Clock::time_point start = Clock::now();
+        const Backend used = run_pipeline(work, chain, backend);
+        const double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        if (used != backend)
+        {
+            throw std::runtime_error(std::string("ran on ") + backend_name(used) + " instead of " +
+                                     backend_name(backend));
+        }
+        return ms;
+    };
+
+    for (int i = 0; i < settings.warmup; ++i) run_once();
+    std::vector<double> times;
+    const Clock::time_point case_start = Clock::now();
+    for (int i = 0; i < std::max(settings.repeat, 1); ++i)
+    {
+        times.push_back(run_once());
+        const double elapsed = std::chrono::duration<double>(Clock::now() - case_start).count();
+        if (times.size() >= 3 && elapsed > settings.max_seconds) break;
+    }
+    std::sort(times.begin(), times.end());
+
+    BenchResult result;
+    result.filter = spec;
+    result.backend = backend_name(backend);
+    result.content = content;
+    result.width = source.width;
+    result.height = source.height;
+    result.runs = static_cast<int>(times.size());
+    result.median_ms = percentile(times, 0.5);
+    result.p95_ms = percentile(times, 0.95);
+    result.mpix_per_s = static_cast<double>(source.width) * source.height / (result.median_ms * 1e3);
+    return result;
+}
+
+JsonValue host_json()
+{
+    JsonValue host = JsonValue::object();
+    host["cpu_threads"] = cpu_thread_count();
+    host["simd"] = simd_level_name(active_simd_level());
+    JsonValue backends = JsonValue::array();
+    for (const BackendInfo& info : backend_registry())
+    {
+        JsonValue entry = JsonValue::object();
+        entry["name"] = backend_name(info.backend);
+        entry["available"] = info.available;
+        entry["description"] = info.description;
+        backends.push_back(std::move(entry));
+    }
+    host["backends"] = std::move(backends);
+    return host;
+}
+
+JsonValue results_json(const std::vector<BenchResult>& results, const BenchSettings& settings)
+{
+    JsonValue root = JsonValue::object();
+    root["schema"] = 1;
+    root["host"] = host_json();
+    JsonValue config = JsonValue::object();
+    config["warmup"] = settings.warmup;
+    config["repeat"] = settings.repeat;
+    config["max_seconds"] = settings.max_seconds;
+    root["settings"] = std::move(config);
+
+    JsonValue list = JsonValue::array();
+    for (const BenchResult& r : results)
+    {
+        JsonValue entry = JsonValue::object();
+        entry["filter"] = r.filter;
+        entry["backend"] = r.backend;
+        entry["content"] = r.content;
+        entry["width"] = r.width;
+        entry["height"] = r.height;
+        entry["runs"] = r.runs;
+        entry["median_ms"] = r.median_ms;
+        entry["p95_ms"] = r.p95_ms;
+        entry["mpix_per_s"] = r.mpix_per_s;
+        list.push_back(std::move(entry));
+    }
+    root["results"] = std::move(list);
+    return root;
+}
+
+std::string case_key(const std::string& filter, const std::string& backend, const std::string& content, int width,
+                     int height)
+{
+    return filter + " | " + backend + " | " + content + " | " + std::to_string(width) + "x" + std::to_string(height);
+}
+
+// case key -> median ms of a results file.
+std::map<std::string, double> load_medians(const std::string& path)
+{
+    std::ifstream in(path, std::ios::binary);
+    if (!in) throw std::runtime_error("Failed to open " + path);
+    std::stringstream text;
+    text << in.rdbuf();
+    const JsonValue root = parse_json(text.str());
+
+    std::map<std::string, double> medians;
+    for (const JsonValue& r : root["results"].elements())
+    {
+        const std::string key = case_key(r["filter"].as_string(), r["backend"].as_string(), r["content"].as_string(),
+                                         static_cast<int>(r["width"].as_number()),
+                                         static_cast<int>(r["height"].as_number()));
+        medians[key] = r["median_ms"].as_number();
+    }
+    return medians;
+}
+
+// Prints slowdowns and speedups beyond the tolerance; returns the number of regressions.
+int compare_results(const std::map<std::string, double>& current, const std::map<std::string, double>& baseline,
+                    double tolerance)
+{
+    int regressions = 0;
+    int improvements = 0;
+    int matched = 0;
+    for (const auto& [key, ms] : current)
+    {
+        const auto it = baseline.find(key);
+        if (it == baseline.end()) continue;
+        ++matched;
+        const double ratio = ms / std::max(it->second, 1e-9);
+        char line[256];
+        std::snprintf(line, sizeof(line), "%8.3f ms -> %8.3f ms (%+.1f%%)", it->second, ms, (ratio - 1.0) * 100.0);
+        if (ratio > 1.0 + tolerance && ms - it->second > kMinRegressionMs)
+        {
+            ++regressions;
+            std::cout << "REGRESSION  " << key << ": " << line << "\n";
+        }
+        else if (ratio < 1.0 - tolerance)
+        {
+            ++improvements;
+            std::cout << "improvement " << key << ": " << line << "\n";
+        }
+    }
+    std::cout << matched << " cases compared (" << current.size() - matched << " without baseline), " << regressions
+              << " regressions, " << improvements << " improvements at " << tolerance * 100.0 << "% tolerance\n";
+    return regressions;
+}
+
+int run_compare_command(int argc, char** argv)
+{
+    if (argc < 4)
+    {
+        print_usage();
+        return 1;
+    }
+    double tolerance = 0.10;
+    for (int i = 4; i < argc; ++i)
+    {
+        if (std::string(argv[i]) == "--tolerance" && i + 1 < argc)
+            tolerance = std::stod(argv[++i]);
+        else
+        {
+            std::cerr << "Unknown compare option: " << argv[i] << "\n";
+            return 1;
+        }
+    }
+    return compare_results(load_medians(argv[2]), load_medians(argv[3]), tolerance) == 0 ? 0 : 1;
+}
+
+BenchSettings parse_settings(int argc, char** argv)
+{
+    BenchSettings settings;
+    for (const char* spec : kDefaultFilters) settings.filters.push_back(spec);
+    for (const char* spec : { "256", "512", "1024", "2048", "4k", "8k" }) settings.sizes.push_back(parse_size(spec));
+
+    bool custom_filters = false;
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        if (arg == "--quick")
+        {
+            settings.sizes = { parse_size("256"), parse_size("1024") };
+            settings.repeat = 3;
+            continue;
+        }
+        if (i + 1 >= argc) throw std::invalid_argument("Unknown or incomplete option: " + arg);
+        const std::string value = argv[++i];
+        if (arg == "--filter")
+        {
+            if (!custom_filters) settings.filters.clear();
+            custom_filters = true;
+            parse_filter_chain(value); // reject typos before any timing starts
+            settings.filters.push_back(value);
+        }
+        else if (arg == "--sizes")
+        {
+            settings.sizes.clear();
+            for (const std::string& spec : split(value, ',')) settings.sizes.push_back(parse_size(spec));
+        }
+        else if (arg == "--content")
+            settings.contents = split(value, ',');
+        else if (arg == "--backends")
+        {
+            settings.backends.clear();
+            for (const std::string& name : split(value, ',')) settings.backends.push_back(parse_backend(name));
+        }
+        else if (arg == "--warmup")
+            settings.warmup = std::stoi(value);
+        else if (arg == "--repeat")
+            settings.repeat = std::stoi(value);
+        else if (arg == "--max-seconds")
+            settings.max_seconds = std::stod(value);
+        else if (arg == "--out")
+            settings.output_path = value;
+        else if (arg == "--baseline")
+            settings.baseline_path = value;
+        else if (arg == "--tolerance")
+            settings.tolerance = std::stod(value);
+        else
+            throw std::invalid_argument("Unknown option: " + arg);
+    }
+    return settings;
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    try
+    {
+        if (argc >= 2 && std::string(argv[1]) == "compare") return run_compare_command(argc, argv);
+        if (argc >= 2 && (std::string(argv[1]) == "--help" || std::string(argv[1]) == "-h"))
+        {
+            print_usage();
+            return 0;
+        }
+
+        BenchSettings settings = parse_settings(argc, argv);
+        std::vector<Backend> backends;
+        for (const BackendInfo& info : backend_registry())
+        {
+            const bool wanted = settings.backends.empty() ||
+                                std::find(settings.backends.begin(), settings.backends.end(), info.backend) !=
+                                    settings.backends.end();
+            if (!wanted) continue;
+            if (info.available)
+                backends.push_back(info.backend);
+            else
+                std::cout << "Skipping " << backend_name(info.backend) << ": " << info.description << "\n";
+        }
+        if (backends.empty()) throw std::runtime_error("No available backend selected");
+
+        std::vector<BenchResult> results;
+        std::printf("%-42s %-10s %-8s %11s %5s %10s %10s %10s\n", "filter", "backend", "content", "size", "runs",
+                    "median ms", "p95 ms", "MPix/s");
+        for (const std::string& content : settings.contents)
+        {
+            for (const FrameSize& size : settings.sizes)
+            {
+                const Image source = make_frame(content, size.width, size.height);
+                for (const std::string& spec : settings.filters)
+                {
+                    for (Backend backend : backends)
+                    {
+                        if (!backend_available(backend)) continue; // CUDA may have been disabled by an error
+                        BenchResult r;
+                        try
+                        {
+                            r = run_case(spec, backend, content, source, settings);
+                        }
+                        catch (const std::exception& ex)
+                        {
+                            std::cerr << "Error: " << spec << " on " << backend_name(backend) << ": " << ex.what()
+                                      << "\n";
+                            continue;
+                        }
+                        const std::string dims = std::to_string(r.width) + "x" + std::to_string(r.height);
+                        std::printf("%-42s %-10s %-8s %11s %5d %10.3f %10.3f %10.1f\n", r.filter.c_str(),
+                                    r.backend.c_str(), r.content.c_str(), dims.c_str(), r.runs, r.median_ms, r.p95_ms,
+                                    r.mpix_per_s);
+                        std::fflush(stdout);
+                        results.push_back(r);
+                    }
+                }
+            }
+        }
+
+        std::ofstream out(settings.output_path, std::ios::binary);
+        out << results_json(results, settings).dump(2) << "\n";
+        if (!out) throw std::runtime_error("Failed to write " + settings.output_path);
+        std::cout << "Wrote " << results.size() << " results to " << settings.output_path << "\n";
+
+        if (!settings.baseline_path.empty())
+        {
+            std::map<std::string, double> current;
+            for (const BenchResult& r : results)
+            {
+                current[case_key(r.filter, r.backend, r.content, r.width, r.height)] = r.median_ms;
+            }
+            return compare_results(current, load_medians(settings.baseline_path), settings.tolerance) == 0 ? 0 : 1;
+        }
+    }
+    catch (const std::exception& ex)
+    {
+        std::cerr << "Error: " << ex.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
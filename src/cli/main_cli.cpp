@@ -1,28 +1,681 @@
 // src/cli/main_cli.cpp
+#include <algorithm>
 #include <chrono>
+#include <cstdio>
+#include <cstring>
 #include <iostream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
 #include <string>
 #include <vector>
 
+#include "core/backend.h"
+#include "core/batch.h"
+#include "core/buffer_pool.h"
 #include "core/filters_cuda.h"
+#include "core/histogram.h"
 #include "core/image.h"
+#include "core/job_server.h"
+#include "core/json.h"
+#include "core/resize.h"
+#include "core/result_cache.h"
+#include "core/streaming.h"
+#include "core/trace.h"
+#include "core/tuning.h"
+#include "core/video.h"
 
 namespace
 {
 void print_usage()
 {
     std::cout << "Usage: cuda_image_filters_cli <input> <output> <filter> [params]\n";
+    std::cout << "       cuda_image_filters_cli <input> <output> <chain>\n";
+    std::cout << "       cuda_image_filters_cli --batch <dir|manifest> <output_dir> <chain> [options]\n";
+    std::cout << "       cuda_image_filters_cli --stream <input.ppm|pam> <output.ppm|pam|png> <chain> [--band <rows>] [--cpu]\n";
+    std::cout << "       cuda_image_filters_cli --video <input> <output> <chain> [video options]\n";
+    std::cout << "       cuda_image_filters_cli --serve [<socket>|-] [server options]\n";
+    std::cout << "       cuda_image_filters_cli --submit <socket> [<input> <output> <chain>]\n";
+    std::cout << "       cuda_image_filters_cli --autotune [--quick] [--chain <chain>]... [--out <file>] [--cpu]\n";
+    std::cout << "       cuda_image_filters_cli --backends\n";
     std::cout << "Filters:\n";
     std::cout << "  grayscale\n";
     std::cout << "  brightness <delta>    (delta in [-1.0, 1.0])\n";
     std::cout << "  contrast <factor>     (factor > 0, e.g., 0.5, 1.0, 1.5, 2.0)\n";
-    std::cout << "  blur\n";
-    std::cout << "  sobel\n";
+    std::cout << "  gamma <gamma>         (gamma > 0, > 1 brightens, e.g., 2.2)\n";
+    std::cout << "  invert\n";
+    std::cout << "  levels <in_black> <in_white> [<out_black> <out_white>]   (0..255)\n";
+    std::cout << "  threshold <level>     (level in [0, 255])\n";
+    std::cout << "  blur [radius]         (box of (2r+1)^2 pixels, default 1)\n";
+    std::cout << "  gaussian <sigma>      (sigma in pixels, three box passes)\n";
+    std::cout << "  sobel [gray]          (gray: write a single-channel magnitude PNG)\n";
+    std::cout << "  canny [low high]      (gradient thresholds, default 50 100)\n";
+    std::cout << "  sharpen, laplacian, emboss, gaussian5 [border [value]]   (fixed 3x3 / 5x5 kernels; border\n";
+    std::cout << "                        clamp (default), mirror, wrap or constant with its value, in chains too)\n";
+    std::cout << "  autolevels [clip]     (stretch the range between the clip and 100 - clip percentiles to 0..255,\n";
+    std::cout << "                        default 0.5)\n";
+    std::cout << "  equalize              (histogram equalization; both share one table across the channels)\n";
+    std::cout << "  thumbnail <max_dim> [kernel]   (fit into max_dim x max_dim keeping the aspect ratio; never enlarges)\n";
+    std::cout << "  resize <W>x<H> [kernel]        (kernel: box, bilinear, bicubic or lanczos3, the default)\n";
+    std::cout << "Chains run several filters in one fused pass, e.g. brightness:0.2,contrast:1.5,sobel\n";
+    std::cout << "(parameters follow the name after ':', e.g. levels:16:235,gamma:2.2; adjacent point ops\n";
+    std::cout << "collapse into a single lookup table). A chain may start with thumbnail:<max_dim>[:kernel] or\n";
+    std::cout << "resize:<W>x<H>[:kernel], which runs first on the CPU, e.g. --batch photos/ thumbs/ thumbnail:256,sharpen\n";
+    std::cout << "Batch mode decodes, filters and encodes on separate worker threads (manifest: one path per line):\n";
+    std::cout << "  --decoders <n>  --filters <n>  --encoders <n>   worker threads per stage\n";
+    std::cout << "  --queue <n>     images buffered between stages (default 4)\n";
+    std::cout << "  --cpu           filter on the CPU instead of the GPU\n";
+    std::cout << "  --format <ext>  output format: png (default), qoi, ppm, pam or bmp\n";
+    std::cout << "Stream mode filters frames larger than memory in bands of rows (default 256).\n";
+    std::cout << "Video mode filters a frame sequence; decode, filter and output overlap. Inputs: - (stdin, Y4M or\n";
+    std::cout << "raw RGB24), .y4m, .rgb/.raw, or a numbered pattern like in/%05d.png; outputs likewise (- is Y4M):\n";
+    std::cout << "  --size <WxH>    frame size of raw RGB24 input\n";
+    std::cout << "  --fps <n[:d]>   frame rate of raw and numbered input (default 25)\n";
+    std::cout << "  --start <n>     first number of a numbered input (default 0 or 1)\n";
+    std::cout << "  --frames <n>    stop after n frames\n";
+    std::cout << "  --queue <n>     frames buffered between stages (default 2)\n";
+    std::cout << "  --realtime      drop frames the filter cannot keep up with instead of stalling the input\n";
+    std::cout << "  --raw           write raw RGB24 instead of Y4M to stdout\n";
+    std::cout << "  --progress      report frames, fps and drops once a second\n";
+    std::cout << "  --cpu           filter on the CPU instead of the GPU\n";
+    std::cout << "Server mode keeps workers and the GPU warm and runs JSON-lines jobs from a Unix socket or stdin\n";
+    std::cout << "({\"id\":\"1\",\"input\":\"a.png\",\"output\":\"b.png\",\"chain\":\"invert\"}; {\"op\":\"stats\"}, {\"op\":\"shutdown\"}):\n";
+    std::cout << "  --decoders <n>  --filters <n>  --encoders <n>   worker threads per stage\n";
+    std::cout << "  --queue <n>     jobs admitted before the server stops reading requests (default 16)\n";
+    std::cout << "  --cpu           filter on the CPU instead of the GPU\n";
+    std::cout << "--submit sends one job, or the JSON lines on stdin, and prints each result as it arrives.\n";
+    std::cout << "Autotune times task, band and CUDA block sizes, thread counts and SIMD levels per filter and frame\n";
+    std::cout << "size and saves the winners to this host's tuning file, which every later run loads:\n";
+    std::cout << "  --quick         time three frame sizes instead of six\n";
+    std::cout << "  --chain <c>     tune this chain (repeatable; default: one chain per kind of filter)\n";
+    std::cout << "  --out <file>    tuning file (default: $CUDAPIX_TUNE_FILE or ~/.cache/cudapix/tune-<host>.json)\n";
+    std::cout << "  --cpu           leave the CUDA launch shapes alone\n";
+    std::cout << "The output format follows the extension: .png, .qoi, .ppm/.pgm, .pam or .bmp. In every mode:\n";
+    std::cout << "  --png-level <0-9>   zlib level for PNG output (default 6; 1 is fastest)\n";
+    std::cout << "  --png-threads <n>   deflate PNG row chunks on n threads (0: all cores, default 1)\n";
+    std::cout << "  --backend <name>    auto (default: by image size), cuda, cpu or cpu-serial\n";
+    std::cout << "  --calibrate         time the backends on this chain first and route by the measured crossovers\n";
+    std::cout << "  --trace <file>      record load, filter stages, allocations, transfers and encode as Chrome trace JSON\n";
+    std::cout << "  --crop <x,y,w,h>    (single image) filter and save only this rectangle, plus the context it needs\n";
+    std::cout << "  --cache <dir>       reuse results (and the chain minus its last stage) for repeated inputs, kept in dir\n";
+    std::cout << "  --cache-mb <n>      in-memory cache budget in MiB (default 256)\n";
+    std::cout << "  --cache-qoi         store cache entries as QOI instead of raw pixels\n";
+    std::cout << "  --huge-pages        back large pooled host buffers with transparent huge pages\n";
+    std::cout << "  --pool-stats        print buffer pool hits, misses and peak bytes at exit\n";
+    std::cout << "  --stats             (single image) print min, max, mean, deviation and percentiles of the result\n";
+}
+
+// Options accepted in every mode.
+struct GlobalOptions
+{
+    PngOptions png;
+    Backend backend = Backend::Auto;
+    bool calibrate = false;
+    std::string trace_path; // empty: tracing off
+    ResultCacheOptions cache; // used when cache.disk_dir is set
+    Rect crop;                // single-image mode; empty: whole frame
+    bool pool_stats = false;
+    bool stats = false;       // single-image mode: print the result's histogram statistics
+};
+
+Rect parse_crop(const std::string& spec)
+{
+    int x = 0, y = 0, w = 0, h = 0;
+    char tail = 0;
+    if (std::sscanf(spec.c_str(), "%d,%d,%d,%d%c", &x, &y, &w, &h, &tail) != 4 || x < 0 || y < 0 || w <= 0 || h <= 0)
+    {
+        throw std::invalid_argument("Bad --crop (expected x,y,width,height): " + spec);
+    }
+    return { x, y, x + w, y + h };
+}
+
+// Copy of the frame's `area`, taken from `work`, which holds the frame's `context` rectangle.
+Image crop_from_context(const Image& work, const Rect& context, const Rect& area)
+{
+    return to_image(ConstImageView(work).crop(area.x0 - context.x0, area.y0 - context.y0, area.x1 - context.x0,
+                                              area.y1 - context.y0));
+}
+
+// Removes the options above (and their values) from argv, wherever they appear.
+GlobalOptions take_global_options(int& argc, char** argv)
+{
+    GlobalOptions options;
+    int kept = 1;
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        if (arg == "--calibrate")
+            options.calibrate = true;
+        else if (arg == "--png-level" && i + 1 < argc)
+            options.png.level = std::stoi(argv[++i]);
+        else if (arg == "--png-threads" && i + 1 < argc)
+            options.png.threads = std::stoi(argv[++i]);
+        else if (arg == "--backend" && i + 1 < argc)
+            options.backend = parse_backend(argv[++i]);
+        else if (arg == "--trace" && i + 1 < argc)
+            options.trace_path = argv[++i];
+        else if (arg == "--cache" && i + 1 < argc)
+            options.cache.disk_dir = argv[++i];
+        else if (arg == "--cache-mb" && i + 1 < argc)
+            options.cache.memory_bytes = static_cast<size_t>(std::max(std::stoi(argv[++i]), 0)) << 20;
+        else if (arg == "--cache-qoi")
+            options.cache.disk_qoi = true;
+        else if (arg == "--crop" && i + 1 < argc)
+            options.crop = parse_crop(argv[++i]);
+        else if (arg == "--huge-pages")
+        {
+            BufferPoolOptions pool = host_buffer_pool().options();
+            pool.huge_pages = true;
+            host_buffer_pool().set_options(pool);
+        }
+        else if (arg == "--pool-stats")
+            options.pool_stats = true;
+        else if (arg == "--stats")
+            options.stats = true;
+        else
+            argv[kept++] = argv[i];
+    }
+    argc = kept;
+    return options;
+}
+
+// Writes the spans recorded during the run when main returns, on success and on error alike, and
+// prints the per-stage totals.
+struct TraceExport
+{
+    std::string path;
+
+    ~TraceExport()
+    {
+        if (path.empty()) return;
+        const std::vector<TraceEvent> events = collect_trace();
+        std::cout << "Stage breakdown (busy time summed over threads):\n";
+        for (const TraceTotal& total : summarize_trace(events))
+        {
+            std::printf("  %-18s %-9s %6d x %10.3f ms\n", total.name, total.category, total.count, total.total_ms);
+        }
+        try
+        {
+            write_chrome_trace(path, events);
+            std::cout << "Wrote " << events.size() << " trace events to " << path << "\n";
+        }
+        catch (const std::exception& ex)
+        {
+            std::cerr << "Error: " << ex.what() << "\n";
+        }
+    }
+};
+
+// Prints the host and device buffer pool statistics when main returns.
+struct PoolStatsReport
+{
+    bool enabled;
+
+    ~PoolStatsReport()
+    {
+        if (!enabled) return;
+        auto print = [](const char* name, const BufferPoolStats& stats) {
+            std::printf("%s pool: %llu hits, %llu misses, peak %.1f MiB, %.1f MiB cached\n", name,
+                        static_cast<unsigned long long>(stats.hits), static_cast<unsigned long long>(stats.misses),
+                        stats.peak_bytes / (1024.0 * 1024.0), stats.cached / (1024.0 * 1024.0));
+        };
+        print("Host", host_buffer_pool().stats());
+        print("Device", device_buffer_pool().stats());
+    }
+};
+
+std::unique_ptr<ResultCache> make_cache(const GlobalOptions& global)
+{
+    if (global.cache.disk_dir.empty()) return nullptr;
+    return std::make_unique<ResultCache>(global.cache);
+}
+
+void print_cache_stats(const ResultCache& cache)
+{
+    const ResultCacheStats stats = cache.stats();
+    std::cout << "Cache: " << stats.memory_hits << " memory hits, " << stats.disk_hits << " disk hits, " << stats.misses
+              << " misses, " << stats.entries << " entries in memory (" << stats.bytes / (1024.0 * 1024.0)
+              << " MiB)\n";
+}
+
+void calibrate_for(const FilterChain& chain)
+{
+    auto pixels = [](uint64_t n) {
+        return n == UINT64_MAX ? std::string("never") : std::to_string(n) + " px";
+    };
+    const RoutingThresholds thresholds = calibrate_routing(chain);
+    set_routing_thresholds(thresholds);
+    std::cout << "Calibrated: CPU pool from " << pixels(thresholds.parallel_min_pixels) << ", CUDA from "
+              << pixels(thresholds.cuda_min_pixels) << "\n";
+}
+
+int run_backends_command()
+{
+    for (const BackendInfo& info : backend_registry())
+    {
+        std::cout << backend_name(info.backend) << ": " << (info.available ? "available" : "unavailable") << " ("
+                  << info.description << ")\n";
+    }
+    const RoutingThresholds thresholds = routing_thresholds();
+    std::cout << "auto: calling thread below " << thresholds.parallel_min_pixels << " px, CUDA from "
+              << thresholds.cuda_min_pixels << " px\n";
+    const std::string path = default_tuning_path();
+    if (init_tuning())
+        std::cout << "tuning: " << installed_tuning().size() << " entries from " << path << "\n";
+    else
+        std::cout << "tuning: defaults (no tuning file for this host" << (path.empty() ? "" : " at " + path) << ")\n";
+    return 0;
+}
+
+std::string format_kib(size_t bytes)
+{
+    return bytes >= (1u << 20) ? std::to_string(bytes >> 20) + " MiB" : std::to_string(bytes >> 10) + " KiB";
+}
+
+// --autotune [--quick] [--chain <chain>]... [--out <file>] [--cpu]
+int run_autotune_command(int argc, char** argv)
+{
+    AutotuneOptions options;
+    std::string path = default_tuning_path();
+    for (int i = 2; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        if (arg == "--quick")
+            options.sides = { 256, 1024, 2048 };
+        else if (arg == "--cpu")
+            options.cuda = false;
+        else if (arg == "--chain" && i + 1 < argc)
+            options.chains.push_back(format_filter_chain(parse_filter_chain(argv[++i])));
+        else if (arg == "--out" && i + 1 < argc)
+            path = argv[++i];
+        else
+        {
+            std::cerr << "Unknown autotune option: " << arg << "\n";
+            print_usage();
+            return 1;
+        }
+    }
+
+    std::cout << "Autotuning on " << host_fingerprint() << "\n";
+    options.progress = [](const TuneEntry& e) {
+        const TuneParams& p = e.params;
+        std::cout << "  " << filter_kind_name(e.kind) << " " << tune_bucket_name(e.bucket) << ": " << e.seconds * 1e3
+                  << " ms (defaults " << e.default_seconds * 1e3 << " ms) with tasks of " << format_kib(p.chunk_bytes)
+                  << ", bands of " << format_kib(p.band_bytes) << ", "
+                  << (p.cpu_tasks > 0 ? std::to_string(p.cpu_tasks) : std::string("all")) << " threads, SIMD "
+                  << (p.simd < 0 ? "best" : simd_level_name(static_cast<SimdLevel>(p.simd))) << ", CUDA blocks "
+                  << p.block_x << "x" << p.block_y << " / " << p.block_1d << "\n";
+    };
+    const std::vector<TuneEntry> entries = autotune(options);
+    install_tuning(entries);
+    save_tuning(entries, path);
+    std::cout << "Saved " << entries.size() << " entries to " << path << "\n";
+    return 0;
+}
+
+// Summary of the combined colour channels, then per-channel means for colour images.
+void print_stats(const ImageView& img, Backend backend)
+{
+    const Histogram hist = compute_histogram(img, backend);
+    const Histogram::Bins bins = hist.combined();
+    const HistogramStats stats = histogram_stats(bins);
+    std::cout << "Stats: min " << stats.min << ", max " << stats.max << ", mean " << stats.mean << ", stddev "
+              << stats.stddev << ", median " << stats.median << ", p1 " << histogram_percentile(bins, 1.0) << ", p99 "
+              << histogram_percentile(bins, 99.0) << "\n";
+    if (hist.channels < 3) return;
+    std::cout << "Channel means: R " << histogram_stats(hist.counts[0]).mean << ", G "
+              << histogram_stats(hist.counts[1]).mean << ", B " << histogram_stats(hist.counts[2]).mean << "\n";
+}
+
+FilterChain single_step(FilterKind kind, std::initializer_list<float> params = {})
+{
+    FilterStep step;
+    step.kind = kind;
+    std::copy(params.begin(), params.end(), step.params.begin());
+    return { step };
+}
+
+bool is_chain_spec(const std::string& arg)
+{
+    return arg.find(',') != std::string::npos || arg.find(':') != std::string::npos;
+}
+
+// "thumbnail:256:lanczos3,sharpen" for log lines.
+std::string describe_chain(const ResizeSpec& resize, const FilterChain& chain)
+{
+    if (!resize.active()) return format_filter_chain(chain);
+    if (chain.empty()) return format_resize_spec(resize);
+    return format_resize_spec(resize) + "," + format_filter_chain(chain);
+}
+
+// --batch <dir|manifest> <output_dir> <chain> [options]
+int run_batch_command(int argc, char** argv, const GlobalOptions& global)
+{
+    if (argc < 5)
+    {
+        print_usage();
+        return 1;
+    }
+
+    BatchOptions options;
+    options.output_dir = argv[3];
+    options.png = global.png;
+    options.backend = global.backend;
+    std::string spec = argv[4];
+    options.resize = take_resize_step(spec);
+    if (!options.resize.active() || !spec.empty()) options.chain = parse_filter_chain(spec);
+    for (int i = 5; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        if (arg == "--cpu")
+        {
+            options.backend = Backend::Cpu;
+            continue;
+        }
+        if (i + 1 >= argc)
+        {
+            std::cerr << "Unknown or incomplete batch option: " << arg << "\n";
+            print_usage();
+            return 1;
+        }
+        if (arg == "--format")
+        {
+            const std::string format = argv[++i];
+            options.extension = format.rfind('.', 0) == 0 ? format : "." + format;
+            continue;
+        }
+        const int value = std::stoi(argv[++i]);
+        if (arg == "--decoders")
+            options.decode_workers = value;
+        else if (arg == "--filters")
+            options.filter_workers = value;
+        else if (arg == "--encoders")
+            options.encode_workers = value;
+        else if (arg == "--queue")
+            options.queue_depth = static_cast<size_t>(std::max(value, 1));
+        else
+        {
+            std::cerr << "Unknown batch option: " << arg << "\n";
+            print_usage();
+            return 1;
+        }
+    }
+
+    if (global.calibrate && !options.chain.empty()) calibrate_for(options.chain);
+    const std::unique_ptr<ResultCache> cache = make_cache(global);
+    options.cache = cache.get();
+    const std::vector<std::string> inputs = collect_batch_inputs(argv[2]);
+    std::cout << "Batch: " << inputs.size() << " images, chain '" << describe_chain(options.resize, options.chain)
+              << "', backend " << backend_name(options.backend) << "\n";
+
+    const BatchStats stats = run_batch(inputs, options);
+    for (const std::string& error : stats.errors)
+    {
+        std::cerr << "Error: " << error << "\n";
+    }
+
+    const double seconds = std::max(stats.seconds, 1e-9);
+    std::cout << "Processed " << stats.images << " images (" << stats.failed << " failed) in " << stats.seconds
+              << " s: " << stats.images / seconds << " images/s, " << stats.pixels / seconds / 1e6 << " MPix/s\n";
+    std::cout << "Stage busy time: decode " << stats.decode_seconds << " s, filter " << stats.filter_seconds
+              << " s, encode " << stats.encode_seconds << " s\n";
+    if (cache) print_cache_stats(*cache);
+    return stats.failed == 0 ? 0 : 1;
+}
+
+// --stream <input> <output> <chain> [--band <rows>] [--cpu]
+int run_stream_command(int argc, char** argv, const GlobalOptions& global)
+{
+    if (argc < 5)
+    {
+        print_usage();
+        return 1;
+    }
+
+    StreamOptions options;
+    options.png_level = global.png.level;
+    options.backend = global.backend;
+    for (int i = 5; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        if (arg == "--cpu")
+            options.backend = Backend::Cpu;
+        else if (arg == "--band" && i + 1 < argc)
+            options.band_rows = std::stoi(argv[++i]);
+        else
+        {
+            std::cerr << "Unknown stream option: " << arg << "\n";
+            print_usage();
+            return 1;
+        }
+    }
+
+    const FilterChain chain = parse_filter_chain(argv[4]);
+    if (global.calibrate) calibrate_for(chain);
+    auto start = std::chrono::high_resolution_clock::now();
+    const StreamStats stats = stream_pipeline(argv[2], argv[3], chain, options);
+    auto end = std::chrono::high_resolution_clock::now();
+    double ms = std::chrono::duration<double, std::milli>(end - start).count();
+
+    std::cout << "Streamed " << argv[2] << " (" << stats.width << "x" << stats.height << ") in " << stats.bands
+              << " bands, halo " << stats.halo << " rows, peak buffer " << stats.peak_bytes / (1024.0 * 1024.0)
+              << " MiB, " << ms << " ms\n";
+    std::cout << "Saved result to " << argv[3] << "\n";
+    return 0;
+}
+// --video <input> <output> <chain> [options]
+int run_video_command(int argc, char** argv, const GlobalOptions& global)
+{
+    if (argc < 5)
+    {
+        print_usage();
+        return 1;
+    }
+    // Frames may go to stdout, so every message (including the trace and pool reports at exit) goes
+    // to stderr in this mode.
+    std::cout.rdbuf(std::cerr.rdbuf());
+
+    VideoInputOptions input;
+    VideoOptions options;
+    options.backend = global.backend;
+    bool raw_output = false;
+    bool progress = false;
+    for (int i = 5; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        if (arg == "--cpu")
+            options.backend = Backend::Cpu;
+        else if (arg == "--realtime")
+            options.drop_late = true;
+        else if (arg == "--raw")
+            raw_output = true;
+        else if (arg == "--progress")
+            progress = true;
+        else if (arg == "--size" && i + 1 < argc)
+        {
+            char tail = 0;
+            if (std::sscanf(argv[++i], "%dx%d%c", &input.width, &input.height, &tail) != 2)
+                throw std::invalid_argument(std::string("Bad --size (expected WxH): ") + argv[i]);
+        }
+        else if (arg == "--fps" && i + 1 < argc)
+        {
+            input.fps_den = 1;
+            if (std::sscanf(argv[++i], "%d:%d", &input.fps_num, &input.fps_den) < 1 || input.fps_num <= 0 ||
+                input.fps_den <= 0)
+            {
+                throw std::invalid_argument(std::string("Bad --fps: ") + argv[i]);
+            }
+        }
+        else if (arg == "--start" && i + 1 < argc)
+            input.first_frame = std::stoi(argv[++i]);
+        else if (arg == "--frames" && i + 1 < argc)
+            options.max_frames = static_cast<size_t>(std::max(std::stoi(argv[++i]), 0));
+        else if (arg == "--queue" && i + 1 < argc)
+            options.queue_depth = static_cast<size_t>(std::max(std::stoi(argv[++i]), 1));
+        else
+        {
+            std::cerr << "Unknown video option: " << arg << "\n";
+            print_usage();
+            return 1;
+        }
+    }
+
+    options.chain = parse_filter_chain(argv[4]);
+    if (global.calibrate) calibrate_for(options.chain);
+    const std::unique_ptr<FrameReader> reader = open_frame_reader(argv[2], input);
+    const VideoFormat& format = reader->format();
+    const std::unique_ptr<FrameWriter> writer = open_frame_writer(argv[3], format, raw_output, global.png);
+    std::cerr << "Video: " << format.width << "x" << format.height << " at " << format.fps_num / double(format.fps_den)
+              << " fps, chain '" << format_filter_chain(options.chain) << "', backend " << backend_name(options.backend)
+              << "\n";
+    if (progress)
+    {
+        options.progress = [](const VideoStats& stats) {
+            std::cerr << "  " << stats.frames_out << " frames, " << stats.fps << " fps, " << stats.dropped
+                      << " dropped\n";
+        };
+    }
+
+    const VideoStats stats = run_video(*reader, *writer, options);
+    const double source_fps = format.fps_num / double(format.fps_den);
+    std::cerr << "Processed " << stats.frames_out << " of " << stats.frames_in << " frames (" << stats.dropped
+              << " dropped) in " << stats.seconds << " s: " << stats.fps << " fps sustained, "
+              << (source_fps > 0.0 ? stats.fps / source_fps : 0.0) << "x the source rate\n";
+    std::cerr << "Stage busy time: decode " << stats.decode_seconds << " s, filter " << stats.filter_seconds
+              << " s, output " << stats.encode_seconds << " s\n";
+    return 0;
+}
+// --serve [<socket>|-] [options]
+int run_serve_command(int argc, char** argv, const GlobalOptions& global)
+{
+    std::string socket_path = "-";
+    int first_option = 2;
+    if (argc > 2 && std::strncmp(argv[2], "--", 2) != 0)
+    {
+        socket_path = argv[2];
+        first_option = 3;
+    }
+    // Over stdin, results go to stdout, so messages (including the reports at exit) go to stderr.
+    if (socket_path == "-") std::cout.rdbuf(std::cerr.rdbuf());
+
+    JobServerOptions options;
+    options.png = global.png;
+    options.backend = global.backend;
+    for (int i = first_option; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        if (arg == "--cpu")
+        {
+            options.backend = Backend::Cpu;
+            continue;
+        }
+        if (i + 1 >= argc)
+        {
+            std::cerr << "Unknown or incomplete server option: " << arg << "\n";
+            print_usage();
+            return 1;
+        }
+        const int value = std::stoi(argv[++i]);
+        if (arg == "--decoders")
+            options.decode_workers = value;
+        else if (arg == "--filters")
+            options.filter_workers = value;
+        else if (arg == "--encoders")
+            options.encode_workers = value;
+        else if (arg == "--queue")
+            options.queue_depth = static_cast<size_t>(std::max(value, 1));
+        else
+        {
+            std::cerr << "Unknown server option: " << arg << "\n";
+            print_usage();
+            return 1;
+        }
+    }
+
+    const std::unique_ptr<ResultCache> cache = make_cache(global);
+    options.cache = cache.get();
+    const auto start = std::chrono::steady_clock::now();
+    JobServer server(options);
+    std::cerr << "Job server ready on " << (socket_path == "-" ? "stdin" : socket_path) << " (backend "
+              << backend_name(options.backend) << ", warm-up "
+              << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count()
+              << " ms)\n";
+    if (socket_path == "-")
+        serve_json_lines(server, 0, 1);
+    else
+        serve_unix_socket(server, socket_path);
+    server.shutdown();
+
+    const JobServerStats stats = server.stats();
+    std::cerr << "Served " << stats.completed << " jobs (" << stats.failed << " failed), latency mean "
+              << stats.mean_total_ms << " ms, max " << stats.max_total_ms << " ms\n";
+    if (cache) print_cache_stats(*cache);
+    return 0;
+}
+
+// --submit <socket> [<input> <output> <chain>]; without a job, forwards the request lines on stdin.
+int run_submit_command(int argc, char** argv)
+{
+    if (argc != 3 && argc != 6)
+    {
+        print_usage();
+        return 1;
+    }
+    size_t failed = 0;
+    if (argc == 6)
+    {
+        JsonValue job = JsonValue::object();
+        job["input"] = argv[3];
+        job["output"] = argv[4];
+        job["chain"] = argv[5];
+        std::istringstream request(job.dump() + "\n");
+        failed = submit_job_lines(argv[2], request, std::cout);
+    }
+    else
+    {
+        failed = submit_job_lines(argv[2], std::cin, std::cout);
+    }
+    return failed == 0 ? 0 : 1;
 }
 } // namespace
 
 int main(int argc, char** argv)
 {
+    GlobalOptions global;
+    try
+    {
+        global = take_global_options(argc, argv);
+    }
+    catch (const std::exception& ex)
+    {
+        std::cerr << "Error: " << ex.what() << "\n";
+        return 1;
+    }
+    TraceExport trace_export{ global.trace_path };
+    PoolStatsReport pool_report{ global.pool_stats };
+    if (!global.trace_path.empty()) set_tracing_enabled(true);
+
+    if (argc >= 2 && std::strcmp(argv[1], "--backends") == 0) return run_backends_command();
+    if (argc >= 2 && (std::strcmp(argv[1], "--batch") == 0 || std::strcmp(argv[1], "--stream") == 0 ||
+                      std::strcmp(argv[1], "--video") == 0 || std::strcmp(argv[1], "--serve") == 0 ||
+                      std::strcmp(argv[1], "--submit") == 0 || std::strcmp(argv[1], "--autotune") == 0))
+    {
+        try
+        {
+            if (std::strcmp(argv[1], "--batch") == 0) return run_batch_command(argc, argv, global);
+            if (std::strcmp(argv[1], "--video") == 0) return run_video_command(argc, argv, global);
+            if (std::strcmp(argv[1], "--serve") == 0) return run_serve_command(argc, argv, global);
+            if (std::strcmp(argv[1], "--submit") == 0) return run_submit_command(argc, argv);
+            if (std::strcmp(argv[1], "--autotune") == 0) return run_autotune_command(argc, argv);
+            return run_stream_command(argc, argv, global);
+        }
+        catch (const std::exception& ex)
+        {
+            std::cerr << "Error: " << ex.what() << "\n";
+            return 1;
+        }
+    }
+
     if (argc < 4)
     {
         print_usage();
@@ -38,11 +691,49 @@ int main(int argc, char** argv)
         Image img = load_image(input_path);
         std::cout << "Loaded " << input_path << " (" << img.width << "x" << img.height << ")\n";
 
-        auto start = std::chrono::high_resolution_clock::now();
+        // `thumbnail` and `resize`, alone or leading a chain, produce a new frame first; the rest of
+        // the command (and --crop) then applies to that.
+        std::string spec = filter;
+        if (filter == "thumbnail" || filter == "resize")
+        {
+            if (argc != 5 && argc != 6)
+            {
+                std::cerr << filter << " requires " << (filter == "thumbnail" ? "<max_dim>" : "<width>x<height>")
+                          << " [box|bilinear|bicubic|lanczos3]\n";
+                print_usage();
+                return 1;
+            }
+            spec += std::string(":") + argv[4];
+            if (argc == 6) spec += std::string(":") + argv[5];
+        }
+        const ResizeSpec resize = take_resize_step(spec);
+        if (resize.active())
+        {
+            const auto start = std::chrono::high_resolution_clock::now();
+            apply_resize(img, resize);
+            const auto end = std::chrono::high_resolution_clock::now();
+            std::cout << "Resized to " << img.width << "x" << img.height << " (" << resize_filter_name(resize.filter)
+                      << ") in " << std::chrono::duration<double, std::milli>(end - start).count() << " ms\n";
+        }
+
+        const Rect crop = global.crop.expanded(0, img.width, img.height);
+        if (!global.crop.empty() && crop.empty()) throw std::invalid_argument("--crop lies outside the image");
 
-        if (filter == "grayscale")
+        // Every command becomes a chain run through the backend dispatcher; `sobel gray` is the one
+        // call with a different output and is dispatched on its own.
+        FilterChain chain;
+        bool sobel_gray = false;
+        if (resize.active() && spec.empty())
+        {
+            // resized only
+        }
+        else if (is_chain_spec(filter))
+        {
+            chain = parse_filter_chain(spec);
+        }
+        else if (filter == "grayscale")
         {
-            apply_grayscale(img);
+            chain = single_step(FilterKind::Grayscale);
         }
         else if (filter == "brightness")
         {
@@ -53,7 +744,7 @@ int main(int argc, char** argv)
                 return 1;
             }
             float delta = std::stof(argv[4]);
-            apply_brightness(img, delta);
+            chain = single_step(FilterKind::Brightness, { delta });
         }
         else if (filter == "contrast")
         {
@@ -64,15 +755,90 @@ int main(int argc, char** argv)
                 return 1;
             }
             float factor = std::stof(argv[4]);
-            apply_contrast(img, factor);
+            chain = single_step(FilterKind::Contrast, { factor });
+        }
+        else if (filter == "gamma")
+        {
+            if (argc < 5)
+            {
+                std::cerr << "gamma requires <gamma>\n";
+                print_usage();
+                return 1;
+            }
+            float gamma = std::stof(argv[4]);
+            chain = single_step(FilterKind::Gamma, { gamma });
+        }
+        else if (filter == "invert")
+        {
+            chain = single_step(FilterKind::Invert);
+        }
+        else if (filter == "levels")
+        {
+            if (argc != 6 && argc != 8)
+            {
+                std::cerr << "levels requires <in_black> <in_white> [<out_black> <out_white>]\n";
+                print_usage();
+                return 1;
+            }
+            float out_black = argc == 8 ? std::stof(argv[6]) : 0.0f;
+            float out_white = argc == 8 ? std::stof(argv[7]) : 255.0f;
+            chain = single_step(FilterKind::Levels, { std::stof(argv[4]), std::stof(argv[5]), out_black, out_white });
+        }
+        else if (filter == "threshold")
+        {
+            if (argc < 5)
+            {
+                std::cerr << "threshold requires <level>\n";
+                print_usage();
+                return 1;
+            }
+            float level = std::stof(argv[4]);
+            chain = single_step(FilterKind::Threshold, { level });
         }
         else if (filter == "blur")
         {
-            apply_box_blur(img);
+            int radius = argc >= 5 ? std::stoi(argv[4]) : 1;
+            chain = single_step(FilterKind::BoxBlur, { static_cast<float>(radius) });
+        }
+        else if (filter == "gaussian")
+        {
+            if (argc < 5)
+            {
+                std::cerr << "gaussian requires <sigma>\n";
+                print_usage();
+                return 1;
+            }
+            float sigma = std::stof(argv[4]);
+            chain = single_step(FilterKind::GaussianBlur, { sigma });
         }
         else if (filter == "sobel")
         {
-            apply_sobel(img);
+            sobel_gray = argc >= 5 && std::string(argv[4]) == "gray";
+            chain = single_step(FilterKind::Sobel);
+        }
+        else if (filter == "canny")
+        {
+            if (argc != 4 && argc != 6)
+            {
+                std::cerr << "canny takes no parameters or <low> <high>\n";
+                print_usage();
+                return 1;
+            }
+            float low = argc == 6 ? std::stof(argv[4]) : 50.0f;
+            float high = argc == 6 ? std::stof(argv[5]) : 100.0f;
+            chain = single_step(FilterKind::Canny, { low, high });
+        }
+        else if (filter == "sharpen" || filter == "laplacian" || filter == "emboss" || filter == "gaussian5")
+        {
+            std::string spec = filter;
+            for (int i = 4; i < argc; ++i) spec += std::string(":") + argv[i];
+            chain = parse_filter_chain(spec);
+        }
+        else if (filter == "autolevels" || filter == "equalize")
+        {
+            std::string spec = filter;
+            for (int i = 4; i < argc; ++i) spec += std::string(":") + argv[i];
+            chain = parse_filter_chain(spec);
         }
         else
         {
@@ -81,12 +847,71 @@ int main(int argc, char** argv)
             return 1;
         }
 
+        if (global.calibrate && !chain.empty()) calibrate_for(chain);
+        auto start = std::chrono::high_resolution_clock::now();
+        Backend used = Backend::Cpu;
+        size_t cached_steps = 0;
+        const std::unique_ptr<ResultCache> cache = make_cache(global);
+        if (sobel_gray)
+        {
+            if (crop.empty())
+            {
+                img = run_sobel_magnitude(img, nullptr, global.backend, &used);
+            }
+            else
+            {
+                // Only the crop and the one pixel of context each side that Sobel reads.
+                const Rect context = region_context(chain, crop, img.width, img.height);
+                Image work = to_image(ConstImageView(img).crop(context));
+                img = crop_from_context(run_sobel_magnitude(work, nullptr, global.backend, &used), context, crop);
+            }
+        }
+        else if (chain.empty())
+        {
+            // resized only
+            if (!crop.empty()) img = to_image(ImageView(img).crop(crop));
+        }
+        else if (cache)
+        {
+            // A crop is served by filtering the context it depends on, which is then what the
+            // cache is keyed on.
+            const Rect context = crop.empty() ? Rect{ 0, 0, img.width, img.height }
+                                              : region_context(chain, crop, img.width, img.height);
+            if (!crop.empty()) img = to_image(ConstImageView(img).crop(context));
+            const CachedRun run = cache->run(img, chain, global.backend);
+            used = run.backend;
+            cached_steps = run.cached_steps;
+            if (!crop.empty()) img = crop_from_context(img, context, crop);
+        }
+        else if (!crop.empty())
+        {
+            img = run_pipeline_region(img, chain, crop, global.backend, &used);
+        }
+        else
+        {
+            used = run_pipeline(img, chain, global.backend);
+        }
         auto end = std::chrono::high_resolution_clock::now();
         double ms = std::chrono::duration<double, std::milli>(end - start).count();
-        std::cout << "Filter '" << filter << "' done in " << ms << " ms\n";
+        if (!chain.empty() || sobel_gray)
+        {
+            std::cout << "Filter '" << filter << "' done in " << ms << " ms";
+            if (cache && !chain.empty() && cached_steps == chain.size())
+                std::cout << " from the cache\n";
+            else if (cached_steps > 0)
+                std::cout << " on " << backend_name(used) << " (" << cached_steps << " of " << chain.size()
+                          << " steps from the cache)\n";
+            else
+                std::cout << " on " << backend_name(used) << "\n";
+        }
+
+        if (global.stats) print_stats(img, global.backend);
 
-        save_image(output_path, img);
-        std::cout << "Saved result to " << output_path << "\n";
+        start = std::chrono::high_resolution_clock::now();
+        save_image(output_path, img, global.png);
+        end = std::chrono::high_resolution_clock::now();
+        ms = std::chrono::duration<double, std::milli>(end - start).count();
+        std::cout << "Saved result to " << output_path << " in " << ms << " ms\n";
     }
     catch (const std::exception& ex)
     {
@@ -0,0 +1,341 @@
+// src/core/backend.cpp
+#include "backend.h"
+
+#include "filters_cpu.h"
+#include "filters_cuda.h"
+#include "histogram.h"
+#include "thread_pool.h"
+#include "trace.h"
+#include "tuning.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <limits>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+
+namespace
+{
+struct CudaState
+{
+    std::once_flag probed;
+    std::atomic<bool> available{ false };
+    std::mutex mutex;
+    std::string description; // guarded by mutex
+};
+
+CudaState& cuda_state()
+{
+    static CudaState state;
+    std::call_once(state.probed, [] {
+        std::string description;
+        const bool ok = probe_cuda_device(&description);
+        std::lock_guard<std::mutex> lock(state.mutex);
+        state.description = description;
+        state.available = ok;
+    });
+    return state;
+}
+
+void disable_cuda(const std::string& reason)
+{
+    CudaState& state = cuda_state();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    state.available = false;
+    state.description = "disabled after error: " + reason;
+}
+
+std::atomic<uint64_t> g_parallel_min_pixels{ RoutingThresholds{}.parallel_min_pixels };
+std::atomic<uint64_t> g_cuda_min_pixels{ RoutingThresholds{}.cuda_min_pixels };
+
+// Runs `gpu` on CUDA, or `cpu` on the CPU (inside a SerialScope for CpuSerial). A CudaError disables
+// CUDA and falls through to the CPU pool.
+template <typename Gpu, typename Cpu>
+Backend dispatch(Backend backend, Gpu gpu, Cpu cpu)
+{
+    if (backend == Backend::Cuda)
+    {
+        try
+        {
+            gpu();
+            return Backend::Cuda;
+        }
+        catch (const CudaError& ex)
+        {
+            disable_cuda(ex.what());
+            backend = Backend::Cpu;
+        }
+    }
+    if (backend == Backend::CpuSerial)
+    {
+        SerialScope serial;
+        cpu();
+        return Backend::CpuSerial;
+    }
+    cpu();
+    return Backend::Cpu;
+}
+
+// Best of a few runs, each on a fresh copy of `frame`; the first call warms caches and allocators.
+double time_backend(Backend backend, const Image& frame, const FilterChain& chain)
+{
+    using Clock = std::chrono::steady_clock;
+    Image work = frame;
+    run_pipeline(work, chain, backend);
+    double best = std::numeric_limits<double>::max();
+    for (int i = 0; i < 3; ++i)
+    {
+        work.pixels.assign(frame.pixels.begin(), frame.pixels.end());
+        const Clock::time_point start = Clock::now();
+        run_pipeline(work, chain, backend);
+        best = std::min(best, std::chrono::duration<double>(Clock::now() - start).count());
+    }
+    return best;
+}
+} // namespace
+
+const char* backend_name(Backend backend)
+{
+    switch (backend)
+    {
+    case Backend::Auto: return "auto";
+    case Backend::Cuda: return "cuda";
+    case Backend::Cpu: return "cpu";
+    case Backend::CpuSerial: return "cpu-serial";
+    }
+    return "unknown";
+}
+
+Backend parse_backend(const std::string& name)
+{
+    for (Backend backend : { Backend::Auto, Backend::Cuda, Backend::Cpu, Backend::CpuSerial })
+    {
+        if (name == backend_name(backend)) return backend;
+    }
+    throw std::invalid_argument("Unknown backend: " + name + " (expected auto, cuda, cpu or cpu-serial)");
+}
+
+std::vector<BackendInfo> backend_registry()
+{
+    std::vector<BackendInfo> registry;
+    CudaState& cuda = cuda_state();
+    {
+        std::lock_guard<std::mutex> lock(cuda.mutex);
+        registry.push_back({ Backend::Cuda, cuda.available.load(), cuda.description });
+    }
+    registry.push_back({ Backend::Cpu, true, std::to_string(cpu_thread_count()) + " threads" });
+    registry.push_back({ Backend::CpuSerial, true, "calling thread" });
+    return registry;
+}
+
+bool backend_available(Backend backend)
+{
+    if (backend == Backend::Cuda) return cuda_state().available.load();
+    return true;
+}
+
+RoutingThresholds routing_thresholds()
+{
+    RoutingThresholds thresholds;
+    thresholds.parallel_min_pixels = g_parallel_min_pixels.load();
+    thresholds.cuda_min_pixels = g_cuda_min_pixels.load();
+    return thresholds;
+}
+
+void set_routing_thresholds(const RoutingThresholds& thresholds)
+{
+    g_parallel_min_pixels = thresholds.parallel_min_pixels;
+    g_cuda_min_pixels = thresholds.cuda_min_pixels;
+}
+
+Image noise_frame(int side)
+{
+    Image img = allocate_image(side, side, 3);
+    const ImageView view(img);
+    std::mt19937 rng(side);
+    for (int y = 0; y < side; ++y)
+    {
+        uint8_t* row = view.row(y);
+        for (size_t i = 0; i < view.row_bytes(); ++i) row[i] = static_cast<uint8_t>(rng());
+    }
+    return img;
+}
+
+RoutingThresholds calibrate_routing(const FilterChain& chain)
+{
+    constexpr uint64_t kNever = std::numeric_limits<uint64_t>::max();
+    constexpr double kMaxRunSeconds = 0.05; // stop growing once the fastest backend takes this long
+    const bool cuda = backend_available(Backend::Cuda);
+    // Traced kernels wait for the GPU after every launch, which would skew the comparison.
+    TraceSpan span("calibrate", "filter");
+    const bool tracing = tracing_enabled();
+    set_tracing_enabled(false);
+
+    struct Sample
+    {
+        uint64_t pixels;
+        double serial, pool, gpu;
+    };
+    std::vector<Sample> samples;
+    for (int side = 32; side <= 2048; side *= 2)
+    {
+        const Image frame = noise_frame(side);
+        Sample s{ static_cast<uint64_t>(side) * side, 0.0, 0.0, 0.0 };
+        s.serial = time_backend(Backend::CpuSerial, frame, chain);
+        s.pool = time_backend(Backend::Cpu, frame, chain);
+        s.gpu = cuda ? time_backend(Backend::Cuda, frame, chain) : std::numeric_limits<double>::max();
+        samples.push_back(s);
+        if (std::min({ s.serial, s.pool, s.gpu }) > kMaxRunSeconds) break;
+    }
+    set_tracing_enabled(tracing);
+
+    // A crossover is the smallest size from which the faster backend keeps winning at every larger
+    // size, so one noisy sample near the boundary cannot move it far.
+    RoutingThresholds thresholds{ kNever, kNever };
+    for (auto it = samples.rbegin(); it != samples.rend() && it->pool < it->serial; ++it)
+    {
+        thresholds.parallel_min_pixels = it->pixels;
+    }
+    for (auto it = samples.rbegin(); it != samples.rend() && it->gpu < std::min(it->serial, it->pool); ++it)
+    {
+        thresholds.cuda_min_pixels = it->pixels;
+    }
+    return thresholds;
+}
+
+Backend resolve_backend(Backend requested, const ImageView& img)
+{
+    if (requested == Backend::Cuda) return backend_available(Backend::Cuda) ? Backend::Cuda : Backend::Cpu;
+    if (requested != Backend::Auto) return requested;
+
+    const uint64_t pixels = static_cast<uint64_t>(std::max(img.width, 0)) * std::max(img.height, 0);
+    if (pixels >= g_cuda_min_pixels.load() && backend_available(Backend::Cuda)) return Backend::Cuda;
+    return pixels >= g_parallel_min_pixels.load() ? Backend::Cpu : Backend::CpuSerial;
+}
+
+Backend run_pipeline(ImageView img, const FilterChain& chain, Backend requested)
+{
+    interleaved_layout(img.channels); // every filter handles gray, RGB and RGBA natively; reject the rest
+    TraceSpan span("pipeline", "filter");
+    const TuneScope tuning(chain, img.width, img.height);
+    const Backend used = dispatch(
+        resolve_backend(requested, img), [&] { apply_pipeline(img, chain); }, [&] { cpu_pipeline(img, chain); });
+    if (span.active())
+    {
+        span.set_detail(format_filter_chain(chain) + " on " + backend_name(used) + ", " + std::to_string(img.width) +
+                        "x" + std::to_string(img.height));
+    }
+    return used;
+}
+
+Image run_sobel_magnitude(ImageView img, std::vector<uint8_t>* direction, Backend requested, Backend* used)
+{
+    Image magnitude;
+    const Backend backend = dispatch(
+        resolve_backend(requested, img), [&] { magnitude = apply_sobel_magnitude(img, direction); },
+        [&] { magnitude = cpu_sobel_magnitude(img, direction); });
+    if (used) *used = backend;
+    return magnitude;
+}
+
+Histogram compute_histogram(const ImageView& img, Backend requested, Backend* used)
+{
+    interleaved_layout(img.channels);
+    Histogram hist;
+    const Backend backend = dispatch(
+        resolve_backend(requested, img), [&] { hist = apply_histogram(img); }, [&] { hist = cpu_histogram(img); });
+    if (used) *used = backend;
+    return hist;
+}
+
+Rect region_context(const FilterChain& chain, const Rect& roi, int width, int height)
+{
+    bool global = false;
+    int halo = 0;
+    for (const FilterStep& step : chain)
+    {
+        global |= is_global_op(step);
+        halo += filter_halo(step);
+    }
+    // Border sampling at the frame edges matches the full-frame run, and artifacts at the inner edges
+    // reach at most `halo` pixels in, so never into the ROI.
+    return global ? Rect{ 0, 0, width, height } : roi.expanded(0, width, height).expanded(halo, width, height);
+}
+
+Image run_pipeline_region(const ConstImageView& src, const FilterChain& chain, const Rect& roi, Backend requested,
+                          Backend* used)
+{
+    const Rect area = roi.expanded(0, src.width, src.height);
+    if (area.empty()) return allocate_image(0, 0, src.channels);
+
+    const Rect context = region_context(chain, area, src.width, src.height);
+    Image work;
+    {
+        TraceSpan span("roi copy", "copy");
+        work = allocate_image(context.width(), context.height(), src.channels);
+        convert_pixels(src.crop(context), work);
+    }
+    const Backend backend = run_pipeline(work, chain, requested);
+    if (used) *used = backend;
+    if (context.x0 == area.x0 && context.y0 == area.y0 && context.x1 == area.x1 && context.y1 == area.y1) return work;
+    TraceSpan span("roi copy", "copy");
+    return to_image(ImageView(work).crop(area.x0 - context.x0, area.y0 - context.y0, area.x1 - context.x0,
+                                         area.y1 - context.y0));
+}
+
+Backend run_pipeline(ImageView img, const FilterChain& chain, const Rect& roi, Backend requested)
+{
+    const Rect area = roi.expanded(0, img.width, img.height);
+    if (area.empty()) return resolve_backend(requested, img);
+    const bool point_only =
+        std::all_of(chain.begin(), chain.end(), [](const FilterStep& s) { return is_point_op(s.kind); });
+    if (point_only) return run_pipeline(img.crop(area), chain, requested);
+
+    Backend used = Backend::Cpu;
+    Image region = run_pipeline_region(img, chain, area, requested, &used);
+    TraceSpan span("roi copy", "copy");
+    convert_pixels(region, img.crop(area));
+    return used;
+}
+
+Backend run_pipeline(PlanarImage& img, const FilterChain& chain, Backend requested)
+{
+    interleaved_layout(img.channels);
+    Backend used = resolve_backend(requested, ImageView(nullptr, img.width, img.height, img.stride, 1));
+    for (size_t i = 0; i < chain.size();)
+    {
+        // Maximal run of steps that agree on whether they can work plane by plane.
+        const bool planar = (filter_layouts(chain[i].kind) & kLayoutPlanar) != 0;
+        size_t j = i + 1;
+        while (j < chain.size() && ((filter_layouts(chain[j].kind) & kLayoutPlanar) != 0) == planar) ++j;
+        const FilterChain part(chain.begin() + i, chain.begin() + j);
+        i = j;
+
+        if (!planar)
+        {
+            Image pixels = allocate_image(img.width, img.height, img.channels);
+            {
+                TraceSpan span("interleave", "copy");
+                from_planar(img, pixels);
+            }
+            used = run_pipeline(pixels, part, requested);
+            TraceSpan span("deinterleave", "copy");
+            img = to_planar(pixels);
+            continue;
+        }
+        if (std::all_of(part.begin(), part.end(), [](const FilterStep& s) { return is_point_op(s.kind); }))
+        {
+            // Planes are stacked at one stride, so point ops see them as one tall gray image.
+            used = run_pipeline(ImageView(img.pixels.data(), img.width, img.height * img.channels, img.stride, 1), part,
+                                requested);
+            continue;
+        }
+        for (int c = 0; c < img.channels; ++c)
+        {
+            used = run_pipeline(img.plane(c), part, requested);
+        }
+    }
+    return used;
+}
@@ -0,0 +1,87 @@
+// src/core/backend.h
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "filter_chain.h"
+#include "image.h"
+
+// One filter entry point over interchangeable implementations of the same filters. All backends
+// produce bit-identical output, so picking one is purely a matter of speed and availability.
+enum class Backend
+{
+    Auto,      // by image size, see RoutingThresholds
+    Cuda,      // apply_* (filters_cuda.h)
+    Cpu,       // cpu_* spread over the shared thread pool (filters_cpu.h)
+    CpuSerial, // cpu_* on the calling thread only, skipping the pool hand-off for small frames
+};
+
+const char* backend_name(Backend backend);       // "auto", "cuda", "cpu", "cpu-serial"
+Backend parse_backend(const std::string& name);  // throws std::invalid_argument
+
+struct BackendInfo
+{
+    Backend backend = Backend::Cpu;
+    bool available = false;
+    std::string description; // device, thread count, or why the backend cannot be used
+};
+
+// The concrete backends, fastest for large frames first. CUDA is probed once, on first use, with
+// calls that report errors rather than throw, so a node without a driver or device lists it as
+// unavailable. A CUDA backend that fails later on is disabled for the rest of the process.
+std::vector<BackendInfo> backend_registry();
+bool backend_available(Backend backend);
+
+// Crossover points for Backend::Auto, in pixels (width * height): frames below parallel_min_pixels
+// stay on the calling thread, frames of at least cuda_min_pixels go to the GPU when there is one,
+// everything else runs on the CPU pool.
+struct RoutingThresholds
+{
+    uint64_t parallel_min_pixels = 128 * 128;
+    uint64_t cuda_min_pixels = 1024 * 1024;
+};
+RoutingThresholds routing_thresholds();
+void set_routing_thresholds(const RoutingThresholds& thresholds);
+
+// Times each available backend running `chain` on synthetic frames of growing size and returns the
+// sizes from which the pool beats the calling thread and the GPU beats both (UINT64_MAX where that
+// never happens). Takes a second or two; pass the result to set_routing_thresholds().
+RoutingThresholds calibrate_routing(const FilterChain& chain);
+// The synthetic frame of calibrate_routing() and autotune() (tuning.h): side x side RGB noise in
+// allocate_image() rows, the same bytes on every call for a given side.
+Image noise_frame(int side);
+
+// Backend a call with `requested` would run on for this frame: Auto applies the thresholds, and an
+// unavailable CUDA backend degrades to the CPU pool.
+Backend resolve_backend(Backend requested, const ImageView& img);
+
+// Filter through the resolved backend and return the one that did the work. When a CUDA call throws
+// CudaError, CUDA is disabled and the call repeated on the CPU; the GPU path writes to img only in
+// its final download, so the input is still intact for the retry. Under a CancelScope (thread_pool.h)
+// both paths stop at the next chunk or step once the flag is set and throw Cancelled, leaving img
+// partly filtered on the CPU path. Throws std::invalid_argument for other than 1, 3 or 4 channels.
+Backend run_pipeline(ImageView img, const FilterChain& chain, Backend requested = Backend::Auto);
+// Filters only `roi` (clipped to the frame) and leaves the pixels around it as they are; the result
+// inside the ROI is the same as a full-frame run. Point-op chains run on the ROI in place. Otherwise
+// the ROI grown by the chain's total halo is copied out, filtered, and its inner part written back,
+// so the work scales with the ROI; chains with a global op (Canny, autolevels, equalize) filter a
+// copy of the whole frame, since any pixel can affect the ROI.
+Backend run_pipeline(ImageView img, const FilterChain& chain, const Rect& roi, Backend requested = Backend::Auto);
+// Part of a width x height frame that a chain run on it must see for `roi` (clipped to the frame) to
+// come out as in a full-frame run: the ROI grown by the chain's total halo, or the whole frame when a
+// step is global.
+Rect region_context(const FilterChain& chain, const Rect& roi, int width, int height);
+// The same without touching src: returns just the filtered ROI, packed (empty if roi misses the frame).
+Image run_pipeline_region(const ConstImageView& src, const FilterChain& chain, const Rect& roi,
+                          Backend requested = Backend::Auto, Backend* used = nullptr);
+
+// Same for a planar image: channel-wise steps (kLayoutPlanar, see filter_chain.h) run on each plane
+// as a gray image, and only the steps that need whole pixels see an interleaved copy.
+Backend run_pipeline(PlanarImage& img, const FilterChain& chain, Backend requested = Backend::Auto);
+Image run_sobel_magnitude(ImageView img, std::vector<uint8_t>* direction = nullptr,
+                          Backend requested = Backend::Auto, Backend* used = nullptr);
+// Histogram of the colour channels (histogram.h; histogram_stats() turns it into min/max/mean/...).
+struct Histogram;
+Histogram compute_histogram(const ImageView& img, Backend requested = Backend::Auto, Backend* used = nullptr);
@@ -0,0 +1,210 @@
+// src/core/batch.cpp
+#include "batch.h"
+
+#include "bounded_queue.h"
+#include "codecs.h"
+#include "image.h"
+#include "pipeline_stages.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+bool has_image_extension(const fs::path& path)
+{
+    const std::string ext = lower_extension(path.string());
+    for (const char* known : { ".png", ".jpg", ".jpeg", ".bmp", ".tga", ".ppm", ".pgm", ".pnm", ".pam", ".qoi" })
+    {
+        if (ext == known) return true;
+    }
+    return false;
+}
+
+std::string trim(const std::string& s)
+{
+    const size_t begin = s.find_first_not_of(" \t\r\n");
+    if (begin == std::string::npos) return {};
+    const size_t end = s.find_last_not_of(" \t\r\n");
+    return s.substr(begin, end - begin + 1);
+}
+
+// <output_dir>/<stem><extension>, with _1, _2, ... appended when the stem is already taken, whether
+// by another input's stem or by a name generated earlier (a.png, a.jpg, a_1.png -> a, a_1, a_1_1).
+std::vector<std::string> output_paths(const std::vector<std::string>& inputs, const std::string& output_dir,
+                                      const std::string& extension)
+{
+    std::vector<std::string> outputs;
+    outputs.reserve(inputs.size());
+    std::set<std::string> used;
+    std::map<std::string, int> next_suffix;
+    for (const std::string& input : inputs)
+    {
+        const std::string stem = fs::path(input).stem().string();
+        std::string name = stem;
+        while (!used.insert(name).second)
+        {
+            name = stem + "_" + std::to_string(++next_suffix[stem]);
+        }
+        outputs.push_back((fs::path(output_dir) / (name + extension)).string());
+    }
+    return outputs;
+}
+
+struct BatchJob
+{
+    size_t index = 0;
+    Image image;
+};
+
+using Clock = std::chrono::steady_clock;
+
+double seconds_since(Clock::time_point start)
+{
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+} // namespace
+
+std::vector<std::string> collect_batch_inputs(const std::string& source)
+{
+    std::vector<std::string> inputs;
+    const fs::path root(source);
+    if (fs::is_directory(root))
+    {
+        for (const fs::directory_entry& entry : fs::directory_iterator(root))
+        {
+            if (entry.is_regular_file() && has_image_extension(entry.path())) inputs.push_back(entry.path().string());
+        }
+        std::sort(inputs.begin(), inputs.end());
+        return inputs;
+    }
+
+    std::ifstream manifest(source);
+    if (!manifest)
+    {
+        throw std::runtime_error("Batch source is neither a directory nor a readable manifest: " + source);
+    }
+    std::string line;
+    while (std::getline(manifest, line))
+    {
+        line = trim(line);
+        if (line.empty() || line[0] == '#') continue;
+        fs::path path(line);
+        if (path.is_relative()) path = root.parent_path() / path;
+        inputs.push_back(path.string());
+    }
+    return inputs;
+}
+
+BatchStats run_batch(const std::vector<std::string>& inputs, const BatchOptions& options)
+{
+    BatchStats stats;
+    const Clock::time_point start = Clock::now();
+    if (inputs.empty()) return stats;
+    fs::create_directories(options.output_dir);
+
+    const std::vector<std::string> outputs = output_paths(inputs, options.output_dir, options.extension);
+    const int decoders = options.decode_workers > 0 ? options.decode_workers : half_hardware_threads();
+    const int encoders = options.encode_workers > 0 ? options.encode_workers : half_hardware_threads();
+    int filters = options.filter_workers;
+    const bool may_use_cuda = options.backend != Backend::Cpu && options.backend != Backend::CpuSerial &&
+                              backend_available(Backend::Cuda);
+    if (filters <= 0) filters = may_use_cuda ? 1 : std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+
+    BoundedQueue<BatchJob> decoded(options.queue_depth);
+    BoundedQueue<BatchJob> filtered(options.queue_depth);
+    std::atomic<size_t> next_input{ 0 };
+
+    std::mutex stats_mutex;
+    auto fail = [&](size_t index, const std::exception& ex) {
+        std::lock_guard<std::mutex> lock(stats_mutex);
+        ++stats.failed;
+        stats.errors.push_back(inputs[index] + ": " + ex.what());
+    };
+    auto add_busy = [&](double& total, double seconds) {
+        std::lock_guard<std::mutex> lock(stats_mutex);
+        total += seconds;
+    };
+
+    std::vector<std::thread> threads;
+    start_stage(threads, decoders, [&] {
+        for (size_t i = next_input++; i < inputs.size(); i = next_input++)
+        {
+            const Clock::time_point t = Clock::now();
+            BatchJob job{ i, {} };
+            try
+            {
+                job.image = load_image(inputs[i]);
+            }
+            catch (const std::exception& ex)
+            {
+                fail(i, ex);
+                continue;
+            }
+            add_busy(stats.decode_seconds, seconds_since(t));
+            if (!decoded.push(std::move(job))) return;
+        }
+    }, [&] { decoded.close(); });
+
+    start_stage(threads, filters, [&] {
+        BatchJob job;
+        while (decoded.pop(job))
+        {
+            const Clock::time_point t = Clock::now();
+            try
+            {
+                apply_resize(job.image, options.resize);
+                if (options.cache && !options.chain.empty())
+                    options.cache->run(job.image, options.chain, options.backend);
+                else if (!options.chain.empty())
+                    run_pipeline(job.image, options.chain, options.backend);
+            }
+            catch (const std::exception& ex)
+            {
+                fail(job.index, ex);
+                continue;
+            }
+            add_busy(stats.filter_seconds, seconds_since(t));
+            if (!filtered.push(std::move(job))) return;
+        }
+    }, [&] { filtered.close(); });
+
+    start_stage(threads, encoders, [&] {
+        BatchJob job;
+        while (filtered.pop(job))
+        {
+            const Clock::time_point t = Clock::now();
+            try
+            {
+                save_image(outputs[job.index], job.image, options.png);
+            }
+            catch (const std::exception& ex)
+            {
+                fail(job.index, ex);
+                continue;
+            }
+            std::lock_guard<std::mutex> lock(stats_mutex);
+            stats.encode_seconds += seconds_since(t);
+            ++stats.images;
+            stats.pixels += static_cast<uint64_t>(job.image.width) * job.image.height;
+        }
+    }, [] {});
+
+    for (std::thread& t : threads)
+    {
+        t.join();
+    }
+    stats.seconds = seconds_since(start);
+    return stats;
+}
@@ -0,0 +1,53 @@
+// src/core/batch.h
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "backend.h"
+#include "filter_chain.h"
+#include "image.h"
+#include "resize.h"
+#include "result_cache.h"
+
+// Batch processing: decode, filter and encode run as separate stages, each with its own worker
+// threads, connected by bounded queues. While one image is being filtered the next ones are already
+// decoding and the previous ones encoding, and at most queue_depth images wait between two stages.
+struct BatchOptions
+{
+    std::string output_dir;       // created if missing; outputs are <output_dir>/<input stem><extension>
+    std::string extension = ".png"; // output format, as picked by save_image()
+    PngOptions png;
+    ResizeSpec resize;            // optional, applied in the filter stage before the chain (resize.h)
+    FilterChain chain;            // may be empty when the batch only resizes
+    Backend backend = Backend::Auto; // run_pipeline() routing for each image
+    int decode_workers = 0;       // <= 0: half the hardware threads
+    int filter_workers = 1;       // <= 0: 1 if CUDA may be used, otherwise the hardware threads
+    int encode_workers = 0;       // <= 0: half the hardware threads
+    size_t queue_depth = 4;       // images waiting between two stages
+    ResultCache* cache = nullptr; // optional: filter through ResultCache::run() (result_cache.h)
+};
+
+struct BatchStats
+{
+    size_t images = 0;            // written successfully
+    size_t failed = 0;
+    uint64_t pixels = 0;          // of the images written
+    double seconds = 0.0;         // wall clock for the whole run
+    double decode_seconds = 0.0;  // busy time summed over each stage's workers
+    double filter_seconds = 0.0;
+    double encode_seconds = 0.0;
+    std::vector<std::string> errors; // "<path>: <message>" per failed image
+};
+
+// Inputs for `source`: every .png/.jpg/.jpeg/.bmp/.tga/.ppm/.pgm/.pnm/.pam/.qoi file in a directory
+// (sorted, not recursive), or the lines of a manifest file (one path per line; blank lines and '#'
+// comments are skipped, relative paths resolve against the manifest's directory). Throws
+// std::runtime_error.
+std::vector<std::string> collect_batch_inputs(const std::string& source);
+
+// Processes `inputs` as described above. Per-image failures are collected in the stats rather than
+// thrown, so one bad file does not stop the run.
+BatchStats run_batch(const std::vector<std::string>& inputs, const BatchOptions& options);
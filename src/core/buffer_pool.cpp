@@ -0,0 +1,204 @@
+// src/core/buffer_pool.cpp
+#include "buffer_pool.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+#include <stdexcept>
+#include <utility>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+namespace
+{
+constexpr size_t kMinClass = 4096;
+constexpr size_t kHostAlignment = 64;
+constexpr size_t kHugePage = size_t(2) << 20;
+
+void* host_allocate(size_t bytes, bool huge_pages)
+{
+    if (huge_pages && bytes >= kHugePage)
+    {
+        void* data = std::aligned_alloc(kHugePage, (bytes + kHugePage - 1) / kHugePage * kHugePage);
+        if (!data) throw std::bad_alloc();
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+        madvise(data, bytes, MADV_HUGEPAGE); // a hint; ignored where THP is disabled
+#endif
+        return data;
+    }
+    void* data = std::aligned_alloc(kHostAlignment, (bytes + kHostAlignment - 1) / kHostAlignment * kHostAlignment);
+    if (!data) throw std::bad_alloc();
+    return data;
+}
+
+void host_release(void* data, size_t)
+{
+    std::free(data);
+}
+} // namespace
+
+ScratchBuffer::ScratchBuffer(ScratchBuffer&& other) noexcept
+    : pool_(std::exchange(other.pool_, nullptr)), data_(std::exchange(other.data_, nullptr)),
+      size_(std::exchange(other.size_, 0))
+{
+}
+
+ScratchBuffer& ScratchBuffer::operator=(ScratchBuffer&& other) noexcept
+{
+    if (this != &other)
+    {
+        if (data_) pool_->release(data_);
+        pool_ = std::exchange(other.pool_, nullptr);
+        data_ = std::exchange(other.data_, nullptr);
+        size_ = std::exchange(other.size_, 0);
+    }
+    return *this;
+}
+
+ScratchBuffer::~ScratchBuffer()
+{
+    if (data_) pool_->release(data_);
+}
+
+BufferPool::BufferPool(Allocator allocator, BufferPoolOptions options) : allocator_(allocator), options_(options)
+{
+}
+
+BufferPool::~BufferPool()
+{
+    trim();
+}
+
+size_t BufferPool::size_class(size_t bytes)
+{
+    if (bytes <= kMinClass) return kMinClass;
+    // Quarter steps of the largest power of two below `bytes`.
+    size_t base = kMinClass;
+    while (base * 2 < bytes) base *= 2;
+    const size_t step = base / 4;
+    return (bytes + step - 1) / step * step;
+}
+
+void* BufferPool::acquire(size_t bytes, size_t* capacity)
+{
+    const size_t size = size_class(bytes);
+    if (capacity) *capacity = size;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = free_.find(size);
+        if (it != free_.end() && !it->second.empty())
+        {
+            void* data = it->second.back();
+            it->second.pop_back();
+            outstanding_.emplace(data, size);
+            ++stats_.hits;
+            stats_.cached -= size;
+            stats_.in_use += size;
+            return data;
+        }
+        ++stats_.misses;
+    }
+
+    void* data = nullptr;
+    {
+        TraceSpan span("pool allocate", "alloc");
+        const bool huge_pages = options().huge_pages;
+        try
+        {
+            data = allocator_.allocate(size, huge_pages);
+        }
+        catch (...)
+        {
+            // Out of memory with buffers of other classes cached: give those back and retry once.
+            if (stats().cached == 0) throw;
+            trim();
+            data = allocator_.allocate(size, huge_pages);
+        }
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    outstanding_.emplace(data, size);
+    stats_.in_use += size;
+    stats_.peak_bytes = std::max(stats_.peak_bytes, stats_.in_use + stats_.cached);
+    return data;
+}
+
+void BufferPool::release(void* data)
+{
+    size_t size = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = outstanding_.find(data);
+        if (it == outstanding_.end()) throw std::invalid_argument("BufferPool::release: buffer not from this pool");
+        size = it->second;
+        outstanding_.erase(it);
+        stats_.in_use -= size;
+        if (stats_.cached + size <= options_.cache_bytes)
+        {
+            free_[size].push_back(data);
+            stats_.cached += size;
+            return;
+        }
+    }
+    allocator_.release(data, size);
+}
+
+ScratchBuffer BufferPool::scratch(size_t bytes)
+{
+    return ScratchBuffer(this, acquire(bytes), bytes);
+}
+
+void BufferPool::trim()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    trim_to(0);
+}
+
+void BufferPool::trim_to(size_t budget)
+{
+    // Largest classes first: they hold the most memory per entry.
+    std::vector<size_t> sizes;
+    for (const auto& [size, buffers] : free_)
+    {
+        if (!buffers.empty()) sizes.push_back(size);
+    }
+    std::sort(sizes.rbegin(), sizes.rend());
+    for (size_t size : sizes)
+    {
+        std::vector<void*>& buffers = free_[size];
+        while (!buffers.empty() && stats_.cached > budget)
+        {
+            allocator_.release(buffers.back(), size);
+            buffers.pop_back();
+            stats_.cached -= size;
+        }
+    }
+}
+
+void BufferPool::set_options(const BufferPoolOptions& options)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    options_ = options;
+    trim_to(options_.cache_bytes);
+}
+
+BufferPoolOptions BufferPool::options() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return options_;
+}
+
+BufferPoolStats BufferPool::stats() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+BufferPool& host_buffer_pool()
+{
+    // Never destroyed: pixel buffers in static objects may be released after main() returns.
+    static BufferPool* pool = new BufferPool({ host_allocate, host_release });
+    return *pool;
+}
@@ -0,0 +1,101 @@
+// src/core/buffer_pool.h
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+struct BufferPoolStats
+{
+    uint64_t hits = 0;     // acquisitions served from a cached buffer
+    uint64_t misses = 0;   // acquisitions that had to allocate
+    size_t in_use = 0;     // bytes handed out and not yet released
+    size_t cached = 0;     // bytes of released buffers held for reuse
+    size_t peak_bytes = 0; // highest in_use + cached so far, i.e. the pool's peak footprint
+};
+
+struct BufferPoolOptions
+{
+    size_t cache_bytes = size_t(512) << 20; // released buffers beyond this are freed; 0 caches nothing
+    bool huge_pages = false;                // host: back buffers of 2 MiB and up with transparent huge pages
+};
+
+class BufferPool;
+
+// A pooled buffer, returned to its pool when the handle is destroyed. Contents are not initialized:
+// scratch space is always written before it is read, so the pool never pays for a zero fill.
+class ScratchBuffer
+{
+public:
+    ScratchBuffer() = default;
+    ScratchBuffer(ScratchBuffer&& other) noexcept;
+    ScratchBuffer& operator=(ScratchBuffer&& other) noexcept;
+    ~ScratchBuffer();
+
+    template <typename T = uint8_t>
+    T* data() const
+    {
+        return static_cast<T*>(data_);
+    }
+    size_t size() const { return size_; }
+
+private:
+    friend class BufferPool;
+    ScratchBuffer(BufferPool* pool, void* data, size_t size) : pool_(pool), data_(data), size_(size) {}
+
+    BufferPool* pool_ = nullptr;
+    void* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+// Size-class cache of large allocations. Requests are rounded up to one of four classes per power of
+// two (at most 25% slack), and released buffers wait in per-class free lists for the next request of
+// that class, so repeated frames of similar size reuse memory instead of faulting in fresh pages.
+// The backing allocator is pluggable: host_buffer_pool() uses aligned host memory, and the CUDA
+// backend keeps a device pool (device_buffer_pool() in filters_cuda.h). Thread-safe.
+class BufferPool
+{
+public:
+    struct Allocator
+    {
+        void* (*allocate)(size_t bytes, bool huge_pages); // throws on failure
+        void (*release)(void* data, size_t bytes);
+    };
+
+    explicit BufferPool(Allocator allocator, BufferPoolOptions options = {});
+    ~BufferPool();
+
+    BufferPool(const BufferPool&) = delete;
+    BufferPool& operator=(const BufferPool&) = delete;
+
+    // Raw form: a buffer of at least `bytes` (*capacity receives the class size), handed back with
+    // release(). scratch() wraps the pair in a handle.
+    void* acquire(size_t bytes, size_t* capacity = nullptr);
+    void release(void* data);
+    ScratchBuffer scratch(size_t bytes);
+
+    // Frees every cached buffer; buffers in use are unaffected.
+    void trim();
+
+    void set_options(const BufferPoolOptions& options); // trims to the new cache budget
+    BufferPoolOptions options() const;
+    BufferPoolStats stats() const;
+
+    static size_t size_class(size_t bytes);
+
+private:
+    void trim_to(size_t budget); // caller holds mutex_
+
+    Allocator allocator_;
+    BufferPoolOptions options_;
+    mutable std::mutex mutex_;
+    std::unordered_map<size_t, std::vector<void*>> free_;  // class size -> released buffers
+    std::unordered_map<void*, size_t> outstanding_;         // buffer -> class size
+    BufferPoolStats stats_;
+};
+
+// Host pool: 64-byte aligned buffers, optionally on huge pages (see BufferPoolOptions). Pixel
+// buffers of 64 KiB and up (image.h) and the CPU filters' frame-sized scratch come from here.
+BufferPool& host_buffer_pool();
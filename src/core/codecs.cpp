@@ -0,0 +1,487 @@
+// src/core/codecs.cpp
+#include "codecs.h"
+
+#include "thread_pool.h"
+#include "trace.h"
+
+#define ZLIB_CONST // z_stream::next_in is a const Bytef*
+#include <zlib.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace
+{
+void check_channels(const ConstImageView& img, const char* codec)
+{
+    if (img.channels != 1 && img.channels != 3)
+    {
+        throw std::runtime_error(std::string(codec) + " encoder expects a gray (1 channel) or RGB (3 channels) image.");
+    }
+}
+
+void put_u32(uint8_t* p, uint32_t v)
+{
+    p[0] = static_cast<uint8_t>(v >> 24);
+    p[1] = static_cast<uint8_t>(v >> 16);
+    p[2] = static_cast<uint8_t>(v >> 8);
+    p[3] = static_cast<uint8_t>(v);
+}
+
+uint32_t get_u32(const uint8_t* p)
+{
+    return static_cast<uint32_t>(p[0]) << 24 | static_cast<uint32_t>(p[1]) << 16 | static_cast<uint32_t>(p[2]) << 8 |
+           p[3];
+}
+
+// ---------------------------------------------------------------------------------------------------
+// PNG
+
+constexpr size_t kDeflateWindow = 32 * 1024;
+constexpr size_t kMinDeflateChunk = 256 * 1024; // smaller chunks cost ratio for little extra parallelism
+constexpr size_t kMaxDeflateChunk = 1 << 30;    // keeps every zlib call and IDAT length within 32 bits
+
+int paeth(int a, int b, int c)
+{
+    const int p = a + b - c;
+    const int pa = std::abs(p - a);
+    const int pb = std::abs(p - b);
+    const int pc = std::abs(p - c);
+    if (pa <= pb && pa <= pc) return a;
+    return pb <= pc ? b : c;
+}
+
+void append_chunk(std::vector<uint8_t>& out, const char* type, const uint8_t* data, size_t bytes)
+{
+    uint8_t header[8];
+    put_u32(header, static_cast<uint32_t>(bytes));
+    std::memcpy(header + 4, type, 4);
+    uLong crc = crc32(0L, header + 4, 4);
+    if (bytes) crc = crc32(crc, data, static_cast<uInt>(bytes));
+    uint8_t trailer[4];
+    put_u32(trailer, static_cast<uint32_t>(crc));
+    out.insert(out.end(), header, header + 8);
+    if (bytes) out.insert(out.end(), data, data + bytes);
+    out.insert(out.end(), trailer, trailer + 4);
+}
+
+// Raw deflate of `bytes` at `data`, primed with up to one window of the bytes preceding it. All but
+// the last chunk end on a sync flush, which byte-aligns them so the pieces can simply be concatenated.
+std::vector<uint8_t> deflate_chunk(const uint8_t* data, size_t bytes, size_t preceding, int level, bool last)
+{
+    z_stream zs{};
+    if (deflateInit2(&zs, level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+    {
+        throw std::runtime_error("deflateInit2 failed");
+    }
+    const size_t dictionary = std::min(preceding, kDeflateWindow);
+    if (dictionary) deflateSetDictionary(&zs, data - dictionary, static_cast<uInt>(dictionary));
+
+    std::vector<uint8_t> out(deflateBound(&zs, static_cast<uLong>(bytes)) + 16);
+    zs.next_in = data;
+    zs.avail_in = static_cast<uInt>(bytes);
+    size_t produced = 0;
+    for (;;)
+    {
+        zs.next_out = out.data() + produced;
+        zs.avail_out = static_cast<uInt>(out.size() - produced);
+        const int status = deflate(&zs, last ? Z_FINISH : Z_SYNC_FLUSH);
+        produced = out.size() - zs.avail_out;
+        if (status == Z_STREAM_ERROR)
+        {
+            deflateEnd(&zs);
+            throw std::runtime_error("deflate failed");
+        }
+        if (last ? status == Z_STREAM_END : zs.avail_in == 0 && zs.avail_out > 0) break;
+        out.resize(out.size() * 2);
+    }
+    deflateEnd(&zs);
+    out.resize(produced);
+    return out;
+}
+
+// ---------------------------------------------------------------------------------------------------
+// QOI, see https://qoiformat.org/qoi-specification.pdf
+
+constexpr uint8_t kQoiOpIndex = 0x00;
+constexpr uint8_t kQoiOpDiff = 0x40;
+constexpr uint8_t kQoiOpLuma = 0x80;
+constexpr uint8_t kQoiOpRun = 0xc0;
+constexpr uint8_t kQoiOpRgb = 0xfe;
+constexpr uint8_t kQoiOpRgba = 0xff;
+constexpr uint8_t kQoiMask = 0xc0;
+constexpr size_t kQoiHeaderBytes = 14;
+constexpr uint8_t kQoiPadding[8] = { 0, 0, 0, 0, 0, 0, 0, 1 };
+
+struct QoiPixel
+{
+    uint8_t r = 0, g = 0, b = 0, a = 255;
+
+    bool operator==(const QoiPixel& o) const { return r == o.r && g == o.g && b == o.b && a == o.a; }
+    int hash() const { return (r * 3 + g * 5 + b * 7 + a * 11) & 63; }
+};
+} // namespace
+
+std::string lower_extension(const std::string& path)
+{
+    const size_t dot = path.find_last_of('.');
+    if (dot == std::string::npos || path.find_first_of("/\\", dot) != std::string::npos) return {};
+    std::string ext = path.substr(dot);
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return std::tolower(c); });
+    return ext;
+}
+
+ImageFormat image_format_for_path(const std::string& path)
+{
+    const std::string ext = lower_extension(path);
+    if (ext == ".qoi") return ImageFormat::Qoi;
+    if (ext == ".ppm" || ext == ".pgm" || ext == ".pnm") return ImageFormat::Ppm;
+    if (ext == ".pam") return ImageFormat::Pam;
+    if (ext == ".bmp") return ImageFormat::Bmp;
+    return ImageFormat::Png;
+}
+
+void png_filter_row(const uint8_t* row, const uint8_t* above, size_t bytes, int bpp, uint8_t* out)
+{
+    // Sum of |residual| for None, Sub, Up, Average and Paeth, all gathered in one pass.
+    uint64_t cost[5] = {};
+    for (size_t i = 0; i < bytes; ++i)
+    {
+        const int x = row[i];
+        const int a = i >= static_cast<size_t>(bpp) ? row[i - bpp] : 0;
+        const int b = above ? above[i] : 0;
+        const int c = above && i >= static_cast<size_t>(bpp) ? above[i - bpp] : 0;
+        cost[0] += std::abs(static_cast<int8_t>(x));
+        cost[1] += std::abs(static_cast<int8_t>(x - a));
+        cost[2] += std::abs(static_cast<int8_t>(x - b));
+        cost[3] += std::abs(static_cast<int8_t>(x - (a + b) / 2));
+        cost[4] += std::abs(static_cast<int8_t>(x - paeth(a, b, c)));
+    }
+    const int type = static_cast<int>(std::min_element(cost, cost + 5) - cost);
+
+    out[0] = static_cast<uint8_t>(type);
+    uint8_t* dst = out + 1;
+    const uint8_t* up = above;
+    if (!up && type >= 2)
+    {
+        // Up/Average/Paeth against an all-zero row; only reachable for the first row.
+        for (size_t i = 0; i < bytes; ++i)
+        {
+            const int a = i >= static_cast<size_t>(bpp) ? row[i - bpp] : 0;
+            dst[i] = static_cast<uint8_t>(row[i] - (type == 2 ? 0 : type == 3 ? a / 2 : a));
+        }
+        return;
+    }
+    const size_t lead = std::min(bytes, static_cast<size_t>(bpp));
+    switch (type)
+    {
+    case 0: std::memcpy(dst, row, bytes); break;
+    case 1:
+        std::memcpy(dst, row, lead);
+        for (size_t i = lead; i < bytes; ++i) dst[i] = static_cast<uint8_t>(row[i] - row[i - bpp]);
+        break;
+    case 2:
+        for (size_t i = 0; i < bytes; ++i) dst[i] = static_cast<uint8_t>(row[i] - up[i]);
+        break;
+    case 3:
+        for (size_t i = 0; i < lead; ++i) dst[i] = static_cast<uint8_t>(row[i] - up[i] / 2);
+        for (size_t i = lead; i < bytes; ++i) dst[i] = static_cast<uint8_t>(row[i] - (row[i - bpp] + up[i]) / 2);
+        break;
+    default:
+        for (size_t i = 0; i < lead; ++i) dst[i] = static_cast<uint8_t>(row[i] - up[i]);
+        for (size_t i = lead; i < bytes; ++i)
+            dst[i] = static_cast<uint8_t>(row[i] - paeth(row[i - bpp], up[i], up[i - bpp]));
+        break;
+    }
+}
+
+std::vector<uint8_t> encode_png(const ConstImageView& img, const PngOptions& options)
+{
+    check_channels(img, "PNG");
+    TraceSpan span("encode png", "codec");
+    if (options.level < 0 || options.level > 9)
+    {
+        throw std::invalid_argument("PNG compression level must be in [0, 9]");
+    }
+    if (img.width <= 0 || img.height <= 0) throw std::invalid_argument("PNG encoder needs a non-empty image");
+    const int threads = options.threads <= 0 ? cpu_thread_count() : options.threads;
+
+    // Filtering is cheap next to deflate but still worth spreading out; each row only reads the
+    // unfiltered row above it. Level 0 stores, where filters would only cost time.
+    const size_t row_bytes = img.row_bytes();
+    const size_t line = row_bytes + 1;
+    const size_t total = line * img.height;
+    std::vector<uint8_t> filtered(total);
+    auto filter_rows = [&](int y0, int y1) {
+        TraceSpan rows_span("png row filters", "codec");
+        for (int y = y0; y < y1; ++y)
+        {
+            uint8_t* out = filtered.data() + y * line;
+            if (options.level == 0)
+            {
+                out[0] = 0;
+                std::memcpy(out + 1, img.row(y), row_bytes);
+            }
+            else
+            {
+                png_filter_row(img.row(y), y > 0 ? img.row(y - 1) : nullptr, row_bytes, img.channels, out);
+            }
+        }
+    };
+    if (threads > 1)
+        parallel_for_rows(img.height, line, filter_rows);
+    else
+        filter_rows(0, img.height);
+
+    size_t chunk_bytes = total;
+    if (threads > 1) chunk_bytes = std::max(kMinDeflateChunk, (total + threads * 4 - 1) / (threads * 4));
+    chunk_bytes = std::max<size_t>(std::min(chunk_bytes, kMaxDeflateChunk), 1);
+    const int chunks = static_cast<int>((total + chunk_bytes - 1) / chunk_bytes);
+
+    std::vector<std::vector<uint8_t>> compressed(chunks);
+    std::vector<uLong> adlers(chunks);
+    // Chunks are already sized for one task each.
+    auto deflate_chunks = [&](int c0, int c1) {
+        for (int c = c0; c < c1; ++c)
+        {
+            const size_t begin = c * chunk_bytes;
+            const size_t bytes = std::min(chunk_bytes, total - begin);
+            TraceSpan chunk_span("deflate", "codec");
+            compressed[c] = deflate_chunk(filtered.data() + begin, bytes, begin, options.level, c + 1 == chunks);
+            adlers[c] = adler32(adler32(0L, nullptr, 0), filtered.data() + begin, static_cast<uInt>(bytes));
+        }
+    };
+    if (threads > 1)
+        cpu_thread_pool().parallel_for(chunks, 1, deflate_chunks);
+    else
+        deflate_chunks(0, chunks);
+
+    uLong adler = adlers[0];
+    for (int c = 1; c < chunks; ++c)
+    {
+        const size_t bytes = std::min(chunk_bytes, total - c * chunk_bytes);
+        adler = adler32_combine(adler, adlers[c], static_cast<z_off_t>(bytes));
+    }
+
+    // zlib header: 32 KiB window, FLEVEL from the compression level, FCHECK making it a multiple of 31.
+    const int flevel = options.level < 2 ? 0 : options.level < 6 ? 1 : options.level == 6 ? 2 : 3;
+    uint8_t zlib_header[2] = { 0x78, static_cast<uint8_t>(flevel << 6) };
+    zlib_header[1] = static_cast<uint8_t>(zlib_header[1] + 31 - ((zlib_header[0] << 8 | zlib_header[1]) % 31));
+    compressed.front().insert(compressed.front().begin(), zlib_header, zlib_header + 2);
+    uint8_t trailer[4];
+    put_u32(trailer, static_cast<uint32_t>(adler));
+    compressed.back().insert(compressed.back().end(), trailer, trailer + 4);
+
+    size_t file_bytes = 8 + 25 + 12;
+    for (const auto& piece : compressed) file_bytes += piece.size() + 12;
+    std::vector<uint8_t> out;
+    out.reserve(file_bytes);
+    static const uint8_t kSignature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+    out.insert(out.end(), kSignature, kSignature + 8);
+    uint8_t ihdr[13] = {};
+    put_u32(ihdr, static_cast<uint32_t>(img.width));
+    put_u32(ihdr + 4, static_cast<uint32_t>(img.height));
+    ihdr[8] = 8;                          // bit depth
+    ihdr[9] = img.channels == 1 ? 0 : 2;  // colour type: grayscale or truecolour
+    append_chunk(out, "IHDR", ihdr, sizeof(ihdr));
+    // One IDAT per deflated chunk; decoders treat consecutive IDATs as a single stream.
+    for (const auto& piece : compressed) append_chunk(out, "IDAT", piece.data(), piece.size());
+    append_chunk(out, "IEND", nullptr, 0);
+    return out;
+}
+
+std::vector<uint8_t> encode_qoi(const ConstImageView& img)
+{
+    check_channels(img, "QOI");
+    TraceSpan span("encode qoi", "codec");
+    const size_t pixels = static_cast<size_t>(img.width) * img.height;
+    // Worst case is an RGB op (4 bytes) per pixel.
+    std::vector<uint8_t> out(kQoiHeaderBytes + pixels * 4 + sizeof(kQoiPadding));
+    uint8_t* p = out.data();
+    std::memcpy(p, "qoif", 4);
+    put_u32(p + 4, static_cast<uint32_t>(img.width));
+    put_u32(p + 8, static_cast<uint32_t>(img.height));
+    p[12] = 3; // channels
+    p[13] = 0; // sRGB with linear alpha
+    p += kQoiHeaderBytes;
+
+    QoiPixel index[64] = {};
+    for (QoiPixel& px : index) px.a = 0;
+    QoiPixel prev;
+    int run = 0;
+    for (int y = 0; y < img.height; ++y)
+    {
+        const uint8_t* src = img.row(y);
+        for (int x = 0; x < img.width; ++x, src += img.channels)
+        {
+            QoiPixel px;
+            px.r = src[0];
+            px.g = img.channels == 3 ? src[1] : src[0];
+            px.b = img.channels == 3 ? src[2] : src[0];
+
+            if (px == prev)
+            {
+                if (++run == 62)
+                {
+                    *p++ = static_cast<uint8_t>(kQoiOpRun | (run - 1));
+                    run = 0;
+                }
+                continue;
+            }
+            if (run > 0)
+            {
+                *p++ = static_cast<uint8_t>(kQoiOpRun | (run - 1));
+                run = 0;
+            }
+
+            const int slot = px.hash();
+            if (index[slot] == px)
+            {
+                *p++ = static_cast<uint8_t>(kQoiOpIndex | slot);
+            }
+            else
+            {
+                index[slot] = px;
+                const int dr = static_cast<int8_t>(px.r - prev.r);
+                const int dg = static_cast<int8_t>(px.g - prev.g);
+                const int db = static_cast<int8_t>(px.b - prev.b);
+                const int dr_dg = dr - dg;
+                const int db_dg = db - dg;
+                if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1)
+                {
+                    *p++ = static_cast<uint8_t>(kQoiOpDiff | (dr + 2) << 4 | (dg + 2) << 2 | (db + 2));
+                }
+                else if (dr_dg >= -8 && dr_dg <= 7 && dg >= -32 && dg <= 31 && db_dg >= -8 && db_dg <= 7)
+                {
+                    *p++ = static_cast<uint8_t>(kQoiOpLuma | (dg + 32));
+                    *p++ = static_cast<uint8_t>((dr_dg + 8) << 4 | (db_dg + 8));
+                }
+                else
+                {
+                    *p++ = kQoiOpRgb;
+                    *p++ = px.r;
+                    *p++ = px.g;
+                    *p++ = px.b;
+                }
+            }
+            prev = px;
+        }
+    }
+    if (run > 0) *p++ = static_cast<uint8_t>(kQoiOpRun | (run - 1));
+    std::memcpy(p, kQoiPadding, sizeof(kQoiPadding));
+    p += sizeof(kQoiPadding);
+    out.resize(static_cast<size_t>(p - out.data()));
+    return out;
+}
+
+bool is_qoi(const uint8_t* data, size_t size)
+{
+    return size >= kQoiHeaderBytes && std::memcmp(data, "qoif", 4) == 0;
+}
+
+Image decode_qoi(const uint8_t* data, size_t size)
+{
+    if (!is_qoi(data, size)) throw std::runtime_error("Not a QOI file");
+    TraceSpan span("decode qoi", "codec");
+    const uint32_t width = get_u32(data + 4);
+    const uint32_t height = get_u32(data + 8);
+    const int channels = data[12];
+    if (width == 0 || height == 0 || width > (1u << 30) / height || (channels != 3 && channels != 4))
+    {
+        throw std::runtime_error("Bad QOI header");
+    }
+
+    Image img;
+    img.width = static_cast<int>(width);
+    img.height = static_cast<int>(height);
+    img.channels = 3;
+    const size_t pixels = static_cast<size_t>(width) * height;
+    img.pixels.resize_uninitialized(pixels * 3);
+
+    QoiPixel index[64] = {};
+    for (QoiPixel& px : index) px.a = 0;
+    QoiPixel px;
+    const uint8_t* p = data + kQoiHeaderBytes;
+    const uint8_t* end = data + size;
+    uint8_t* dst = img.pixels.data();
+    for (size_t i = 0; i < pixels;)
+    {
+        if (p >= end) throw std::runtime_error("Truncated QOI data");
+        const uint8_t op = *p++;
+        int run = 1;
+        if (op == kQoiOpRgb || op == kQoiOpRgba)
+        {
+            const size_t need = op == kQoiOpRgb ? 3 : 4;
+            if (static_cast<size_t>(end - p) < need) throw std::runtime_error("Truncated QOI data");
+            px.r = p[0];
+            px.g = p[1];
+            px.b = p[2];
+            if (op == kQoiOpRgba) px.a = p[3];
+            p += need;
+        }
+        else if ((op & kQoiMask) == kQoiOpIndex)
+        {
+            px = index[op];
+        }
+        else if ((op & kQoiMask) == kQoiOpDiff)
+        {
+            px.r = static_cast<uint8_t>(px.r + ((op >> 4) & 3) - 2);
+            px.g = static_cast<uint8_t>(px.g + ((op >> 2) & 3) - 2);
+            px.b = static_cast<uint8_t>(px.b + (op & 3) - 2);
+        }
+        else if ((op & kQoiMask) == kQoiOpLuma)
+        {
+            if (p >= end) throw std::runtime_error("Truncated QOI data");
+            const int dg = (op & 0x3f) - 32;
+            const uint8_t b = *p++;
+            px.r = static_cast<uint8_t>(px.r + dg - 8 + (b >> 4));
+            px.g = static_cast<uint8_t>(px.g + dg);
+            px.b = static_cast<uint8_t>(px.b + dg - 8 + (b & 15));
+        }
+        else
+        {
+            run = std::min<size_t>((op & 0x3f) + 1, pixels - i);
+        }
+        index[px.hash()] = px;
+        for (int r = 0; r < run; ++r, dst += 3)
+        {
+            dst[0] = px.r;
+            dst[1] = px.g;
+            dst[2] = px.b;
+        }
+        i += run;
+    }
+    return img;
+}
+
+std::vector<uint8_t> encode_pnm(const ConstImageView& img, bool pam)
+{
+    check_channels(img, pam ? "PAM" : "PNM");
+    TraceSpan span("encode pnm", "codec");
+    char header[160];
+    int length = 0;
+    if (pam)
+    {
+        length = std::snprintf(header, sizeof(header), "P7\nWIDTH %d\nHEIGHT %d\nDEPTH %d\nMAXVAL 255\nTUPLTYPE %s\nENDHDR\n",
+                               img.width, img.height, img.channels, img.channels == 1 ? "GRAYSCALE" : "RGB");
+    }
+    else
+    {
+        length = std::snprintf(header, sizeof(header), "P%d\n%d %d\n255\n", img.channels == 1 ? 5 : 6, img.width,
+                               img.height);
+    }
+
+    const size_t row_bytes = img.row_bytes();
+    std::vector<uint8_t> out(length + row_bytes * img.height);
+    std::memcpy(out.data(), header, length);
+    for (int y = 0; y < img.height; ++y)
+    {
+        std::memcpy(out.data() + length + y * row_bytes, img.row(y), row_bytes);
+    }
+    return out;
+}
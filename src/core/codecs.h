@@ -0,0 +1,49 @@
+// src/core/codecs.h
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "image.h"
+
+// In-memory encoders and decoders behind save_image() / load_image(). All of them take gray (1 channel)
+// or RGB (3 channels) views with any row stride and return the complete file contents.
+
+enum class ImageFormat
+{
+    Png,
+    Qoi,
+    Ppm,
+    Pam,
+    Bmp,
+};
+
+// Extension of the path's last component, dot included and lowercased ("a/B.PNG" -> ".png"); "" when
+// it has none. Every format and stream choice by file name goes through this.
+std::string lower_extension(const std::string& path);
+// Output format for a path's extension (case-insensitive); anything unrecognized is PNG.
+ImageFormat image_format_for_path(const std::string& path);
+
+// PNG with zlib at options.level. With options.threads > 1 the filtered rows are split into chunks
+// that are deflated concurrently on cpu_thread_pool(), each primed with the previous chunk's last
+// 32 KiB as dictionary, and concatenated into a single zlib stream (as pigz does). The file is a
+// normal PNG; the output depends on the thread count (`threads`, or cpu_thread_count() when <= 0)
+// but not on how the pool schedules the chunks. Throws std::invalid_argument for an empty image.
+std::vector<uint8_t> encode_png(const ConstImageView& img, const PngOptions& options = {});
+
+// Writes one PNG scanline to out (filter type byte + `bytes` filtered bytes), choosing the filter
+// with the smallest sum of absolute signed residuals. `above` is the previous unfiltered row, or
+// nullptr for the first row; bpp is bytes per pixel.
+void png_filter_row(const uint8_t* row, const uint8_t* above, size_t bytes, int bpp, uint8_t* out);
+
+// QOI ("Quite OK Image"), lossless and several times faster than PNG in both directions. Gray
+// images are stored as RGB, as the format has no single-channel layout.
+std::vector<uint8_t> encode_qoi(const ConstImageView& img);
+// Decodes to RGB, dropping alpha. Throws std::runtime_error on malformed input.
+Image decode_qoi(const uint8_t* data, size_t size);
+bool is_qoi(const uint8_t* data, size_t size); // checks the magic bytes
+
+// Binary PNM: P6 (RGB) or P5 (gray) when pam is false, otherwise P7 with TUPLTYPE RGB / GRAYSCALE.
+std::vector<uint8_t> encode_pnm(const ConstImageView& img, bool pam);
@@ -0,0 +1,62 @@
+// src/core/cpu_features.cpp
+#include "cpu_features.h"
+
+#include <algorithm>
+#include <atomic>
+
+namespace
+{
+SimdLevel probe_simd_level()
+{
+#if defined(CUDAPIX_X86_SIMD)
+    __builtin_cpu_init();
+    // libgcc/compiler-rt also check XCR0 here, so AVX levels are only reported when the OS saves them.
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")) return SimdLevel::AVX512;
+    if (__builtin_cpu_supports("avx2")) return SimdLevel::AVX2;
+    if (__builtin_cpu_supports("sse4.1")) return SimdLevel::SSE41;
+#endif
+    return SimdLevel::Scalar;
+}
+
+std::atomic<int> g_requested_level{ -1 };
+} // namespace
+
+SimdLevel detect_simd_level()
+{
+    static const SimdLevel level = probe_simd_level();
+    return level;
+}
+
+SimdLevel active_simd_level()
+{
+    const int requested = g_requested_level.load(std::memory_order_relaxed);
+    if (requested < 0) return detect_simd_level();
+    return std::min(static_cast<SimdLevel>(requested), detect_simd_level());
+}
+
+void set_simd_level(SimdLevel level)
+{
+    g_requested_level.store(static_cast<int>(level), std::memory_order_relaxed);
+}
+
+const char* simd_level_name(SimdLevel level)
+{
+    switch (level)
+    {
+    case SimdLevel::Scalar: return "scalar";
+    case SimdLevel::SSE41: return "sse4.1";
+    case SimdLevel::AVX2: return "avx2";
+    case SimdLevel::AVX512: return "avx512";
+    }
+    return "unknown";
+}
+
+bool cpu_has_avx512vbmi()
+{
+#if defined(CUDAPIX_X86_SIMD)
+    static const bool has = detect_simd_level() == SimdLevel::AVX512 && __builtin_cpu_supports("avx512vbmi");
+    return has;
+#else
+    return false;
+#endif
+}
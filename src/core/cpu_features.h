@@ -0,0 +1,24 @@
+// src/core/cpu_features.h
+#pragma once
+
+// Instruction-set levels the CPU filters have hand-vectorized kernels for, in increasing order.
+enum class SimdLevel
+{
+    Scalar = 0,
+    SSE41,
+    AVX2,
+    AVX512 // AVX-512 F + BW
+};
+
+// Best level supported by this CPU and OS (probed once via CPUID/XGETBV).
+SimdLevel detect_simd_level();
+
+// Level the CPU filters dispatch to. Defaults to detect_simd_level(); set_simd_level() can lower it
+// (e.g. to compare against the scalar path) but never raises it above what the CPU supports.
+SimdLevel active_simd_level();
+void set_simd_level(SimdLevel level);
+
+const char* simd_level_name(SimdLevel level);
+
+// AVX-512 VBMI (byte permutes); used for table lookups when the AVX-512 level is active.
+bool cpu_has_avx512vbmi();
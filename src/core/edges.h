@@ -0,0 +1,18 @@
+// src/core/edges.h
+#pragma once
+
+#include <cstdint>
+
+// Sobel gradient direction quantized to the four neighbour axes used by Canny-style non-maximum
+// suppression. A pixel is compared with its two neighbours along the gradient (y grows downwards):
+//   Horizontal:  (x - 1, y)     and (x + 1, y)
+//   Diagonal45:  (x + 1, y - 1) and (x - 1, y + 1)   gradient pointing up-right / down-left
+//   Vertical:    (x, y - 1)     and (x, y + 1)
+//   Diagonal135: (x - 1, y - 1) and (x + 1, y + 1)   gradient pointing down-right / up-left
+enum class EdgeDirection : uint8_t
+{
+    Horizontal = 0,
+    Diagonal45,
+    Vertical,
+    Diagonal135
+};
@@ -0,0 +1,271 @@
+// src/core/filter_chain.cpp
+#include "filter_chain.h"
+#include "stencil.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+
+namespace
+{
+struct FilterInfo
+{
+    FilterKind kind;
+    const char* name;
+    int min_params;
+    int max_params;
+    std::array<float, kMaxFilterParams> defaults;
+    unsigned layouts;
+};
+
+constexpr unsigned kInterleaved = kLayoutGray | kLayoutRgb | kLayoutRgba;
+constexpr unsigned kAnyLayout = kInterleaved | kLayoutPlanar;
+
+const FilterInfo kFilters[] = {
+    { FilterKind::Grayscale, "grayscale", 0, 0, {}, kInterleaved },
+    { FilterKind::Brightness, "brightness", 1, 1, {}, kAnyLayout },
+    { FilterKind::Contrast, "contrast", 1, 1, {}, kAnyLayout },
+    { FilterKind::Gamma, "gamma", 1, 1, {}, kAnyLayout },
+    { FilterKind::Invert, "invert", 0, 0, {}, kAnyLayout },
+    { FilterKind::Levels, "levels", 2, 4, { 0.0f, 255.0f, 0.0f, 255.0f }, kAnyLayout },
+    { FilterKind::Threshold, "threshold", 1, 1, {}, kAnyLayout },
+    { FilterKind::BoxBlur, "blur", 0, 1, { 1.0f }, kAnyLayout },
+    { FilterKind::GaussianBlur, "gaussian", 1, 1, {}, kAnyLayout },
+    { FilterKind::Sobel, "sobel", 0, 0, {}, kInterleaved },
+    { FilterKind::Canny, "canny", 0, 2, { 50.0f, 100.0f }, kInterleaved },
+    { FilterKind::Sharpen, "sharpen", 0, 2, {}, kAnyLayout },
+    { FilterKind::Laplacian, "laplacian", 0, 2, {}, kAnyLayout },
+    { FilterKind::Emboss, "emboss", 0, 2, {}, kAnyLayout },
+    { FilterKind::Gaussian5, "gaussian5", 0, 2, {}, kAnyLayout },
+    { FilterKind::AutoLevels, "autolevels", 0, 1, { 0.5f }, kInterleaved },
+    { FilterKind::Equalize, "equalize", 0, 0, {}, kInterleaved },
+};
+
+const char* const kBorderNames[] = { "clamp", "mirror", "wrap", "constant" };
+
+const FilterInfo& info_for(FilterKind kind)
+{
+    for (const auto& info : kFilters)
+    {
+        if (info.kind == kind) return info;
+    }
+    throw std::invalid_argument("Unknown filter kind");
+}
+
+std::string trim(const std::string& s)
+{
+    const auto begin = s.find_first_not_of(" \t");
+    if (begin == std::string::npos) return {};
+    const auto end = s.find_last_not_of(" \t");
+    return s.substr(begin, end - begin + 1);
+}
+
+float parse_param(const std::string& name, const std::string& arg)
+{
+    size_t used = 0;
+    float value = 0.0f;
+    try
+    {
+        value = std::stof(arg, &used);
+    }
+    catch (const std::exception&)
+    {
+        used = 0;
+    }
+    if (arg.empty() || used != arg.size()) throw std::invalid_argument("Bad parameter for " + name + ": " + arg);
+    return value;
+}
+
+FilterStep parse_step(const std::string& token)
+{
+    std::vector<std::string> parts;
+    std::stringstream ss(token);
+    std::string part;
+    while (std::getline(ss, part, ':'))
+    {
+        parts.push_back(trim(part));
+    }
+    if (parts.empty()) throw std::invalid_argument("Empty filter name");
+    const std::string& name = parts.front();
+    const int count = static_cast<int>(parts.size()) - 1;
+
+    for (const auto& info : kFilters)
+    {
+        if (name != info.name) continue;
+
+        if (info.max_params == 0 && count > 0) throw std::invalid_argument(name + " takes no parameter");
+        if (count < info.min_params)
+            throw std::invalid_argument(name + " requires " + std::to_string(info.min_params) + " parameter(s), e.g. " + name + ":1.0");
+        if (count > info.max_params)
+            throw std::invalid_argument(name + " takes at most " + std::to_string(info.max_params) + " parameters");
+
+        FilterStep step;
+        step.kind = info.kind;
+        step.params = info.defaults;
+        for (int i = 0; i < count; ++i)
+        {
+            // A convolution's first parameter is its border mode, stored as the BorderMode value.
+            if (i == 0 && is_convolution(info.kind))
+            {
+                const auto* end = std::end(kBorderNames);
+                const auto* mode = std::find(std::begin(kBorderNames), end, parts[1]);
+                if (mode == end) throw std::invalid_argument("Unknown border mode for " + name + ": " + parts[1]);
+                step.params[0] = static_cast<float>(mode - std::begin(kBorderNames));
+                continue;
+            }
+            step.params[i] = parse_param(name, parts[i + 1]);
+        }
+        return step;
+    }
+    throw std::invalid_argument("Unknown filter: " + name);
+}
+} // namespace
+
+FilterChain parse_filter_chain(const std::string& spec)
+{
+    FilterChain chain;
+    std::stringstream ss(spec);
+    std::string token;
+    while (std::getline(ss, token, ','))
+    {
+        if (trim(token).empty()) throw std::invalid_argument("Empty stage in filter chain: " + spec);
+        chain.push_back(parse_step(token));
+    }
+    if (chain.empty()) throw std::invalid_argument("Empty filter chain");
+    return chain;
+}
+
+std::string format_filter_chain(const FilterChain& chain)
+{
+    std::ostringstream out;
+    for (size_t i = 0; i < chain.size(); ++i)
+    {
+        const FilterInfo& info = info_for(chain[i].kind);
+        if (i > 0) out << ',';
+        out << info.name;
+        for (int p = 0; p < info.max_params; ++p)
+        {
+            if (p == 0 && is_convolution(info.kind))
+                out << ':' << border_mode_name(filter_border(chain[i]));
+            else
+                out << ':' << chain[i].params[p];
+        }
+    }
+    return out.str();
+}
+
+const char* filter_kind_name(FilterKind kind)
+{
+    return info_for(kind).name;
+}
+
+bool is_point_op(FilterKind kind)
+{
+    return kind != FilterKind::BoxBlur && kind != FilterKind::GaussianBlur && kind != FilterKind::Sobel &&
+           kind != FilterKind::Canny && !is_convolution(kind) && !is_stats_op(kind);
+}
+
+bool is_global_op(FilterKind kind)
+{
+    return kind == FilterKind::Canny || is_stats_op(kind);
+}
+
+bool is_stats_op(FilterKind kind)
+{
+    return kind == FilterKind::AutoLevels || kind == FilterKind::Equalize;
+}
+
+bool is_global_op(const FilterStep& step)
+{
+    return is_global_op(step.kind) || (is_convolution(step.kind) && filter_border(step) == BorderMode::Wrap);
+}
+
+bool is_convolution(FilterKind kind)
+{
+    return kind == FilterKind::Sharpen || kind == FilterKind::Laplacian || kind == FilterKind::Emboss ||
+           kind == FilterKind::Gaussian5;
+}
+
+BorderMode filter_border(const FilterStep& step)
+{
+    const int mode = static_cast<int>(step.params[0]);
+    return mode >= 0 && mode <= static_cast<int>(BorderMode::Constant) ? static_cast<BorderMode>(mode) : BorderMode::Clamp;
+}
+
+const char* border_mode_name(BorderMode mode)
+{
+    return kBorderNames[static_cast<int>(mode)];
+}
+
+unsigned filter_layouts(FilterKind kind)
+{
+    return info_for(kind).layouts;
+}
+
+unsigned chain_layouts(const FilterChain& chain)
+{
+    unsigned layouts = kAnyLayout;
+    for (const FilterStep& step : chain)
+    {
+        layouts &= filter_layouts(step.kind);
+    }
+    return layouts;
+}
+
+unsigned interleaved_layout(int channels)
+{
+    switch (channels)
+    {
+    case 1: return kLayoutGray;
+    case 3: return kLayoutRgb;
+    case 4: return kLayoutRgba;
+    }
+    throw std::invalid_argument("Unsupported pixel layout: " + std::to_string(channels) + " channels");
+}
+
+bool is_lut_op(FilterKind kind)
+{
+    return is_point_op(kind) && kind != FilterKind::Grayscale;
+}
+
+int filter_halo(const FilterStep& step)
+{
+    if (step.kind == FilterKind::Sobel) return 1;
+    if (is_convolution(step.kind)) return visit_stencil(step.kind, [](auto k) { return decltype(k)::kRadius; });
+
+    int halo = 0;
+    for (const BoxPass& pass : blur_passes(step))
+    {
+        halo += pass.radius;
+    }
+    return halo;
+}
+
+std::vector<BoxPass> blur_passes(const FilterStep& step)
+{
+    std::vector<BoxPass> passes;
+    if (step.kind == FilterKind::BoxBlur)
+    {
+        const int radius = static_cast<int>(std::lround(std::clamp(step.param(), 0.0f, float(kMaxBlurRadius))));
+        if (radius > 0) passes.push_back({ radius, false });
+    }
+    else if (step.kind == FilterKind::GaussianBlur)
+    {
+        // Three boxes of widths wl or wl + 2 (odd), m of them the smaller, such that the summed box
+        // variances (w^2 - 1) / 12 come closest to sigma^2.
+        const float sigma = std::clamp(step.param(), 0.0f, kMaxBlurRadius / 2.0f);
+        const float ideal = std::sqrt(4.0f * sigma * sigma + 1.0f); // sqrt(12 sigma^2 / n + 1), n = 3
+        int wl = static_cast<int>(std::floor(ideal));
+        if (wl % 2 == 0) --wl;
+        const float m_ideal = (12.0f * sigma * sigma - 3.0f * wl * wl - 12.0f * wl - 9.0f) / (-4.0f * wl - 4.0f);
+        const int m = static_cast<int>(std::lround(m_ideal));
+        for (int i = 0; i < 3; ++i)
+        {
+            const int width = i < m ? wl : wl + 2;
+            if (width > 1) passes.push_back({ std::min(width / 2, kMaxBlurRadius), true });
+        }
+    }
+    return passes;
+}
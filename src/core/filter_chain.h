@@ -0,0 +1,110 @@
+// src/core/filter_chain.h
+#pragma once
+
+#include <array>
+#include <string>
+#include <vector>
+
+// Ordered list of filters run by cpu_pipeline()/apply_pipeline(). Adjacent point ops are fused into
+// a single pass and stencil stages are processed band by band, so a chain touches the frame once.
+enum class FilterKind
+{
+    Grayscale,
+    Brightness,   // delta in [-1, 1]
+    Contrast,     // factor > 0
+    Gamma,        // gamma > 0; > 1 brightens midtones
+    Invert,
+    Levels,       // in_black, in_white [, out_black, out_white], all in 0..255
+    Threshold,    // level in 0..255; channels >= level become 255, the rest 0
+    BoxBlur,      // optional radius (default 1, i.e. 3x3)
+    GaussianBlur, // sigma in pixels; approximated by three box passes
+    Sobel,
+    Canny,        // low, high gradient thresholds (default 50, 100); needs the whole frame
+    Sharpen,      // fixed 3x3/5x5 convolutions (see stencil.h), each with an optional border mode
+    Laplacian,    // (clamp, mirror, wrap or constant; default clamp) and constant border value,
+    Emboss,       // e.g. "emboss:mirror" or "sharpen:constant:255"
+    Gaussian5,    // 5x5 binomial
+    AutoLevels,   // optional clip percentage at each end (default 0.5); stretches the frame's range
+    Equalize      // histogram equalization; both compile to a table from the frame's histogram
+};
+
+// How convolutions sample outside the frame: repeat the edge pixel, reflect about it, wrap around,
+// or read a constant value.
+enum class BorderMode
+{
+    Clamp,
+    Mirror,
+    Wrap,
+    Constant
+};
+
+constexpr int kMaxFilterParams = 4;
+
+struct FilterStep
+{
+    FilterKind kind = FilterKind::Grayscale;
+    std::array<float, kMaxFilterParams> params{}; // meaning per kind, see above
+
+    float param() const { return params[0]; }
+};
+
+using FilterChain = std::vector<FilterStep>;
+
+// Parses "brightness:0.2,contrast:1.5,sobel"; multiple parameters are colon-separated
+// ("levels:16:235"). Throws std::invalid_argument on unknown filters or bad parameters.
+FilterChain parse_filter_chain(const std::string& spec);
+
+// Inverse of parse_filter_chain(), e.g. for log lines.
+std::string format_filter_chain(const FilterChain& chain);
+
+const char* filter_kind_name(FilterKind kind);
+
+// Point ops map each pixel independently; everything else reads a neighbourhood (see filter_halo()).
+bool is_point_op(FilterKind kind);
+// Point ops whose per-channel output depends only on that channel's input byte (all but grayscale);
+// these compile to a 256-entry lookup table, see point_lut.h.
+bool is_lut_op(FilterKind kind);
+// Ops that need the whole frame (Canny's hysteresis follows edges any distance, the stats ops' table
+// depends on every pixel); pipelines run them between the fused parts of a chain. The FilterStep form
+// also counts convolutions with a Wrap border, whose edge rows read the opposite side of the frame.
+bool is_global_op(FilterKind kind);
+bool is_global_op(const FilterStep& step);
+// AutoLevels and Equalize: point ops whose table is built from the histogram of their input frame
+// (stats_lut() in histogram.h). Pipelines collect that histogram in the pass that writes the frame
+// and fold the table into the next point pass, so neither costs an extra read of the image.
+bool is_stats_op(FilterKind kind);
+// Fixed-kernel convolutions (Sharpen .. Gaussian5); filter_border() is their border mode.
+bool is_convolution(FilterKind kind);
+BorderMode filter_border(const FilterStep& step);
+const char* border_mode_name(BorderMode mode);
+int filter_halo(const FilterStep& step); // rows/columns of context needed on each side (local ops)
+
+// Pixel layouts (see image.h) a filter processes natively, as a bit mask. With 4 channels the point
+// ops and edge filters leave the 4th byte alone and the blurs filter it like a colour channel.
+// Planar images run channel-wise filters plane by plane; run_pipeline() interleaves a planar image
+// only around the steps that need whole pixels.
+enum LayoutMask : unsigned
+{
+    kLayoutGray = 1u << 0,   // 1 channel
+    kLayoutRgb = 1u << 1,    // 3 interleaved channels
+    kLayoutRgba = 1u << 2,   // 4 interleaved channels (RGBA or RGBX)
+    kLayoutPlanar = 1u << 3, // PlanarImage, one gray plane per channel
+};
+unsigned filter_layouts(FilterKind kind);
+unsigned chain_layouts(const FilterChain& chain); // layouts every step of the chain supports
+// The mask bit for an interleaved image; throws std::invalid_argument for other than 1, 3 or 4 channels.
+unsigned interleaved_layout(int channels);
+
+// Blurs run as separable running-sum box passes over edge-clamped samples, so their cost per pixel
+// does not depend on the radius. A pass sums the (2r+1)^2 window in integers and divides once;
+// `round` selects round-to-nearest instead of the truncation used by plain box blur.
+constexpr int kMaxBlurRadius = 1024;
+struct BoxPass
+{
+    int radius = 1;
+    bool round = false;
+};
+
+// Passes for a BoxBlur (one truncating pass) or GaussianBlur step (three rounding passes whose
+// widths are chosen so the combined variance matches sigma^2). Zero-radius passes are dropped.
+std::vector<BoxPass> blur_passes(const FilterStep& step);
@@ -1,8 +1,22 @@
 // src/core/filters_cpu.cpp
 #include "filters_cpu.h"
 
+#include "buffer_pool.h"
+#include "filters_cpu_simd.h"
+#include "histogram.h"
+#include "point_lut.h"
+#include "stencil.h"
+#include "thread_pool.h"
+#include "trace.h"
+#include "tuning.h"
+
 #include <algorithm>
 #include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+#include <string>
 
 namespace
 {
@@ -16,138 +30,1057 @@ inline float to_gray(uint8_t r, uint8_t g, uint8_t b)
 {
     return 0.299f * r + 0.587f * g + 0.114f * b;
 }
-} // namespace
 
-void cpu_grayscale(Image& img)
+// SIMD kernels only cover interleaved RGB8; anything else stays on the scalar path.
+const CpuRowKernels* kernels_for(const ImageView& img)
+{
+    return img.channels == 3 ? cpu_row_kernels(tuned_simd_level()) : nullptr;
+}
+
+// Point passes also take gray rows: the table kernel is byte-wise and grayscale skips them.
+const CpuRowKernels* point_kernels_for(const ImageView& img)
 {
-    const int stride = img.channels;
-    for (int y = 0; y < img.height; ++y)
+    return img.channels == 1 || img.channels == 3 ? cpu_row_kernels(tuned_simd_level()) : nullptr;
+}
+
+// Runs body(first_pixel, pixel_count) over rows [y0, y1) of a view: once when its rows are packed,
+// otherwise once per row.
+template <typename Body>
+void for_each_span(const ImageView& img, int y0, int y1, Body body)
+{
+    if (img.is_packed())
+    {
+        body(img.row(y0), static_cast<size_t>(y1 - y0) * img.width);
+        return;
+    }
+    for (int y = y0; y < y1; ++y)
     {
-        for (int x = 0; x < img.width; ++x)
+        body(img.row(y), static_cast<size_t>(img.width));
+    }
+}
+
+// Packed staging area for a stencil's whole-frame output, which is copied back into the view once
+// complete. Drawn from the host pool uninitialized, so repeated calls skip the allocation, its page
+// faults and the zero fill.
+ScratchBuffer frame_output(size_t bytes)
+{
+    TraceSpan span("frame buffer", "alloc");
+    return host_buffer_pool().scratch(bytes);
+}
+
+// Packed rows (row_bytes() apart, as the stencils produce them) back into the view.
+void store_rows(const uint8_t* packed, const ImageView& img)
+{
+    TraceSpan span("store rows", "copy");
+    parallel_for_rows(img.height, img.row_bytes(), [&](int y0, int y1) {
+        for (int y = y0; y < y1; ++y)
         {
-            const int idx = (y * img.width + x) * stride;
-            float gray = to_gray(img.pixels[idx], img.pixels[idx + 1], img.pixels[idx + 2]);
-            uint8_t g = clamp_byte(gray);
-            img.pixels[idx] = img.pixels[idx + 1] = img.pixels[idx + 2] = g;
+            std::memcpy(img.row(y), packed + static_cast<size_t>(y) * img.row_bytes(), img.row_bytes());
         }
+    });
+}
+
+// ---- Point ops over a contiguous run of packed pixels -------------------------------------------
+
+// Gray pixels are already gray; a 4th channel (alpha or padding) is left as it is.
+void grayscale_span(uint8_t* base, size_t pixels, int channels, const CpuRowKernels* simd)
+{
+    if (channels < 3) return;
+    const size_t done = simd ? simd->grayscale(base, pixels) : 0;
+    for (size_t i = done; i < pixels; ++i)
+    {
+        uint8_t* px = base + i * channels;
+        uint8_t g = clamp_byte(to_gray(px[0], px[1], px[2]));
+        px[0] = px[1] = px[2] = g;
     }
 }
 
-void cpu_brightness(Image& img, float delta)
+void lut_span(uint8_t* base, size_t bytes, const PointLut& lut, const CpuRowKernels* simd)
 {
-    delta = std::clamp(delta, -1.0f, 1.0f);
-    const int stride = img.channels;
-    for (int y = 0; y < img.height; ++y)
+    const size_t done = simd && simd->lut ? simd->lut(base, bytes, lut.table.data()) : 0;
+    for (size_t i = done; i < bytes; ++i)
     {
-        for (int x = 0; x < img.width; ++x)
-        {
-            const int idx = (y * img.width + x) * stride;
-            for (int c = 0; c < img.channels; ++c)
-            {
-                float v = static_cast<float>(img.pixels[idx + c]) / 255.0f;
-                v = std::clamp(v + delta, 0.0f, 1.0f);
-                img.pixels[idx + c] = clamp_byte(v * 255.0f);
-            }
-        }
+        base[i] = lut.table[base[i]];
+    }
+}
+
+// Tables map the colour channels only: with 4 channels every 4th byte (alpha or padding) is skipped.
+void lut_pixels(uint8_t* base, size_t pixels, int channels, const PointLut& lut, const CpuRowKernels* simd)
+{
+    if (channels != 4)
+    {
+        lut_span(base, pixels * channels, lut, simd);
+        return;
+    }
+    for (size_t i = 0; i < pixels; ++i)
+    {
+        uint8_t* px = base + i * 4;
+        px[0] = lut.table[px[0]];
+        px[1] = lut.table[px[1]];
+        px[2] = lut.table[px[2]];
     }
 }
 
-void cpu_contrast(Image& img, float factor)
+// Runs a compiled point segment over `pixels` packed pixels. The span is walked in L1-sized chunks
+// and every stage is applied to a chunk before moving on, so memory is streamed through only once.
+// With `capture`, each finished chunk is also counted into that histogram while it is still in cache.
+void point_program_span(const PointProgram& program, uint8_t* base, size_t pixels, int channels,
+                        const CpuRowKernels* simd, Histogram* capture = nullptr)
 {
-    factor = std::max(factor, 0.0f);
-    const int stride = img.channels;
-    for (int y = 0; y < img.height; ++y)
+    if (program.stages.empty() && !capture) return;
+    const size_t chunk_pixels = 16 * 1024 / static_cast<size_t>(channels);
+    for (size_t first = 0; first < pixels; first += chunk_pixels)
     {
-        for (int x = 0; x < img.width; ++x)
+        const size_t count = std::min(chunk_pixels, pixels - first);
+        uint8_t* chunk = base + first * channels;
+        for (const PointProgram::Stage& stage : program.stages)
         {
-            const int idx = (y * img.width + x) * stride;
-            for (int c = 0; c < img.channels; ++c)
-            {
-                float v = static_cast<float>(img.pixels[idx + c]) / 255.0f;
-                v = (v - 0.5f) * factor + 0.5f;
-                v = std::clamp(v, 0.0f, 1.0f);
-                img.pixels[idx + c] = clamp_byte(v * 255.0f);
-            }
+            if (stage.grayscale)
+                grayscale_span(chunk, count, channels, simd);
+            else
+                lut_pixels(chunk, count, channels, stage.lut, simd);
         }
+        if (capture) accumulate_histogram(*capture, chunk, count, channels);
     }
 }
 
-void cpu_box_blur(Image& img)
+// Per-task histograms for a parallel pass: each task counts into its own and merges it once at the
+// end, so the counting itself never contends.
+class HistogramCollector
 {
-    const int stride = img.channels;
-    std::vector<uint8_t> output(img.pixels.size(), 0);
+public:
+    HistogramCollector(Histogram* target, int channels) : target_(target), channels_(std::min(channels, 3))
+    {
+        if (target_) *target_ = local();
+    }
 
-    auto sample = [&](int x, int y, int c) -> uint8_t
+    // An empty histogram for one task to count into.
+    Histogram local() const
     {
-        x = std::clamp(x, 0, img.width - 1);
-        y = std::clamp(y, 0, img.height - 1);
-        return img.pixels[(y * img.width + x) * stride + c];
-    };
+        Histogram hist;
+        hist.channels = channels_;
+        return hist;
+    }
+    bool active() const { return target_ != nullptr; }
 
-    for (int y = 0; y < img.height; ++y)
+    void merge(const Histogram& part)
     {
-        for (int x = 0; x < img.width; ++x)
-        {
-            for (int c = 0; c < img.channels; ++c)
+        if (!target_) return;
+        std::lock_guard<std::mutex> lock(mutex_);
+        target_->merge(part);
+    }
+
+private:
+    Histogram* target_;
+    int channels_;
+    std::mutex mutex_;
+};
+
+// ---- 3x3 stencils over bands of rows ------------------------------------------------------------
+
+// Rows [lo, hi) of an image that is `height` rows tall, `stride` bytes apart. Row indices are clamped to the image
+// before lookup, mirroring the edge-clamp sampling of the filters.
+struct RowBand
+{
+    const uint8_t* data;
+    int lo;
+    int hi;
+    size_t stride;
+    int height;
+
+    const uint8_t* row(int y) const
+    {
+        y = std::clamp(y, 0, height - 1);
+        return data + static_cast<size_t>(y - lo) * stride;
+    }
+};
+
+// Output rows [y0, y1) into dst (row y0 first, dst_stride apart). src must cover the clamped rows
+// y0 - 1 .. y1.
+void box_blur_rows(const RowBand& src, uint8_t* dst, size_t dst_stride, int y0, int y1, int width, int channels,
+                   const CpuRowKernels* simd)
+{
+    for (int y = y0; y < y1; ++y)
+    {
+        const uint8_t* rows[3] = { src.row(y - 1), src.row(y), src.row(y + 1) };
+        uint8_t* out = dst + static_cast<size_t>(y - y0) * dst_stride;
+
+        auto blur_pixel = [&](int x) {
+            for (int c = 0; c < channels; ++c)
             {
                 int sum = 0;
                 int count = 0;
-                for (int ky = -1; ky <= 1; ++ky)
+                for (int ky = 0; ky < 3; ++ky)
                 {
                     for (int kx = -1; kx <= 1; ++kx)
                     {
-                        sum += sample(x + kx, y + ky, c);
+                        sum += rows[ky][std::clamp(x + kx, 0, width - 1) * channels + c];
                         ++count;
                     }
                 }
-                output[(y * img.width + x) * stride + c] = static_cast<uint8_t>(sum / count);
+                out[x * channels + c] = static_cast<uint8_t>(sum / count);
             }
+        };
+
+        if (simd && simd->box_blur(rows[0], rows[1], rows[2], out, width))
+        {
+            blur_pixel(0);
+            blur_pixel(width - 1);
+            continue;
+        }
+        for (int x = 0; x < width; ++x)
+        {
+            blur_pixel(x);
         }
     }
+}
+
+// ---- Edge detection over a rolling window of luma rows -------------------------------------------
 
-    img.pixels.swap(output);
+// 8-bit luma with weights in 15-bit fixed point (summing to 2^15). Integer, so the SIMD kernels and
+// the GPU reproduce it exactly.
+inline uint8_t luma8(uint8_t r, uint8_t g, uint8_t b)
+{
+    return static_cast<uint8_t>((9798 * r + 19235 * g + 3735 * b + 16384) >> 15);
 }
 
-void cpu_sobel(Image& img)
+void luma_row(const uint8_t* in, uint8_t* gray, int width, int channels, const CpuRowKernels* simd)
 {
-    const int stride = img.channels;
-    std::vector<uint8_t> output(img.pixels.size(), 0);
+    if (channels == 1)
+    {
+        std::memcpy(gray, in, static_cast<size_t>(width));
+        return;
+    }
+    const size_t done = simd ? simd->luma(in, gray, width) : 0;
+    for (size_t x = done; x < static_cast<size_t>(width); ++x)
+    {
+        gray[x] = luma8(in[x * channels], in[x * channels + 1], in[x * channels + 2]);
+    }
+}
+
+// Integer Sobel gradients at column x of three luma rows; x is clamped at the row ends.
+inline void sobel_gradient(const uint8_t* const g[3], int x, int width, int& gx, int& gy)
+{
+    const int l = std::max(x - 1, 0);
+    const int r = std::min(x + 1, width - 1);
+    auto sample = [&](int dx, int dy) { return static_cast<int>(g[dy + 1][dx < 0 ? l : (dx > 0 ? r : x)]); };
+    gx = stencil_sum<SobelXStencil>(sample);
+    gy = stencil_sum<SobelYStencil>(sample);
+}
 
-    const int gx[3][3] = { { -1, 0, 1 }, { -2, 0, 2 }, { -1, 0, 1 } };
-    const int gy[3][3] = { { 1, 2, 1 }, { 0, 0, 0 }, { -1, -2, -1 } };
+// round(|(gx, gy)|), at most 1443. gx^2 + gy^2 is exact in float and sqrt is correctly rounded, so
+// the SIMD kernels and the GPU get the same value.
+inline int gradient_magnitude(int gx, int gy)
+{
+    return static_cast<int>(std::sqrt(static_cast<float>(gx * gx + gy * gy)) + 0.5f);
+}
 
-    auto sample_gray = [&](int x, int y) -> float
+// EdgeDirection of (gx, gy) by integer comparison against tan(22.5) ~ 106/256 and tan(67.5) ~ 618/256.
+inline uint8_t gradient_direction(int gx, int gy)
+{
+    const int ax = std::abs(gx);
+    const int ay = std::abs(gy);
+    if (ay * 256 <= ax * 106) return static_cast<uint8_t>(EdgeDirection::Horizontal);
+    if (ay * 256 >= ax * 618) return static_cast<uint8_t>(EdgeDirection::Vertical);
+    // gy > 0 means the row above is brighter, i.e. the gradient points up.
+    return static_cast<uint8_t>((gx > 0) == (gy > 0) ? EdgeDirection::Diagonal45 : EdgeDirection::Diagonal135);
+}
+
+// Per-thread buffers reused across bands by the stencils.
+struct StencilScratch
+{
+    std::vector<uint8_t> luma;      // edge filters: rolling window of three luma rows
+    std::vector<int32_t> row_sums;  // box pass: horizontal window sums of the band's rows
+    std::vector<int32_t> window;    // box pass: running vertical sum of row_sums
+    std::vector<uint8_t> padded;    // box pass: one source row with clamped padding
+    std::vector<uint8_t> constant;  // convolutions: a row of the constant border value
+};
+
+// Calls row_fn(y, g) for every output row y in [y0, y1), with g the luma of the edge-clamped rows
+// y - 1, y and y + 1. The rows live in a rolling three-row buffer, so each source row of the band is
+// converted to luma once instead of once per tap.
+template <typename RowFn>
+void for_each_luma_window(const RowBand& src, int y0, int y1, int width, int channels, const CpuRowKernels* simd,
+                          StencilScratch& scratch, RowFn row_fn)
+{
+    scratch.luma.resize(3 * static_cast<size_t>(width));
+    auto slot = [&](int y) { return scratch.luma.data() + static_cast<size_t>((y + 3) % 3) * width; }; // y >= -1
+
+    luma_row(src.row(y0 - 1), slot(y0 - 1), width, channels, simd);
+    luma_row(src.row(y0), slot(y0), width, channels, simd);
+    for (int y = y0; y < y1; ++y)
     {
-        x = std::clamp(x, 0, img.width - 1);
-        y = std::clamp(y, 0, img.height - 1);
-        int idx = (y * img.width + x) * stride;
-        return to_gray(img.pixels[idx], img.pixels[idx + 1], img.pixels[idx + 2]);
+        luma_row(src.row(y + 1), slot(y + 1), width, channels, simd);
+        const uint8_t* g[3] = { slot(y - 1), slot(y), slot(y + 1) };
+        row_fn(y, g);
+    }
+}
+
+// Sobel magnitude (clamped to 255) of rows [y0, y1), written as out_channels equal bytes per pixel
+// (4-channel output keeps the input's 4th byte) into dst (row y0 first, rows dst_stride apart).
+void sobel_rows(const RowBand& src, uint8_t* dst, size_t dst_stride, int y0, int y1, int width, int channels,
+                int out_channels, const CpuRowKernels* simd, StencilScratch& scratch)
+{
+    for_each_luma_window(src, y0, y1, width, channels, simd, scratch, [&](int y, const uint8_t* const g[3]) {
+        uint8_t* out = dst + static_cast<size_t>(y - y0) * dst_stride;
+        auto write = [&](int x) {
+            int gx, gy;
+            sobel_gradient(g, x, width, gx, gy);
+            const uint8_t m = static_cast<uint8_t>(std::min(gradient_magnitude(gx, gy), 255));
+            for (int c = 0; c < std::min(out_channels, 3); ++c) out[x * out_channels + c] = m;
+            if (out_channels == 4) out[x * 4 + 3] = src.row(y)[x * 4 + 3]; // alpha passes through
+        };
+
+        if (simd && simd->sobel(g[0], g[1], g[2], out, width, out_channels))
+        {
+            write(0);
+            write(width - 1);
+            return;
+        }
+        for (int x = 0; x < width; ++x)
+        {
+            write(x);
+        }
+    });
+}
+
+// Magnitude (capped at `limit`) and EdgeDirection of rows [y0, y1), one element each per pixel.
+template <typename T>
+void gradient_rows(const RowBand& src, T* magnitude, uint8_t* direction, int y0, int y1, int width, int channels,
+                   int limit, const CpuRowKernels* simd, StencilScratch& scratch)
+{
+    for_each_luma_window(src, y0, y1, width, channels, simd, scratch, [&](int y, const uint8_t* const g[3]) {
+        const size_t row = static_cast<size_t>(y - y0) * width;
+        for (int x = 0; x < width; ++x)
+        {
+            int gx, gy;
+            sobel_gradient(g, x, width, gx, gy);
+            magnitude[row + x] = static_cast<T>(std::min(gradient_magnitude(gx, gy), limit));
+            direction[row + x] = gradient_direction(gx, gy);
+        }
+    });
+}
+
+// Horizontal sums of the 2r+1 edge-clamped samples around every element of one packed row. The row
+// is first copied with r + 1 clamped pixels of padding on each side so the running sum needs no
+// bounds checks; each step then costs one add and one subtract per channel.
+void horizontal_box_sums(const uint8_t* row, int32_t* sums, int width, int channels, int radius,
+                         std::vector<uint8_t>& padded)
+{
+    const size_t pad = static_cast<size_t>(radius + 1) * channels;
+    const size_t n = static_cast<size_t>(width) * channels;
+    padded.resize(n + 2 * pad);
+    for (size_t i = 0; i < pad; ++i)
+    {
+        padded[i] = row[i % channels];
+        padded[pad + n + i] = row[n - channels + i % channels];
+    }
+    std::memcpy(padded.data() + pad, row, n);
+
+    const uint8_t* center = padded.data() + pad;
+    int32_t sum[4] = {};
+    for (int c = 0; c < channels; ++c)
+    {
+        for (int k = -radius; k <= radius; ++k)
+        {
+            sum[c] += center[k * channels + c];
+        }
+    }
+    const uint8_t* add = center + static_cast<size_t>(radius + 1) * channels;
+    const uint8_t* sub = center - static_cast<size_t>(radius) * channels;
+    for (size_t i = 0; i < n; i += channels)
+    {
+        for (int c = 0; c < channels; ++c)
+        {
+            sums[i + c] = sum[c];
+            sum[c] += add[i + c] - sub[i + c];
+        }
+    }
+}
+
+// out[i] = window[i] / area, truncated or rounded. The +0.5 keeps exact multiples of area clear of
+// the truncation boundary; T must represent window + bias to within 1/2 of a unit in the quotient's
+// last place, which float does for windows below 2^22 and double for every possible window.
+template <typename T>
+void divide_window(const int32_t* window, uint8_t* out, size_t n, int32_t area, bool round)
+{
+    const T inv_area = T(1) / T(area);
+    const T bias = T(round ? area / 2 : 0) + T(0.5);
+    for (size_t i = 0; i < n; ++i)
+    {
+        out[i] = static_cast<uint8_t>(static_cast<int32_t>((static_cast<T>(window[i]) + bias) * inv_area));
+    }
+}
+
+// Output rows [y0, y1) of one running-sum box pass. src must cover the clamped rows y0 - r .. y1 + r - 1.
+// Every source row's horizontal sums are computed once; a vertical running sum over them then costs
+// one add and one subtract per element and output row, independent of the radius.
+void box_pass_rows(const RowBand& src, uint8_t* dst, size_t dst_stride, int y0, int y1, int width, int channels,
+                   BoxPass pass, StencilScratch& scratch)
+{
+    const int r = pass.radius;
+    const size_t n = static_cast<size_t>(width) * channels;
+    const int first = std::max(y0 - r, 0);
+    const int last = std::min(y1 + r, src.height);
+    scratch.row_sums.resize(static_cast<size_t>(last - first) * n);
+    for (int y = first; y < last; ++y)
+    {
+        horizontal_box_sums(src.row(y), scratch.row_sums.data() + static_cast<size_t>(y - first) * n, width, channels, r,
+                            scratch.padded);
+    }
+    auto sums = [&](int y) {
+        y = std::clamp(y, 0, src.height - 1);
+        return scratch.row_sums.data() + static_cast<size_t>(y - first) * n;
+    };
+
+    std::vector<int32_t>& window = scratch.window;
+    window.assign(n, 0);
+    for (int k = -r; k <= r; ++k)
+    {
+        const int32_t* add = sums(y0 + k);
+        for (size_t i = 0; i < n; ++i) window[i] += add[i];
+    }
+
+    const int32_t area = (2 * r + 1) * (2 * r + 1);
+    for (int y = y0; y < y1; ++y)
+    {
+        uint8_t* out = dst + static_cast<size_t>(y - y0) * dst_stride;
+        if (y > y0)
+        {
+            const int32_t* add = sums(y + r);
+            const int32_t* sub = sums(y - r - 1);
+            int32_t* w = window.data();
+            for (size_t i = 0; i < n; ++i) w[i] += add[i] - sub[i];
+        }
+        // Float is exact below 2^22 (radius <= 63); larger windows divide in double.
+        if (256 * area < (1 << 22))
+            divide_window<float>(window.data(), out, n, area, pass.round);
+        else
+            divide_window<double>(window.data(), out, n, area, pass.round);
+    }
+}
+
+// ---- Fixed-kernel convolutions (see stencil.h) ----------------------------------------------------
+
+// Output rows [y0, y1) of Stencil K into dst (row y0 first, dst_stride apart). Samples outside the
+// frame follow `border`; rows are resolved to source pointers once per output row, so only the R
+// columns at either end of a row take the per-tap border path and the interior loop indexes directly.
+// src must cover every row the border maps y0 - R .. y1 + R - 1 to (for all modes but Wrap these lie
+// within R rows of [y0, y1)). The first min(channels, 3) channels are filtered; a 4th is copied.
+template <typename K>
+void convolve_rows(const RowBand& src, uint8_t* dst, size_t dst_stride, int y0, int y1, int width, int channels,
+                   BorderMode border, uint8_t constant, StencilScratch& scratch)
+{
+    constexpr int R = K::kRadius;
+    const size_t n = static_cast<size_t>(width) * channels;
+    const int colour = std::min(channels, 3);
+    const int inner_lo = std::min(R, width);
+    const int inner_hi = std::max(width - R, inner_lo);
+    if (border == BorderMode::Constant) scratch.constant.assign(n, constant);
+
+    auto source_row = [&](int y) {
+        const int sy = border_index(y, src.height, border);
+        return sy < 0 ? scratch.constant.data() : src.row(sy);
+    };
+    auto sample_x = [&](const uint8_t* row, int x, int c) {
+        const int sx = border_index(x, width, border);
+        return sx < 0 ? static_cast<int>(constant) : static_cast<int>(row[sx * channels + c]);
+    };
+    auto copy_alpha = [&](const uint8_t* in, uint8_t* out) {
+        if (channels != 4) return;
+        for (int x = 0; x < width; ++x) out[x * 4 + 3] = in[x * 4 + 3];
     };
 
-    for (int y = 0; y < img.height; ++y)
+    if constexpr (K::kSeparable)
     {
-        for (int x = 0; x < img.width; ++x)
+        // Row pass over every source row the band needs, then the column pass over those sums.
+        const int rows = y1 - y0 + 2 * R;
+        scratch.row_sums.resize(static_cast<size_t>(rows) * n);
+        for (int v = 0; v < rows; ++v)
+        {
+            const uint8_t* in = source_row(y0 - R + v);
+            int32_t* sums = scratch.row_sums.data() + static_cast<size_t>(v) * n;
+            auto edge = [&](int x) {
+                for (int c = 0; c < channels; ++c)
+                    sums[x * channels + c] = stencil_row_sum<K>([&](int dx) { return sample_x(in, x + dx, c); });
+            };
+            for (int x = 0; x < inner_lo; ++x) edge(x);
+            for (size_t i = static_cast<size_t>(inner_lo) * channels; i < static_cast<size_t>(inner_hi) * channels; ++i)
+            {
+                sums[i] = stencil_row_sum<K>([&](int dx) { return static_cast<int>(in[i + dx * channels]); });
+            }
+            for (int x = inner_hi; x < width; ++x) edge(x);
+        }
+        for (int y = y0; y < y1; ++y)
         {
-            float sum_x = 0.0f;
-            float sum_y = 0.0f;
+            const int32_t* sums = scratch.row_sums.data() + static_cast<size_t>(y - y0 + R) * n;
+            uint8_t* out = dst + static_cast<size_t>(y - y0) * dst_stride;
+            for (size_t i = 0; i < n; ++i)
+            {
+                out[i] = K::finish(stencil_col_sum<K>([&](int dy) { return sums[static_cast<ptrdiff_t>(dy) * n + i]; }));
+            }
+            copy_alpha(src.row(y), out);
+        }
+        return;
+    }
 
-            for (int ky = -1; ky <= 1; ++ky)
+    for (int y = y0; y < y1; ++y)
+    {
+        const uint8_t* in[K::kSize];
+        for (int k = 0; k < K::kSize; ++k) in[k] = source_row(y - R + k);
+        uint8_t* out = dst + static_cast<size_t>(y - y0) * dst_stride;
+
+        auto edge = [&](int x) {
+            for (int c = 0; c < colour; ++c)
             {
-                for (int kx = -1; kx <= 1; ++kx)
+                out[x * channels + c] =
+                    K::finish(stencil_sum<K>([&](int dx, int dy) { return sample_x(in[dy + R], x + dx, c); }));
+            }
+        };
+        for (int x = 0; x < inner_lo; ++x) edge(x);
+        for (size_t i = static_cast<size_t>(inner_lo) * channels; i < static_cast<size_t>(inner_hi) * channels; ++i)
+        {
+            out[i] = K::finish(
+                stencil_sum<K>([&](int dx, int dy) { return static_cast<int>(in[dy + R][i + dx * channels]); }));
+        }
+        for (int x = inner_hi; x < width; ++x) edge(x);
+        copy_alpha(src.row(y), out); // the interior loop also wrote the 4th byte
+    }
+}
+
+void convolve_step_rows(const FilterStep& step, const RowBand& src, uint8_t* dst, size_t dst_stride, int y0, int y1,
+                        int width, int channels, StencilScratch& scratch)
+{
+    const uint8_t constant = static_cast<uint8_t>(std::clamp(std::lround(step.params[1]), 0L, 255L));
+    visit_stencil(step.kind, [&](auto k) {
+        convolve_rows<decltype(k)>(src, dst, dst_stride, y0, y1, width, channels, filter_border(step), constant, scratch);
+    });
+}
+
+// A fused pipeline segment: a run of point ops, Sobel, a convolution, or one box pass of a blur.
+struct Segment
+{
+    FilterKind stencil = FilterKind::Grayscale;
+    bool is_stencil = false;
+    BoxPass pass;                     // for BoxBlur segments
+    FilterStep step;                  // for convolution segments
+    std::vector<FilterStep> point_ops;
+    PointProgram program;             // point_ops compiled to composed tables
+};
+
+int segment_halo(const Segment& s)
+{
+    if (!s.is_stencil) return 0;
+    if (is_convolution(s.stencil)) return filter_halo(s.step);
+    return s.stencil == FilterKind::Sobel ? 1 : s.pass.radius;
+}
+
+// Span name for a segment's share of a band.
+const char* segment_name(const Segment& s)
+{
+    if (!s.is_stencil) return "point ops";
+    if (is_convolution(s.stencil)) return filter_kind_name(s.stencil);
+    return s.stencil == FilterKind::Sobel ? "sobel" : "box pass";
+}
+
+void stencil_rows(const Segment& s, const RowBand& src, uint8_t* dst, size_t dst_stride, int y0, int y1, int width,
+                  int channels, const CpuRowKernels* simd, StencilScratch& scratch)
+{
+    if (s.stencil == FilterKind::Sobel)
+    {
+        sobel_rows(src, dst, dst_stride, y0, y1, width, channels, channels, simd, scratch);
+    }
+    else if (is_convolution(s.stencil))
+    {
+        convolve_step_rows(s.step, src, dst, dst_stride, y0, y1, width, channels, scratch);
+    }
+    else if (s.pass.radius == 1 && !s.pass.round)
+    {
+        box_blur_rows(src, dst, dst_stride, y0, y1, width, channels, simd); // 3x3 has dedicated SIMD kernels
+    }
+    else
+    {
+        box_pass_rows(src, dst, dst_stride, y0, y1, width, channels, s.pass, scratch);
+    }
+}
+
+std::vector<Segment> fuse_chain(const FilterChain& chain)
+{
+    std::vector<Segment> segments;
+    for (const FilterStep& step : chain)
+    {
+        if (is_point_op(step.kind))
+        {
+            if (segments.empty() || segments.back().is_stencil) segments.emplace_back();
+            segments.back().point_ops.push_back(step);
+        }
+        else if (step.kind == FilterKind::Sobel || is_convolution(step.kind))
+        {
+            Segment s;
+            s.is_stencil = true;
+            s.stencil = step.kind;
+            s.step = step;
+            segments.push_back(std::move(s));
+        }
+        else
+        {
+            for (const BoxPass& pass : blur_passes(step))
+            {
+                Segment s;
+                s.is_stencil = true;
+                s.stencil = FilterKind::BoxBlur;
+                s.pass = pass;
+                segments.push_back(std::move(s));
+            }
+        }
+    }
+    for (Segment& s : segments)
+    {
+        if (!s.is_stencil) s.program = compile_point_ops(s.point_ops);
+    }
+    return segments;
+}
+} // namespace
+
+const CpuRowKernels* cpu_row_kernels(SimdLevel level)
+{
+#if defined(CUDAPIX_X86_SIMD)
+    switch (level)
+    {
+    case SimdLevel::AVX512: return cpu_has_avx512vbmi() ? &kAvx512VbmiRowKernels : &kAvx512RowKernels;
+    case SimdLevel::AVX2: return &kAvx2RowKernels;
+    case SimdLevel::SSE41: return &kSse41RowKernels;
+    case SimdLevel::Scalar: break;
+    }
+#else
+    (void)level;
+#endif
+    return nullptr;
+}
+
+// Every filter below is split into row bands on the shared work-stealing pool. Each pixel is computed
+// exactly as in the single-threaded version, so the output does not depend on the thread count.
+// The 3x3 stencils read from an untouched copy of the input, so a band's one-row halo above and
+// below is simply read from the neighbouring rows of that copy.
+// Within a band, the SIMD kernels from filters_cpu_simd.h take the bulk of each row; scalar code only
+// finishes short remainders of the point ops and the left/right border columns of the stencils.
+
+void cpu_grayscale(ImageView img)
+{
+    const CpuRowKernels* simd = kernels_for(img);
+    parallel_for_rows(img.height, img.row_bytes(), [&](int y0, int y1) {
+        TraceSpan span("grayscale", "filter");
+        // With packed rows a band is one contiguous run of pixels.
+        for_each_span(img, y0, y1, [&](uint8_t* base, size_t pixels) {
+            grayscale_span(base, pixels, img.channels, simd);
+        });
+    });
+}
+
+void cpu_point_lut(ImageView img, const PointLut& lut)
+{
+    const CpuRowKernels* simd = point_kernels_for(img);
+    parallel_for_rows(img.height, img.row_bytes(), [&](int y0, int y1) {
+        TraceSpan span("point ops", "filter");
+        for_each_span(img, y0, y1, [&](uint8_t* base, size_t pixels) {
+            lut_pixels(base, pixels, img.channels, lut, simd);
+        });
+    });
+}
+
+Histogram cpu_histogram(const ImageView& img)
+{
+    Histogram hist;
+    HistogramCollector collector(&hist, img.channels);
+    parallel_for_rows(img.height, img.row_bytes(), [&](int y0, int y1) {
+        TraceSpan span("histogram", "filter");
+        Histogram part = collector.local();
+        for_each_span(img, y0, y1, [&](const uint8_t* base, size_t pixels) {
+            accumulate_histogram(part, base, pixels, img.channels);
+        });
+        collector.merge(part);
+    });
+    return hist;
+}
+
+void cpu_brightness(ImageView img, float delta)
+{
+    cpu_point_lut(img, brightness_lut(delta));
+}
+
+void cpu_contrast(ImageView img, float factor)
+{
+    cpu_point_lut(img, contrast_lut(factor));
+}
+
+void cpu_gamma(ImageView img, float gamma)
+{
+    cpu_point_lut(img, gamma_lut(gamma));
+}
+
+void cpu_invert(ImageView img)
+{
+    cpu_point_lut(img, invert_lut());
+}
+
+void cpu_levels(ImageView img, float in_black, float in_white, float out_black, float out_white)
+{
+    cpu_point_lut(img, levels_lut(in_black, in_white, out_black, out_white));
+}
+
+void cpu_threshold(ImageView img, float level)
+{
+    cpu_point_lut(img, threshold_lut(level));
+}
+
+void cpu_box_blur(ImageView img, int radius)
+{
+    if (radius != 1)
+    {
+        FilterStep step{ FilterKind::BoxBlur };
+        step.params[0] = static_cast<float>(radius);
+        cpu_pipeline(img, { step });
+        return;
+    }
+
+    const CpuRowKernels* simd = kernels_for(img);
+    const size_t out_stride = img.row_bytes();
+    ScratchBuffer output = frame_output(out_stride * img.height);
+    const RowBand src{ img.data, 0, img.height, img.stride, img.height };
+
+    parallel_for_rows(img.height, out_stride, [&](int y0, int y1) {
+        TraceSpan span("box pass", "filter");
+        box_blur_rows(src, output.data() + static_cast<size_t>(y0) * out_stride, out_stride, y0, y1, img.width,
+                      img.channels, simd);
+    });
+
+    store_rows(output.data(), img);
+}
+
+void cpu_gaussian_blur(ImageView img, float sigma)
+{
+    FilterStep step{ FilterKind::GaussianBlur };
+    step.params[0] = sigma;
+    cpu_pipeline(img, { step });
+}
+
+void cpu_convolve(ImageView img, const FilterStep& step)
+{
+    if (!is_convolution(step.kind))
+        throw std::invalid_argument(std::string(filter_kind_name(step.kind)) + " is not a convolution");
+    if (img.empty()) return;
+
+    const size_t out_stride = img.row_bytes();
+    ScratchBuffer output = frame_output(out_stride * img.height);
+    const RowBand src{ img.data, 0, img.height, img.stride, img.height };
+
+    parallel_for_rows(img.height, out_stride, [&](int y0, int y1) {
+        TraceSpan span("convolve", "filter");
+        StencilScratch scratch;
+        convolve_step_rows(step, src, output.data() + static_cast<size_t>(y0) * out_stride, out_stride, y0, y1,
+                           img.width, img.channels, scratch);
+    });
+
+    store_rows(output.data(), img);
+}
+
+void cpu_sobel(ImageView img)
+{
+    const CpuRowKernels* simd = kernels_for(img);
+    const size_t out_stride = img.row_bytes();
+    ScratchBuffer output = frame_output(out_stride * img.height);
+    const RowBand src{ img.data, 0, img.height, img.stride, img.height };
+
+    parallel_for_rows(img.height, out_stride, [&](int y0, int y1) {
+        TraceSpan span("sobel", "filter");
+        StencilScratch scratch;
+        sobel_rows(src, output.data() + static_cast<size_t>(y0) * out_stride, out_stride, y0, y1, img.width,
+                   img.channels, img.channels, simd, scratch);
+    });
+
+    store_rows(output.data(), img);
+}
+
+Image cpu_sobel_magnitude(ImageView img, std::vector<uint8_t>* direction)
+{
+    TraceSpan span("sobel magnitude", "filter");
+    const CpuRowKernels* simd = kernels_for(img);
+    const RowBand src{ img.data, 0, img.height, img.stride, img.height };
+    const size_t width = static_cast<size_t>(img.width);
+
+    Image out;
+    out.width = img.width;
+    out.height = img.height;
+    out.channels = 1;
+    out.pixels.resize_uninitialized(width * img.height);
+    if (direction) direction->resize(out.pixels.size());
+
+    parallel_for_rows(img.height, img.row_bytes(), [&](int y0, int y1) {
+        StencilScratch scratch;
+        uint8_t* mag = out.pixels.data() + y0 * width;
+        if (direction)
+            gradient_rows(src, mag, direction->data() + y0 * width, y0, y1, img.width, img.channels, 255, simd, scratch);
+        else
+            sobel_rows(src, mag, width, y0, y1, img.width, img.channels, 1, simd, scratch);
+    });
+    return out;
+}
+
+void cpu_canny(ImageView img, float low, float high)
+{
+    if (low > high) std::swap(low, high);
+    TraceSpan span("canny", "filter");
+    const CpuRowKernels* simd = kernels_for(img);
+    const RowBand src{ img.data, 0, img.height, img.stride, img.height };
+    const int w = img.width;
+    const int h = img.height;
+    const size_t pixels = static_cast<size_t>(w) * h;
+
+    // Unclamped magnitudes, so thresholds above 255 and saturated regions still suppress properly.
+    // Every per-pixel buffer is written in full before it is read, so they come from the pool as is.
+    const ScratchBuffer magnitude_buffer = host_buffer_pool().scratch(pixels * sizeof(uint16_t));
+    const ScratchBuffer direction_buffer = host_buffer_pool().scratch(pixels);
+    const ScratchBuffer edges_buffer = host_buffer_pool().scratch(pixels);
+    const uint16_t* magnitude = magnitude_buffer.data<uint16_t>();
+    const uint8_t* direction = direction_buffer.data();
+    uint8_t* edges = edges_buffer.data();
+    parallel_for_rows(h, img.row_bytes(), [&](int y0, int y1) {
+        StencilScratch scratch;
+        const size_t first = static_cast<size_t>(y0) * w;
+        gradient_rows(src, magnitude_buffer.data<uint16_t>() + first, direction_buffer.data() + first, y0, y1, w,
+                      img.channels, 0xffff, simd, scratch);
+    });
+
+    // Non-maximum suppression along the gradient plus double threshold: 0 none, 1 weak, 2 strong.
+    // Ties are kept on one side only, so plateaus thin to a single pixel.
+    static const int kAxis[4][2] = { { 1, 0 }, { 1, -1 }, { 0, 1 }, { 1, 1 } }; // per EdgeDirection
+    parallel_for_rows(h, static_cast<size_t>(w) * 3, [&](int y0, int y1) {
+        auto mag_at = [&](int x, int y) {
+            return x < 0 || x >= w || y < 0 || y >= h ? 0 : magnitude[static_cast<size_t>(y) * w + x];
+        };
+        for (int y = y0; y < y1; ++y)
+        {
+            for (int x = 0; x < w; ++x)
+            {
+                const size_t i = static_cast<size_t>(y) * w + x;
+                const int m = magnitude[i];
+                const int* axis = kAxis[direction[i]];
+                const bool peak = m > mag_at(x - axis[0], y - axis[1]) && m >= mag_at(x + axis[0], y + axis[1]);
+                edges[i] = !peak || m < low ? 0 : (m >= high ? 2 : 1);
+            }
+        }
+    });
+
+    // Hysteresis: weak pixels 8-connected to a strong one through other weak pixels become edges.
+    TraceSpan hysteresis_span("canny hysteresis", "filter");
+    std::vector<size_t> stack;
+    for (size_t i = 0; i < pixels; ++i)
+    {
+        if (edges[i] == 2) stack.push_back(i);
+    }
+    while (!stack.empty())
+    {
+        const size_t i = stack.back();
+        stack.pop_back();
+        const int x = static_cast<int>(i % w);
+        const int y = static_cast<int>(i / w);
+        for (int dy = -1; dy <= 1; ++dy)
+        {
+            for (int dx = -1; dx <= 1; ++dx)
+            {
+                const int nx = x + dx;
+                const int ny = y + dy;
+                if (nx < 0 || nx >= w || ny < 0 || ny >= h) continue;
+                const size_t n = static_cast<size_t>(ny) * w + nx;
+                if (edges[n] != 1) continue;
+                edges[n] = 2;
+                stack.push_back(n);
+            }
+        }
+    }
+
+    parallel_for_rows(h, img.row_bytes(), [&](int y0, int y1) {
+        for (int y = y0; y < y1; ++y)
+        {
+            uint8_t* row = img.row(y);
+            const uint8_t* e = edges + static_cast<size_t>(y) * w;
+            for (int x = 0; x < w; ++x)
+            {
+                uint8_t* px = row + static_cast<size_t>(x) * img.channels;
+                std::memset(px, e[x] == 2 ? 255 : 0, std::min(img.channels, 3));
+            }
+        }
+    });
+}
+
+namespace
+{
+// One fused part of a chain (no global ops). `lead`, if given, is a table applied before the chain,
+// folded into its first point pass; `capture`, if given, receives the histogram of the result,
+// counted in the pass that writes it.
+void pipeline_fused(ImageView img, const FilterChain& chain, const PointLut* lead, Histogram* capture)
+{
+    std::vector<Segment> segments = fuse_chain(chain);
+    if (lead && !lead->is_identity())
+    {
+        if (segments.empty() || segments.front().is_stencil) segments.insert(segments.begin(), Segment{});
+        prepend_point_lut(segments.front().program, *lead);
+    }
+    if (segments.empty())
+    {
+        if (capture) *capture = cpu_histogram(img); // nothing to fuse with
+        return;
+    }
+
+    const CpuRowKernels* simd = kernels_for(img);
+    const CpuRowKernels* point_simd = point_kernels_for(img);
+    const size_t stride = img.row_bytes(); // of the packed band buffers
+    HistogramCollector collector(capture, img.channels);
+
+    int total_halo = 0;
+    for (const Segment& s : segments)
+    {
+        total_halo += segment_halo(s);
+    }
+
+    // Point ops only: one fused in-place pass.
+    if (total_halo == 0)
+    {
+        parallel_for_rows(img.height, stride, [&](int y0, int y1) {
+            TraceSpan span("point ops", "filter");
+            Histogram part = collector.local();
+            for_each_span(img, y0, y1, [&](uint8_t* base, size_t pixels) {
+                point_program_span(segments.front().program, base, pixels, img.channels, point_simd,
+                                   collector.active() ? &part : nullptr);
+            });
+            collector.merge(part);
+        });
+        return;
+    }
+
+    // Stencils present: every output band is produced from the source by running the whole chain on
+    // a band-sized working set that grows by each remaining stencil's halo. Intermediates live in
+    // per-thread scratch buffers that stay cache-resident; only the final rows reach `output`.
+    ScratchBuffer output = frame_output(stride * img.height);
+    const TuneParams& tuning = current_tuning();
+    const int band_rows = std::clamp(static_cast<int>(tuning.band_bytes / std::max<size_t>(stride, 1)),
+                                     std::max(4 * total_halo, 8), std::max(img.height, 1));
+    const int bands = (img.height + band_rows - 1) / band_rows;
+    const int grain = tuning.cpu_tasks > 0 ? (bands + tuning.cpu_tasks - 1) / tuning.cpu_tasks : 1;
+
+    cpu_thread_pool().parallel_for(bands, grain, [&](int b0, int b1) {
+        TuneScope tuned(tuning);
+        thread_local std::vector<uint8_t> cur;
+        thread_local std::vector<uint8_t> next;
+        thread_local StencilScratch scratch;
+        Histogram part = collector.local();
+
+        for (int band = b0; band < b1; ++band)
+        {
+            const int y0 = band * band_rows;
+            const int y1 = std::min(y0 + band_rows, img.height);
+
+            // Row range each segment has to produce, walking back from [y0, y1).
+            std::vector<std::pair<int, int>> ranges(segments.size() + 1);
+            ranges.back() = { y0, y1 };
+            for (size_t i = segments.size(); i-- > 0;)
+            {
+                const int halo = segment_halo(segments[i]);
+                ranges[i] = { std::max(ranges[i + 1].first - halo, 0), std::min(ranges[i + 1].second + halo, img.height) };
+            }
+
+            // Stage the source rows the first segment needs.
+            int lo = ranges.front().first;
+            int hi = ranges.front().second;
+            {
+                TraceSpan span("stage rows", "copy");
+                cur.resize(static_cast<size_t>(hi - lo) * stride);
+                for (int y = lo; y < hi; ++y)
                 {
-                    float g = sample_gray(x + kx, y + ky);
-                    sum_x += g * gx[ky + 1][kx + 1];
-                    sum_y += g * gy[ky + 1][kx + 1];
+                    std::memcpy(cur.data() + static_cast<size_t>(y - lo) * stride, img.row(y), stride);
                 }
             }
 
-            float mag = std::sqrt(sum_x * sum_x + sum_y * sum_y);
-            uint8_t out = clamp_byte(mag);
+            // Index of the last stencil; it writes straight into the output band.
+            size_t last_stencil = 0;
+            for (size_t i = 0; i < segments.size(); ++i)
+            {
+                if (segments[i].is_stencil) last_stencil = i;
+            }
 
-            int idx = (y * img.width + x) * stride;
-            output[idx] = output[idx + 1] = output[idx + 2] = out;
+            uint8_t* out_band = output.data() + static_cast<size_t>(y0) * stride;
+            for (size_t i = 0; i < segments.size(); ++i)
+            {
+                const Segment& s = segments[i];
+                const int out_lo = ranges[i + 1].first;
+                const int out_hi = ranges[i + 1].second;
+                TraceSpan span(segment_name(s), "filter");
+                if (!s.is_stencil)
+                {
+                    uint8_t* data = i > last_stencil ? out_band : cur.data();
+                    point_program_span(s.program, data, static_cast<size_t>(out_hi - out_lo) * img.width, img.channels,
+                                       point_simd);
+                    continue;
+                }
+
+                const RowBand src{ cur.data(), lo, hi, stride, img.height };
+                if (i == last_stencil)
+                {
+                    stencil_rows(s, src, out_band, stride, out_lo, out_hi, img.width, img.channels, simd, scratch);
+                }
+                else
+                {
+                    next.resize(static_cast<size_t>(out_hi - out_lo) * stride);
+                    stencil_rows(s, src, next.data(), stride, out_lo, out_hi, img.width, img.channels, simd, scratch);
+                    cur.swap(next);
+                }
+                lo = out_lo;
+                hi = out_hi;
+            }
+            if (collector.active())
+            {
+                TraceSpan span("histogram", "filter");
+                accumulate_histogram(part, out_band, static_cast<size_t>(y1 - y0) * img.width, img.channels);
+            }
         }
+        collector.merge(part);
+    });
+
+    store_rows(output.data(), img);
+}
+
+void pipeline_part(ImageView img, const FilterChain& chain, const PointLut* lead, Histogram* capture)
+{
+    // Canny, wrapped convolutions and the stats ops need the whole frame, so they split the chain;
+    // the parts around them are fused as usual. A stats op's histogram is captured by the pass that
+    // writes its input, and its table rides along with the first pass after it.
+    for (size_t i = 0; i < chain.size(); ++i)
+    {
+        if (!is_global_op(chain[i])) continue;
+        const FilterChain prefix(chain.begin(), chain.begin() + i);
+        const FilterChain suffix(chain.begin() + i + 1, chain.end());
+        if (is_stats_op(chain[i].kind))
+        {
+            Histogram hist;
+            pipeline_part(img, prefix, lead, &hist);
+            const PointLut lut = stats_lut(chain[i], hist);
+            pipeline_part(img, suffix, &lut, capture);
+            return;
+        }
+        pipeline_part(img, prefix, lead, nullptr);
+        if (chain[i].kind == FilterKind::Canny)
+            cpu_canny(img, chain[i].params[0], chain[i].params[1]);
+        else
+            cpu_convolve(img, chain[i]);
+        pipeline_part(img, suffix, nullptr, capture);
+        return;
     }
+    pipeline_fused(img, chain, lead, capture);
+}
+} // namespace
 
-    img.pixels.swap(output);
+void cpu_pipeline(ImageView img, const FilterChain& chain)
+{
+    if (chain.empty() || img.empty()) return;
+    pipeline_part(img, chain, nullptr, nullptr);
 }
@@ -1,11 +1,52 @@
 // src/core/filters_cpu.h
 #pragma once
 
+#include "edges.h"
+#include "filter_chain.h"
 #include "image.h"
 
-// CPU implementations of the same filters used on the GPU. Operate in-place on RGB8 data.
-void cpu_grayscale(Image& img);
-void cpu_brightness(Image& img, float delta); // [-1, 1]
-void cpu_contrast(Image& img, float factor);  // > 0
-void cpu_box_blur(Image& img);                // 3x3 blur
-void cpu_sobel(Image& img);                   // edge detection, grayscale
+// CPU implementations of the same filters used on the GPU. Operate in-place on RGB8 data given as
+// an ImageView (an Image converts implicitly), so strided and cropped buffers work too.
+// Work is split into row bands on the shared pool from thread_pool.h; see set_cpu_thread_count().
+void cpu_grayscale(ImageView img);
+void cpu_brightness(ImageView img, float delta); // [-1, 1]
+void cpu_contrast(ImageView img, float factor);  // > 0
+void cpu_gamma(ImageView img, float gamma);      // > 0, > 1 brightens
+void cpu_invert(ImageView img);
+void cpu_levels(ImageView img, float in_black, float in_white, float out_black = 0.0f, float out_white = 255.0f);
+void cpu_threshold(ImageView img, float level);  // [0, 255]
+void cpu_sobel(ImageView img);                   // edge detection, grayscale
+
+// Sobel magnitude as a single-channel image (the value cpu_sobel() writes to all three channels).
+// If `direction` is given it receives one EdgeDirection per pixel (see edges.h).
+Image cpu_sobel_magnitude(ImageView img, std::vector<uint8_t>* direction = nullptr);
+
+// Canny edges: Sobel gradients, non-maximum suppression along the gradient direction, then
+// hysteresis between `low` and `high` (gradient magnitudes, 0..1443). Writes 255 on edges, 0 elsewhere.
+void cpu_canny(ImageView img, float low, float high);
+
+// Edge-clamped (2r+1)^2 box blur and a Gaussian approximated by three box passes. Both run as
+// separable running sums, so the cost per pixel does not grow with the radius / sigma.
+void cpu_box_blur(ImageView img, int radius = 1);
+void cpu_gaussian_blur(ImageView img, float sigma);
+
+// Sharpen, Laplacian, Emboss or Gaussian5 (is_convolution()) over the whole frame with the step's
+// border mode; the kernels are the compile-time Stencils of stencil.h.
+void cpu_convolve(ImageView img, const FilterStep& step);
+
+// Applies any per-channel 256-entry table (see point_lut.h); all point ops except grayscale go
+// through this, so composing several tables first makes a chain of them cost a single pass.
+struct PointLut;
+void cpu_point_lut(ImageView img, const PointLut& lut);
+
+// Histogram of the colour channels (histogram.h), counted by row bands into per-task tables that are
+// merged at the end.
+struct Histogram;
+Histogram cpu_histogram(const ImageView& img);
+
+// Runs a whole chain with adjacent point ops fused and stencils evaluated band by band, so
+// intermediates stay in per-thread cache-sized buffers. Matches running the cpu_* calls in order.
+// Autolevels / equalize take their histogram from the pass before them and fold their table into
+// the pass after, so they only cost a pass of their own where nothing fusable precedes them (at the
+// start of the chain or right after Canny).
+void cpu_pipeline(ImageView img, const FilterChain& chain);
@@ -0,0 +1,261 @@
+// src/core/filters_cpu_avx2.cpp
+// AVX2 row kernels (32 bytes / 8 pixels per step). Compiled with -mavx2 -ffp-contract=off.
+#include "filters_cpu_simd.h"
+
+#include <immintrin.h>
+
+#include <cstring>
+
+namespace
+{
+inline __m256i clamp_to_byte_lanes(__m256 v)
+{
+    v = _mm256_max_ps(_mm256_min_ps(v, _mm256_set1_ps(255.0f)), _mm256_setzero_ps());
+    return _mm256_cvttps_epi32(_mm256_add_ps(v, _mm256_set1_ps(0.5f)));
+}
+
+// 8 interleaved RGB pixels starting at p (reads 28 bytes) as float r, g, b lanes.
+inline void deinterleave8(const uint8_t* p, __m256& r, __m256& g, __m256& b)
+{
+    const __m256i mr = _mm256_setr_epi8(0, -1, -1, -1, 3, -1, -1, -1, 6, -1, -1, -1, 9, -1, -1, -1,
+                                        0, -1, -1, -1, 3, -1, -1, -1, 6, -1, -1, -1, 9, -1, -1, -1);
+    const __m256i mg = _mm256_setr_epi8(1, -1, -1, -1, 4, -1, -1, -1, 7, -1, -1, -1, 10, -1, -1, -1,
+                                        1, -1, -1, -1, 4, -1, -1, -1, 7, -1, -1, -1, 10, -1, -1, -1);
+    const __m256i mb = _mm256_setr_epi8(2, -1, -1, -1, 5, -1, -1, -1, 8, -1, -1, -1, 11, -1, -1, -1,
+                                        2, -1, -1, -1, 5, -1, -1, -1, 8, -1, -1, -1, 11, -1, -1, -1);
+    __m256i v = _mm256_inserti128_si256(
+        _mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))),
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 12)), 1);
+    r = _mm256_cvtepi32_ps(_mm256_shuffle_epi8(v, mr));
+    g = _mm256_cvtepi32_ps(_mm256_shuffle_epi8(v, mg));
+    b = _mm256_cvtepi32_ps(_mm256_shuffle_epi8(v, mb));
+}
+
+inline __m256 luma8(__m256 r, __m256 g, __m256 b)
+{
+    __m256 sum = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(0.299f), r), _mm256_mul_ps(_mm256_set1_ps(0.587f), g));
+    return _mm256_add_ps(sum, _mm256_mul_ps(_mm256_set1_ps(0.114f), b));
+}
+
+inline void store12(uint8_t* dst, __m128i rgb)
+{
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(dst), rgb);
+    const int tail = _mm_extract_epi32(rgb, 2);
+    std::memcpy(dst + 8, &tail, 4);
+}
+
+// Writes 8 int32 byte values as 8 gray RGB pixels (24 bytes) without touching the bytes after them.
+inline void store_gray_rgb8(uint8_t* dst, __m256i values)
+{
+    const __m256i rep = _mm256_setr_epi8(0, 0, 0, 4, 4, 4, 8, 8, 8, 12, 12, 12, -1, -1, -1, -1,
+                                         0, 0, 0, 4, 4, 4, 8, 8, 8, 12, 12, 12, -1, -1, -1, -1);
+    __m256i rgb = _mm256_shuffle_epi8(values, rep);
+    store12(dst, _mm256_castsi256_si128(rgb));
+    store12(dst + 12, _mm256_extracti128_si256(rgb, 1));
+}
+
+size_t grayscale_avx2(uint8_t* rgb, size_t pixels)
+{
+    size_t x = 0;
+    for (; (x + 8) * 3 + 4 <= pixels * 3; x += 8)
+    {
+        __m256 r, g, b;
+        deinterleave8(rgb + x * 3, r, g, b);
+        store_gray_rgb8(rgb + x * 3, clamp_to_byte_lanes(luma8(r, g, b)));
+    }
+    return x;
+}
+
+size_t lut_avx2(uint8_t* data, size_t bytes, const uint8_t* table)
+{
+    // The table is split into 16 rows of 16 bytes indexed by the low nibble. For row k the index
+    // x - 16k is pushed through a saturating add so only bytes with high nibble k keep bit 7 clear;
+    // pshufb zeroes every other lane, and OR-ing the 16 partial lookups yields the full result.
+    __m256i rows[16];
+    for (int k = 0; k < 16; ++k)
+    {
+        rows[k] = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(table + 16 * k)));
+    }
+    const __m256i sixteen = _mm256_set1_epi8(16);
+    const __m256i bias = _mm256_set1_epi8(0x70);
+
+    size_t i = 0;
+    for (; i + 32 <= bytes; i += 32)
+    {
+        __m256i idx = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        __m256i result = _mm256_setzero_si256();
+        for (int k = 0; k < 16; ++k)
+        {
+            result = _mm256_or_si256(result, _mm256_shuffle_epi8(rows[k], _mm256_adds_epu8(idx, bias)));
+            idx = _mm256_sub_epi8(idx, sixteen);
+        }
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(data + i), result);
+    }
+    return i;
+}
+
+// Fixed-point luma (see luma8_4() in the SSE4.1 kernels) of 8 pixels, lanes 0-3 / 4-7 per half.
+inline __m256i luma8_8(const uint8_t* p)
+{
+    const __m256i mrg = _mm256_broadcastsi128_si256(_mm_setr_epi8(0, -1, 1, -1, 3, -1, 4, -1, 6, -1, 7, -1, 9, -1, 10, -1));
+    const __m256i mb = _mm256_broadcastsi128_si256(_mm_setr_epi8(2, -1, -1, -1, 5, -1, -1, -1, 8, -1, -1, -1, 11, -1, -1, -1));
+    const __m256i wrg = _mm256_set1_epi32((19235 << 16) | 9798);
+    const __m256i wb = _mm256_set1_epi32(3735);
+    __m256i v = _mm256_inserti128_si256(
+        _mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))),
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 12)), 1);
+    __m256i sum = _mm256_add_epi32(_mm256_madd_epi16(_mm256_shuffle_epi8(v, mrg), wrg),
+                                   _mm256_madd_epi16(_mm256_shuffle_epi8(v, mb), wb));
+    return _mm256_srli_epi32(_mm256_add_epi32(sum, _mm256_set1_epi32(1 << 14)), 15);
+}
+
+size_t luma_avx2(const uint8_t* rgb, uint8_t* gray, size_t pixels)
+{
+    size_t x = 0;
+    for (; (x + 16) * 3 + 4 <= pixels * 3; x += 16)
+    {
+        __m256i lo = luma8_8(rgb + x * 3);
+        __m256i hi = luma8_8(rgb + x * 3 + 24);
+        // Lane-wise packs leave the dwords as pixels 0-3, 8-11 | 4-7, 12-15; one permute restores order.
+        __m256i packed = _mm256_packus_epi16(_mm256_packs_epi32(lo, hi), _mm256_setzero_si256());
+        packed = _mm256_permutevar8x32_epi32(packed, _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(gray + x), _mm256_castsi256_si128(packed));
+    }
+    return x;
+}
+
+inline __m256i widen_sum3(const uint8_t* p, __m256i& hi)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p - 3));
+    __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    __m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 3));
+    hi = _mm256_add_epi16(_mm256_add_epi16(_mm256_unpackhi_epi8(a, zero), _mm256_unpackhi_epi8(b, zero)),
+                          _mm256_unpackhi_epi8(c, zero));
+    return _mm256_add_epi16(_mm256_add_epi16(_mm256_unpacklo_epi8(a, zero), _mm256_unpacklo_epi8(b, zero)),
+                            _mm256_unpacklo_epi8(c, zero));
+}
+
+bool box_blur_avx2(const uint8_t* above, const uint8_t* row, const uint8_t* below, uint8_t* out, int width)
+{
+    const size_t begin = 3;
+    const size_t end = static_cast<size_t>(width - 1) * 3;
+    if (width < 2 || end - begin < 32) return false;
+
+    const __m256i div9 = _mm256_set1_epi16(7282); // exact sum / 9 for sums <= 2295
+    auto step = [&](size_t i) {
+        __m256i h0, h1, h2;
+        __m256i l0 = widen_sum3(above + i, h0);
+        __m256i l1 = widen_sum3(row + i, h1);
+        __m256i l2 = widen_sum3(below + i, h2);
+        __m256i lo = _mm256_mulhi_epu16(_mm256_add_epi16(_mm256_add_epi16(l0, l1), l2), div9);
+        __m256i hi = _mm256_mulhi_epu16(_mm256_add_epi16(_mm256_add_epi16(h0, h1), h2), div9);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_packus_epi16(lo, hi));
+    };
+    size_t i = begin;
+    for (; i + 32 <= end; i += 32) step(i);
+    if (i < end) step(end - 32);
+    return true;
+}
+
+inline __m256i load16_u16(const uint8_t* p)
+{
+    return _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+}
+
+// Writes 16 bytes as 16 gray RGB pixels (48 bytes).
+inline void store_gray_rgb16(uint8_t* dst, __m128i m)
+{
+    const __m128i rep0 = _mm_setr_epi8(0, 0, 0, 1, 1, 1, 2, 2, 2, 3, 3, 3, 4, 4, 4, 5);
+    const __m128i rep1 = _mm_setr_epi8(5, 5, 6, 6, 6, 7, 7, 7, 8, 8, 8, 9, 9, 9, 10, 10);
+    const __m128i rep2 = _mm_setr_epi8(10, 11, 11, 11, 12, 12, 12, 13, 13, 13, 14, 14, 14, 15, 15, 15);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm_shuffle_epi8(m, rep0));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 16), _mm_shuffle_epi8(m, rep1));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 32), _mm_shuffle_epi8(m, rep2));
+}
+
+bool sobel_avx2(const uint8_t* above, const uint8_t* row, const uint8_t* below, uint8_t* out, int width,
+                int out_channels)
+{
+    if (width - 2 < 16) return false;
+
+    auto step = [&](int x) {
+        __m256i a0 = load16_u16(above + x - 1), a1 = load16_u16(above + x), a2 = load16_u16(above + x + 1);
+        __m256i r0 = load16_u16(row + x - 1), r2 = load16_u16(row + x + 1);
+        __m256i b0 = load16_u16(below + x - 1), b1 = load16_u16(below + x), b2 = load16_u16(below + x + 1);
+
+        __m256i gx = _mm256_add_epi16(_mm256_add_epi16(_mm256_sub_epi16(a2, a0), _mm256_sub_epi16(b2, b0)),
+                                      _mm256_slli_epi16(_mm256_sub_epi16(r2, r0), 1));
+        __m256i gy = _mm256_sub_epi16(_mm256_add_epi16(_mm256_add_epi16(a0, a2), _mm256_slli_epi16(a1, 1)),
+                                      _mm256_add_epi16(_mm256_add_epi16(b0, b2), _mm256_slli_epi16(b1, 1)));
+
+        // Per-lane unpack/pack round trip keeps pixel order; see sobel_magnitude8() in the SSE4.1 kernels.
+        const __m256 half = _mm256_set1_ps(0.5f);
+        __m256i lo = _mm256_unpacklo_epi16(gx, gy);
+        __m256i hi = _mm256_unpackhi_epi16(gx, gy);
+        __m256i mlo = _mm256_cvttps_epi32(_mm256_add_ps(_mm256_sqrt_ps(_mm256_cvtepi32_ps(_mm256_madd_epi16(lo, lo))), half));
+        __m256i mhi = _mm256_cvttps_epi32(_mm256_add_ps(_mm256_sqrt_ps(_mm256_cvtepi32_ps(_mm256_madd_epi16(hi, hi))), half));
+        __m256i m16 = _mm256_packs_epi32(mlo, mhi);
+        __m256i bytes = _mm256_permute4x64_epi64(_mm256_packus_epi16(m16, m16), _MM_SHUFFLE(3, 1, 2, 0));
+        __m128i m = _mm256_castsi256_si128(bytes);
+
+        if (out_channels == 1)
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + x), m);
+        else
+            store_gray_rgb16(out + x * 3, m);
+    };
+    int x = 1;
+    for (; x + 16 <= width - 1; x += 16) step(x);
+    if (x < width - 1) step(width - 1 - 16);
+    return true;
+}
+
+// madd_rows16() of the SSE4.1 kernels on every 128-bit lane: unpacks stay within lanes, so sum[j]
+// holds bytes 4j..4j+3 of each lane; the lane-wise packs below put them back in order.
+inline void madd_rows32(__m256i a, __m256i b, __m256i w, __m256i (&sum)[4])
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i lo = _mm256_unpacklo_epi8(a, b);
+    const __m256i hi = _mm256_unpackhi_epi8(a, b);
+    sum[0] = _mm256_add_epi32(sum[0], _mm256_madd_epi16(_mm256_unpacklo_epi8(lo, zero), w));
+    sum[1] = _mm256_add_epi32(sum[1], _mm256_madd_epi16(_mm256_unpackhi_epi8(lo, zero), w));
+    sum[2] = _mm256_add_epi32(sum[2], _mm256_madd_epi16(_mm256_unpacklo_epi8(hi, zero), w));
+    sum[3] = _mm256_add_epi32(sum[3], _mm256_madd_epi16(_mm256_unpackhi_epi8(hi, zero), w));
+}
+
+inline __m256i load32(const uint8_t* p)
+{
+    return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+}
+
+size_t resample_rows_avx2(const uint8_t* const* rows, const int16_t* weights, int taps, uint8_t* out,
+                          size_t bytes)
+{
+    const __m256i round = _mm256_set1_epi32(1 << 13);
+    size_t i = 0;
+    for (; i + 32 <= bytes; i += 32)
+    {
+        __m256i sum[4] = { round, round, round, round };
+        int k = 0;
+        for (; k + 1 < taps; k += 2)
+        {
+            madd_rows32(load32(rows[k] + i), load32(rows[k + 1] + i),
+                        _mm256_set1_epi32(pair_weights(weights[k], weights[k + 1])), sum);
+        }
+        if (k < taps)
+        {
+            madd_rows32(load32(rows[k] + i), _mm256_setzero_si256(), _mm256_set1_epi32(pair_weights(weights[k], 0)),
+                        sum);
+        }
+        const __m256i lo = _mm256_packs_epi32(_mm256_srai_epi32(sum[0], 14), _mm256_srai_epi32(sum[1], 14));
+        const __m256i hi = _mm256_packs_epi32(_mm256_srai_epi32(sum[2], 14), _mm256_srai_epi32(sum[3], 14));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_packus_epi16(lo, hi));
+    }
+    return i;
+}
+} // namespace
+
+const CpuRowKernels kAvx2RowKernels = {
+    grayscale_avx2, lut_avx2, luma_avx2, box_blur_avx2, sobel_avx2,
+    resample_rows_avx2, resample_pixels_sse41,
+};
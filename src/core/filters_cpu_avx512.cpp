@@ -0,0 +1,286 @@
+// src/core/filters_cpu_avx512.cpp
+// AVX-512 (F + BW) row kernels (64 bytes / 16 pixels per step). Compiled with
+// -mavx512f -mavx512bw -ffp-contract=off; the latter matters here because AVX-512F implies FMA.
+#include "filters_cpu_simd.h"
+
+#include <immintrin.h>
+
+#include <cstring>
+
+namespace
+{
+inline __m512i clamp_to_byte_lanes(__m512 v)
+{
+    v = _mm512_max_ps(_mm512_min_ps(v, _mm512_set1_ps(255.0f)), _mm512_setzero_ps());
+    return _mm512_cvttps_epi32(_mm512_add_ps(v, _mm512_set1_ps(0.5f)));
+}
+
+inline __mmask64 tail_mask(size_t count) // count < 64
+{
+    return (__mmask64(1) << count) - 1;
+}
+
+// 16 interleaved RGB pixels starting at p (reads 52 bytes) as float r, g, b lanes.
+inline void deinterleave16(const uint8_t* p, __m512& r, __m512& g, __m512& b)
+{
+    const __m512i mr = _mm512_broadcast_i32x4(_mm_setr_epi8(0, -1, -1, -1, 3, -1, -1, -1, 6, -1, -1, -1, 9, -1, -1, -1));
+    const __m512i mg = _mm512_broadcast_i32x4(_mm_setr_epi8(1, -1, -1, -1, 4, -1, -1, -1, 7, -1, -1, -1, 10, -1, -1, -1));
+    const __m512i mb = _mm512_broadcast_i32x4(_mm_setr_epi8(2, -1, -1, -1, 5, -1, -1, -1, 8, -1, -1, -1, 11, -1, -1, -1));
+    __m512i v = _mm512_castsi128_si512(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+    v = _mm512_inserti32x4(v, _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 12)), 1);
+    v = _mm512_inserti32x4(v, _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 24)), 2);
+    v = _mm512_inserti32x4(v, _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 36)), 3);
+    r = _mm512_cvtepi32_ps(_mm512_shuffle_epi8(v, mr));
+    g = _mm512_cvtepi32_ps(_mm512_shuffle_epi8(v, mg));
+    b = _mm512_cvtepi32_ps(_mm512_shuffle_epi8(v, mb));
+}
+
+inline __m512 luma16(__m512 r, __m512 g, __m512 b)
+{
+    __m512 sum = _mm512_add_ps(_mm512_mul_ps(_mm512_set1_ps(0.299f), r), _mm512_mul_ps(_mm512_set1_ps(0.587f), g));
+    return _mm512_add_ps(sum, _mm512_mul_ps(_mm512_set1_ps(0.114f), b));
+}
+
+inline void store12(uint8_t* dst, __m128i rgb)
+{
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(dst), rgb);
+    const int tail = _mm_extract_epi32(rgb, 2);
+    std::memcpy(dst + 8, &tail, 4);
+}
+
+// Writes 16 int32 byte values as 16 gray RGB pixels (48 bytes) without touching the bytes after them.
+inline void store_gray_rgb16(uint8_t* dst, __m512i values)
+{
+    const __m512i rep = _mm512_broadcast_i32x4(_mm_setr_epi8(0, 0, 0, 4, 4, 4, 8, 8, 8, 12, 12, 12, -1, -1, -1, -1));
+    __m512i rgb = _mm512_shuffle_epi8(values, rep);
+    store12(dst, _mm512_castsi512_si128(rgb));
+    store12(dst + 12, _mm512_extracti32x4_epi32(rgb, 1));
+    store12(dst + 24, _mm512_extracti32x4_epi32(rgb, 2));
+    store12(dst + 36, _mm512_extracti32x4_epi32(rgb, 3));
+}
+
+size_t grayscale_avx512(uint8_t* rgb, size_t pixels)
+{
+    size_t x = 0;
+    for (; (x + 16) * 3 + 4 <= pixels * 3; x += 16)
+    {
+        __m512 r, g, b;
+        deinterleave16(rgb + x * 3, r, g, b);
+        store_gray_rgb16(rgb + x * 3, clamp_to_byte_lanes(luma16(r, g, b)));
+    }
+    return x;
+}
+
+size_t lut_avx512(uint8_t* data, size_t bytes, const uint8_t* table)
+{
+    // 16 pshufb lookups into the 16-byte table rows (see lut_avx2()); the tail uses masked loads.
+    __m512i rows[16];
+    for (int k = 0; k < 16; ++k)
+    {
+        rows[k] = _mm512_broadcast_i32x4(_mm_loadu_si128(reinterpret_cast<const __m128i*>(table + 16 * k)));
+    }
+    const __m512i sixteen = _mm512_set1_epi8(16);
+    const __m512i bias = _mm512_set1_epi8(0x70);
+
+    auto step = [&](size_t i, __mmask64 mask) {
+        __m512i idx = _mm512_maskz_loadu_epi8(mask, data + i);
+        __m512i result = _mm512_setzero_si512();
+        for (int k = 0; k < 16; ++k)
+        {
+            result = _mm512_or_si512(result, _mm512_shuffle_epi8(rows[k], _mm512_adds_epu8(idx, bias)));
+            idx = _mm512_sub_epi8(idx, sixteen);
+        }
+        _mm512_mask_storeu_epi8(data + i, mask, result);
+    };
+    size_t i = 0;
+    for (; i + 64 <= bytes; i += 64) step(i, ~__mmask64(0));
+    if (i < bytes) step(i, tail_mask(bytes - i));
+    return bytes;
+}
+
+// Two vpermi2b lookups cover table[0..127] and table[128..255]; bit 7 of the index picks between them.
+__attribute__((target("avx512f,avx512bw,avx512vbmi"))) size_t lut_avx512vbmi(uint8_t* data, size_t bytes,
+                                                                             const uint8_t* table)
+{
+    const __m512i t0 = _mm512_loadu_si512(table);
+    const __m512i t1 = _mm512_loadu_si512(table + 64);
+    const __m512i t2 = _mm512_loadu_si512(table + 128);
+    const __m512i t3 = _mm512_loadu_si512(table + 192);
+
+    // A plain loop rather than a step lambda: lambdas do not inherit the target attribute.
+    for (size_t i = 0; i < bytes; i += 64)
+    {
+        const __mmask64 mask = bytes - i >= 64 ? ~__mmask64(0) : tail_mask(bytes - i);
+        __m512i idx = _mm512_maskz_loadu_epi8(mask, data + i);
+        __m512i low = _mm512_permutex2var_epi8(t0, idx, t1);
+        __m512i high = _mm512_permutex2var_epi8(t2, idx, t3);
+        _mm512_mask_storeu_epi8(data + i, mask, _mm512_mask_blend_epi8(_mm512_movepi8_mask(idx), low, high));
+    }
+    return bytes;
+}
+
+// Fixed-point luma (see luma8_4() in the SSE4.1 kernels) of 16 pixels, 4 per 128-bit lane.
+size_t luma_avx512(const uint8_t* rgb, uint8_t* gray, size_t pixels)
+{
+    const __m512i mrg = _mm512_broadcast_i32x4(_mm_setr_epi8(0, -1, 1, -1, 3, -1, 4, -1, 6, -1, 7, -1, 9, -1, 10, -1));
+    const __m512i mb = _mm512_broadcast_i32x4(_mm_setr_epi8(2, -1, -1, -1, 5, -1, -1, -1, 8, -1, -1, -1, 11, -1, -1, -1));
+    const __m512i wrg = _mm512_set1_epi32((19235 << 16) | 9798);
+    const __m512i wb = _mm512_set1_epi32(3735);
+
+    size_t x = 0;
+    for (; (x + 16) * 3 + 4 <= pixels * 3; x += 16)
+    {
+        const uint8_t* p = rgb + x * 3;
+        __m512i v = _mm512_castsi128_si512(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+        v = _mm512_inserti32x4(v, _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 12)), 1);
+        v = _mm512_inserti32x4(v, _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 24)), 2);
+        v = _mm512_inserti32x4(v, _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 36)), 3);
+        __m512i sum = _mm512_add_epi32(_mm512_madd_epi16(_mm512_shuffle_epi8(v, mrg), wrg),
+                                       _mm512_madd_epi16(_mm512_shuffle_epi8(v, mb), wb));
+        __m512i y = _mm512_srli_epi32(_mm512_add_epi32(sum, _mm512_set1_epi32(1 << 14)), 15);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(gray + x), _mm512_cvtepi32_epi8(y));
+    }
+    return x;
+}
+
+inline __m512i widen_sum3(const uint8_t* p, __m512i& hi)
+{
+    const __m512i zero = _mm512_setzero_si512();
+    __m512i a = _mm512_loadu_si512(p - 3);
+    __m512i b = _mm512_loadu_si512(p);
+    __m512i c = _mm512_loadu_si512(p + 3);
+    hi = _mm512_add_epi16(_mm512_add_epi16(_mm512_unpackhi_epi8(a, zero), _mm512_unpackhi_epi8(b, zero)),
+                          _mm512_unpackhi_epi8(c, zero));
+    return _mm512_add_epi16(_mm512_add_epi16(_mm512_unpacklo_epi8(a, zero), _mm512_unpacklo_epi8(b, zero)),
+                            _mm512_unpacklo_epi8(c, zero));
+}
+
+bool box_blur_avx512(const uint8_t* above, const uint8_t* row, const uint8_t* below, uint8_t* out, int width)
+{
+    const size_t begin = 3;
+    const size_t end = static_cast<size_t>(width - 1) * 3;
+    if (width < 2 || end - begin < 64) return false;
+
+    const __m512i div9 = _mm512_set1_epi16(7282); // exact sum / 9 for sums <= 2295
+    auto step = [&](size_t i) {
+        __m512i h0, h1, h2;
+        __m512i l0 = widen_sum3(above + i, h0);
+        __m512i l1 = widen_sum3(row + i, h1);
+        __m512i l2 = widen_sum3(below + i, h2);
+        __m512i lo = _mm512_mulhi_epu16(_mm512_add_epi16(_mm512_add_epi16(l0, l1), l2), div9);
+        __m512i hi = _mm512_mulhi_epu16(_mm512_add_epi16(_mm512_add_epi16(h0, h1), h2), div9);
+        _mm512_storeu_si512(out + i, _mm512_packus_epi16(lo, hi));
+    };
+    size_t i = begin;
+    for (; i + 64 <= end; i += 64) step(i);
+    if (i < end) step(end - 64);
+    return true;
+}
+
+inline __m512i load32_u16(const uint8_t* p)
+{
+    return _mm512_cvtepu8_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)));
+}
+
+// Writes 16 bytes as 16 gray RGB pixels (48 bytes).
+inline void store_gray_rgb16_bytes(uint8_t* dst, __m128i m)
+{
+    const __m128i rep0 = _mm_setr_epi8(0, 0, 0, 1, 1, 1, 2, 2, 2, 3, 3, 3, 4, 4, 4, 5);
+    const __m128i rep1 = _mm_setr_epi8(5, 5, 6, 6, 6, 7, 7, 7, 8, 8, 8, 9, 9, 9, 10, 10);
+    const __m128i rep2 = _mm_setr_epi8(10, 11, 11, 11, 12, 12, 12, 13, 13, 13, 14, 14, 14, 15, 15, 15);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm_shuffle_epi8(m, rep0));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 16), _mm_shuffle_epi8(m, rep1));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 32), _mm_shuffle_epi8(m, rep2));
+}
+
+bool sobel_avx512(const uint8_t* above, const uint8_t* row, const uint8_t* below, uint8_t* out, int width,
+                  int out_channels)
+{
+    if (width - 2 < 32) return false;
+
+    auto step = [&](int x) {
+        __m512i a0 = load32_u16(above + x - 1), a1 = load32_u16(above + x), a2 = load32_u16(above + x + 1);
+        __m512i r0 = load32_u16(row + x - 1), r2 = load32_u16(row + x + 1);
+        __m512i b0 = load32_u16(below + x - 1), b1 = load32_u16(below + x), b2 = load32_u16(below + x + 1);
+
+        __m512i gx = _mm512_add_epi16(_mm512_add_epi16(_mm512_sub_epi16(a2, a0), _mm512_sub_epi16(b2, b0)),
+                                      _mm512_slli_epi16(_mm512_sub_epi16(r2, r0), 1));
+        __m512i gy = _mm512_sub_epi16(_mm512_add_epi16(_mm512_add_epi16(a0, a2), _mm512_slli_epi16(a1, 1)),
+                                      _mm512_add_epi16(_mm512_add_epi16(b0, b2), _mm512_slli_epi16(b1, 1)));
+
+        const __m512 half = _mm512_set1_ps(0.5f);
+        __m512i lo = _mm512_unpacklo_epi16(gx, gy);
+        __m512i hi = _mm512_unpackhi_epi16(gx, gy);
+        __m512i mlo = _mm512_cvttps_epi32(_mm512_add_ps(_mm512_sqrt_ps(_mm512_cvtepi32_ps(_mm512_madd_epi16(lo, lo))), half));
+        __m512i mhi = _mm512_cvttps_epi32(_mm512_add_ps(_mm512_sqrt_ps(_mm512_cvtepi32_ps(_mm512_madd_epi16(hi, hi))), half));
+        // Magnitudes are <= 1443, so the unsigned-saturating narrow doubles as min(255, m).
+        __m256i m = _mm512_cvtusepi16_epi8(_mm512_packs_epi32(mlo, mhi));
+
+        if (out_channels == 1)
+        {
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + x), m);
+            return;
+        }
+        store_gray_rgb16_bytes(out + x * 3, _mm256_castsi256_si128(m));
+        store_gray_rgb16_bytes(out + x * 3 + 48, _mm256_extracti128_si256(m, 1));
+    };
+    int x = 1;
+    for (; x + 32 <= width - 1; x += 32) step(x);
+    if (x < width - 1) step(width - 1 - 32);
+    return true;
+}
+
+// madd_rows16() of the SSE4.1 kernels on every 128-bit lane: unpacks stay within lanes, so sum[j]
+// holds bytes 4j..4j+3 of each lane; the lane-wise packs below put them back in order.
+inline void madd_rows64(__m512i a, __m512i b, __m512i w, __m512i (&sum)[4])
+{
+    const __m512i zero = _mm512_setzero_si512();
+    const __m512i lo = _mm512_unpacklo_epi8(a, b);
+    const __m512i hi = _mm512_unpackhi_epi8(a, b);
+    sum[0] = _mm512_add_epi32(sum[0], _mm512_madd_epi16(_mm512_unpacklo_epi8(lo, zero), w));
+    sum[1] = _mm512_add_epi32(sum[1], _mm512_madd_epi16(_mm512_unpackhi_epi8(lo, zero), w));
+    sum[2] = _mm512_add_epi32(sum[2], _mm512_madd_epi16(_mm512_unpacklo_epi8(hi, zero), w));
+    sum[3] = _mm512_add_epi32(sum[3], _mm512_madd_epi16(_mm512_unpackhi_epi8(hi, zero), w));
+}
+
+inline __m512i load64(const uint8_t* p)
+{
+    return _mm512_loadu_si512(reinterpret_cast<const __m512i*>(p));
+}
+
+size_t resample_rows_avx512(const uint8_t* const* rows, const int16_t* weights, int taps, uint8_t* out,
+                            size_t bytes)
+{
+    const __m512i round = _mm512_set1_epi32(1 << 13);
+    size_t i = 0;
+    for (; i + 64 <= bytes; i += 64)
+    {
+        __m512i sum[4] = { round, round, round, round };
+        int k = 0;
+        for (; k + 1 < taps; k += 2)
+        {
+            madd_rows64(load64(rows[k] + i), load64(rows[k + 1] + i),
+                        _mm512_set1_epi32(pair_weights(weights[k], weights[k + 1])), sum);
+        }
+        if (k < taps)
+        {
+            madd_rows64(load64(rows[k] + i), _mm512_setzero_si512(), _mm512_set1_epi32(pair_weights(weights[k], 0)),
+                        sum);
+        }
+        const __m512i lo = _mm512_packs_epi32(_mm512_srai_epi32(sum[0], 14), _mm512_srai_epi32(sum[1], 14));
+        const __m512i hi = _mm512_packs_epi32(_mm512_srai_epi32(sum[2], 14), _mm512_srai_epi32(sum[3], 14));
+        _mm512_storeu_si512(reinterpret_cast<__m512i*>(out + i), _mm512_packus_epi16(lo, hi));
+    }
+    return i;
+}
+} // namespace
+
+const CpuRowKernels kAvx512RowKernels = {
+    grayscale_avx512, lut_avx512, luma_avx512, box_blur_avx512, sobel_avx512,
+    resample_rows_avx512, resample_pixels_sse41,
+};
+
+const CpuRowKernels kAvx512VbmiRowKernels = {
+    grayscale_avx512, lut_avx512vbmi, luma_avx512, box_blur_avx512, sobel_avx512,
+    resample_rows_avx512, resample_pixels_sse41,
+};
@@ -0,0 +1,65 @@
+// src/core/filters_cpu_simd.h
+#pragma once
+
+// Internal to the CPU filters: per-ISA row kernels for interleaved RGB8. Each ISA lives in its own
+// translation unit compiled with the matching -m flags; filters_cpu.cpp picks one table at runtime.
+// Every kernel reproduces the scalar arithmetic operation for operation (no FMA contraction, same
+// evaluation order), so results are bit-identical to the scalar path.
+
+#include <cstddef>
+#include <cstdint>
+
+#include "cpu_features.h"
+
+struct CpuRowKernels
+{
+    // In-place point ops over a contiguous byte/pixel span. Return how many leading elements were
+    // processed; the caller finishes the (short) remainder with scalar code.
+    size_t (*grayscale)(uint8_t* rgb, size_t pixels);
+    // data[i] = table[data[i]] with a 256-entry table (see point_lut.h), via byte shuffles.
+    // Null at SSE4.1, where 16 pshufb per 16 bytes lose to plain scalar table loads.
+    size_t (*lut)(uint8_t* data, size_t bytes, const uint8_t* table);
+
+    // 8-bit fixed-point luma of `pixels` RGB pixels into `gray`, same formula as the scalar luma8().
+    size_t (*luma)(const uint8_t* rgb, uint8_t* gray, size_t pixels);
+
+    // 3x3 stencils for the interior columns x in [1, width - 1) of one output row. `above`/`below`
+    // are the (already edge-clamped) neighbouring rows. Return false when the row is too narrow
+    // for the vector width; the caller then computes the whole row with scalar code.
+    bool (*box_blur)(const uint8_t* above, const uint8_t* row, const uint8_t* below, uint8_t* out, int width);
+    // Sobel magnitude from three rows of 8-bit luma, written as `out_channels` (1 or 3) equal bytes.
+    bool (*sobel)(const uint8_t* above, const uint8_t* row, const uint8_t* below, uint8_t* out, int width,
+                  int out_channels);
+
+    // Separable resampling (resize.cpp) with 14-bit fixed-point weights: each output byte is
+    // clamp((8192 + sum of weight * input byte) >> 14), the same integer sums as the scalar code.
+    // Vertical pass: out[i] from byte i of each of the `taps` rows. Returns the bytes processed.
+    size_t (*resample_rows)(const uint8_t* const* rows, const int16_t* weights, int taps, uint8_t* out,
+                            size_t bytes);
+    // Horizontal pass over one row of 3- or 4-channel pixels: output pixel x reads the `taps` input
+    // pixels from starts[x] on, with weights[x * taps ...]. Returns how many leading pixels were
+    // processed; kernels stop at the first pixel whose loads would run past the row's in_width pixels.
+    size_t (*resample_pixels)(const uint8_t* row, int in_width, const int* starts, const int16_t* weights,
+                              int taps, int channels, uint8_t* out, size_t pixels);
+};
+
+// Kernel table for `level`, or nullptr for SimdLevel::Scalar / non-x86 builds.
+const CpuRowKernels* cpu_row_kernels(SimdLevel level);
+
+// Defined by filters_cpu_{sse41,avx2,avx512}.cpp, which are only built for x86 (CUDAPIX_X86_SIMD).
+// The VBMI table differs only in its lut kernel (a two-instruction vpermi2b lookup).
+extern const CpuRowKernels kSse41RowKernels;
+extern const CpuRowKernels kAvx2RowKernels;
+extern const CpuRowKernels kAvx512RowKernels;
+extern const CpuRowKernels kAvx512VbmiRowKernels;
+
+// The horizontal resample kernel of the SSE4.1 table, shared by the AVX2 and AVX-512 tables: the
+// taps of one output pixel do not fill a wider vector.
+size_t resample_pixels_sse41(const uint8_t* row, int in_width, const int* starts, const int16_t* weights, int taps,
+                             int channels, uint8_t* out, size_t pixels);
+
+// Two 16-bit weights as one 32-bit lane, the pair layout _mm_madd_epi16 multiplies against.
+inline int pair_weights(int16_t w0, int16_t w1)
+{
+    return static_cast<int>(static_cast<uint16_t>(w0) | (static_cast<uint32_t>(static_cast<uint16_t>(w1)) << 16));
+}
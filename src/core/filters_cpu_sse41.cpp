@@ -0,0 +1,256 @@
+// src/core/filters_cpu_sse41.cpp
+// SSE4.1 row kernels (16 bytes / 4 pixels per step). Compiled with -msse4.1 -ffp-contract=off.
+#include "filters_cpu_simd.h"
+
+#include <immintrin.h>
+
+#include <cstring>
+
+namespace
+{
+// clamp_byte(): clamp to [0, 255], add 0.5, truncate.
+inline __m128i clamp_to_byte_lanes(__m128 v)
+{
+    v = _mm_max_ps(_mm_min_ps(v, _mm_set1_ps(255.0f)), _mm_setzero_ps());
+    return _mm_cvttps_epi32(_mm_add_ps(v, _mm_set1_ps(0.5f)));
+}
+
+// Splits 4 interleaved RGB pixels (first 12 bytes of v) into float r, g, b lanes.
+inline void deinterleave4(__m128i v, __m128& r, __m128& g, __m128& b)
+{
+    const __m128i mr = _mm_setr_epi8(0, -1, -1, -1, 3, -1, -1, -1, 6, -1, -1, -1, 9, -1, -1, -1);
+    const __m128i mg = _mm_setr_epi8(1, -1, -1, -1, 4, -1, -1, -1, 7, -1, -1, -1, 10, -1, -1, -1);
+    const __m128i mb = _mm_setr_epi8(2, -1, -1, -1, 5, -1, -1, -1, 8, -1, -1, -1, 11, -1, -1, -1);
+    r = _mm_cvtepi32_ps(_mm_shuffle_epi8(v, mr));
+    g = _mm_cvtepi32_ps(_mm_shuffle_epi8(v, mg));
+    b = _mm_cvtepi32_ps(_mm_shuffle_epi8(v, mb));
+}
+
+inline __m128 luma4(__m128 r, __m128 g, __m128 b)
+{
+    __m128 sum = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(0.299f), r), _mm_mul_ps(_mm_set1_ps(0.587f), g));
+    return _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(0.114f), b));
+}
+
+// Writes 4 int32 byte values as 4 gray RGB pixels (12 bytes) without touching the bytes after them.
+inline void store_gray_rgb4(uint8_t* dst, __m128i values)
+{
+    const __m128i rep = _mm_setr_epi8(0, 0, 0, 4, 4, 4, 8, 8, 8, 12, 12, 12, -1, -1, -1, -1);
+    __m128i rgb = _mm_shuffle_epi8(values, rep);
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(dst), rgb);
+    const int tail = _mm_extract_epi32(rgb, 2);
+    std::memcpy(dst + 8, &tail, 4);
+}
+
+size_t grayscale_sse41(uint8_t* rgb, size_t pixels)
+{
+    size_t x = 0;
+    // Each step reads 16 bytes but only consumes 12, so stop while 4 spare bytes remain.
+    for (; (x + 4) * 3 + 4 <= pixels * 3; x += 4)
+    {
+        __m128 r, g, b;
+        deinterleave4(_mm_loadu_si128(reinterpret_cast<const __m128i*>(rgb + x * 3)), r, g, b);
+        store_gray_rgb4(rgb + x * 3, clamp_to_byte_lanes(luma4(r, g, b)));
+    }
+    return x;
+}
+
+// Fixed-point luma of the 4 pixels in the first 12 bytes of v as int32 lanes: r and g are paired
+// for one pmaddwd, b for another, then (sum + 2^14) >> 15 as in the scalar luma8().
+inline __m128i luma8_4(__m128i v)
+{
+    const __m128i mrg = _mm_setr_epi8(0, -1, 1, -1, 3, -1, 4, -1, 6, -1, 7, -1, 9, -1, 10, -1);
+    const __m128i mb = _mm_setr_epi8(2, -1, -1, -1, 5, -1, -1, -1, 8, -1, -1, -1, 11, -1, -1, -1);
+    const __m128i wrg = _mm_set1_epi32((19235 << 16) | 9798);
+    const __m128i wb = _mm_set1_epi32(3735);
+    __m128i sum = _mm_add_epi32(_mm_madd_epi16(_mm_shuffle_epi8(v, mrg), wrg), _mm_madd_epi16(_mm_shuffle_epi8(v, mb), wb));
+    return _mm_srli_epi32(_mm_add_epi32(sum, _mm_set1_epi32(1 << 14)), 15);
+}
+
+size_t luma_sse41(const uint8_t* rgb, uint8_t* gray, size_t pixels)
+{
+    size_t x = 0;
+    for (; (x + 16) * 3 + 4 <= pixels * 3; x += 16)
+    {
+        const uint8_t* p = rgb + x * 3;
+        __m128i y0 = luma8_4(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+        __m128i y1 = luma8_4(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 12)));
+        __m128i y2 = luma8_4(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 24)));
+        __m128i y3 = luma8_4(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 36)));
+        __m128i bytes = _mm_packus_epi16(_mm_packs_epi32(y0, y1), _mm_packs_epi32(y2, y3));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(gray + x), bytes);
+    }
+    return x;
+}
+
+inline __m128i widen_sum3(const uint8_t* p, __m128i& hi)
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p - 3));
+    __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 3));
+    hi = _mm_add_epi16(_mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero)),
+                       _mm_unpackhi_epi8(c, zero));
+    return _mm_add_epi16(_mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero)),
+                         _mm_unpacklo_epi8(c, zero));
+}
+
+bool box_blur_sse41(const uint8_t* above, const uint8_t* row, const uint8_t* below, uint8_t* out, int width)
+{
+    const size_t begin = 3;
+    const size_t end = static_cast<size_t>(width - 1) * 3; // interior bytes [3, end)
+    if (width < 2 || end - begin < 16) return false;
+
+    // sum / 9 == (sum * 7282) >> 16 exactly for every 3x3 sum of bytes (sum <= 2295).
+    const __m128i div9 = _mm_set1_epi16(7282);
+    auto step = [&](size_t i) {
+        __m128i h0, h1, h2;
+        __m128i l0 = widen_sum3(above + i, h0);
+        __m128i l1 = widen_sum3(row + i, h1);
+        __m128i l2 = widen_sum3(below + i, h2);
+        __m128i lo = _mm_mulhi_epu16(_mm_add_epi16(_mm_add_epi16(l0, l1), l2), div9);
+        __m128i hi = _mm_mulhi_epu16(_mm_add_epi16(_mm_add_epi16(h0, h1), h2), div9);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_packus_epi16(lo, hi));
+    };
+    size_t i = begin;
+    for (; i + 16 <= end; i += 16) step(i);
+    if (i < end) step(end - 16); // overlapping last step; output is a separate buffer
+    return true;
+}
+
+inline __m128i load8_u16(const uint8_t* p)
+{
+    return _mm_cvtepu8_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p)));
+}
+
+// min(255, round(sqrt(gx^2 + gy^2))) for 8 int16 gradient pairs, as bytes in the low 8 lanes.
+// pmaddwd on interleaved (gx, gy) yields the squared norms directly in int32.
+inline __m128i sobel_magnitude8(__m128i gx, __m128i gy)
+{
+    const __m128 half = _mm_set1_ps(0.5f);
+    __m128i lo = _mm_unpacklo_epi16(gx, gy);
+    __m128i hi = _mm_unpackhi_epi16(gx, gy);
+    __m128i mlo = _mm_cvttps_epi32(_mm_add_ps(_mm_sqrt_ps(_mm_cvtepi32_ps(_mm_madd_epi16(lo, lo))), half));
+    __m128i mhi = _mm_cvttps_epi32(_mm_add_ps(_mm_sqrt_ps(_mm_cvtepi32_ps(_mm_madd_epi16(hi, hi))), half));
+    __m128i m16 = _mm_packs_epi32(mlo, mhi);
+    return _mm_packus_epi16(m16, m16);
+}
+
+bool sobel_sse41(const uint8_t* above, const uint8_t* row, const uint8_t* below, uint8_t* out, int width,
+                 int out_channels)
+{
+    if (width - 2 < 8) return false;
+
+    auto step = [&](int x) {
+        __m128i a0 = load8_u16(above + x - 1), a1 = load8_u16(above + x), a2 = load8_u16(above + x + 1);
+        __m128i r0 = load8_u16(row + x - 1), r2 = load8_u16(row + x + 1);
+        __m128i b0 = load8_u16(below + x - 1), b1 = load8_u16(below + x), b2 = load8_u16(below + x + 1);
+
+        // Integer gradients fit int16: |gx|, |gy| <= 4 * 255.
+        __m128i gx = _mm_add_epi16(_mm_add_epi16(_mm_sub_epi16(a2, a0), _mm_sub_epi16(b2, b0)),
+                                   _mm_slli_epi16(_mm_sub_epi16(r2, r0), 1));
+        __m128i gy = _mm_sub_epi16(_mm_add_epi16(_mm_add_epi16(a0, a2), _mm_slli_epi16(a1, 1)),
+                                   _mm_add_epi16(_mm_add_epi16(b0, b2), _mm_slli_epi16(b1, 1)));
+        __m128i m = sobel_magnitude8(gx, gy);
+
+        if (out_channels == 1)
+        {
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(out + x), m);
+            return;
+        }
+        const __m128i rep0 = _mm_setr_epi8(0, 0, 0, 1, 1, 1, 2, 2, 2, 3, 3, 3, 4, 4, 4, 5);
+        const __m128i rep1 = _mm_setr_epi8(5, 5, 6, 6, 6, 7, 7, 7, -1, -1, -1, -1, -1, -1, -1, -1);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + x * 3), _mm_shuffle_epi8(m, rep0));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(out + x * 3 + 16), _mm_shuffle_epi8(m, rep1));
+    };
+    int x = 1;
+    for (; x + 8 <= width - 1; x += 8) step(x);
+    if (x < width - 1) step(width - 1 - 8);
+    return true;
+}
+
+inline __m128i load4(const uint8_t* p)
+{
+    int v;
+    std::memcpy(&v, p, 4);
+    return _mm_cvtsi32_si128(v);
+}
+
+// Interleaves the bytes of a and b and widens them to 16 bits, so madd against pair_weights()
+// gives w0 * a[i] + w1 * b[i] in every 32-bit lane: lanes for bytes 0-3, 4-7, 8-11 and 12-15.
+inline void madd_rows16(__m128i a, __m128i b, __m128i w, __m128i (&sum)[4])
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i lo = _mm_unpacklo_epi8(a, b);
+    const __m128i hi = _mm_unpackhi_epi8(a, b);
+    sum[0] = _mm_add_epi32(sum[0], _mm_madd_epi16(_mm_unpacklo_epi8(lo, zero), w));
+    sum[1] = _mm_add_epi32(sum[1], _mm_madd_epi16(_mm_unpackhi_epi8(lo, zero), w));
+    sum[2] = _mm_add_epi32(sum[2], _mm_madd_epi16(_mm_unpacklo_epi8(hi, zero), w));
+    sum[3] = _mm_add_epi32(sum[3], _mm_madd_epi16(_mm_unpackhi_epi8(hi, zero), w));
+}
+
+size_t resample_rows_sse41(const uint8_t* const* rows, const int16_t* weights, int taps, uint8_t* out,
+                           size_t bytes)
+{
+    const __m128i round = _mm_set1_epi32(1 << 13);
+    size_t i = 0;
+    for (; i + 16 <= bytes; i += 16)
+    {
+        __m128i sum[4] = { round, round, round, round };
+        int k = 0;
+        for (; k + 1 < taps; k += 2)
+        {
+            madd_rows16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(rows[k] + i)),
+                        _mm_loadu_si128(reinterpret_cast<const __m128i*>(rows[k + 1] + i)),
+                        _mm_set1_epi32(pair_weights(weights[k], weights[k + 1])), sum);
+        }
+        if (k < taps)
+        {
+            madd_rows16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(rows[k] + i)), _mm_setzero_si128(),
+                        _mm_set1_epi32(pair_weights(weights[k], 0)), sum);
+        }
+        // packs/packus saturate, which is the scalar clamp to [0, 255].
+        const __m128i lo = _mm_packs_epi32(_mm_srai_epi32(sum[0], 14), _mm_srai_epi32(sum[1], 14));
+        const __m128i hi = _mm_packs_epi32(_mm_srai_epi32(sum[2], 14), _mm_srai_epi32(sum[3], 14));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_packus_epi16(lo, hi));
+    }
+    return i;
+}
+
+} // namespace
+
+// One output pixel per step, its channels in the 32-bit lanes. Pixels are loaded as 4 bytes, so a
+// 3-channel tap also reads the first byte of the next pixel (with no lane of its own in the result).
+size_t resample_pixels_sse41(const uint8_t* row, int in_width, const int* starts, const int16_t* weights, int taps,
+                             int channels, uint8_t* out, size_t pixels)
+{
+    const int limit = channels == 4 ? in_width : in_width - 1;
+    const __m128i round = _mm_set1_epi32(1 << 13);
+    size_t x = 0;
+    for (; x < pixels && starts[x] + taps <= limit; ++x)
+    {
+        const uint8_t* p = row + static_cast<size_t>(starts[x]) * channels;
+        const int16_t* w = weights + x * taps;
+        __m128i sum = round;
+        int k = 0;
+        for (; k + 1 < taps; k += 2, p += 2 * channels)
+        {
+            const __m128i pair = _mm_cvtepu8_epi16(_mm_unpacklo_epi8(load4(p), load4(p + channels)));
+            sum = _mm_add_epi32(sum, _mm_madd_epi16(pair, _mm_set1_epi32(pair_weights(w[k], w[k + 1]))));
+        }
+        if (k < taps)
+        {
+            const __m128i single = _mm_cvtepu8_epi16(_mm_unpacklo_epi8(load4(p), _mm_setzero_si128()));
+            sum = _mm_add_epi32(sum, _mm_madd_epi16(single, _mm_set1_epi32(pair_weights(w[k], 0))));
+        }
+        const __m128i packed = _mm_packs_epi32(_mm_srai_epi32(sum, 14), _mm_setzero_si128());
+        const int value = _mm_cvtsi128_si32(_mm_packus_epi16(packed, packed));
+        std::memcpy(out + x * channels, &value, channels);
+    }
+    return x;
+}
+
+const CpuRowKernels kSse41RowKernels = {
+    grayscale_sse41, nullptr, luma_sse41, box_blur_sse41, sobel_sse41,
+    resample_rows_sse41, resample_pixels_sse41,
+};
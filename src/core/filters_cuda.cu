@@ -1,11 +1,21 @@
 // src/core/filters_cuda.cu
 #include "filters_cuda.h"
+#include "buffer_pool.h"
+#include "histogram.h"
+#include "point_lut.h"
+#include "stencil.h"
+#include "thread_pool.h"
+#include "trace.h"
+#include "tuning.h"
 
 #include <cuda_runtime.h>
 #include <algorithm>
 #include <cmath>
+#include <optional>
 #include <stdexcept>
 #include <string>
+#include <utility>
+#include <vector>
 
 #define CUDA_CHECK(expr)                                                                             \
     do                                                                                               \
@@ -13,7 +23,7 @@
         cudaError_t err__ = (expr);                                                                  \
         if (err__ != cudaSuccess)                                                                    \
         {                                                                                            \
-            throw std::runtime_error(std::string("CUDA error: ") + cudaGetErrorString(err__));       \
+            throw CudaError(std::string("CUDA error: ") + cudaGetErrorString(err__));                \
         }                                                                                            \
     } while (0)
 
@@ -31,203 +41,1048 @@ __device__ __forceinline__ float to_grayscale(uint8_t r, uint8_t g, uint8_t b)
     return 0.299f * r + 0.587f * g + 0.114f * b;
 }
 
+// Gray pixels are already gray; a 4th channel (alpha or padding) is left as it is.
+__device__ __forceinline__ void grayscale_pixel(uint8_t* px, int channels)
+{
+    if (channels < 3) return;
+    uint8_t g = clamp_to_byte(to_grayscale(px[0], px[1], px[2]));
+    px[0] = px[1] = px[2] = g;
+}
+
+// Stages of one compiled point program (see point_lut.h), uploaded before each point_program_kernel
+// launch. Tables are built on the host by the same code the CPU filters use, so results match exactly.
+struct PointStage
+{
+    int grayscale;
+    uint8_t table[256];
+};
+constexpr int kMaxPointStages = 16;
+__constant__ PointStage c_point_stages[kMaxPointStages];
+
 __global__ void grayscale_kernel(uint8_t* data, int width, int height, int channels)
 {
     int x = blockIdx.x * blockDim.x + threadIdx.x;
     int y = blockIdx.y * blockDim.y + threadIdx.y;
     if (x >= width || y >= height) return;
 
-    int idx = (y * width + x) * channels;
-    float gray = to_grayscale(data[idx], data[idx + 1], data[idx + 2]);
-    uint8_t g = clamp_to_byte(gray);
-    data[idx] = data[idx + 1] = data[idx + 2] = g;
+    grayscale_pixel(data + (y * width + x) * channels, channels);
+}
+
+// Block-private histogram in shared memory: threads count with shared atomics, and the block adds its
+// totals to the global bins once at the end, so global atomics scale with blocks rather than pixels.
+// Counters are 32-bit; launches cap the grid so that no block sees anywhere near 2^32 samples.
+constexpr int kHistogramBlocks = 1024;
+
+__device__ __forceinline__ void count_pixel(unsigned int (*bins)[256], const uint8_t* px, int colour)
+{
+    for (int c = 0; c < colour; ++c) atomicAdd(&bins[c][px[c]], 1u);
+}
+
+__device__ __forceinline__ void flush_histogram(unsigned int (*bins)[256], unsigned long long* histogram, int colour)
+{
+    __syncthreads();
+    for (int i = threadIdx.x; i < colour * 256; i += blockDim.x)
+    {
+        const unsigned int n = bins[i / 256][i % 256];
+        if (n) atomicAdd(&histogram[i], static_cast<unsigned long long>(n));
+    }
+}
+
+__device__ __forceinline__ void clear_histogram(unsigned int (*bins)[256])
+{
+    for (int i = threadIdx.x; i < 3 * 256; i += blockDim.x) bins[i / 256][i % 256] = 0;
+}
+
+__global__ void histogram_kernel(const uint8_t* data, size_t pixels, int channels, unsigned long long* histogram)
+{
+    __shared__ unsigned int bins[3][256];
+    clear_histogram(bins);
+    __syncthreads();
+
+    const int colour = min(channels, 3);
+    for (size_t i = blockIdx.x * static_cast<size_t>(blockDim.x) + threadIdx.x; i < pixels;
+         i += static_cast<size_t>(gridDim.x) * blockDim.x)
+    {
+        count_pixel(bins, data + i * channels, colour);
+    }
+    flush_histogram(bins, histogram, colour);
+}
+
+// Grid-stride over the packed pixels. With `histogram`, each pixel is also counted after its last
+// stage (see histogram_kernel), which lets autolevels / equalize take their statistics from the
+// point pass before them instead of reading the frame again.
+__global__ void point_program_kernel(uint8_t* data, size_t pixels, int channels, int stage_count,
+                                     unsigned long long* histogram)
+{
+    // Constant memory serializes lanes that read different addresses, which table lookups always do,
+    // so each block first copies the tables into shared memory.
+    __shared__ uint8_t tables[kMaxPointStages][256];
+    __shared__ unsigned int bins[3][256];
+    for (int i = threadIdx.x; i < stage_count * 256; i += blockDim.x)
+    {
+        tables[i / 256][i % 256] = c_point_stages[i / 256].table[i % 256];
+    }
+    if (histogram) clear_histogram(bins);
+    __syncthreads();
+
+    const int colour = min(channels, 3); // tables leave alpha alone
+    for (size_t i = blockIdx.x * static_cast<size_t>(blockDim.x) + threadIdx.x; i < pixels;
+         i += static_cast<size_t>(gridDim.x) * blockDim.x)
+    {
+        // Each pixel is loaded once, run through every stage, and stored once.
+        uint8_t px[4];
+        uint8_t* p = data + i * channels;
+        for (int c = 0; c < channels; ++c) px[c] = p[c];
+
+        for (int s = 0; s < stage_count; ++s)
+        {
+            if (c_point_stages[s].grayscale)
+            {
+                grayscale_pixel(px, channels);
+                continue;
+            }
+            for (int c = 0; c < colour; ++c) px[c] = tables[s][px[c]];
+        }
+
+        for (int c = 0; c < channels; ++c) p[c] = px[c];
+        if (histogram) count_pixel(bins, px, colour);
+    }
+    if (histogram) flush_histogram(bins, histogram, colour);
 }
 
-__global__ void brightness_kernel(uint8_t* data, int width, int height, int channels, float delta)
+__global__ void box_blur_kernel(const uint8_t* input, uint8_t* output, int width, int height, int channels)
 {
     int x = blockIdx.x * blockDim.x + threadIdx.x;
     int y = blockIdx.y * blockDim.y + threadIdx.y;
     if (x >= width || y >= height) return;
 
-    int idx = (y * width + x) * channels;
+    // Edge-clamped 3x3, same as the CPU filter and the running-sum passes below.
     for (int c = 0; c < channels; ++c)
     {
-        float v = static_cast<float>(data[idx + c]) / 255.0f;
-        v = fminf(fmaxf(v + delta, 0.0f), 1.0f);
-        data[idx + c] = clamp_to_byte(v * 255.0f);
+        int sum = 0;
+        for (int ky = -1; ky <= 1; ++ky)
+        {
+            int yy = min(max(y + ky, 0), height - 1);
+            for (int kx = -1; kx <= 1; ++kx)
+            {
+                int xx = min(max(x + kx, 0), width - 1);
+                sum += input[(yy * width + xx) * channels + c];
+            }
+        }
+        output[(y * width + x) * channels + c] = static_cast<uint8_t>(sum / 9);
+    }
+}
+
+// First half of a box pass: one block per row writes the row's per-channel inclusive prefix sums,
+// scanning the row in tiles of whole pixels (a Hillis-Steele scan in shared memory, strided by the
+// channel count so the interleaved channels stay apart) and carrying each tile's last prefixes into
+// the next. Loads and stores are coalesced along the row, and the cost does not grow with the radius.
+__global__ void box_row_prefix_kernel(const uint8_t* input, int* prefix, int width, int channels)
+{
+    extern __shared__ int scan[];
+    __shared__ int carry[4];
+
+    const int y = blockIdx.x;
+    const int i = threadIdx.x;
+    const int row_elems = width * channels;
+    const int tile = (blockDim.x / channels) * channels;
+    const uint8_t* row = input + static_cast<size_t>(y) * row_elems;
+    int* out = prefix + static_cast<size_t>(y) * row_elems;
+    if (i < channels) carry[i] = 0;
+
+    for (int base = 0; base < row_elems; base += tile)
+    {
+        const int n = min(tile, row_elems - base);
+        int value = i < n ? row[base + i] : 0;
+        scan[i] = value;
+        __syncthreads();
+        for (int offset = channels; offset < n; offset *= 2)
+        {
+            const int add = i < n && i >= offset ? scan[i - offset] : 0;
+            __syncthreads();
+            value += add;
+            scan[i] = value;
+            __syncthreads();
+        }
+        value += carry[i % channels];
+        __syncthreads(); // every thread has read the carry before the last pixel replaces it
+        if (i < n) out[base + i] = value;
+        if (i >= n - channels && i < n) carry[i % channels] = value;
+    }
+}
+
+// Sum of row[clamp(x - r)] .. row[clamp(x + r)] for one channel, from the row's inclusive prefixes
+// (p points at the row's prefix for channel c, elements `channels` apart). Window positions past
+// either edge repeat the edge pixel, like the CPU filters.
+__device__ __forceinline__ int box_row_window(const int* p, int x, int width, int channels, int radius)
+{
+    const int hi = x + radius;
+    const int lo = x - radius - 1;
+    int sum = p[min(hi, width - 1) * channels] - (lo >= 0 ? p[lo * channels] : 0);
+    if (lo < -1) sum += (-1 - lo) * p[0];
+    if (hi >= width)
+    {
+        const int last = p[(width - 1) * channels] - (width > 1 ? p[(width - 2) * channels] : 0);
+        sum += (hi - width + 1) * last;
     }
+    return sum;
 }
 
-__global__ void contrast_kernel(uint8_t* data, int width, int height, int channels, float factor)
+// Second half: one thread per column element slides the window down the row sums, each the
+// difference of two prefixes (adjacent threads read adjacent elements, so every row step is a
+// coalesced load), and divides once per output.
+__global__ void box_columns_kernel(const int* prefix, uint8_t* output, int width, int height, int channels,
+                                   int radius, bool round)
 {
+    int i = blockIdx.x * blockDim.x + threadIdx.x;
+    const int row_elems = width * channels;
+    if (i >= row_elems) return;
+
+    const int x = i / channels;
+    const int* column = prefix + i % channels;
+    auto row_sum = [&](int y) {
+        return box_row_window(column + static_cast<size_t>(y) * row_elems, x, width, channels, radius);
+    };
+    const int area = (2 * radius + 1) * (2 * radius + 1);
+    const int bias = round ? area / 2 : 0;
+    int sum = 0;
+    for (int k = -radius; k <= radius; ++k)
+    {
+        sum += row_sum(min(max(k, 0), height - 1));
+    }
+    for (int y = 0; y < height; ++y)
+    {
+        output[static_cast<size_t>(y) * row_elems + i] = static_cast<uint8_t>((sum + bias) / area);
+        sum += row_sum(min(y + radius + 1, height - 1)) - row_sum(max(y - radius, 0));
+    }
+}
+
+// Fixed-kernel convolutions over the Stencils of stencil.h, the same definitions the CPU filters
+// use. Threads whose window lies inside the frame read directly; only the border ring maps
+// coordinates through border_index(). The first min(channels, 3) channels are filtered, a 4th copied.
+__device__ __forceinline__ int border_sample(const uint8_t* input, int x, int y, int c, int width, int height,
+                                             int channels, BorderMode border, uint8_t constant)
+{
+    const int sx = border_index(x, width, border);
+    const int sy = border_index(y, height, border);
+    if (sx < 0 || sy < 0) return constant;
+    return input[(static_cast<size_t>(sy) * width + sx) * channels + c];
+}
+
+template <typename K>
+__global__ void convolve_kernel(const uint8_t* input, uint8_t* output, int width, int height, int channels,
+                                BorderMode border, uint8_t constant)
+{
+    constexpr int R = K::kRadius;
     int x = blockIdx.x * blockDim.x + threadIdx.x;
     int y = blockIdx.y * blockDim.y + threadIdx.y;
     if (x >= width || y >= height) return;
 
-    int idx = (y * width + x) * channels;
-    for (int c = 0; c < channels; ++c)
+    const bool interior = x >= R && x < width - R && y >= R && y < height - R;
+    const size_t i = (static_cast<size_t>(y) * width + x) * channels;
+    const ptrdiff_t row = static_cast<ptrdiff_t>(width) * channels;
+    for (int c = 0; c < min(channels, 3); ++c)
     {
-        float v = static_cast<float>(data[idx + c]) / 255.0f;
-        v = (v - 0.5f) * factor + 0.5f;
-        v = fminf(fmaxf(v, 0.0f), 1.0f);
-        data[idx + c] = clamp_to_byte(v * 255.0f);
+        const int sum = interior ? stencil_sum<K>([&](int dx, int dy) {
+            return static_cast<int>(input[i + dy * row + dx * channels + c]);
+        })
+                                 : stencil_sum<K>([&](int dx, int dy) {
+                                       return border_sample(input, x + dx, y + dy, c, width, height, channels, border,
+                                                            constant);
+                                   });
+        output[i + c] = K::finish(sum);
     }
+    if (channels == 4) output[i + 3] = input[i + 3];
 }
 
-__global__ void box_blur_kernel(const uint8_t* input, uint8_t* output, int width, int height, int channels)
+// Separable Stencils: row sums of every element into `sums`, then the column pass over them.
+template <typename K>
+__global__ void convolve_rows_kernel(const uint8_t* input, int* sums, int width, int height, int channels,
+                                     BorderMode border, uint8_t constant)
 {
+    constexpr int R = K::kRadius;
     int x = blockIdx.x * blockDim.x + threadIdx.x;
     int y = blockIdx.y * blockDim.y + threadIdx.y;
     if (x >= width || y >= height) return;
 
+    const size_t i = (static_cast<size_t>(y) * width + x) * channels;
+    const bool interior = x >= R && x < width - R;
     for (int c = 0; c < channels; ++c)
     {
-        int sum = 0;
-        int count = 0;
-        for (int ky = -1; ky <= 1; ++ky)
+        sums[i + c] = interior ? stencil_row_sum<K>([&](int dx) { return static_cast<int>(input[i + dx * channels + c]); })
+                               : stencil_row_sum<K>([&](int dx) {
+                                     return border_sample(input, x + dx, y, c, width, height, channels, border, constant);
+                                 });
+    }
+}
+
+template <typename K>
+__global__ void convolve_cols_kernel(const uint8_t* input, const int* sums, uint8_t* output, int width, int height,
+                                     int channels, BorderMode border, uint8_t constant)
+{
+    constexpr int R = K::kRadius;
+    int x = blockIdx.x * blockDim.x + threadIdx.x;
+    int y = blockIdx.y * blockDim.y + threadIdx.y;
+    if (x >= width || y >= height) return;
+
+    const size_t i = (static_cast<size_t>(y) * width + x) * channels;
+    const ptrdiff_t row = static_cast<ptrdiff_t>(width) * channels;
+    const bool interior = y >= R && y < height - R;
+    const int constant_row = stencil_row_sum<K>([&](int) { return static_cast<int>(constant); });
+    for (int c = 0; c < min(channels, 3); ++c)
+    {
+        const int sum = interior ? stencil_col_sum<K>([&](int dy) { return sums[i + dy * row + c]; })
+                                 : stencil_col_sum<K>([&](int dy) {
+                                       const int sy = border_index(y + dy, height, border);
+                                       return sy < 0 ? constant_row : sums[(static_cast<size_t>(sy) * width + x) * channels + c];
+                                   });
+        output[i + c] = K::finish(sum);
+    }
+    if (channels == 4) output[i + 3] = input[i + 3];
+}
+
+// Integer luma and Sobel helpers, identical to the CPU filters so both backends give the same bytes.
+__device__ __forceinline__ uint8_t luma8(const uint8_t* px, int channels)
+{
+    if (channels < 3) return px[0];
+    return static_cast<uint8_t>((9798 * px[0] + 19235 * px[1] + 3735 * px[2] + 16384) >> 15);
+}
+
+__device__ __forceinline__ int gradient_magnitude(int gx, int gy)
+{
+    return static_cast<int>(sqrtf(static_cast<float>(gx * gx + gy * gy)) + 0.5f);
+}
+
+__device__ __forceinline__ uint8_t gradient_direction(int gx, int gy)
+{
+    const int ax = abs(gx);
+    const int ay = abs(gy);
+    if (ay * 256 <= ax * 106) return static_cast<uint8_t>(EdgeDirection::Horizontal);
+    if (ay * 256 >= ax * 618) return static_cast<uint8_t>(EdgeDirection::Vertical);
+    return static_cast<uint8_t>((gx > 0) == (gy > 0) ? EdgeDirection::Diagonal45 : EdgeDirection::Diagonal135);
+}
+
+// Edge kernels run in 16x16 blocks over an 18x18 luma tile (block plus one clamped pixel on each side),
+// so every source pixel is converted to luma once per block instead of once per tap.
+constexpr int kEdgeBlock = 16;
+constexpr int kEdgeTile = kEdgeBlock + 2;
+
+__device__ void load_luma_tile(const uint8_t* input, uint8_t (&tile)[kEdgeTile][kEdgeTile], int width, int height,
+                               int channels)
+{
+    const int x0 = blockIdx.x * kEdgeBlock - 1;
+    const int y0 = blockIdx.y * kEdgeBlock - 1;
+    for (int i = threadIdx.y * kEdgeBlock + threadIdx.x; i < kEdgeTile * kEdgeTile; i += kEdgeBlock * kEdgeBlock)
+    {
+        const int xx = min(max(x0 + i % kEdgeTile, 0), width - 1);
+        const int yy = min(max(y0 + i / kEdgeTile, 0), height - 1);
+        tile[i / kEdgeTile][i % kEdgeTile] = luma8(input + (static_cast<size_t>(yy) * width + xx) * channels, channels);
+    }
+    __syncthreads();
+}
+
+// Gradients of the pixel under this thread; (tx, ty) = threadIdx + 1 in the tile.
+__device__ __forceinline__ void sobel_gradient(const uint8_t (&t)[kEdgeTile][kEdgeTile], int tx, int ty, int& gx,
+                                               int& gy)
+{
+    auto sample = [&](int dx, int dy) { return static_cast<int>(t[ty + dy][tx + dx]); };
+    gx = stencil_sum<SobelXStencil>(sample);
+    gy = stencil_sum<SobelYStencil>(sample);
+}
+
+// Magnitude clamped to 255, written to the first min(out_channels, 3) of out_channels bytes per pixel
+// (a 4th output byte is copied from the input);
+// `direction` (optional) receives one EdgeDirection per pixel.
+__global__ void sobel_kernel(const uint8_t* input, uint8_t* output, uint8_t* direction, int width, int height,
+                             int channels, int out_channels)
+{
+    __shared__ uint8_t tile[kEdgeTile][kEdgeTile];
+    load_luma_tile(input, tile, width, height, channels);
+
+    int x = blockIdx.x * blockDim.x + threadIdx.x;
+    int y = blockIdx.y * blockDim.y + threadIdx.y;
+    if (x >= width || y >= height) return;
+
+    int gx, gy;
+    sobel_gradient(tile, threadIdx.x + 1, threadIdx.y + 1, gx, gy);
+    const uint8_t m = static_cast<uint8_t>(min(gradient_magnitude(gx, gy), 255));
+    const size_t i = static_cast<size_t>(y) * width + x;
+    for (int c = 0; c < min(out_channels, 3); ++c) output[i * out_channels + c] = m;
+    if (out_channels == 4) output[i * 4 + 3] = input[i * channels + 3]; // alpha passes through
+    if (direction) direction[i] = gradient_direction(gx, gy);
+}
+
+// Canny, stage 1: unclamped magnitude and direction per pixel.
+__global__ void canny_gradient_kernel(const uint8_t* input, uint16_t* magnitude, uint8_t* direction, int width,
+                                      int height, int channels)
+{
+    __shared__ uint8_t tile[kEdgeTile][kEdgeTile];
+    load_luma_tile(input, tile, width, height, channels);
+
+    int x = blockIdx.x * blockDim.x + threadIdx.x;
+    int y = blockIdx.y * blockDim.y + threadIdx.y;
+    if (x >= width || y >= height) return;
+
+    int gx, gy;
+    sobel_gradient(tile, threadIdx.x + 1, threadIdx.y + 1, gx, gy);
+    const size_t i = static_cast<size_t>(y) * width + x;
+    magnitude[i] = static_cast<uint16_t>(gradient_magnitude(gx, gy));
+    direction[i] = gradient_direction(gx, gy);
+}
+
+__device__ __forceinline__ int magnitude_at(const uint16_t* magnitude, int x, int y, int width, int height)
+{
+    return x < 0 || x >= width || y < 0 || y >= height ? 0 : magnitude[static_cast<size_t>(y) * width + x];
+}
+
+// Stage 2: non-maximum suppression along the gradient and the double threshold (0 none, 1 weak,
+// 2 strong). Same tie rule as cpu_canny(): strictly greater than one neighbour, >= the other.
+__global__ void canny_nms_kernel(const uint16_t* magnitude, const uint8_t* direction, uint8_t* edges, int width,
+                                 int height, float low, float high)
+{
+    int x = blockIdx.x * blockDim.x + threadIdx.x;
+    int y = blockIdx.y * blockDim.y + threadIdx.y;
+    if (x >= width || y >= height) return;
+
+    const int axis[4][2] = { { 1, 0 }, { 1, -1 }, { 0, 1 }, { 1, 1 } }; // per EdgeDirection
+    const size_t i = static_cast<size_t>(y) * width + x;
+    const int m = magnitude[i];
+    const int* a = axis[direction[i]];
+    const bool peak = m > magnitude_at(magnitude, x - a[0], y - a[1], width, height) &&
+                      m >= magnitude_at(magnitude, x + a[0], y + a[1], width, height);
+    edges[i] = !peak || m < low ? 0 : (m >= high ? 2 : 1);
+}
+
+// Stage 3: hysteresis. Each block promotes weak pixels next to strong ones inside its tile until
+// nothing changes locally, then writes back and raises *changed; the host relaunches until a pass
+// changes nothing, so edges can cross any number of blocks. Pixels only ever go from 1 to 2, so
+// reading a neighbouring block's halo while it is being updated is harmless.
+__global__ void canny_hysteresis_kernel(uint8_t* edges, int width, int height, int* changed)
+{
+    __shared__ uint8_t tile[kEdgeTile][kEdgeTile];
+    const int x0 = blockIdx.x * kEdgeBlock - 1;
+    const int y0 = blockIdx.y * kEdgeBlock - 1;
+    for (int i = threadIdx.y * kEdgeBlock + threadIdx.x; i < kEdgeTile * kEdgeTile; i += kEdgeBlock * kEdgeBlock)
+    {
+        const int xx = x0 + i % kEdgeTile;
+        const int yy = y0 + i / kEdgeTile;
+        const bool inside = xx >= 0 && xx < width && yy >= 0 && yy < height;
+        tile[i / kEdgeTile][i % kEdgeTile] = inside ? edges[static_cast<size_t>(yy) * width + xx] : 0;
+    }
+    __syncthreads();
+
+    const int tx = threadIdx.x + 1;
+    const int ty = threadIdx.y + 1;
+    const int x = blockIdx.x * blockDim.x + threadIdx.x;
+    const int y = blockIdx.y * blockDim.y + threadIdx.y;
+    const bool inside = x < width && y < height;
+    bool promoted = false;
+    for (;;)
+    {
+        bool step = false;
+        if (inside && tile[ty][tx] == 1)
         {
-            int yy = y + ky;
-            if (yy < 0 || yy >= height) continue;
-            for (int kx = -1; kx <= 1; ++kx)
+            for (int dy = -1; dy <= 1 && !step; ++dy)
             {
-                int xx = x + kx;
-                if (xx < 0 || xx >= width) continue;
-                int src_idx = (yy * width + xx) * channels + c;
-                sum += input[src_idx];
-                ++count;
+                for (int dx = -1; dx <= 1; ++dx)
+                {
+                    if (tile[ty + dy][tx + dx] == 2)
+                    {
+                        step = true;
+                        break;
+                    }
+                }
             }
         }
-        output[(y * width + x) * channels + c] = static_cast<uint8_t>(sum / count);
+        __syncthreads();
+        if (step) tile[ty][tx] = 2;
+        promoted = promoted || step;
+        if (!__syncthreads_or(step)) break;
+    }
+
+    if (promoted)
+    {
+        edges[static_cast<size_t>(y) * width + x] = 2;
+        *changed = 1;
     }
 }
 
-__global__ void sobel_kernel(const uint8_t* input, uint8_t* output, int width, int height, int channels)
+// Stage 4: 255 on strong pixels, 0 elsewhere.
+__global__ void canny_output_kernel(const uint8_t* edges, uint8_t* output, int width, int height, int channels)
 {
     int x = blockIdx.x * blockDim.x + threadIdx.x;
     int y = blockIdx.y * blockDim.y + threadIdx.y;
     if (x >= width || y >= height) return;
 
-    // Sobel kernels.
-    const int gx[3][3] = { { -1, 0, 1 }, { -2, 0, 2 }, { -1, 0, 1 } };
-    const int gy[3][3] = { { 1, 2, 1 }, { 0, 0, 0 }, { -1, -2, -1 } };
+    const size_t i = static_cast<size_t>(y) * width + x;
+    const uint8_t v = edges[i] == 2 ? 255 : 0;
+    for (int c = 0; c < min(channels, 3); ++c) output[i * channels + c] = v;
+}
+
+dim3 make_grid(int width, int height, dim3 block)
+{
+    return dim3((width + block.x - 1) / block.x, (height + block.y - 1) / block.y);
+}
+
+// Launch shapes of the current TuneScope (tuning.h): 2D for per-pixel kernels without a fixed
+// shared-memory tile, 1D for grid-stride and per-line kernels.
+dim3 tuned_block()
+{
+    const TuneParams& tuning = current_tuning();
+    return dim3(tuning.block_x, tuning.block_y);
+}
+
+int tuned_threads()
+{
+    return current_tuning().block_1d;
+}
+
+size_t image_size_bytes(const ImageView& img)
+{
+    return static_cast<size_t>(img.width) * static_cast<size_t>(img.height) * static_cast<size_t>(img.channels);
+}
+
+void* device_allocate(size_t bytes, bool)
+{
+    void* data = nullptr;
+    CUDA_CHECK(cudaMalloc(&data, bytes));
+    return data;
+}
+
+void device_release(void* data, size_t)
+{
+    cudaFree(data); // no CUDA_CHECK: also runs on trims after a failed launch left the context unusable
+}
+
+// Device scratch from device_buffer_pool(); *ptr stays valid while the returned handle lives.
+template <typename T>
+ScratchBuffer device_alloc(T** ptr, size_t bytes)
+{
+    TraceSpan span("device buffer", "alloc");
+    ScratchBuffer buffer = device_buffer_pool().scratch(bytes);
+    *ptr = buffer.data<T>();
+    return buffer;
+}
+
+// Kernel launches return before the GPU is done. While tracing, wait for the kernel so its span covers
+// the device work and not only the launch; traced GPU chains lose launch overlap as a result.
+void sync_if_traced(const TraceSpan& span)
+{
+    if (span.active()) CUDA_CHECK(cudaDeviceSynchronize());
+}
+
+// Host views may be strided; device buffers are always packed. cudaMemcpy2D handles both cases
+// (and degenerates to a plain copy when the host rows are packed).
+void upload(uint8_t* d_img, const ImageView& img)
+{
+    TraceSpan span("upload", "transfer");
+    CUDA_CHECK(cudaMemcpy2D(d_img, img.row_bytes(), img.data, img.stride, img.row_bytes(), img.height,
+                            cudaMemcpyHostToDevice));
+}
+
+void download(const ImageView& img, const uint8_t* d_img)
+{
+    TraceSpan span("download", "transfer");
+    CUDA_CHECK(cudaMemcpy2D(img.data, img.stride, d_img, img.row_bytes(), img.row_bytes(), img.height,
+                            cudaMemcpyDeviceToHost));
+}
+
+unsigned int grid_stride_blocks(size_t pixels, int threads, size_t max_blocks)
+{
+    const size_t blocks = (pixels + threads - 1) / threads;
+    return static_cast<unsigned int>(std::clamp<size_t>(blocks, 1, max_blocks));
+}
+
+// Histogram of a packed device image into d_bins (3 x 256 counters, cleared here).
+void launch_histogram(const uint8_t* d_img, const ImageView& img, unsigned long long* d_bins)
+{
+    TraceSpan span("histogram", "kernel");
+    const size_t pixels = static_cast<size_t>(img.width) * img.height;
+    CUDA_CHECK(cudaMemset(d_bins, 0, 3 * 256 * sizeof(unsigned long long)));
+    const int threads = tuned_threads();
+    histogram_kernel<<<grid_stride_blocks(pixels, threads, kHistogramBlocks), threads>>>(d_img, pixels, img.channels,
+                                                                                        d_bins);
+    CUDA_CHECK(cudaGetLastError());
+    sync_if_traced(span);
+}
 
-    float sum_x = 0.0f;
-    float sum_y = 0.0f;
+Histogram read_histogram(const unsigned long long* d_bins, const ImageView& img)
+{
+    Histogram hist;
+    hist.channels = std::min(img.channels, 3);
+    hist.pixels = static_cast<uint64_t>(img.width) * img.height;
+    unsigned long long bins[3][256];
+    CUDA_CHECK(cudaMemcpy(bins, d_bins, sizeof(bins), cudaMemcpyDeviceToHost));
+    for (int c = 0; c < hist.channels; ++c) std::copy(bins[c], bins[c] + 256, hist.counts[c].begin());
+    return hist;
+}
 
-    for (int ky = -1; ky <= 1; ++ky)
+// Launches `program` over a device image, kMaxPointStages stages per launch. With d_bins, the last
+// launch also fills them with the histogram of the result (a bare histogram pass for an empty program).
+void launch_point_program(uint8_t* d_img, const ImageView& img, const PointProgram& program,
+                          unsigned long long* d_bins = nullptr)
+{
+    if (program.stages.empty())
+    {
+        if (d_bins) launch_histogram(d_img, img, d_bins);
+        return;
+    }
+    TraceSpan span("point ops", "kernel");
+    const size_t pixels = static_cast<size_t>(img.width) * img.height;
+    if (d_bins) CUDA_CHECK(cudaMemset(d_bins, 0, 3 * 256 * sizeof(unsigned long long)));
+    for (size_t first = 0; first < program.stages.size(); first += kMaxPointStages)
     {
-        int yy = min(max(y + ky, 0), height - 1);
-        for (int kx = -1; kx <= 1; ++kx)
+        PointStage stages[kMaxPointStages];
+        const int count = static_cast<int>(std::min<size_t>(kMaxPointStages, program.stages.size() - first));
+        for (int s = 0; s < count; ++s)
         {
-            int xx = min(max(x + kx, 0), width - 1);
-            int idx = (yy * width + xx) * channels;
-            float gray = to_grayscale(input[idx], input[idx + 1], input[idx + 2]);
-            sum_x += gray * gx[ky + 1][kx + 1];
-            sum_y += gray * gy[ky + 1][kx + 1];
+            const PointProgram::Stage& stage = program.stages[first + s];
+            stages[s].grayscale = stage.grayscale ? 1 : 0;
+            std::copy(stage.lut.table.begin(), stage.lut.table.end(), stages[s].table);
         }
+        CUDA_CHECK(cudaMemcpyToSymbol(c_point_stages, stages, sizeof(PointStage) * count));
+        // Plain launches cover every pixel with one thread; counting ones cap the grid so that each
+        // block's shared bins absorb many pixels per global flush.
+        unsigned long long* bins = first + count == program.stages.size() ? d_bins : nullptr;
+        const int threads = tuned_threads();
+        const unsigned int blocks = grid_stride_blocks(pixels, threads, bins ? kHistogramBlocks : 0x7fffffff);
+        point_program_kernel<<<blocks, threads>>>(d_img, pixels, img.channels, count, bins);
+        CUDA_CHECK(cudaGetLastError());
     }
+    sync_if_traced(span);
+}
 
-    float magnitude = sqrtf(sum_x * sum_x + sum_y * sum_y);
-    magnitude = fminf(magnitude, 255.0f);
-    uint8_t out = clamp_to_byte(magnitude);
+// Sobel from d_input into d_output (out_channels bytes per pixel), optionally with directions.
+void launch_sobel(const uint8_t* d_input, uint8_t* d_output, uint8_t* d_direction, const ImageView& img, int out_channels)
+{
+    TraceSpan span("sobel", "kernel");
+    dim3 block(kEdgeBlock, kEdgeBlock);
+    dim3 grid = make_grid(img.width, img.height, block);
+    sobel_kernel<<<grid, block>>>(d_input, d_output, d_direction, img.width, img.height, img.channels, out_channels);
+    CUDA_CHECK(cudaGetLastError());
+    sync_if_traced(span);
+}
 
-    int out_idx = (y * width + x) * channels;
-    output[out_idx] = output[out_idx + 1] = output[out_idx + 2] = out;
+bool convolution_needs_sums(const FilterStep& step)
+{
+    return visit_stencil(step.kind, [](auto k) { return decltype(k)::kSeparable; });
 }
 
-dim3 make_grid(int width, int height, dim3 block = dim3(16, 16))
+// A convolution step from d_input into d_output; separable kernels need d_sums (4 bytes per element).
+void launch_convolve(const uint8_t* d_input, uint8_t* d_output, int* d_sums, const ImageView& img, const FilterStep& step)
 {
-    return dim3((width + block.x - 1) / block.x, (height + block.y - 1) / block.y);
+    TraceSpan span("convolve", "kernel");
+    const BorderMode border = filter_border(step);
+    const uint8_t constant = static_cast<uint8_t>(std::clamp(std::lround(step.params[1]), 0L, 255L));
+    const dim3 block = tuned_block();
+    dim3 grid = make_grid(img.width, img.height, block);
+    visit_stencil(step.kind, [&](auto k) {
+        using K = decltype(k);
+        if constexpr (K::kSeparable)
+        {
+            convolve_rows_kernel<K><<<grid, block>>>(d_input, d_sums, img.width, img.height, img.channels, border, constant);
+            convolve_cols_kernel<K><<<grid, block>>>(d_input, d_sums, d_output, img.width, img.height, img.channels,
+                                                     border, constant);
+        }
+        else
+        {
+            convolve_kernel<K><<<grid, block>>>(d_input, d_output, img.width, img.height, img.channels, border, constant);
+        }
+    });
+    CUDA_CHECK(cudaGetLastError());
+    sync_if_traced(span);
 }
 
-size_t image_size_bytes(const Image& img)
+// Canny over a device image, in place. Allocates its own magnitude/direction/class buffers.
+void launch_canny(uint8_t* d_img, const ImageView& img, float low, float high)
 {
-    return static_cast<size_t>(img.width) * static_cast<size_t>(img.height) * static_cast<size_t>(img.channels);
+    if (low > high) std::swap(low, high);
+    TraceSpan span("canny", "kernel");
+    const size_t pixels = static_cast<size_t>(img.width) * img.height;
+    uint16_t* d_magnitude = nullptr;
+    uint8_t* d_direction = nullptr;
+    uint8_t* d_edges = nullptr;
+    int* d_changed = nullptr;
+    const ScratchBuffer magnitude_buffer = device_alloc(&d_magnitude, pixels * sizeof(uint16_t));
+    const ScratchBuffer direction_buffer = device_alloc(&d_direction, pixels);
+    const ScratchBuffer edges_buffer = device_alloc(&d_edges, pixels);
+    const ScratchBuffer changed_buffer = device_alloc(&d_changed, sizeof(int));
+
+    dim3 block(kEdgeBlock, kEdgeBlock);
+    dim3 grid = make_grid(img.width, img.height, block);
+    canny_gradient_kernel<<<grid, block>>>(d_img, d_magnitude, d_direction, img.width, img.height, img.channels);
+    canny_nms_kernel<<<grid, block>>>(d_magnitude, d_direction, d_edges, img.width, img.height, low, high);
+    CUDA_CHECK(cudaGetLastError());
+
+    for (int changed = 1; changed;)
+    {
+        CUDA_CHECK(cudaMemset(d_changed, 0, sizeof(int)));
+        canny_hysteresis_kernel<<<grid, block>>>(d_edges, img.width, img.height, d_changed);
+        CUDA_CHECK(cudaGetLastError());
+        CUDA_CHECK(cudaMemcpy(&changed, d_changed, sizeof(int), cudaMemcpyDeviceToHost));
+    }
+
+    canny_output_kernel<<<grid, block>>>(d_edges, d_img, img.width, img.height, img.channels);
+    CUDA_CHECK(cudaGetLastError());
+    sync_if_traced(span);
+}
+
+// One box pass from d_input into d_output. The 3x3 truncating pass keeps its single-kernel stencil;
+// every other pass goes through the row prefix sums and column running sums and needs d_sums (4 bytes
+// per element).
+void launch_box_pass(const uint8_t* d_input, uint8_t* d_output, int* d_sums, const ImageView& img, BoxPass pass)
+{
+    TraceSpan span("box pass", "kernel");
+    if (pass.radius == 1 && !pass.round)
+    {
+        const dim3 block = tuned_block();
+        dim3 grid = make_grid(img.width, img.height, block);
+        box_blur_kernel<<<grid, block>>>(d_input, d_output, img.width, img.height, img.channels);
+    }
+    else
+    {
+        const int threads = tuned_threads();
+        const int columns = img.width * img.channels;
+        box_row_prefix_kernel<<<img.height, threads, threads * sizeof(int)>>>(d_input, d_sums, img.width,
+                                                                               img.channels);
+        box_columns_kernel<<<(columns + threads - 1) / threads, threads>>>(d_sums, d_output, img.width, img.height,
+                                                                           img.channels, pass.radius, pass.round);
+    }
+    CUDA_CHECK(cudaGetLastError());
+    sync_if_traced(span);
+}
+
+bool needs_box_sums(const std::vector<BoxPass>& passes)
+{
+    for (const BoxPass& pass : passes)
+    {
+        if (pass.radius != 1 || pass.round) return true;
+    }
+    return false;
+}
+
+// Runs all box passes of a blur step with one upload/download, ping-ponging between two buffers.
+void run_blur_step(ImageView img, const FilterStep& step)
+{
+    const std::vector<BoxPass> passes = blur_passes(step);
+    if (passes.empty()) return;
+
+    size_t bytes = image_size_bytes(img);
+    uint8_t* d_input = nullptr;
+    uint8_t* d_output = nullptr;
+    int* d_sums = nullptr;
+    const ScratchBuffer input_buffer = device_alloc(&d_input, bytes);
+    const ScratchBuffer output_buffer = device_alloc(&d_output, bytes);
+    ScratchBuffer sums_buffer;
+    if (needs_box_sums(passes)) sums_buffer = device_alloc(&d_sums, bytes * sizeof(int));
+    upload(d_input, img);
+
+    for (const BoxPass& pass : passes)
+    {
+        launch_box_pass(d_input, d_output, d_sums, img, pass);
+        std::swap(d_input, d_output);
+    }
+    CUDA_CHECK(cudaDeviceSynchronize());
+    download(img, d_input);
 }
 
 } // namespace
 
-void apply_grayscale(Image& img)
+BufferPool& device_buffer_pool()
+{
+    // Never destroyed, so no cudaFree runs after the runtime has shut down at exit.
+    static BufferPool* pool = new BufferPool({ device_allocate, device_release }, { size_t(1) << 30, false });
+    return *pool;
+}
+
+bool probe_cuda_device(std::string* description)
+{
+    auto fail = [description](const char* what, cudaError_t err) {
+        if (description) *description = std::string(what) + ": " + cudaGetErrorString(err);
+        return false;
+    };
+    int count = 0;
+    cudaError_t err = cudaGetDeviceCount(&count);
+    if (err != cudaSuccess) return fail("no CUDA runtime", err);
+    if (count == 0)
+    {
+        if (description) *description = "no CUDA device";
+        return false;
+    }
+    int device = 0;
+    cudaDeviceProp prop{};
+    err = cudaGetDevice(&device);
+    if (err == cudaSuccess) err = cudaGetDeviceProperties(&prop, device);
+    if (err != cudaSuccess) return fail("cannot query device", err);
+    // Forces context creation, which is where a broken driver or an exclusive-mode device shows up.
+    err = cudaFree(nullptr);
+    if (err != cudaSuccess) return fail("cannot create context", err);
+    if (description)
+    {
+        *description = std::string(prop.name) + ", " + std::to_string(prop.totalGlobalMem >> 20) + " MiB, sm_" +
+                       std::to_string(prop.major) + std::to_string(prop.minor);
+    }
+    return true;
+}
+
+void apply_grayscale(ImageView img)
 {
     size_t bytes = image_size_bytes(img);
     uint8_t* d_img = nullptr;
-    CUDA_CHECK(cudaMalloc(&d_img, bytes));
-    CUDA_CHECK(cudaMemcpy(d_img, img.pixels.data(), bytes, cudaMemcpyHostToDevice));
+    const ScratchBuffer img_buffer = device_alloc(&d_img, bytes);
+    upload(d_img, img);
 
-    dim3 block(16, 16);
-    dim3 grid = make_grid(img.width, img.height, block);
-    grayscale_kernel<<<grid, block>>>(d_img, img.width, img.height, img.channels);
-    CUDA_CHECK(cudaDeviceSynchronize());
-    CUDA_CHECK(cudaMemcpy(img.pixels.data(), d_img, bytes, cudaMemcpyDeviceToHost));
-    CUDA_CHECK(cudaFree(d_img));
+    {
+        TraceSpan span("grayscale", "kernel");
+        const dim3 block = tuned_block();
+        dim3 grid = make_grid(img.width, img.height, block);
+        grayscale_kernel<<<grid, block>>>(d_img, img.width, img.height, img.channels);
+        CUDA_CHECK(cudaDeviceSynchronize());
+    }
+    download(img, d_img);
 }
 
-void apply_brightness(Image& img, float delta)
+void apply_point_lut(ImageView img, const PointLut& lut)
 {
-    delta = std::clamp(delta, -1.0f, 1.0f);
+    PointProgram program;
+    program.stages.push_back({ false, lut });
 
     size_t bytes = image_size_bytes(img);
     uint8_t* d_img = nullptr;
-    CUDA_CHECK(cudaMalloc(&d_img, bytes));
-    CUDA_CHECK(cudaMemcpy(d_img, img.pixels.data(), bytes, cudaMemcpyHostToDevice));
+    const ScratchBuffer img_buffer = device_alloc(&d_img, bytes);
+    upload(d_img, img);
 
-    dim3 block(16, 16);
-    dim3 grid = make_grid(img.width, img.height, block);
-    brightness_kernel<<<grid, block>>>(d_img, img.width, img.height, img.channels, delta);
+    launch_point_program(d_img, img, program);
     CUDA_CHECK(cudaDeviceSynchronize());
-    CUDA_CHECK(cudaMemcpy(img.pixels.data(), d_img, bytes, cudaMemcpyDeviceToHost));
-    CUDA_CHECK(cudaFree(d_img));
+    download(img, d_img);
+}
+
+void apply_brightness(ImageView img, float delta)
+{
+    apply_point_lut(img, brightness_lut(delta));
+}
+
+void apply_contrast(ImageView img, float factor)
+{
+    apply_point_lut(img, contrast_lut(factor));
+}
+
+void apply_gamma(ImageView img, float gamma)
+{
+    apply_point_lut(img, gamma_lut(gamma));
+}
+
+void apply_invert(ImageView img)
+{
+    apply_point_lut(img, invert_lut());
+}
+
+void apply_levels(ImageView img, float in_black, float in_white, float out_black, float out_white)
+{
+    apply_point_lut(img, levels_lut(in_black, in_white, out_black, out_white));
+}
+
+void apply_threshold(ImageView img, float level)
+{
+    apply_point_lut(img, threshold_lut(level));
 }
 
-void apply_contrast(Image& img, float factor)
+void apply_box_blur(ImageView img, int radius)
 {
-    if (factor < 0.0f) factor = 0.0f;
+    FilterStep step{ FilterKind::BoxBlur };
+    step.params[0] = static_cast<float>(radius);
+    run_blur_step(img, step);
+}
 
+void apply_gaussian_blur(ImageView img, float sigma)
+{
+    FilterStep step{ FilterKind::GaussianBlur };
+    step.params[0] = sigma;
+    run_blur_step(img, step);
+}
+
+void apply_sobel(ImageView img)
+{
     size_t bytes = image_size_bytes(img);
-    uint8_t* d_img = nullptr;
-    CUDA_CHECK(cudaMalloc(&d_img, bytes));
-    CUDA_CHECK(cudaMemcpy(d_img, img.pixels.data(), bytes, cudaMemcpyHostToDevice));
+    uint8_t* d_input = nullptr;
+    uint8_t* d_output = nullptr;
+    const ScratchBuffer input_buffer = device_alloc(&d_input, bytes);
+    const ScratchBuffer output_buffer = device_alloc(&d_output, bytes);
+    upload(d_input, img);
 
-    dim3 block(16, 16);
-    dim3 grid = make_grid(img.width, img.height, block);
-    contrast_kernel<<<grid, block>>>(d_img, img.width, img.height, img.channels, factor);
+    launch_sobel(d_input, d_output, nullptr, img, img.channels);
     CUDA_CHECK(cudaDeviceSynchronize());
-    CUDA_CHECK(cudaMemcpy(img.pixels.data(), d_img, bytes, cudaMemcpyDeviceToHost));
-    CUDA_CHECK(cudaFree(d_img));
+    download(img, d_output);
 }
 
-void apply_box_blur(Image& img)
+void apply_convolve(ImageView img, const FilterStep& step)
 {
+    if (!is_convolution(step.kind))
+        throw std::invalid_argument(std::string(filter_kind_name(step.kind)) + " is not a convolution");
     size_t bytes = image_size_bytes(img);
     uint8_t* d_input = nullptr;
     uint8_t* d_output = nullptr;
-    CUDA_CHECK(cudaMalloc(&d_input, bytes));
-    CUDA_CHECK(cudaMalloc(&d_output, bytes));
-    CUDA_CHECK(cudaMemcpy(d_input, img.pixels.data(), bytes, cudaMemcpyHostToDevice));
+    int* d_sums = nullptr;
+    const ScratchBuffer input_buffer = device_alloc(&d_input, bytes);
+    const ScratchBuffer output_buffer = device_alloc(&d_output, bytes);
+    ScratchBuffer sums_buffer;
+    if (convolution_needs_sums(step)) sums_buffer = device_alloc(&d_sums, bytes * sizeof(int));
+    upload(d_input, img);
 
-    dim3 block(16, 16);
-    dim3 grid = make_grid(img.width, img.height, block);
-    box_blur_kernel<<<grid, block>>>(d_input, d_output, img.width, img.height, img.channels);
+    launch_convolve(d_input, d_output, d_sums, img, step);
     CUDA_CHECK(cudaDeviceSynchronize());
-    CUDA_CHECK(cudaMemcpy(img.pixels.data(), d_output, bytes, cudaMemcpyDeviceToHost));
-    CUDA_CHECK(cudaFree(d_input));
-    CUDA_CHECK(cudaFree(d_output));
+    download(img, d_output);
 }
 
-void apply_sobel(Image& img)
+Histogram apply_histogram(const ImageView& img)
 {
+    size_t bytes = image_size_bytes(img);
+    uint8_t* d_img = nullptr;
+    unsigned long long* d_bins = nullptr;
+    const ScratchBuffer img_buffer = device_alloc(&d_img, bytes);
+    const ScratchBuffer bins_buffer = device_alloc(&d_bins, 3 * 256 * sizeof(unsigned long long));
+    upload(d_img, img);
+
+    launch_histogram(d_img, img, d_bins);
+    return read_histogram(d_bins, img);
+}
+
+Image apply_sobel_magnitude(ImageView img, std::vector<uint8_t>* direction)
+{
+    Image out;
+    out.width = img.width;
+    out.height = img.height;
+    out.channels = 1;
+    out.pixels.resize_uninitialized(static_cast<size_t>(img.width) * img.height);
+    if (direction) direction->resize(out.pixels.size());
+
     size_t bytes = image_size_bytes(img);
     uint8_t* d_input = nullptr;
     uint8_t* d_output = nullptr;
-    CUDA_CHECK(cudaMalloc(&d_input, bytes));
-    CUDA_CHECK(cudaMalloc(&d_output, bytes));
-    CUDA_CHECK(cudaMemcpy(d_input, img.pixels.data(), bytes, cudaMemcpyHostToDevice));
+    uint8_t* d_direction = nullptr;
+    const ScratchBuffer input_buffer = device_alloc(&d_input, bytes);
+    const ScratchBuffer output_buffer = device_alloc(&d_output, out.pixels.size());
+    ScratchBuffer direction_buffer;
+    if (direction) direction_buffer = device_alloc(&d_direction, out.pixels.size());
+    upload(d_input, img);
+
+    launch_sobel(d_input, d_output, d_direction, img, 1);
+    CUDA_CHECK(cudaDeviceSynchronize());
+    {
+        TraceSpan span("download", "transfer");
+        CUDA_CHECK(cudaMemcpy(out.pixels.data(), d_output, out.pixels.size(), cudaMemcpyDeviceToHost));
+        if (direction) CUDA_CHECK(cudaMemcpy(direction->data(), d_direction, out.pixels.size(), cudaMemcpyDeviceToHost));
+    }
+    return out;
+}
+
+void apply_canny(ImageView img, float low, float high)
+{
+    size_t bytes = image_size_bytes(img);
+    uint8_t* d_img = nullptr;
+    const ScratchBuffer img_buffer = device_alloc(&d_img, bytes);
+    upload(d_img, img);
+
+    launch_canny(d_img, img, low, high);
+    CUDA_CHECK(cudaDeviceSynchronize());
+    download(img, d_img);
+}
+
+void apply_pipeline(ImageView img, const FilterChain& chain)
+{
+    if (chain.empty()) return;
+
+    bool has_stencil = false;
+    bool has_box_sums = false;
+    bool has_stats = false;
+    for (const FilterStep& step : chain)
+    {
+        has_stencil = has_stencil || (!is_point_op(step.kind) && !is_stats_op(step.kind));
+        has_stats = has_stats || is_stats_op(step.kind);
+        has_box_sums = has_box_sums || needs_box_sums(blur_passes(step)) ||
+                       (is_convolution(step.kind) && convolution_needs_sums(step));
+    }
+
+    // One upload and one download for the whole chain; stencils ping-pong between two device buffers.
+    size_t bytes = image_size_bytes(img);
+    uint8_t* d_current = nullptr;
+    uint8_t* d_scratch = nullptr;
+    int* d_sums = nullptr;
+    const ScratchBuffer current_buffer = device_alloc(&d_current, bytes);
+    ScratchBuffer scratch_buffer;
+    if (has_stencil) scratch_buffer = device_alloc(&d_scratch, bytes);
+    ScratchBuffer sums_buffer;
+    if (has_box_sums) sums_buffer = device_alloc(&d_sums, bytes * sizeof(int));
+    unsigned long long* d_bins = nullptr;
+    ScratchBuffer bins_buffer;
+    if (has_stats) bins_buffer = device_alloc(&d_bins, 3 * 256 * sizeof(unsigned long long));
+    upload(d_current, img);
+
+    // Autolevels / equalize: the point pass before one also counts its output into d_bins, and the
+    // resulting table is held in `lead` until the next point pass, which applies it first.
+    std::optional<PointLut> lead;
+    bool captured = false; // d_bins holds the histogram of d_current
+
+    // Cancellation is checked between steps; the buffers are released before Cancelled propagates.
+    bool cancelled = false;
+    for (size_t i = 0; i < chain.size();)
+    {
+        if (cancel_requested())
+        {
+            cancelled = true;
+            break;
+        }
+        if (is_point_op(chain[i].kind) || lead)
+        {
+            std::vector<FilterStep> ops;
+            for (; i < chain.size() && is_point_op(chain[i].kind); ++i) ops.push_back(chain[i]);
+            PointProgram program = compile_point_ops(ops);
+            if (lead) prepend_point_lut(program, *lead);
+            lead.reset();
+            captured = i < chain.size() && is_stats_op(chain[i].kind);
+            launch_point_program(d_current, img, program, captured ? d_bins : nullptr);
+            continue;
+        }
+        if (is_stats_op(chain[i].kind))
+        {
+            if (!captured) launch_histogram(d_current, img, d_bins); // a stencil wrote the frame
+            lead = stats_lut(chain[i], read_histogram(d_bins, img));
+            captured = false;
+            ++i;
+            continue;
+        }
+        captured = false;
+
+        if (chain[i].kind == FilterKind::Sobel)
+        {
+            launch_sobel(d_current, d_scratch, nullptr, img, img.channels);
+            std::swap(d_current, d_scratch);
+        }
+        if (chain[i].kind == FilterKind::Canny)
+        {
+            launch_canny(d_current, img, chain[i].params[0], chain[i].params[1]);
+        }
+        if (is_convolution(chain[i].kind))
+        {
+            launch_convolve(d_current, d_scratch, d_sums, img, chain[i]);
+            std::swap(d_current, d_scratch);
+        }
+        for (const BoxPass& pass : blur_passes(chain[i]))
+        {
+            launch_box_pass(d_current, d_scratch, d_sums, img, pass);
+            std::swap(d_current, d_scratch);
+        }
+        ++i;
+    }
+
+    if (lead && !cancelled)
+    {
+        PointProgram program;
+        prepend_point_lut(program, *lead); // a stats op ended the chain
+        launch_point_program(d_current, img, program);
+    }
 
-    dim3 block(16, 16);
-    dim3 grid = make_grid(img.width, img.height, block);
-    sobel_kernel<<<grid, block>>>(d_input, d_output, img.width, img.height, img.channels);
     CUDA_CHECK(cudaDeviceSynchronize());
-    CUDA_CHECK(cudaMemcpy(img.pixels.data(), d_output, bytes, cudaMemcpyDeviceToHost));
-    CUDA_CHECK(cudaFree(d_input));
-    CUDA_CHECK(cudaFree(d_output));
+    if (!cancelled) download(img, d_current);
+    if (cancelled) throw Cancelled();
 }
@@ -1,11 +1,67 @@
 // src/core/filters_cuda.h
 #pragma once
 
+#include "edges.h"
+#include "filter_chain.h"
 #include "image.h"
 
-// Apply filters in-place on the GPU. Image data is assumed to be interleaved RGB8.
-void apply_grayscale(Image& img);
-void apply_brightness(Image& img, float delta); // delta in [-1, 1]
-void apply_contrast(Image& img, float factor);  // e.g. 0.5, 1.0, 1.5, 2.0
-void apply_box_blur(Image& img);                 // naive 3x3 blur
-void apply_sobel(Image& img);                    // edge detection, output grayscale
+#include <stdexcept>
+#include <string>
+
+// Thrown by the apply_* functions when a CUDA runtime call fails (no device, out of memory, failed
+// launch). Parameter errors are still std::invalid_argument.
+class CudaError : public std::runtime_error
+{
+public:
+    using std::runtime_error::runtime_error;
+};
+
+// Checks for a usable CUDA device without throwing: the runtime must report at least one device and
+// create a context on the current one. `description` receives the device name and memory, or the
+// reason CUDA cannot be used.
+bool probe_cuda_device(std::string* description = nullptr);
+
+// Device memory the apply_* functions take their buffers from (see buffer_pool.h), so repeated
+// calls skip cudaMalloc/cudaFree. Everything runs on the default stream, so a released buffer is only
+// reused by work queued after the work that used it.
+class BufferPool;
+BufferPool& device_buffer_pool();
+
+// Apply filters in-place on the GPU. Image data is assumed to be interleaved RGB8; views may be strided
+// (rows are gathered into a packed device buffer on upload and scattered back on download).
+void apply_grayscale(ImageView img);
+void apply_brightness(ImageView img, float delta); // delta in [-1, 1]
+void apply_contrast(ImageView img, float factor);  // e.g. 0.5, 1.0, 1.5, 2.0
+void apply_gamma(ImageView img, float gamma);      // > 0, > 1 brightens
+void apply_invert(ImageView img);
+void apply_levels(ImageView img, float in_black, float in_white, float out_black = 0.0f, float out_white = 255.0f);
+void apply_threshold(ImageView img, float level);  // [0, 255]
+void apply_sobel(ImageView img);                    // edge detection, output grayscale
+
+// Single-channel Sobel magnitude with optional per-pixel EdgeDirection, and Canny edges (255 / 0).
+// Same integer arithmetic as cpu_sobel_magnitude() / cpu_canny(), so results are bit-identical.
+Image apply_sobel_magnitude(ImageView img, std::vector<uint8_t>* direction = nullptr);
+void apply_canny(ImageView img, float low, float high);
+
+// Edge-clamped (2r+1)^2 box blur and a three-box-pass Gaussian, as separable running sums whose cost
+// per pixel does not depend on the radius. Bit-identical to cpu_box_blur() / cpu_gaussian_blur().
+void apply_box_blur(ImageView img, int radius = 1);
+void apply_gaussian_blur(ImageView img, float sigma);
+
+// Sharpen, Laplacian, Emboss or Gaussian5 with the step's border mode; the same Stencils
+// (stencil.h) as cpu_convolve(), so results are bit-identical.
+void apply_convolve(ImageView img, const FilterStep& step);
+
+// Applies a per-channel 256-entry table (see point_lut.h), staged through constant memory.
+struct PointLut;
+void apply_point_lut(ImageView img, const PointLut& lut);
+
+// Histogram of the colour channels (histogram.h), counted in shared-memory bins per block and added
+// to the global ones once per block; same counts as cpu_histogram().
+struct Histogram;
+Histogram apply_histogram(const ImageView& img);
+
+// Runs a whole chain with a single upload/download. Adjacent point ops are compiled into composed
+// tables and run in one kernel launch; stencil stages keep their intermediates on the device.
+// Autolevels / equalize read back only their histogram, counted by the point pass before them.
+void apply_pipeline(ImageView img, const FilterChain& chain);
@@ -0,0 +1,135 @@
+// src/core/histogram.cpp
+#include "histogram.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
+Histogram::Bins Histogram::combined() const
+{
+    Bins bins{};
+    for (int c = 0; c < channels; ++c)
+    {
+        for (int v = 0; v < 256; ++v) bins[v] += counts[c][v];
+    }
+    return bins;
+}
+
+void Histogram::merge(const Histogram& other)
+{
+    if (other.pixels == 0) return;
+    if (pixels == 0) channels = other.channels;
+    if (channels != other.channels) throw std::invalid_argument("Histogram::merge: channel counts differ");
+    pixels += other.pixels;
+    for (int c = 0; c < channels; ++c)
+    {
+        for (int v = 0; v < 256; ++v) counts[c][v] += other.counts[c][v];
+    }
+}
+
+void accumulate_histogram(Histogram& hist, const uint8_t* data, size_t pixels, int channels)
+{
+    hist.pixels += pixels;
+    if (channels == 1)
+    {
+        // Two interleaved sets of bins, so runs of equal values do not serialize on one counter.
+        Histogram::Bins& bins = hist.counts[0];
+        std::array<uint32_t, 256> odd{};
+        size_t i = 0;
+        for (; i + 1 < pixels; i += 2)
+        {
+            ++bins[data[i]];
+            ++odd[data[i + 1]];
+        }
+        if (i < pixels) ++bins[data[i]];
+        for (int v = 0; v < 256; ++v) bins[v] += odd[v];
+        return;
+    }
+    Histogram::Bins& r = hist.counts[0];
+    Histogram::Bins& g = hist.counts[1];
+    Histogram::Bins& b = hist.counts[2];
+    for (size_t i = 0; i < pixels; ++i, data += channels)
+    {
+        ++r[data[0]];
+        ++g[data[1]];
+        ++b[data[2]];
+    }
+}
+
+HistogramStats histogram_stats(const Histogram::Bins& bins)
+{
+    HistogramStats stats;
+    uint64_t total = 0;
+    double sum = 0.0;
+    double sum_sq = 0.0;
+    for (int v = 0; v < 256; ++v)
+    {
+        if (bins[v] == 0) continue;
+        if (total == 0) stats.min = v;
+        stats.max = v;
+        total += bins[v];
+        sum += static_cast<double>(bins[v]) * v;
+        sum_sq += static_cast<double>(bins[v]) * v * v;
+    }
+    if (total == 0) return stats;
+    stats.mean = sum / static_cast<double>(total);
+    stats.stddev = std::sqrt(std::max(sum_sq / static_cast<double>(total) - stats.mean * stats.mean, 0.0));
+    stats.median = histogram_percentile(bins, 50.0);
+    return stats;
+}
+
+int histogram_percentile(const Histogram::Bins& bins, double percent)
+{
+    uint64_t total = 0;
+    for (uint64_t n : bins) total += n;
+    if (total == 0) return 0;
+    const double fraction = std::clamp(percent, 0.0, 100.0) / 100.0;
+    const uint64_t target = std::max<uint64_t>(static_cast<uint64_t>(std::ceil(fraction * static_cast<double>(total))), 1);
+    uint64_t seen = 0;
+    for (int v = 0; v < 256; ++v)
+    {
+        seen += bins[v];
+        if (seen >= target) return v;
+    }
+    return 255;
+}
+
+PointLut stats_lut(const FilterStep& step, const Histogram& hist)
+{
+    const Histogram::Bins bins = hist.combined();
+    if (step.kind == FilterKind::AutoLevels)
+    {
+        const double clip = std::clamp(static_cast<double>(step.param()), 0.0, 49.0);
+        const int lo = histogram_percentile(bins, clip);
+        const int hi = histogram_percentile(bins, 100.0 - clip);
+        if (hi <= lo) return PointLut::identity(); // flat frame: nothing to stretch
+        return levels_lut(static_cast<float>(lo), static_cast<float>(hi));
+    }
+    if (step.kind == FilterKind::Equalize)
+    {
+        // Classic equalization: (cdf(v) - cdf_min) / (total - cdf_min), scaled to 0..255 and rounded
+        // in integers, with cdf_min the count of the lowest occupied value (which maps to 0).
+        uint64_t total = 0;
+        for (uint64_t n : bins) total += n;
+        uint64_t cdf_min = 0;
+        for (uint64_t n : bins)
+        {
+            if (n == 0) continue;
+            cdf_min = n;
+            break;
+        }
+        if (total == cdf_min) return PointLut::identity(); // at most one value present
+        const uint64_t range = total - cdf_min;
+        PointLut lut;
+        uint64_t cdf = 0;
+        for (int v = 0; v < 256; ++v)
+        {
+            cdf += bins[v];
+            const uint64_t above = cdf > cdf_min ? cdf - cdf_min : 0;
+            lut.table[v] = static_cast<uint8_t>((above * 510 + range) / (2 * range));
+        }
+        return lut;
+    }
+    throw std::invalid_argument(std::string(filter_kind_name(step.kind)) + " does not compile from a histogram");
+}
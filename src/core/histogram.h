@@ -0,0 +1,49 @@
+// src/core/histogram.h
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "filter_chain.h"
+#include "point_lut.h"
+
+// 256-bin histograms of an image's colour channels (the first min(channels, 3); a 4th byte is not
+// counted). Produced by cpu_histogram() / apply_histogram() / compute_histogram() (backend.h), and
+// by the pipelines as a by-product of the pass that writes the frame before autolevels / equalize.
+struct Histogram
+{
+    using Bins = std::array<uint64_t, 256>;
+
+    int channels = 0;    // colour channels counted
+    uint64_t pixels = 0;
+    std::array<Bins, 3> counts{};
+
+    // All counted channels summed; what autolevels and equalize work from.
+    Bins combined() const;
+    void merge(const Histogram& other);
+};
+
+// Counts `pixels` interleaved pixels of `channels` bytes each into hist (whose channels must be
+// min(channels, 3)).
+void accumulate_histogram(Histogram& hist, const uint8_t* data, size_t pixels, int channels);
+
+struct HistogramStats
+{
+    int min = 0;        // lowest and highest occupied bin; 0 for an empty histogram
+    int max = 0;
+    double mean = 0.0;
+    double stddev = 0.0;
+    int median = 0;
+};
+HistogramStats histogram_stats(const Histogram::Bins& bins);
+
+// Smallest value v such that at least `percent` % of the samples (and at least one) are <= v, so
+// 0 % is the minimum and 100 % the maximum; 0 for an empty histogram.
+int histogram_percentile(const Histogram::Bins& bins, double percent);
+
+// Table an AutoLevels or Equalize step (is_stats_op()) compiles to for a frame with histogram `hist`:
+// autolevels stretches the [clip %, 100 - clip %] percentile range to 0..255 through levels_lut(),
+// equalize maps each value to its rank in the cumulative histogram. Both use the combined histogram,
+// so every channel gets the same table and hues do not shift.
+PointLut stats_lut(const FilterStep& step, const Histogram& hist);
@@ -1,17 +1,399 @@
 // src/core/image.cpp
 #include "image.h"
+#include "buffer_pool.h"
+#include "codecs.h"
+#include "row_io.h"
+#include "thread_pool.h"
+#include "trace.h"
 
 #define STB_IMAGE_IMPLEMENTATION
 #define STB_IMAGE_WRITE_IMPLEMENTATION
 #include <stb_image.h>
 #include <stb_image_write.h>
 
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <new>
 #include <stdexcept>
 #include <string>
+#include <utility>
 #include <vector>
 
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define CUDAPIX_HAS_MMAP 1
+#endif
+
+namespace
+{
+void free_owned(uint8_t* data, size_t)
+{
+    std::free(data);
+}
+
+void release_pooled(uint8_t* data, size_t)
+{
+    host_buffer_pool().release(data);
+}
+
+// Buffers from this size up come from host_buffer_pool(), so frame-sized images recycle memory
+// instead of faulting in fresh pages; smaller ones are not worth the pool's bookkeeping.
+constexpr size_t kPooledPixelBytes = size_t(64) << 10;
+
+std::vector<uint8_t> read_file(const std::string& path)
+{
+    std::unique_ptr<std::FILE, int (*)(std::FILE*)> file(std::fopen(path.c_str(), "rb"), &std::fclose);
+    if (!file) throw std::runtime_error("Failed to open " + path);
+    std::vector<uint8_t> data;
+    if (std::fseek(file.get(), 0, SEEK_END) == 0)
+    {
+        const long size = std::ftell(file.get());
+        if (size > 0) data.resize(static_cast<size_t>(size));
+        std::rewind(file.get());
+    }
+    if (std::fread(data.data(), 1, data.size(), file.get()) != data.size())
+    {
+        throw std::runtime_error("Failed to read " + path);
+    }
+    return data;
+}
+
+void write_file(const std::string& path, const std::vector<uint8_t>& data)
+{
+    std::unique_ptr<std::FILE, int (*)(std::FILE*)> file(std::fopen(path.c_str(), "wb"), &std::fclose);
+    if (!file || std::fwrite(data.data(), 1, data.size(), file.get()) != data.size() ||
+        std::fclose(file.release()) != 0)
+    {
+        throw std::runtime_error("Failed to save image: " + path);
+    }
+}
+
+// Decodes a PNM file whose layout cannot be mapped as RGB8 (gray, alpha) row by row.
+Image read_pnm(const std::string& path)
+{
+    std::unique_ptr<RowReader> reader = open_row_reader(path);
+    Image img;
+    img.width = reader->width();
+    img.height = reader->height();
+    img.channels = reader->channels();
+    img.pixels.resize_uninitialized(reader->row_bytes() * img.height);
+    reader->read_rows(img.pixels.data(), img.height);
+    return img;
+}
+
+// Image over `bytes` bytes of `path` starting at `offset`, copy-on-write mapped where supported.
+Image map_file_region(const std::string& path, size_t offset, int width, int height, int channels)
+{
+    const size_t bytes = static_cast<size_t>(width) * height * channels;
+    Image img;
+    img.width = width;
+    img.height = height;
+    img.channels = channels;
+
+#if defined(CUDAPIX_HAS_MMAP)
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) throw std::runtime_error("Failed to open " + path);
+    struct stat st{};
+    if (::fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < offset + bytes)
+    {
+        ::close(fd);
+        throw std::runtime_error("File too short for a " + std::to_string(width) + "x" + std::to_string(height) +
+                                 " image: " + path);
+    }
+    const size_t length = offset + bytes;
+    // MAP_PRIVATE: reads come from the page cache, writes go to private pages and never reach the file.
+    void* base = ::mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (base == MAP_FAILED) throw std::runtime_error("Failed to map " + path);
+    img.pixels = PixelBuffer(static_cast<uint8_t*>(base) + offset, bytes,
+                             [base, length](uint8_t*, size_t) { ::munmap(base, length); });
+#else
+    std::unique_ptr<std::FILE, int (*)(std::FILE*)> file(std::fopen(path.c_str(), "rb"), &std::fclose);
+    if (!file) throw std::runtime_error("Failed to open " + path);
+    img.pixels.resize_uninitialized(bytes);
+    if (std::fseek(file.get(), static_cast<long>(offset), SEEK_SET) != 0 ||
+        std::fread(img.pixels.data(), 1, bytes, file.get()) != bytes)
+    {
+        throw std::runtime_error("File too short for a " + std::to_string(width) + "x" + std::to_string(height) +
+                                 " image: " + path);
+    }
+#endif
+    return img;
+}
+} // namespace
+
+PixelBuffer::PixelBuffer(size_t size, uint8_t value)
+{
+    assign(size, value);
+}
+
+PixelBuffer::PixelBuffer(uint8_t* data, size_t size, Release release)
+    : data_(data), size_(size), capacity_(size), release_(std::move(release))
+{
+}
+
+PixelBuffer::PixelBuffer(const PixelBuffer& other)
+{
+    assign(other.begin(), other.end());
+}
+
+PixelBuffer::PixelBuffer(PixelBuffer&& other) noexcept
+{
+    swap(other);
+}
+
+PixelBuffer& PixelBuffer::operator=(PixelBuffer other) noexcept
+{
+    swap(other);
+    return *this;
+}
+
+PixelBuffer::~PixelBuffer()
+{
+    if (data_) release_(data_, capacity_);
+}
+
+void PixelBuffer::reallocate(size_t capacity)
+{
+    uint8_t* fresh = nullptr;
+    Release release = free_owned;
+    if (capacity >= kPooledPixelBytes)
+    {
+        fresh = static_cast<uint8_t*>(host_buffer_pool().acquire(capacity, &capacity)); // class size, 64-aligned
+        release = release_pooled;
+    }
+    else
+    {
+        const size_t bytes = (std::max<size_t>(capacity, 1) + kRowAlignment - 1) / kRowAlignment * kRowAlignment;
+        fresh = static_cast<uint8_t*>(std::aligned_alloc(kRowAlignment, bytes));
+        if (!fresh) throw std::bad_alloc();
+    }
+    if (size_) std::memcpy(fresh, data_, std::min(size_, capacity));
+    if (data_) release_(data_, capacity_);
+    data_ = fresh;
+    capacity_ = capacity;
+    release_ = std::move(release);
+}
+
+void PixelBuffer::resize(size_t size)
+{
+    if (size > capacity_) reallocate(std::max(size, capacity_ + capacity_ / 2));
+    if (size > size_) std::memset(data_ + size_, 0, size - size_);
+    size_ = size;
+}
+
+void PixelBuffer::resize_uninitialized(size_t size)
+{
+    if (size > capacity_)
+    {
+        size_ = std::min(size_, size);
+        reallocate(std::max(size, capacity_ + capacity_ / 2));
+    }
+    size_ = size;
+}
+
+void PixelBuffer::assign(const uint8_t* first, const uint8_t* last)
+{
+    const size_t size = static_cast<size_t>(last - first);
+    size_ = 0;
+    if (size > capacity_) reallocate(size);
+    if (size) std::memmove(data_, first, size);
+    size_ = size;
+}
+
+void PixelBuffer::assign(size_t size, uint8_t value)
+{
+    size_ = 0;
+    if (size > capacity_) reallocate(size);
+    if (size) std::memset(data_, value, size);
+    size_ = size;
+}
+
+void PixelBuffer::swap(PixelBuffer& other) noexcept
+{
+    std::swap(data_, other.data_);
+    std::swap(size_, other.size_);
+    std::swap(capacity_, other.capacity_);
+    std::swap(release_, other.release_);
+}
+
+bool PixelBuffer::operator==(const PixelBuffer& other) const
+{
+    return size_ == other.size_ && (size_ == 0 || std::memcmp(data_, other.data_, size_) == 0);
+}
+
+Image to_image(const ConstImageView& view)
+{
+    Image img;
+    img.width = view.width;
+    img.height = view.height;
+    img.channels = view.channels;
+    img.pixels.resize_uninitialized(view.row_bytes() * view.height);
+    for (int y = 0; y < view.height; ++y)
+    {
+        std::memcpy(img.pixels.data() + y * view.row_bytes(), view.row(y), view.row_bytes());
+    }
+    return img;
+}
+
+Image allocate_image(int width, int height, int channels, size_t alignment)
+{
+    if (width < 0 || height < 0) throw std::invalid_argument("allocate_image: negative size");
+    if (channels != 1 && channels != 3 && channels != 4)
+    {
+        throw std::invalid_argument("allocate_image: expected 1, 3 or 4 channels, got " + std::to_string(channels));
+    }
+    if (alignment == 0 || (alignment & (alignment - 1)) != 0)
+    {
+        throw std::invalid_argument("allocate_image: alignment must be a power of two");
+    }
+    Image img;
+    img.width = width;
+    img.height = height;
+    img.channels = channels;
+    img.stride = (static_cast<size_t>(width) * channels + alignment - 1) / alignment * alignment;
+    const size_t bytes = img.stride * height;
+    if (alignment <= kRowAlignment)
+    {
+        img.pixels.assign(bytes, 0);
+        return img;
+    }
+    uint8_t* data = static_cast<uint8_t*>(std::aligned_alloc(alignment, std::max(bytes, alignment)));
+    if (!data) throw std::bad_alloc();
+    std::memset(data, 0, bytes);
+    img.pixels = PixelBuffer(data, bytes, free_owned);
+    return img;
+}
+
+void convert_pixels(const ConstImageView& src, const ImageView& dst)
+{
+    if (src.width != dst.width || src.height != dst.height)
+    {
+        throw std::invalid_argument("convert_pixels: size mismatch");
+    }
+    for (const int c : { src.channels, dst.channels })
+    {
+        if (c != 1 && c != 3 && c != 4) throw std::invalid_argument("convert_pixels: expected 1, 3 or 4 channels");
+    }
+    const int sc = src.channels;
+    const int dc = dst.channels;
+    parallel_for_rows(src.height, std::max(src.row_bytes(), dst.row_bytes()), [&](int y0, int y1) {
+        for (int y = y0; y < y1; ++y)
+        {
+            const uint8_t* in = src.row(y);
+            uint8_t* out = dst.row(y);
+            if (sc == dc)
+            {
+                std::memmove(out, in, src.row_bytes());
+                continue;
+            }
+            for (int x = 0; x < src.width; ++x, in += sc, out += dc)
+            {
+                if (dc == 1)
+                {
+                    out[0] = static_cast<uint8_t>((9798 * in[0] + 19235 * in[1] + 3735 * in[2] + 16384) >> 15);
+                }
+                else if (sc == 1)
+                {
+                    out[0] = out[1] = out[2] = in[0];
+                }
+                else
+                {
+                    out[0] = in[0];
+                    out[1] = in[1];
+                    out[2] = in[2];
+                }
+            }
+        }
+    });
+}
+
+Image convert_channels(const ConstImageView& src, int channels)
+{
+    Image img = allocate_image(src.width, src.height, channels);
+    if (channels == 4 && src.channels != 4)
+    {
+        for (int y = 0; y < img.height; ++y)
+        {
+            uint8_t* row = img.pixels.data() + y * img.stride;
+            for (int x = 0; x < img.width; ++x) row[x * 4 + 3] = 255;
+        }
+    }
+    convert_pixels(src, img);
+    return img;
+}
+
+PlanarImage to_planar(const ConstImageView& src, size_t alignment)
+{
+    if (src.channels < 1 || src.channels > 4) throw std::invalid_argument("to_planar: expected 1 to 4 channels");
+    if (alignment == 0 || (alignment & (alignment - 1)) != 0)
+    {
+        throw std::invalid_argument("to_planar: alignment must be a power of two");
+    }
+    PlanarImage planar;
+    planar.width = src.width;
+    planar.height = src.height;
+    planar.channels = src.channels;
+    planar.stride = (static_cast<size_t>(src.width) + alignment - 1) / alignment * alignment;
+    planar.pixels.assign(planar.plane_bytes() * src.channels, 0);
+    parallel_for_rows(src.height, src.row_bytes(), [&](int y0, int y1) {
+        for (int y = y0; y < y1; ++y)
+        {
+            const uint8_t* in = src.row(y);
+            for (int c = 0; c < src.channels; ++c)
+            {
+                uint8_t* out = planar.plane(c).row(y);
+                for (int x = 0; x < src.width; ++x) out[x] = in[x * src.channels + c];
+            }
+        }
+    });
+    return planar;
+}
+
+void from_planar(PlanarImage& src, const ImageView& dst)
+{
+    if (src.width != dst.width || src.height != dst.height || src.channels != dst.channels)
+    {
+        throw std::invalid_argument("from_planar: layout mismatch");
+    }
+    parallel_for_rows(dst.height, dst.row_bytes(), [&](int y0, int y1) {
+        for (int y = y0; y < y1; ++y)
+        {
+            uint8_t* out = dst.row(y);
+            for (int c = 0; c < dst.channels; ++c)
+            {
+                const uint8_t* in = src.plane(c).row(y);
+                for (int x = 0; x < dst.width; ++x) out[x * dst.channels + c] = in[x];
+            }
+        }
+    });
+}
+
 Image load_image(const std::string& path)
 {
+    TraceSpan span("load", "io");
+    if (span.active()) span.set_detail(path);
+    const std::string ext = lower_extension(path);
+    if (ext == ".ppm" || ext == ".pam") return map_image(path);
+    if (ext == ".qoi")
+    {
+        const std::vector<uint8_t> data = read_file(path);
+        try
+        {
+            return decode_qoi(data.data(), data.size());
+        }
+        catch (const std::runtime_error& ex)
+        {
+            throw std::runtime_error("Failed to load image: " + path + " (" + ex.what() + ")");
+        }
+    }
+
     int w = 0, h = 0, ch = 0;
     // Force 3 channels to normalize downstream CUDA kernels.
     unsigned char* data = stbi_load(path.c_str(), &w, &h, &ch, 3);
@@ -20,26 +402,58 @@ Image load_image(const std::string& path)
         throw std::runtime_error("Failed to load image: " + path);
     }
 
+    // The decoder's buffer is adopted as is instead of being copied.
     Image img;
     img.width = w;
     img.height = h;
     img.channels = 3;
-    img.pixels.assign(data, data + (w * h * img.channels));
-    stbi_image_free(data);
+    img.pixels = PixelBuffer(data, static_cast<size_t>(w) * h * img.channels,
+                             [](uint8_t* p, size_t) { stbi_image_free(p); });
     return img;
 }
 
-void save_image(const std::string& path, const Image& img)
+Image map_image(const std::string& path)
+{
+    const PnmHeader header = read_pnm_header(path);
+    if (header.depth != 3) return read_pnm(path);
+    return map_file_region(path, header.data_offset, header.width, header.height, 3);
+}
+
+Image map_raw_image(const std::string& path, int width, int height, int channels, size_t offset)
+{
+    if (width <= 0 || height <= 0 || channels < 1 || channels > 4)
+    {
+        throw std::invalid_argument("Bad raw image layout for " + path);
+    }
+    return map_file_region(path, offset, width, height, channels);
+}
+
+void save_image(const std::string& path, const Image& img, const PngOptions& png)
 {
-    if (img.channels != 3)
+    if (img.channels == 4) return save_image(path, convert_channels(img, 3), png);
+    if (img.channels != 1 && img.channels != 3)
     {
-        throw std::runtime_error("save_image expects RGB image (3 channels).");
+        throw std::runtime_error("save_image expects a gray (1 channel), RGB (3) or RGBA (4 channels) image.");
     }
 
-    int stride = img.width * img.channels;
-    int result = stbi_write_png(path.c_str(), img.width, img.height, img.channels, img.pixels.data(), stride);
-    if (result == 0)
+    TraceSpan span("save", "io");
+    if (span.active()) span.set_detail(path);
+    std::vector<uint8_t> encoded;
+    const ConstImageView view(img);
+    switch (image_format_for_path(path))
     {
-        throw std::runtime_error("Failed to save image: " + path);
+    case ImageFormat::Qoi: encoded = encode_qoi(view); break;
+    case ImageFormat::Ppm: encoded = encode_pnm(view, false); break;
+    case ImageFormat::Pam: encoded = encode_pnm(view, true); break;
+    case ImageFormat::Bmp:
+        if (!view.is_packed()) return save_image(path, to_image(view), png);
+        if (!stbi_write_bmp(path.c_str(), img.width, img.height, img.channels, img.pixels.data()))
+        {
+            throw std::runtime_error("Failed to save image: " + path);
+        }
+        return;
+    case ImageFormat::Png: encoded = encode_png(view, png); break;
     }
+    TraceSpan write_span("write file", "io");
+    write_file(path, encoded);
 }
@@ -1,21 +1,231 @@
 // src/core/image.h
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
+#include <functional>
 #include <string>
-#include <vector>
 
-// Simple 8-bit interleaved RGB image stored row-major.
+// Row alignment of allocate_image(): a cache line, and enough for any SIMD width the filters use.
+// Storage a PixelBuffer allocates itself starts on such a boundary too.
+constexpr size_t kRowAlignment = 64;
+
+// Byte buffer behind Image. Behaves like a std::vector<uint8_t> for the operations the filters use,
+// but can also adopt memory it did not allocate (a decoder's output, a file mapping) so loading
+// needs no extra copy. Adopted memory is handed back through `release` when the buffer is destroyed
+// or has to grow. Copies are always deep and owned.
+class PixelBuffer
+{
+public:
+    using Release = std::function<void(uint8_t* data, size_t size)>;
+
+    PixelBuffer() = default;
+    explicit PixelBuffer(size_t size, uint8_t value = 0);
+    PixelBuffer(uint8_t* data, size_t size, Release release); // takes ownership of data
+    PixelBuffer(const PixelBuffer& other);
+    PixelBuffer(PixelBuffer&& other) noexcept;
+    PixelBuffer& operator=(PixelBuffer other) noexcept;
+    ~PixelBuffer();
+
+    uint8_t* data() { return data_; }
+    const uint8_t* data() const { return data_; }
+    size_t size() const { return size_; }
+    size_t capacity() const { return capacity_; }
+    bool empty() const { return size_ == 0; }
+
+    uint8_t* begin() { return data_; }
+    uint8_t* end() { return data_ + size_; }
+    const uint8_t* begin() const { return data_; }
+    const uint8_t* end() const { return data_ + size_; }
+    uint8_t& operator[](size_t i) { return data_[i]; }
+    const uint8_t& operator[](size_t i) const { return data_[i]; }
+
+    // New bytes are zero, as with std::vector. Shrinking never reallocates.
+    void resize(size_t size);
+    // Same without the zero fill, for buffers about to be overwritten in full.
+    void resize_uninitialized(size_t size);
+    void assign(const uint8_t* first, const uint8_t* last);
+    void assign(size_t size, uint8_t value);
+    void clear() { size_ = 0; }
+    void swap(PixelBuffer& other) noexcept;
+
+    bool operator==(const PixelBuffer& other) const;
+    bool operator!=(const PixelBuffer& other) const { return !(*this == other); }
+
+private:
+    void reallocate(size_t capacity);
+
+    uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+    size_t capacity_ = 0;
+    Release release_; // empty when data_ is null
+};
+
+// 8-bit interleaved image stored row-major: 1 channel (gray), 3 (RGB) or 4 (RGBA, or RGBX where the
+// 4th byte is padding). Loaders produce packed RGB; allocate_image() gives rows aligned for SIMD and
+// DMA, with `stride` padding bytes at the end of each row.
 struct Image
 {
     int width = 0;
     int height = 0;
-    int channels = 3; // we normalize to RGB
-    std::vector<uint8_t> pixels;
+    int channels = 3; // 1, 3 or 4; loaders normalize to RGB
+    size_t stride = 0; // bytes from one row to the next; 0 means packed (width * channels)
+    PixelBuffer pixels;
+
+    size_t row_stride() const { return stride ? stride : static_cast<size_t>(width) * channels; }
+};
+
+// Pixel rectangle: columns [x0, x1), rows [y0, y1).
+struct Rect
+{
+    int x0 = 0;
+    int y0 = 0;
+    int x1 = 0;
+    int y1 = 0;
+
+    int width() const { return x1 - x0; }
+    int height() const { return y1 - y0; }
+    bool empty() const { return x1 <= x0 || y1 <= y0; }
+    // Grown by `margin` on every side, then clipped to a width x height frame.
+    Rect expanded(int margin, int width, int height) const
+    {
+        return { x0 - margin < 0 ? 0 : x0 - margin, y0 - margin < 0 ? 0 : y0 - margin,
+                 x1 + margin > width ? width : x1 + margin, y1 + margin > height ? height : y1 + margin };
+    }
+};
+
+// Non-owning window onto interleaved 8-bit pixels with an arbitrary row stride, e.g. a whole Image,
+// a crop of one, or a caller's framebuffer. Filters take views, so any of these can be processed in
+// place; an Image converts implicitly.
+struct ImageView
+{
+    uint8_t* data = nullptr;
+    int width = 0;
+    int height = 0;
+    size_t stride = 0; // bytes from one row to the next, >= width * channels
+    int channels = 3;
+
+    ImageView() = default;
+    ImageView(uint8_t* data, int width, int height, size_t stride, int channels = 3)
+        : data(data), width(width), height(height), stride(stride), channels(channels)
+    {
+    }
+    ImageView(Image& img) // NOLINT: implicit on purpose
+        : data(img.pixels.data()), width(img.width), height(img.height),
+          stride(img.row_stride()), channels(img.channels)
+    {
+    }
+
+    uint8_t* row(int y) const { return data + static_cast<size_t>(y) * stride; }
+    size_t row_bytes() const { return static_cast<size_t>(width) * channels; }
+    bool is_packed() const { return stride == row_bytes(); }
+    bool empty() const { return data == nullptr || width <= 0 || height <= 0; }
+    // Rows [y0, y1) and columns [x0, x1) of this view.
+    ImageView crop(int x0, int y0, int x1, int y1) const
+    {
+        return ImageView(row(y0) + static_cast<size_t>(x0) * channels, x1 - x0, y1 - y0, stride, channels);
+    }
+    ImageView crop(const Rect& r) const { return crop(r.x0, r.y0, r.x1, r.y1); }
+};
+
+// Read-only counterpart of ImageView, taken by everything that only reads pixels (copies,
+// conversions, encoders, hashing, resampling), so a const Image can be passed without a cast. An
+// Image or ImageView converts implicitly.
+struct ConstImageView
+{
+    const uint8_t* data = nullptr;
+    int width = 0;
+    int height = 0;
+    size_t stride = 0; // bytes from one row to the next, >= width * channels
+    int channels = 3;
+
+    ConstImageView() = default;
+    ConstImageView(const uint8_t* data, int width, int height, size_t stride, int channels = 3)
+        : data(data), width(width), height(height), stride(stride), channels(channels)
+    {
+    }
+    ConstImageView(const Image& img) // NOLINT: implicit on purpose
+        : data(img.pixels.data()), width(img.width), height(img.height),
+          stride(img.row_stride()), channels(img.channels)
+    {
+    }
+    ConstImageView(const ImageView& view) // NOLINT: implicit on purpose
+        : data(view.data), width(view.width), height(view.height), stride(view.stride), channels(view.channels)
+    {
+    }
+
+    const uint8_t* row(int y) const { return data + static_cast<size_t>(y) * stride; }
+    size_t row_bytes() const { return static_cast<size_t>(width) * channels; }
+    bool is_packed() const { return stride == row_bytes(); }
+    bool empty() const { return data == nullptr || width <= 0 || height <= 0; }
+    ConstImageView crop(int x0, int y0, int x1, int y1) const
+    {
+        return ConstImageView(row(y0) + static_cast<size_t>(x0) * channels, x1 - x0, y1 - y0, stride, channels);
+    }
+    ConstImageView crop(const Rect& r) const { return crop(r.x0, r.y0, r.x1, r.y1); }
 };
 
-// Load an image from disk. Alpha (if present) is dropped and data is converted to RGB.
+// Packed copy of a view's pixels.
+Image to_image(const ConstImageView& view);
+
+// Zeroed image whose first row starts on an `alignment` boundary and whose rows are `alignment`
+// bytes apart (`stride` rounded up). Throws std::invalid_argument for other than 1, 3 or 4 channels.
+Image allocate_image(int width, int height, int channels, size_t alignment = kRowAlignment);
+
+// Copies src into dst (same size) converting between 1, 3 and 4 channels: gray is replicated to
+// RGB, colour becomes gray with the integer luma the edge filters use, and alpha is dropped. When
+// dst has 4 channels and src fewer, dst's 4th bytes are left as they are. Throws
+// std::invalid_argument on a size mismatch or unsupported channel count.
+void convert_pixels(const ConstImageView& src, const ImageView& dst);
+
+// Aligned copy of a view with `channels` channels per pixel; an added alpha channel is opaque.
+Image convert_channels(const ConstImageView& src, int channels);
+
+// Planar (structure-of-arrays) layout: plane c holds the c-th channel of every pixel, `height` rows
+// `stride` bytes apart, starting c * plane_bytes() into `pixels`. Channel-wise filters run on each
+// plane as a gray view with no repacking; see filter_layouts() and run_pipeline().
+struct PlanarImage
+{
+    int width = 0;
+    int height = 0;
+    int channels = 3;
+    size_t stride = 0; // of each plane, >= width
+    PixelBuffer pixels;
+
+    size_t plane_bytes() const { return stride * static_cast<size_t>(height); }
+    ImageView plane(int c)
+    {
+        return ImageView(pixels.data() + c * plane_bytes(), width, height, stride, 1);
+    }
+};
+
+// Splits an interleaved view into aligned planes, and writes planes back into an interleaved view
+// of the same size and channel count (throws std::invalid_argument otherwise).
+PlanarImage to_planar(const ConstImageView& src, size_t alignment = kRowAlignment);
+void from_planar(PlanarImage& src, const ImageView& dst);
+
+// Load an image from disk. Alpha (if present) is dropped and data is converted to RGB. The decoder's
+// buffer becomes the Image's storage directly; PPM/PAM files are memory-mapped (see map_image()) and
+// QOI files go through decode_qoi().
 Image load_image(const std::string& path);
 
-// Save an image to disk as PNG.
-void save_image(const std::string& path, const Image& img);
+// Maps an uncompressed 8-bit RGB PPM (P6) or PAM (DEPTH 3) file copy-on-write: the pixels are read
+// straight from the page cache, and only pages a filter writes to get private copies. Other PNM
+// layouts (gray, alpha) are decoded into memory instead. Throws std::runtime_error.
+Image map_image(const std::string& path);
+
+// Same for headerless interleaved pixels: `channels` bytes per pixel, packed rows, starting `offset`
+// bytes into the file.
+Image map_raw_image(const std::string& path, int width, int height, int channels = 3, size_t offset = 0);
+
+// PNG encoder settings for save_image().
+struct PngOptions
+{
+    int level = 6;   // zlib level: 0 stores, 1 is fastest, 9 smallest
+    int threads = 1; // > 1 deflates row chunks in parallel on cpu_thread_pool(); <= 0 uses every pool thread
+};
+
+// Save an image to disk in the format named by the extension: .qoi, .ppm/.pgm/.pnm (P6, or P5 for
+// gray), .pam, .bmp, and PNG for .png and anything else. Accepts RGB and single-channel (e.g.
+// apply_sobel_magnitude()) images; 4-channel images are saved as RGB. Throws std::runtime_error.
+void save_image(const std::string& path, const Image& img, const PngOptions& png = {});
@@ -0,0 +1,605 @@
+// src/core/job_server.cpp
+#include "job_server.h"
+
+#include "bounded_queue.h"
+#include "json.h"
+#include "pipeline_stages.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstring>
+#include <filesystem>
+#include <istream>
+#include <mutex>
+#include <ostream>
+#include <stdexcept>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+using Clock = std::chrono::steady_clock;
+
+double ms_between(Clock::time_point from, Clock::time_point to)
+{
+    return std::chrono::duration<double, std::milli>(to - from).count();
+}
+
+struct PendingJob
+{
+    ServerJob job;
+    JobServer::Callback done;
+    JobResult result;
+    Image image;
+    Clock::time_point submitted;
+};
+using JobPtr = std::unique_ptr<PendingJob>;
+
+// ---- line I/O on file descriptors ----------------------------------------------------------------
+
+class LineReader
+{
+public:
+    explicit LineReader(int fd) : fd_(fd) {}
+
+    // The next line without its "\n" / "\r\n"; false at end of input (a last unterminated line is
+    // still returned first).
+    bool next(std::string& line)
+    {
+        for (;;)
+        {
+            const size_t newline = buffer_.find('\n', scanned_);
+            if (newline != std::string::npos)
+            {
+                line.assign(buffer_, 0, newline);
+                buffer_.erase(0, newline + 1);
+                scanned_ = 0;
+                if (!line.empty() && line.back() == '\r') line.pop_back();
+                return true;
+            }
+            scanned_ = buffer_.size();
+            char chunk[64 * 1024];
+            const ssize_t got = ::read(fd_, chunk, sizeof(chunk));
+            if (got < 0 && errno == EINTR) continue;
+            if (got <= 0)
+            {
+                if (buffer_.empty()) return false;
+                line.swap(buffer_);
+                buffer_.clear();
+                scanned_ = 0;
+                return true;
+            }
+            buffer_.append(chunk, static_cast<size_t>(got));
+        }
+    }
+
+private:
+    int fd_;
+    std::string buffer_;
+    size_t scanned_ = 0; // bytes of buffer_ known to hold no newline
+};
+
+// Writes all of `data`; false when the peer is gone. Sockets use send() so a vanished client yields
+// EPIPE instead of SIGPIPE.
+bool write_all(int fd, const std::string& data)
+{
+    size_t done = 0;
+    while (done < data.size())
+    {
+        ssize_t n = ::send(fd, data.data() + done, data.size() - done, MSG_NOSIGNAL);
+        if (n < 0 && errno == ENOTSOCK) n = ::write(fd, data.data() + done, data.size() - done);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        done += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+// ---- protocol ------------------------------------------------------------------------------------
+
+double round_ms(double ms)
+{
+    return std::round(ms * 1000.0) / 1000.0; // microsecond resolution keeps the lines short
+}
+
+JsonValue result_json(const JobResult& result)
+{
+    JsonValue out = JsonValue::object();
+    out["id"] = result.id;
+    out["ok"] = result.ok;
+    if (!result.ok)
+    {
+        out["error"] = result.error;
+        return out;
+    }
+    out["backend"] = backend_name(result.backend);
+    out["width"] = result.width;
+    out["height"] = result.height;
+    out["queue_ms"] = round_ms(result.queue_ms);
+    out["decode_ms"] = round_ms(result.decode_ms);
+    out["filter_ms"] = round_ms(result.filter_ms);
+    out["encode_ms"] = round_ms(result.encode_ms);
+    out["total_ms"] = round_ms(result.total_ms);
+    return out;
+}
+
+JsonValue error_json(const std::string& id, const std::string& message)
+{
+    JsonValue out = JsonValue::object();
+    out["id"] = id;
+    out["ok"] = false;
+    out["error"] = message;
+    return out;
+}
+
+std::string id_of(const JsonValue& request, size_t line_number)
+{
+    const JsonValue* id = request.find("id");
+    if (!id || id->is_null()) return std::to_string(line_number);
+    if (id->is_string()) return id->as_string();
+    if (id->is_number())
+    {
+        const double value = id->as_number();
+        if (value == std::floor(value) && std::fabs(value) < 1e15) return std::to_string(static_cast<long long>(value));
+    }
+    return id->dump();
+}
+
+const std::string& required_string(const JsonValue& request, const char* key)
+{
+    const JsonValue* value = request.find(key);
+    if (!value || !value->is_string()) throw std::invalid_argument(std::string("Missing string field \"") + key + "\"");
+    return value->as_string();
+}
+
+// State shared by one conversation and the callbacks of the jobs it submitted.
+struct Conversation
+{
+    int out_fd = -1;
+    std::mutex write_mutex;
+    std::mutex mutex;
+    std::condition_variable idle;
+    size_t outstanding = 0;
+
+    void send(const JsonValue& value)
+    {
+        const std::string line = value.dump() + "\n";
+        std::lock_guard<std::mutex> lock(write_mutex);
+        write_all(out_fd, line); // a client that hung up just misses its results
+    }
+
+    void wait_idle()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        idle.wait(lock, [this] { return outstanding == 0; });
+    }
+};
+} // namespace
+
+// ---- JobServer -----------------------------------------------------------------------------------
+
+struct JobServer::Pipeline
+{
+    explicit Pipeline(size_t depth) : admitted(depth), decoded(depth), filtered(depth) {}
+
+    BoundedQueue<JobPtr> admitted;
+    BoundedQueue<JobPtr> decoded;
+    BoundedQueue<JobPtr> filtered;
+
+    mutable std::mutex stats_mutex;
+    JobServerStats stats;
+    double total_ms_sum = 0.0;
+
+    // Delivers the result of a job that finished or failed at any stage.
+    void finish(PendingJob& pending)
+    {
+        JobResult& result = pending.result;
+        result.total_ms = ms_between(pending.submitted, Clock::now());
+        {
+            std::lock_guard<std::mutex> lock(stats_mutex);
+            --stats.in_flight;
+            if (result.ok)
+            {
+                ++stats.completed;
+                total_ms_sum += result.total_ms;
+                stats.mean_total_ms = total_ms_sum / static_cast<double>(stats.completed);
+                stats.max_total_ms = std::max(stats.max_total_ms, result.total_ms);
+            }
+            else
+            {
+                ++stats.failed;
+            }
+        }
+        pending.image = Image{}; // back to the pool before the callback runs
+        if (pending.done) pending.done(result);
+    }
+
+    void fail(PendingJob& pending, const std::exception& ex)
+    {
+        pending.result.ok = false;
+        pending.result.error = ex.what();
+        finish(pending);
+    }
+};
+
+JobServer::JobServer(const JobServerOptions& options)
+    : options_(options), pipeline_(std::make_unique<Pipeline>(std::max<size_t>(options.queue_depth, 1)))
+{
+    const bool may_use_cuda = options_.backend != Backend::Cpu && options_.backend != Backend::CpuSerial &&
+                              backend_available(Backend::Cuda);
+    {
+        // Warm-up: creates the CUDA context, loads the kernels and starts the CPU pool now rather than
+        // inside the first job.
+        Image frame = allocate_image(64, 64, 3);
+        const FilterChain chain = parse_filter_chain("invert");
+        if (may_use_cuda) run_pipeline(frame, chain, Backend::Cuda);
+        run_pipeline(frame, chain, Backend::Cpu);
+    }
+
+    const int decoders = options_.decode_workers > 0 ? options_.decode_workers : half_hardware_threads();
+    const int encoders = options_.encode_workers > 0 ? options_.encode_workers : half_hardware_threads();
+    int filters = options_.filter_workers;
+    if (filters <= 0) filters = may_use_cuda ? 1 : std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+
+    Pipeline& p = *pipeline_;
+    start_stage(threads_, decoders, [&p] {
+        JobPtr pending;
+        while (p.admitted.pop(pending))
+        {
+            const Clock::time_point t = Clock::now();
+            pending->result.queue_ms = ms_between(pending->submitted, t);
+            try
+            {
+                pending->image = load_image(pending->job.input);
+            }
+            catch (const std::exception& ex)
+            {
+                p.fail(*pending, ex);
+                continue;
+            }
+            pending->result.width = pending->image.width;
+            pending->result.height = pending->image.height;
+            pending->result.decode_ms = ms_between(t, Clock::now());
+            p.decoded.push(std::move(pending));
+        }
+    }, [&p] { p.decoded.close(); });
+
+    const JobServerOptions* opts = &options_;
+    start_stage(threads_, filters, [&p, opts] {
+        JobPtr pending;
+        while (p.decoded.pop(pending))
+        {
+            const Clock::time_point t = Clock::now();
+            try
+            {
+                apply_resize(pending->image, pending->job.resize);
+                pending->result.width = pending->image.width;
+                pending->result.height = pending->image.height;
+                const FilterChain& chain = pending->job.chain;
+                if (chain.empty())
+                    pending->result.backend = Backend::Cpu; // resized only
+                else if (opts->cache)
+                    pending->result.backend = opts->cache->run(pending->image, chain, opts->backend).backend;
+                else
+                    pending->result.backend = run_pipeline(pending->image, chain, opts->backend);
+            }
+            catch (const std::exception& ex)
+            {
+                p.fail(*pending, ex);
+                continue;
+            }
+            pending->result.filter_ms = ms_between(t, Clock::now());
+            p.filtered.push(std::move(pending));
+        }
+    }, [&p] { p.filtered.close(); });
+
+    start_stage(threads_, encoders, [&p, opts] {
+        JobPtr pending;
+        while (p.filtered.pop(pending))
+        {
+            const Clock::time_point t = Clock::now();
+            try
+            {
+                save_image(pending->job.output, pending->image, opts->png);
+            }
+            catch (const std::exception& ex)
+            {
+                p.fail(*pending, ex);
+                continue;
+            }
+            pending->result.encode_ms = ms_between(t, Clock::now());
+            pending->result.ok = true;
+            p.finish(*pending);
+        }
+    }, [] {});
+}
+
+JobServer::~JobServer()
+{
+    shutdown();
+}
+
+bool JobServer::submit(ServerJob job, Callback done)
+{
+    if (stopped_) return false;
+    auto pending = std::make_unique<PendingJob>();
+    pending->result.id = job.id;
+    pending->job = std::move(job);
+    pending->done = std::move(done);
+    pending->submitted = Clock::now();
+    {
+        std::lock_guard<std::mutex> lock(pipeline_->stats_mutex);
+        ++pipeline_->stats.in_flight;
+    }
+    if (pipeline_->admitted.push(std::move(pending))) return true;
+    std::lock_guard<std::mutex> lock(pipeline_->stats_mutex);
+    --pipeline_->stats.in_flight;
+    return false;
+}
+
+void JobServer::shutdown()
+{
+    if (stopped_.exchange(true)) return;
+    pipeline_->admitted.close();
+    for (std::thread& t : threads_)
+    {
+        t.join();
+    }
+    threads_.clear();
+}
+
+JobServerStats JobServer::stats() const
+{
+    std::lock_guard<std::mutex> lock(pipeline_->stats_mutex);
+    return pipeline_->stats;
+}
+
+// ---- transports ----------------------------------------------------------------------------------
+
+bool serve_json_lines(JobServer& server, int in_fd, int out_fd)
+{
+    auto conversation = std::make_shared<Conversation>();
+    conversation->out_fd = out_fd;
+    LineReader reader(in_fd);
+    std::string line;
+    size_t line_number = 0;
+    bool shutdown_requested = false;
+    while (!shutdown_requested && reader.next(line))
+    {
+        ++line_number;
+        if (line.find_first_not_of(" \t") == std::string::npos) continue;
+
+        std::string id = std::to_string(line_number);
+        try
+        {
+            const JsonValue request = parse_json(line);
+            if (!request.is_object()) throw std::invalid_argument("Request is not a JSON object");
+            id = id_of(request, line_number);
+
+            if (const JsonValue* op = request.find("op"))
+            {
+                const std::string name = op->is_string() ? op->as_string() : std::string();
+                JsonValue reply = JsonValue::object();
+                reply["op"] = name;
+                reply["ok"] = true;
+                if (name == "stats")
+                {
+                    const JobServerStats stats = server.stats();
+                    reply["completed"] = stats.completed;
+                    reply["failed"] = stats.failed;
+                    reply["in_flight"] = stats.in_flight;
+                    reply["mean_total_ms"] = round_ms(stats.mean_total_ms);
+                    reply["max_total_ms"] = round_ms(stats.max_total_ms);
+                }
+                else if (name == "shutdown")
+                {
+                    shutdown_requested = true;
+                }
+                else
+                {
+                    throw std::invalid_argument("Unknown op: " + op->dump());
+                }
+                conversation->send(reply);
+                continue;
+            }
+
+            ServerJob job;
+            job.id = id;
+            job.input = required_string(request, "input");
+            job.output = required_string(request, "output");
+            std::string chain = required_string(request, "chain");
+            job.resize = take_resize_step(chain);
+            if (!job.resize.active() || !chain.empty()) job.chain = parse_filter_chain(chain);
+            {
+                std::lock_guard<std::mutex> lock(conversation->mutex);
+                ++conversation->outstanding;
+            }
+            // Blocks while the server is saturated, which stops this loop from reading further.
+            const bool queued = server.submit(std::move(job), [conversation](const JobResult& result) {
+                conversation->send(result_json(result));
+                std::lock_guard<std::mutex> lock(conversation->mutex);
+                if (--conversation->outstanding == 0) conversation->idle.notify_all();
+            });
+            if (!queued)
+            {
+                std::lock_guard<std::mutex> lock(conversation->mutex);
+                --conversation->outstanding;
+                throw std::runtime_error("Server is shutting down");
+            }
+        }
+        catch (const std::exception& ex)
+        {
+            conversation->send(error_json(id, ex.what()));
+        }
+    }
+    conversation->wait_idle();
+    return shutdown_requested;
+}
+
+namespace
+{
+sockaddr_un socket_address(const std::string& path)
+{
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(addr.sun_path))
+        throw std::runtime_error("Socket path must be 1 to " + std::to_string(sizeof(addr.sun_path) - 1) + " bytes: " + path);
+    std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+    return addr;
+}
+
+struct FdCloser
+{
+    int fd;
+    ~FdCloser()
+    {
+        if (fd >= 0) ::close(fd);
+    }
+};
+} // namespace
+
+void serve_unix_socket(JobServer& server, const std::string& path)
+{
+    const sockaddr_un addr = socket_address(path);
+    std::error_code ec;
+    const fs::file_status status = fs::symlink_status(path, ec);
+    if (fs::exists(status))
+    {
+        // A leftover from a server that did not exit cleanly; anything else is not ours to delete.
+        if (status.type() != fs::file_type::socket) throw std::runtime_error("Not a socket, refusing to replace: " + path);
+        fs::remove(path);
+    }
+
+    FdCloser listener{ ::socket(AF_UNIX, SOCK_STREAM, 0) };
+    if (listener.fd < 0) throw std::runtime_error(std::string("socket() failed: ") + std::strerror(errno));
+    if (::bind(listener.fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) != 0 || ::listen(listener.fd, 64) != 0)
+        throw std::runtime_error("Cannot listen on " + path + ": " + std::strerror(errno));
+
+    struct Connection
+    {
+        int fd;
+        std::thread thread;
+        std::shared_ptr<std::atomic<bool>> finished;
+    };
+    std::vector<Connection> connections;
+    std::atomic<bool> stop{ false };
+
+    auto reap = [&](bool all) {
+        for (auto it = connections.begin(); it != connections.end();)
+        {
+            if (!all && !*it->finished)
+            {
+                ++it;
+                continue;
+            }
+            it->thread.join();
+            ::close(it->fd);
+            it = connections.erase(it);
+        }
+    };
+
+    // Idle clients see end of input; running jobs still deliver their results.
+    auto close_all = [&] {
+        for (const Connection& c : connections)
+        {
+            ::shutdown(c.fd, SHUT_RD);
+        }
+        reap(true);
+    };
+
+    try
+    {
+        while (!stop)
+        {
+            // Polled with a timeout so a shutdown request from any connection ends the loop promptly.
+            pollfd pfd{ listener.fd, POLLIN, 0 };
+            const int ready = ::poll(&pfd, 1, 200);
+            const int poll_errno = errno;
+            reap(false);
+            if (ready < 0 && poll_errno != EINTR) throw std::runtime_error(std::string("poll() failed: ") + std::strerror(poll_errno));
+            if (ready <= 0) continue;
+            const int fd = ::accept(listener.fd, nullptr, nullptr);
+            if (fd < 0) continue;
+            auto finished = std::make_shared<std::atomic<bool>>(false);
+            std::thread thread([&server, &stop, fd, finished] {
+                try
+                {
+                    if (serve_json_lines(server, fd, fd)) stop = true;
+                }
+                catch (const std::exception&)
+                {
+                    // I/O on this connection failed; the others carry on.
+                }
+                // The client reads until end of input, so signal it now rather than when reap()
+                // closes the descriptor on a later poll tick.
+                ::shutdown(fd, SHUT_RDWR);
+                *finished = true;
+            });
+            connections.push_back({ fd, std::move(thread), std::move(finished) });
+        }
+    }
+    catch (...)
+    {
+        close_all();
+        fs::remove(path, ec);
+        throw;
+    }
+
+    close_all();
+    fs::remove(path, ec);
+}
+
+size_t submit_job_lines(const std::string& path, std::istream& requests, std::ostream& responses)
+{
+    const sockaddr_un addr = socket_address(path);
+    FdCloser fd{ ::socket(AF_UNIX, SOCK_STREAM, 0) };
+    if (fd.fd < 0) throw std::runtime_error(std::string("socket() failed: ") + std::strerror(errno));
+    if (::connect(fd.fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) != 0)
+        throw std::runtime_error("Cannot connect to job server at " + path + ": " + std::strerror(errno));
+
+    // Requests go out on their own thread while responses are read here, so a server pushing back
+    // on a long request list cannot deadlock against unread responses.
+    bool sent_all = true;
+    std::thread sender([&] {
+        std::string line;
+        while (std::getline(requests, line))
+        {
+            if (line.find_first_not_of(" \t\r") == std::string::npos) continue;
+            if (!write_all(fd.fd, line + "\n"))
+            {
+                sent_all = false;
+                break;
+            }
+        }
+        ::shutdown(fd.fd, SHUT_WR); // end of input: the server answers the rest, then closes
+    });
+
+    size_t failed = 0;
+    LineReader reader(fd.fd);
+    std::string line;
+    while (reader.next(line))
+    {
+        responses << line << "\n" << std::flush;
+        try
+        {
+            const JsonValue response = parse_json(line);
+            const JsonValue* ok = response.find("ok");
+            if (ok && !ok->as_bool()) ++failed;
+        }
+        catch (const std::exception&)
+        {
+            ++failed;
+        }
+    }
+    sender.join();
+    if (!sent_all) throw std::runtime_error("Job server closed the connection early");
+    return failed;
+}
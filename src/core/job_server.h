@@ -0,0 +1,126 @@
+// src/core/job_server.h
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "backend.h"
+#include "filter_chain.h"
+#include "image.h"
+#include "resize.h"
+#include "result_cache.h"
+
+// Long-running job server: one process keeps its decode, filter and encode workers, buffer pools and
+// the CUDA context alive across jobs, so a stream of small images does not pay process start-up and
+// CUDA initialization per image. Jobs (input path, output path, chain) run through the same three
+// stages as batch mode (batch.h), each job with its own chain, and report per-stage latencies.
+struct ServerJob
+{
+    std::string id; // echoed in the result
+    std::string input;
+    std::string output; // format by extension, as save_image()
+    ResizeSpec resize;  // optional, applied before the chain (resize.h)
+    FilterChain chain;  // may be empty when the job only resizes
+};
+
+struct JobResult
+{
+    std::string id;
+    bool ok = false;
+    std::string error; // when !ok
+    Backend backend = Backend::Cpu;
+    int width = 0; // of the output
+    int height = 0;
+    double queue_ms = 0.0;  // from submit() until a decoder picked the job up
+    double decode_ms = 0.0;
+    double filter_ms = 0.0;
+    double encode_ms = 0.0;
+    double total_ms = 0.0;  // submit() to result, including the waits between stages
+};
+
+struct JobServerOptions
+{
+    PngOptions png;
+    Backend backend = Backend::Auto; // run_pipeline() routing for each job
+    int decode_workers = 0;          // <= 0: half the hardware threads
+    int filter_workers = 0;          // <= 0: 1 if CUDA may be used, otherwise the hardware threads
+    int encode_workers = 0;          // <= 0: half the hardware threads
+    // Jobs admitted but not yet decoding. Beyond that submit() blocks, which stalls the reading side
+    // of a connection and, through the socket buffers, the client: that is the backpressure.
+    size_t queue_depth = 16;
+    ResultCache* cache = nullptr;    // optional: filter through ResultCache::run() (result_cache.h)
+};
+
+struct JobServerStats
+{
+    size_t completed = 0; // ok
+    size_t failed = 0;
+    size_t in_flight = 0; // submitted, no result yet
+    double mean_total_ms = 0.0;
+    double max_total_ms = 0.0;
+};
+
+class JobServer
+{
+public:
+    using Callback = std::function<void(const JobResult&)>;
+
+    // Starts the workers and warms the backend up: CUDA is probed and, when it may be used, a small
+    // frame is filtered on it, so the first job does not pay for the context and kernel loading.
+    explicit JobServer(const JobServerOptions& options);
+    ~JobServer(); // shutdown()
+
+    JobServer(const JobServer&) = delete;
+    JobServer& operator=(const JobServer&) = delete;
+
+    // Queues a job; `done` is called exactly once, on a worker thread, with its result (failures
+    // included). Blocks while queue_depth jobs are waiting. Returns false, without calling `done`,
+    // once the server is shutting down.
+    bool submit(ServerJob job, Callback done);
+    // Stops admitting jobs, finishes the admitted ones and joins the workers. Idempotent.
+    void shutdown();
+
+    JobServerStats stats() const;
+    const JobServerOptions& options() const { return options_; }
+
+private:
+    struct Pipeline;
+
+    JobServerOptions options_;
+    std::unique_ptr<Pipeline> pipeline_;
+    std::vector<std::thread> threads_;
+    std::atomic<bool> stopped_{ false };
+};
+
+// JSON-lines protocol, one object per line in each direction. Requests:
+//   {"id": "7", "input": "in.png", "output": "out.png", "chain": "levels:16:235,sharpen"}
+//   {"id": "8", "input": "big.jpg", "output": "thumb.png", "chain": "thumbnail:256,sharpen"}
+//   {"op": "stats"}      server totals (JobServerStats)
+//   {"op": "shutdown"}   end this conversation; on a socket, stop the server once its jobs are done
+// "id" is optional (default: the request's line number). A chain may start with a thumbnail or
+// resize step (take_resize_step() in resize.h). Each job gets one response when it
+// finishes, so responses come in completion order:
+//   {"id": "7", "ok": true, "backend": "cuda", "width": 640, "height": 480, "queue_ms": 0.02,
+//    "decode_ms": 1.9, "filter_ms": 0.4, "encode_ms": 3.1, "total_ms": 5.5}
+//   {"id": "8", "ok": false, "error": "Failed to load image: missing.png"}
+
+// Serves one conversation: reads requests from in_fd until end of input or a shutdown request,
+// writes responses to out_fd as jobs finish, and returns once every job it submitted has answered.
+// Returns true when the conversation ended with a shutdown request.
+bool serve_json_lines(JobServer& server, int in_fd, int out_fd);
+
+// Listens on a Unix domain socket (a stale socket file at `path` is replaced) and serves each
+// connection with serve_json_lines() on a thread of its own, until a client sends a shutdown
+// request. Removes the socket file on return. Throws std::runtime_error when it cannot listen.
+void serve_unix_socket(JobServer& server, const std::string& path);
+
+// Client side: connects to the server at `path`, sends every non-blank line of `requests` and
+// copies each response line to `responses` as it arrives, returning after the last one. Returns the
+// number of responses with "ok": false. Throws std::runtime_error when the server is unreachable.
+size_t submit_job_lines(const std::string& path, std::istream& requests, std::ostream& responses);
@@ -0,0 +1,412 @@
+// src/core/json.cpp
+#include "json.h"
+
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+
+namespace
+{
+const char* type_name(JsonValue::Type type)
+{
+    switch (type)
+    {
+    case JsonValue::Type::Null: return "null";
+    case JsonValue::Type::Bool: return "bool";
+    case JsonValue::Type::Number: return "number";
+    case JsonValue::Type::String: return "string";
+    case JsonValue::Type::Array: return "array";
+    case JsonValue::Type::Object: return "object";
+    }
+    return "unknown";
+}
+
+[[noreturn]] void type_error(JsonValue::Type expected, JsonValue::Type actual)
+{
+    throw std::runtime_error(std::string("JSON value is a ") + type_name(actual) + ", expected a " +
+                             type_name(expected));
+}
+
+void append_utf8(std::string& out, uint32_t cp)
+{
+    if (cp < 0x80)
+    {
+        out += static_cast<char>(cp);
+    }
+    else if (cp < 0x800)
+    {
+        out += static_cast<char>(0xc0 | cp >> 6);
+        out += static_cast<char>(0x80 | (cp & 0x3f));
+    }
+    else if (cp < 0x10000)
+    {
+        out += static_cast<char>(0xe0 | cp >> 12);
+        out += static_cast<char>(0x80 | (cp >> 6 & 0x3f));
+        out += static_cast<char>(0x80 | (cp & 0x3f));
+    }
+    else
+    {
+        out += static_cast<char>(0xf0 | cp >> 18);
+        out += static_cast<char>(0x80 | (cp >> 12 & 0x3f));
+        out += static_cast<char>(0x80 | (cp >> 6 & 0x3f));
+        out += static_cast<char>(0x80 | (cp & 0x3f));
+    }
+}
+
+void dump_string(std::string& out, const std::string& s)
+{
+    static const char kHex[] = "0123456789abcdef";
+    out += '"';
+    for (const char ch : s)
+    {
+        const auto c = static_cast<unsigned char>(ch);
+        switch (c)
+        {
+        case '"': out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        case '\t': out += "\\t"; break;
+        case '\b': out += "\\b"; break;
+        case '\f': out += "\\f"; break;
+        default:
+            if (c < 0x20)
+            {
+                out += "\\u00";
+                out += kHex[c >> 4];
+                out += kHex[c & 15];
+            }
+            else
+            {
+                out += ch;
+            }
+        }
+    }
+    out += '"';
+}
+
+void newline(std::string& out, int indent, int depth)
+{
+    if (indent < 0) return;
+    out += '\n';
+    out.append(static_cast<size_t>(indent) * depth, ' ');
+}
+
+class Parser
+{
+public:
+    explicit Parser(const std::string& text) : text_(text) {}
+
+    JsonValue parse_document()
+    {
+        JsonValue value = parse_value(0);
+        skip_space();
+        if (pos_ != text_.size()) fail("trailing characters");
+        return value;
+    }
+
+private:
+    static constexpr int kMaxDepth = 256;
+
+    [[noreturn]] void fail(const std::string& what) const
+    {
+        throw std::runtime_error("JSON parse error at offset " + std::to_string(pos_) + ": " + what);
+    }
+
+    void skip_space()
+    {
+        while (pos_ < text_.size() &&
+               (text_[pos_] == ' ' || text_[pos_] == '\t' || text_[pos_] == '\n' || text_[pos_] == '\r'))
+        {
+            ++pos_;
+        }
+    }
+
+    bool consume(char c)
+    {
+        skip_space();
+        if (pos_ < text_.size() && text_[pos_] == c)
+        {
+            ++pos_;
+            return true;
+        }
+        return false;
+    }
+
+    void expect(char c)
+    {
+        if (!consume(c)) fail(std::string("expected '") + c + "'");
+    }
+
+    bool consume_word(const char* word)
+    {
+        const std::string w(word);
+        if (text_.compare(pos_, w.size(), w) != 0) return false;
+        pos_ += w.size();
+        return true;
+    }
+
+    JsonValue parse_value(int depth)
+    {
+        if (depth > kMaxDepth) fail("nesting too deep");
+        skip_space();
+        if (pos_ >= text_.size()) fail("unexpected end of input");
+        const char c = text_[pos_];
+        if (c == '{') return parse_object(depth);
+        if (c == '[') return parse_array(depth);
+        if (c == '"') return JsonValue(parse_string());
+        if (consume_word("true")) return JsonValue(true);
+        if (consume_word("false")) return JsonValue(false);
+        if (consume_word("null")) return JsonValue();
+        return JsonValue(parse_number());
+    }
+
+    JsonValue parse_object(int depth)
+    {
+        ++pos_; // '{'
+        JsonValue object = JsonValue::object();
+        if (consume('}')) return object;
+        do
+        {
+            skip_space();
+            if (pos_ >= text_.size() || text_[pos_] != '"') fail("expected a key");
+            std::string key = parse_string();
+            expect(':');
+            object[key] = parse_value(depth + 1);
+        } while (consume(','));
+        expect('}');
+        return object;
+    }
+
+    JsonValue parse_array(int depth)
+    {
+        ++pos_; // '['
+        JsonValue array = JsonValue::array();
+        if (consume(']')) return array;
+        do
+        {
+            array.push_back(parse_value(depth + 1));
+        } while (consume(','));
+        expect(']');
+        return array;
+    }
+
+    uint32_t parse_hex4()
+    {
+        if (pos_ + 4 > text_.size()) fail("truncated \\u escape");
+        uint32_t value = 0;
+        const auto [end, ec] = std::from_chars(text_.data() + pos_, text_.data() + pos_ + 4, value, 16);
+        if (ec != std::errc() || end != text_.data() + pos_ + 4) fail("bad \\u escape");
+        pos_ += 4;
+        return value;
+    }
+
+    std::string parse_string()
+    {
+        ++pos_; // '"'
+        std::string out;
+        for (;;)
+        {
+            if (pos_ >= text_.size()) fail("unterminated string");
+            const char c = text_[pos_++];
+            if (c == '"') return out;
+            if (static_cast<unsigned char>(c) < 0x20) fail("control character in string");
+            if (c != '\\')
+            {
+                out += c;
+                continue;
+            }
+            if (pos_ >= text_.size()) fail("unterminated string");
+            const char e = text_[pos_++];
+            switch (e)
+            {
+            case '"': out += '"'; break;
+            case '\\': out += '\\'; break;
+            case '/': out += '/'; break;
+            case 'b': out += '\b'; break;
+            case 'f': out += '\f'; break;
+            case 'n': out += '\n'; break;
+            case 'r': out += '\r'; break;
+            case 't': out += '\t'; break;
+            case 'u':
+            {
+                uint32_t cp = parse_hex4();
+                if (cp >= 0xd800 && cp < 0xdc00 && text_.compare(pos_, 2, "\\u") == 0)
+                {
+                    pos_ += 2;
+                    const uint32_t low = parse_hex4();
+                    if (low < 0xdc00 || low >= 0xe000) fail("bad surrogate pair");
+                    cp = 0x10000 + ((cp - 0xd800) << 10) + (low - 0xdc00);
+                }
+                append_utf8(out, cp);
+                break;
+            }
+            default: fail("bad escape");
+            }
+        }
+    }
+
+    double parse_number()
+    {
+        const size_t start = pos_;
+        if (pos_ < text_.size() && text_[pos_] == '-') ++pos_;
+        while (pos_ < text_.size() && (std::isdigit(static_cast<unsigned char>(text_[pos_])) || text_[pos_] == '.' ||
+                                       text_[pos_] == 'e' || text_[pos_] == 'E' || text_[pos_] == '+' ||
+                                       text_[pos_] == '-'))
+        {
+            ++pos_;
+        }
+        double value = 0.0;
+        const auto [end, ec] = std::from_chars(text_.data() + start, text_.data() + pos_, value);
+        if (start == pos_ || ec != std::errc() || end != text_.data() + pos_)
+        {
+            pos_ = start;
+            fail("expected a value");
+        }
+        return value;
+    }
+
+    const std::string& text_;
+    size_t pos_ = 0;
+};
+} // namespace
+
+JsonValue JsonValue::array()
+{
+    JsonValue value;
+    value.type_ = Type::Array;
+    return value;
+}
+
+JsonValue JsonValue::object()
+{
+    JsonValue value;
+    value.type_ = Type::Object;
+    return value;
+}
+
+bool JsonValue::as_bool() const
+{
+    if (type_ != Type::Bool) type_error(Type::Bool, type_);
+    return bool_;
+}
+
+double JsonValue::as_number() const
+{
+    if (type_ != Type::Number) type_error(Type::Number, type_);
+    return number_;
+}
+
+const std::string& JsonValue::as_string() const
+{
+    if (type_ != Type::String) type_error(Type::String, type_);
+    return string_;
+}
+
+const std::vector<JsonValue>& JsonValue::elements() const
+{
+    if (type_ != Type::Array) type_error(Type::Array, type_);
+    return array_;
+}
+
+const std::vector<JsonValue::Member>& JsonValue::members() const
+{
+    if (type_ != Type::Object) type_error(Type::Object, type_);
+    return object_;
+}
+
+void JsonValue::push_back(JsonValue value)
+{
+    if (type_ == Type::Null) type_ = Type::Array;
+    if (type_ != Type::Array) type_error(Type::Array, type_);
+    array_.push_back(std::move(value));
+}
+
+const JsonValue* JsonValue::find(const std::string& key) const
+{
+    if (type_ != Type::Object) return nullptr;
+    for (const Member& member : object_)
+    {
+        if (member.first == key) return &member.second;
+    }
+    return nullptr;
+}
+
+const JsonValue& JsonValue::operator[](const std::string& key) const
+{
+    const JsonValue* value = find(key);
+    if (!value) throw std::runtime_error("JSON object has no key \"" + key + "\"");
+    return *value;
+}
+
+JsonValue& JsonValue::operator[](const std::string& key)
+{
+    if (type_ == Type::Null) type_ = Type::Object;
+    if (type_ != Type::Object) type_error(Type::Object, type_);
+    for (Member& member : object_)
+    {
+        if (member.first == key) return member.second;
+    }
+    object_.emplace_back(key, JsonValue());
+    return object_.back().second;
+}
+
+std::string JsonValue::dump(int indent) const
+{
+    std::string out;
+    dump_to(out, indent, 0);
+    return out;
+}
+
+void JsonValue::dump_to(std::string& out, int indent, int depth) const
+{
+    switch (type_)
+    {
+    case Type::Null: out += "null"; break;
+    case Type::Bool: out += bool_ ? "true" : "false"; break;
+    case Type::Number:
+    {
+        if (!std::isfinite(number_))
+        {
+            out += "null"; // JSON has no inf/nan
+            break;
+        }
+        char buf[32];
+        const auto [end, ec] = std::to_chars(buf, buf + sizeof(buf), number_); // shortest round-trip form
+        out.append(buf, ec == std::errc() ? end : buf);
+        break;
+    }
+    case Type::String: dump_string(out, string_); break;
+    case Type::Array:
+        out += '[';
+        for (size_t i = 0; i < array_.size(); ++i)
+        {
+            if (i > 0) out += ',';
+            newline(out, indent, depth + 1);
+            array_[i].dump_to(out, indent, depth + 1);
+        }
+        if (!array_.empty()) newline(out, indent, depth);
+        out += ']';
+        break;
+    case Type::Object:
+        out += '{';
+        for (size_t i = 0; i < object_.size(); ++i)
+        {
+            if (i > 0) out += ',';
+            newline(out, indent, depth + 1);
+            dump_string(out, object_[i].first);
+            out += indent < 0 ? ":" : ": ";
+            object_[i].second.dump_to(out, indent, depth + 1);
+        }
+        if (!object_.empty()) newline(out, indent, depth);
+        out += '}';
+        break;
+    }
+}
+
+JsonValue parse_json(const std::string& text)
+{
+    return Parser(text).parse_document();
+}
@@ -0,0 +1,81 @@
+// src/core/json.h
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Small JSON document model for the tools' machine-readable files (benchmark results and baselines).
+// Objects keep their keys in insertion order so written files diff cleanly.
+class JsonValue
+{
+public:
+    enum class Type
+    {
+        Null,
+        Bool,
+        Number,
+        String,
+        Array,
+        Object,
+    };
+    using Member = std::pair<std::string, JsonValue>;
+
+    JsonValue() = default;
+    JsonValue(std::nullptr_t) {}
+    JsonValue(bool value) : type_(Type::Bool), bool_(value) {}
+    template <typename T, std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, bool>, int> = 0>
+    JsonValue(T value) : type_(Type::Number), number_(static_cast<double>(value))
+    {
+    }
+    JsonValue(double value) : type_(Type::Number), number_(value) {}
+    JsonValue(const char* value) : type_(Type::String), string_(value) {}
+    JsonValue(std::string value) : type_(Type::String), string_(std::move(value)) {}
+
+    static JsonValue array();
+    static JsonValue object();
+
+    Type type() const { return type_; }
+    bool is_null() const { return type_ == Type::Null; }
+    bool is_number() const { return type_ == Type::Number; }
+    bool is_string() const { return type_ == Type::String; }
+    bool is_array() const { return type_ == Type::Array; }
+    bool is_object() const { return type_ == Type::Object; }
+
+    // Typed access; throws std::runtime_error when the value has another type.
+    bool as_bool() const;
+    double as_number() const;
+    const std::string& as_string() const;
+    const std::vector<JsonValue>& elements() const;
+    const std::vector<Member>& members() const;
+
+    // Arrays.
+    size_t size() const { return type_ == Type::Object ? object_.size() : array_.size(); }
+    const JsonValue& operator[](size_t index) const { return elements().at(index); }
+    void push_back(JsonValue value);
+
+    // Objects. The const lookup throws std::runtime_error for a missing key; the non-const one adds it
+    // (turning a null value into an object first).
+    bool contains(const std::string& key) const { return find(key) != nullptr; }
+    const JsonValue* find(const std::string& key) const;
+    const JsonValue& operator[](const std::string& key) const;
+    JsonValue& operator[](const std::string& key);
+
+    // Serializes the value; indent < 0 writes everything on one line.
+    std::string dump(int indent = -1) const;
+
+private:
+    void dump_to(std::string& out, int indent, int depth) const;
+
+    Type type_ = Type::Null;
+    bool bool_ = false;
+    double number_ = 0.0;
+    std::string string_;
+    std::vector<JsonValue> array_;
+    std::vector<Member> object_;
+};
+
+// Parses a complete JSON text. Throws std::runtime_error naming the byte offset of the problem.
+JsonValue parse_json(const std::string& text);
@@ -0,0 +1,33 @@
+// src/core/pipeline_stages.h
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+// Worker-stage helpers shared by the batch pipeline (batch.cpp) and the job server (job_server.cpp),
+// whose decode, filter and encode stages are groups of threads connected by BoundedQueues.
+
+// Default worker count of the decode and encode stages.
+inline int half_hardware_threads()
+{
+    const unsigned hw = std::thread::hardware_concurrency();
+    return std::max(1, static_cast<int>(hw / 2));
+}
+
+// Runs `count` threads of body(); when the last one returns, `done` is called (to close the next
+// stage's queue so its workers drain and exit).
+template <typename Body, typename Done>
+void start_stage(std::vector<std::thread>& threads, int count, Body body, Done done)
+{
+    auto remaining = std::make_shared<std::atomic<int>>(count);
+    for (int i = 0; i < count; ++i)
+    {
+        threads.emplace_back([=] {
+            body();
+            if (remaining->fetch_sub(1) == 1) done();
+        });
+    }
+}
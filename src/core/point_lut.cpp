@@ -0,0 +1,166 @@
+// src/core/point_lut.cpp
+#include "point_lut.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace
+{
+// Same rounding as the filters' clamp_byte(): clamp, add 0.5, truncate.
+inline uint8_t clamp_byte(float v)
+{
+    v = std::clamp(v, 0.0f, 255.0f);
+    return static_cast<uint8_t>(v + 0.5f);
+}
+
+template <typename F>
+PointLut make_lut(F f)
+{
+    PointLut lut;
+    for (int i = 0; i < 256; ++i)
+    {
+        lut.table[i] = f(static_cast<uint8_t>(i));
+    }
+    return lut;
+}
+} // namespace
+
+PointLut PointLut::identity()
+{
+    return make_lut([](uint8_t v) { return v; });
+}
+
+PointLut PointLut::then(const PointLut& next) const
+{
+    PointLut out;
+    for (int i = 0; i < 256; ++i)
+    {
+        out.table[i] = next.table[table[i]];
+    }
+    return out;
+}
+
+bool PointLut::is_identity() const
+{
+    for (int i = 0; i < 256; ++i)
+    {
+        if (table[i] != i) return false;
+    }
+    return true;
+}
+
+PointLut brightness_lut(float delta)
+{
+    delta = std::clamp(delta, -1.0f, 1.0f);
+    return make_lut([delta](uint8_t in) {
+        float v = static_cast<float>(in) / 255.0f;
+        v = std::clamp(v + delta, 0.0f, 1.0f);
+        return clamp_byte(v * 255.0f);
+    });
+}
+
+PointLut contrast_lut(float factor)
+{
+    factor = std::max(factor, 0.0f);
+    return make_lut([factor](uint8_t in) {
+        float v = static_cast<float>(in) / 255.0f;
+        v = (v - 0.5f) * factor + 0.5f;
+        v = std::clamp(v, 0.0f, 1.0f);
+        return clamp_byte(v * 255.0f);
+    });
+}
+
+PointLut gamma_lut(float gamma)
+{
+    const float inv = 1.0f / std::max(gamma, 1e-3f);
+    return make_lut([inv](uint8_t in) {
+        return clamp_byte(255.0f * std::pow(static_cast<float>(in) / 255.0f, inv));
+    });
+}
+
+PointLut invert_lut()
+{
+    return make_lut([](uint8_t in) { return static_cast<uint8_t>(255 - in); });
+}
+
+PointLut levels_lut(float in_black, float in_white, float out_black, float out_white)
+{
+    const float range = std::max(in_white - in_black, 1e-3f);
+    return make_lut([=](uint8_t in) {
+        float t = std::clamp((static_cast<float>(in) - in_black) / range, 0.0f, 1.0f);
+        return clamp_byte(out_black + (out_white - out_black) * t);
+    });
+}
+
+PointLut threshold_lut(float level)
+{
+    return make_lut([level](uint8_t in) { return static_cast<uint8_t>(static_cast<float>(in) >= level ? 255 : 0); });
+}
+
+PointLut point_lut_for(const FilterStep& step)
+{
+    const auto& p = step.params;
+    switch (step.kind)
+    {
+    case FilterKind::Brightness: return brightness_lut(p[0]);
+    case FilterKind::Contrast: return contrast_lut(p[0]);
+    case FilterKind::Gamma: return gamma_lut(p[0]);
+    case FilterKind::Invert: return invert_lut();
+    case FilterKind::Levels: return levels_lut(p[0], p[1], p[2], p[3]);
+    case FilterKind::Threshold: return threshold_lut(p[0]);
+    case FilterKind::Grayscale:
+    case FilterKind::BoxBlur:
+    case FilterKind::GaussianBlur:
+    case FilterKind::Sobel:
+    case FilterKind::Canny:
+    case FilterKind::Sharpen:
+    case FilterKind::Laplacian:
+    case FilterKind::Emboss:
+    case FilterKind::Gaussian5:
+    case FilterKind::AutoLevels:
+    case FilterKind::Equalize: break;
+    }
+    throw std::invalid_argument(std::string(filter_kind_name(step.kind)) + " is not a per-channel point op");
+}
+
+PointProgram compile_point_ops(const std::vector<FilterStep>& ops)
+{
+    PointProgram program;
+    bool open_lut = false; // last stage is a table that can absorb the next one
+    for (const FilterStep& op : ops)
+    {
+        if (op.kind == FilterKind::Grayscale)
+        {
+            program.stages.push_back({ true, {} });
+            open_lut = false;
+            continue;
+        }
+        const PointLut lut = point_lut_for(op);
+        if (open_lut)
+        {
+            program.stages.back().lut = program.stages.back().lut.then(lut);
+        }
+        else
+        {
+            program.stages.push_back({ false, lut });
+            open_lut = true;
+        }
+    }
+
+    program.stages.erase(std::remove_if(program.stages.begin(), program.stages.end(),
+                                        [](const PointProgram::Stage& s) { return !s.grayscale && s.lut.is_identity(); }),
+                         program.stages.end());
+    return program;
+}
+
+void prepend_point_lut(PointProgram& program, const PointLut& lut)
+{
+    if (lut.is_identity()) return;
+    if (!program.stages.empty() && !program.stages.front().grayscale)
+    {
+        program.stages.front().lut = lut.then(program.stages.front().lut);
+        return;
+    }
+    program.stages.insert(program.stages.begin(), { false, lut });
+}
@@ -0,0 +1,53 @@
+// src/core/point_lut.h
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "filter_chain.h"
+
+// A per-channel point op as a 256-entry byte table. Since every such op's output depends only on the
+// input byte, any run of them composes into a single table, so N chained ops cost one lookup.
+struct PointLut
+{
+    std::array<uint8_t, 256> table{};
+
+    static PointLut identity();
+
+    // Table equivalent to applying *this first and then `next`.
+    PointLut then(const PointLut& next) const;
+
+    bool is_identity() const;
+};
+
+// Tables for the individual ops. Brightness and contrast evaluate the exact float formula of the
+// original per-pixel filters for every input byte, so table lookups are bit-identical to them.
+PointLut brightness_lut(float delta);
+PointLut contrast_lut(float factor);
+PointLut gamma_lut(float gamma);
+PointLut invert_lut();
+PointLut levels_lut(float in_black, float in_white, float out_black = 0.0f, float out_white = 255.0f);
+PointLut threshold_lut(float level);
+
+// Table for any step with is_lut_op(step.kind); throws std::invalid_argument otherwise.
+PointLut point_lut_for(const FilterStep& step);
+
+// A fused point segment compiled for execution: composed tables separated by grayscale conversions
+// (the only point op that mixes channels and therefore cannot be folded into a table).
+struct PointProgram
+{
+    struct Stage
+    {
+        bool grayscale = false;
+        PointLut lut; // used when !grayscale
+    };
+    std::vector<Stage> stages;
+};
+
+// Compiles a run of point ops; adjacent table ops collapse into one stage, identities are dropped.
+PointProgram compile_point_ops(const std::vector<FilterStep>& ops);
+
+// Runs `lut` ahead of the program: merged into a leading table stage, or added as a new first stage.
+// This is how an autolevels / equalize table (histogram.h) rides along with the next point pass.
+void prepend_point_lut(PointProgram& program, const PointLut& lut);
@@ -0,0 +1,425 @@
+// src/core/resize.cpp
+#include "resize.h"
+
+#include "buffer_pool.h"
+#include "filters_cpu_simd.h"
+#include "thread_pool.h"
+#include "trace.h"
+#include "tuning.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+namespace
+{
+constexpr int kWeightBits = 14; // weights are fixed point with this many fraction bits, summing to 1.0
+constexpr int kWeightOne = 1 << kWeightBits;
+constexpr int kWeightRound = 1 << (kWeightBits - 1);
+constexpr double kPi = 3.14159265358979323846;
+
+const char* const kFilterNames[] = { "box", "bilinear", "bicubic", "lanczos3" };
+
+double filter_support(ResizeFilter filter)
+{
+    switch (filter)
+    {
+    case ResizeFilter::Box: return 0.5;
+    case ResizeFilter::Bilinear: return 1.0;
+    case ResizeFilter::Bicubic: return 2.0;
+    case ResizeFilter::Lanczos3: return 3.0;
+    }
+    return 1.0;
+}
+
+double sinc(double x)
+{
+    if (x == 0.0) return 1.0;
+    x *= kPi;
+    return std::sin(x) / x;
+}
+
+double filter_weight(ResizeFilter filter, double x)
+{
+    switch (filter)
+    {
+    case ResizeFilter::Box:
+        // Half-open, so a sample exactly between two pixels belongs to one of them only.
+        return x > -0.5 && x <= 0.5 ? 1.0 : 0.0;
+    case ResizeFilter::Bilinear:
+        x = std::abs(x);
+        return x < 1.0 ? 1.0 - x : 0.0;
+    case ResizeFilter::Bicubic:
+    {
+        constexpr double a = -0.5;
+        x = std::abs(x);
+        if (x < 1.0) return ((a + 2.0) * x - (a + 3.0)) * x * x + 1.0;
+        if (x < 2.0) return (((x - 5.0) * x + 8.0) * x - 4.0) * a;
+        return 0.0;
+    }
+    case ResizeFilter::Lanczos3:
+        return std::abs(x) < 3.0 ? sinc(x) * sinc(x / 3.0) : 0.0;
+    }
+    return 0.0;
+}
+
+// Weights for one axis. Output coordinate i reads the `taps` input samples starting at starts[i]
+// with weights[i * taps ...]; every window is shifted to lie inside the input (padding with zero
+// weights instead), so SIMD kernels can always load `taps` whole samples.
+struct ResampleTable
+{
+    int taps = 0;
+    std::vector<int> starts;
+    std::vector<int16_t> weights;
+};
+
+// `in_extent` is the input length in input samples; it differs from in_size after a pre-reduction,
+// whose last block may be partial, so the output keeps the geometry of the original frame.
+ResampleTable build_table(int in_size, double in_extent, int out_size, ResizeFilter filter)
+{
+    const double scale = in_extent / out_size;
+    // Shrinking widens the kernel by the scale, so it averages every input sample it covers.
+    const double filter_scale = std::max(scale, 1.0);
+    const double support = filter_support(filter) * filter_scale;
+
+    ResampleTable table;
+    table.taps = std::min(static_cast<int>(std::ceil(support)) * 2 + 1, in_size);
+    table.starts.resize(out_size);
+    table.weights.assign(static_cast<size_t>(out_size) * table.taps, 0);
+    std::vector<double> values(table.taps);
+    for (int i = 0; i < out_size; ++i)
+    {
+        const double center = (i + 0.5) * scale;
+        const int first = std::max(static_cast<int>(center - support + 0.5), 0);
+        const int last = std::min(static_cast<int>(center + support + 0.5), in_size);
+        const int count = std::min(last - first, table.taps);
+        double total = 0.0;
+        for (int k = 0; k < count; ++k)
+        {
+            values[k] = filter_weight(filter, (first + k - center + 0.5) / filter_scale);
+            total += values[k];
+        }
+
+        const int start = std::min(first, in_size - table.taps);
+        table.starts[i] = start;
+        int16_t* weights = &table.weights[static_cast<size_t>(i) * table.taps + (first - start)];
+        if (count <= 0 || total == 0.0)
+        {
+            // Nothing under the kernel (a sample between box cells): take the nearest pixel.
+            const int nearest = std::clamp(static_cast<int>(center), start, start + table.taps - 1);
+            table.weights[static_cast<size_t>(i) * table.taps + (nearest - start)] = kWeightOne;
+            continue;
+        }
+        // Rounded weights may miss 1.0 by a few units; the largest one absorbs the difference, so a
+        // flat area stays exactly flat.
+        int sum = 0;
+        int largest = 0;
+        for (int k = 0; k < count; ++k)
+        {
+            weights[k] = static_cast<int16_t>(std::lround(values[k] / total * kWeightOne));
+            sum += weights[k];
+            if (weights[k] > weights[largest]) largest = k;
+        }
+        weights[largest] = static_cast<int16_t>(weights[largest] + kWeightOne - sum);
+    }
+    return table;
+}
+
+inline uint8_t clamp_fixed(int acc)
+{
+    return static_cast<uint8_t>(std::clamp(acc >> kWeightBits, 0, 255));
+}
+
+template <int C>
+void resample_pixels_scalar(const uint8_t* row, const ResampleTable& table, uint8_t* out, int x0, int x1)
+{
+    const int taps = table.taps;
+    for (int x = x0; x < x1; ++x)
+    {
+        const uint8_t* p = row + static_cast<size_t>(table.starts[x]) * C;
+        const int16_t* w = &table.weights[static_cast<size_t>(x) * taps];
+        int acc[C];
+        for (int c = 0; c < C; ++c) acc[c] = kWeightRound;
+        for (int k = 0; k < taps; ++k)
+        {
+            for (int c = 0; c < C; ++c) acc[c] += w[k] * p[k * C + c];
+        }
+        for (int c = 0; c < C; ++c) out[x * C + c] = clamp_fixed(acc[c]);
+    }
+}
+
+// One output row of the horizontal pass.
+void resample_row(const uint8_t* row, int in_width, int channels, const ResampleTable& table, uint8_t* out,
+                  int out_width, const CpuRowKernels* simd)
+{
+    int x = 0;
+    if (simd && channels != 1)
+    {
+        x = static_cast<int>(simd->resample_pixels(row, in_width, table.starts.data(), table.weights.data(),
+                                                   table.taps, channels, out, out_width));
+    }
+    switch (channels)
+    {
+    case 1: resample_pixels_scalar<1>(row, table, out, x, out_width); break;
+    case 3: resample_pixels_scalar<3>(row, table, out, x, out_width); break;
+    default: resample_pixels_scalar<4>(row, table, out, x, out_width); break;
+    }
+}
+
+void horizontal_pass(const ConstImageView& src, const ImageView& dst, const ResampleTable& table,
+                     const CpuRowKernels* simd)
+{
+    TraceSpan span("resize rows", "filter");
+    parallel_for_rows(dst.height, dst.row_bytes() * table.taps, [&](int y0, int y1) {
+        for (int y = y0; y < y1; ++y)
+        {
+            resample_row(src.row(y), src.width, src.channels, table, dst.row(y), dst.width, simd);
+        }
+    });
+}
+
+void vertical_pass(const ConstImageView& src, const ImageView& dst, const ResampleTable& table,
+                   const CpuRowKernels* simd)
+{
+    TraceSpan span("resize columns", "filter");
+    const size_t bytes = dst.row_bytes();
+    parallel_for_rows(dst.height, bytes * table.taps, [&](int y0, int y1) {
+        std::vector<const uint8_t*> rows(table.taps);
+        for (int y = y0; y < y1; ++y)
+        {
+            const int16_t* w = &table.weights[static_cast<size_t>(y) * table.taps];
+            for (int k = 0; k < table.taps; ++k) rows[k] = src.row(table.starts[y] + k);
+            uint8_t* out = dst.row(y);
+            size_t i = simd ? simd->resample_rows(rows.data(), w, table.taps, out, bytes) : 0;
+            for (; i < bytes; ++i)
+            {
+                int acc = kWeightRound;
+                for (int k = 0; k < table.taps; ++k) acc += w[k] * rows[k][i];
+                out[i] = clamp_fixed(acc);
+            }
+        }
+    });
+}
+
+// Uninitialized intermediate frame of the two-pass resize, from the host pool.
+ImageView scratch_view(ScratchBuffer& buffer, int width, int height, int channels)
+{
+    const size_t row = static_cast<size_t>(width) * channels;
+    const size_t stride = (row + kRowAlignment - 1) / kRowAlignment * kRowAlignment;
+    buffer = host_buffer_pool().scratch(stride * height);
+    return ImageView(buffer.data(), width, height, stride, channels);
+}
+
+// Resamples `in` into `dst` with one table per axis; an axis whose size does not change is skipped
+// (its table is the identity then). With both axes changing, runs the cheaper pass order.
+void resample(const ConstImageView& in, const ImageView& dst, const ResampleTable& columns, const ResampleTable& rows,
+              const CpuRowKernels* simd)
+{
+    if (in.width == dst.width && in.height == dst.height)
+    {
+        convert_pixels(in, dst);
+        return;
+    }
+    if (in.height == dst.height)
+    {
+        horizontal_pass(in, dst, columns, simd);
+        return;
+    }
+    if (in.width == dst.width)
+    {
+        vertical_pass(in, dst, rows, simd);
+        return;
+    }
+
+    // A horizontal tap costs about kHorizontalCost vertical ones: the horizontal kernels take one pixel
+    // per vector step, the vertical ones a full vector of bytes.
+    constexpr double kHorizontalCost = 4.0;
+    const double in_width = in.width;
+    const double in_height = in.height;
+    const double out_width = dst.width;
+    const double out_height = dst.height;
+    const double columns_first = (in_height * columns.taps * kHorizontalCost + out_height * rows.taps) * out_width;
+    const double rows_first = (in_width * rows.taps + out_width * columns.taps * kHorizontalCost) * out_height;
+    ScratchBuffer buffer;
+    if (columns_first <= rows_first)
+    {
+        const ImageView mid = scratch_view(buffer, dst.width, in.height, in.channels);
+        horizontal_pass(in, mid, columns, simd);
+        vertical_pass(mid, dst, rows, simd);
+    }
+    else
+    {
+        const ImageView mid = scratch_view(buffer, in.width, dst.height, in.channels);
+        vertical_pass(in, mid, rows, simd);
+        horizontal_pass(mid, dst, columns, simd);
+    }
+}
+
+// Averages fx x fy blocks, partial ones at the right and bottom edges over the pixels they have:
+// a box resample by exactly the integer factors, so it runs on the same SIMD passes.
+Image box_reduce(const ConstImageView& src, int fx, int fy, const CpuRowKernels* simd)
+{
+    TraceSpan span("resize prereduce", "filter");
+    const int width = (src.width + fx - 1) / fx;
+    const int height = (src.height + fy - 1) / fy;
+    Image reduced = allocate_image(width, height, src.channels);
+    resample(src, reduced, build_table(src.width, static_cast<double>(width) * fx, width, ResizeFilter::Box),
+             build_table(src.height, static_cast<double>(height) * fy, height, ResizeFilter::Box), simd);
+    return reduced;
+}
+
+int parse_positive(const std::string& text, const std::string& what)
+{
+    int value = 0;
+    char tail = 0;
+    if (std::sscanf(text.c_str(), "%d%c", &value, &tail) != 1 || value <= 0)
+        throw std::invalid_argument("Bad " + what + ": " + text);
+    return value;
+}
+} // namespace
+
+const char* resize_filter_name(ResizeFilter filter)
+{
+    return kFilterNames[static_cast<int>(filter)];
+}
+
+ResizeFilter parse_resize_filter(const std::string& name)
+{
+    if (name == "box" || name == "area") return ResizeFilter::Box;
+    if (name == "bilinear" || name == "linear") return ResizeFilter::Bilinear;
+    if (name == "bicubic" || name == "cubic") return ResizeFilter::Bicubic;
+    if (name == "lanczos3" || name == "lanczos") return ResizeFilter::Lanczos3;
+    throw std::invalid_argument("Unknown resize filter: " + name + " (box, bilinear, bicubic or lanczos3)");
+}
+
+void ResizeSpec::target(int in_width, int in_height, int& out_width, int& out_height) const
+{
+    if (width > 0 && height > 0)
+    {
+        out_width = width;
+        out_height = height;
+        return;
+    }
+    out_width = in_width;
+    out_height = in_height;
+    const int longest = std::max(in_width, in_height);
+    if (max_dim <= 0 || longest <= max_dim) return;
+    const double scale = static_cast<double>(max_dim) / longest;
+    out_width = in_width == longest ? max_dim : std::max(1, static_cast<int>(std::lround(in_width * scale)));
+    out_height = in_height == longest ? max_dim : std::max(1, static_cast<int>(std::lround(in_height * scale)));
+}
+
+ResizeSpec parse_resize_spec(const std::string& spec)
+{
+    std::vector<std::string> parts;
+    std::stringstream ss(spec);
+    std::string part;
+    while (std::getline(ss, part, ':')) parts.push_back(part);
+    if (parts.size() < 2 || parts.size() > 3)
+    {
+        throw std::invalid_argument("Bad resize step (thumbnail:<max_dim>[:filter] or resize:<W>x<H>[:filter]): " +
+                                    spec);
+    }
+
+    ResizeSpec resize;
+    if (parts[0] == "thumbnail")
+    {
+        resize.max_dim = parse_positive(parts[1], "thumbnail size");
+    }
+    else if (parts[0] == "resize")
+    {
+        const size_t x = parts[1].find('x');
+        if (x == std::string::npos) throw std::invalid_argument("Bad resize size (expected <W>x<H>): " + parts[1]);
+        resize.width = parse_positive(parts[1].substr(0, x), "resize width");
+        resize.height = parse_positive(parts[1].substr(x + 1), "resize height");
+    }
+    else
+    {
+        throw std::invalid_argument("Not a resize step: " + spec);
+    }
+    if (parts.size() == 3) resize.filter = parse_resize_filter(parts[2]);
+    return resize;
+}
+
+std::string format_resize_spec(const ResizeSpec& spec)
+{
+    if (!spec.active()) return {};
+    std::string text = spec.width > 0 && spec.height > 0
+                           ? "resize:" + std::to_string(spec.width) + "x" + std::to_string(spec.height)
+                           : "thumbnail:" + std::to_string(spec.max_dim);
+    return text + ":" + resize_filter_name(spec.filter);
+}
+
+ResizeSpec take_resize_step(std::string& chain_spec)
+{
+    const size_t comma = chain_spec.find(',');
+    const std::string first = chain_spec.substr(0, comma);
+    const std::string name = first.substr(0, first.find(':'));
+    if (name != "thumbnail" && name != "resize") return {};
+    const ResizeSpec spec = parse_resize_spec(first);
+    chain_spec = comma == std::string::npos ? std::string() : chain_spec.substr(comma + 1);
+    return spec;
+}
+
+Image resize_image(const ConstImageView& src, int width, int height, ResizeFilter filter, bool prereduce)
+{
+    if (src.width <= 0 || src.height <= 0 || width <= 0 || height <= 0)
+        throw std::invalid_argument("resize needs a non-empty source and target size");
+    if (src.channels != 1 && src.channels != 3 && src.channels != 4)
+        throw std::invalid_argument("resize supports 1, 3 or 4 channels");
+
+    TraceSpan span("resize", "filter");
+    if (span.active())
+    {
+        span.set_detail(std::to_string(src.width) + "x" + std::to_string(src.height) + " to " + std::to_string(width) +
+                        "x" + std::to_string(height) + ", " + resize_filter_name(filter));
+    }
+
+    // Large shrinks: average whole blocks first, leaving at least a 2x shrink for the kernel so it
+    // still antialiases. A 6000 px side going to 256 then needs 15 Lanczos taps per sample, not 143.
+    // Box is already an area average, and gains nothing from this.
+    const CpuRowKernels* simd = cpu_row_kernels(tuned_simd_level());
+    Image reduced;
+    ConstImageView in = src;
+    double in_width = src.width;
+    double in_height = src.height;
+    if (prereduce && filter != ResizeFilter::Box)
+    {
+        const int fx = std::max(src.width / (2 * width), 1);
+        const int fy = std::max(src.height / (2 * height), 1);
+        if (fx > 1 || fy > 1)
+        {
+            reduced = box_reduce(src, fx, fy, simd);
+            in = reduced;
+            in_width /= fx;
+            in_height /= fy;
+        }
+    }
+
+    Image out = allocate_image(width, height, src.channels);
+    resample(in, out, build_table(in.width, in_width, width, filter), build_table(in.height, in_height, height, filter),
+             simd);
+    return out;
+}
+
+Image resize_image(const ConstImageView& src, const ResizeSpec& spec)
+{
+    int width = 0;
+    int height = 0;
+    spec.target(src.width, src.height, width, height);
+    return resize_image(src, width, height, spec.filter, spec.prereduce);
+}
+
+void apply_resize(Image& img, const ResizeSpec& spec)
+{
+    if (!spec.active()) return;
+    int width = 0;
+    int height = 0;
+    spec.target(img.width, img.height, width, height);
+    if (width == img.width && height == img.height) return;
+    img = resize_image(img, width, height, spec.filter, spec.prereduce);
+}
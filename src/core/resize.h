@@ -0,0 +1,61 @@
+// src/core/resize.h
+#pragma once
+
+#include <string>
+
+#include "image.h"
+
+// Resampling to a new frame size. Unlike the chain filters (filter_chain.h), which work in place,
+// a resize produces a new image, so it runs before a chain rather than as one of its steps.
+// Both axes are resampled separately (a horizontal and a vertical pass, in whichever order touches
+// fewer samples) with weight tables built once per call in 14-bit fixed point; kernels widen with
+// the scale when shrinking, so downscales are antialiased. CPU only, on the shared pool, with the
+// SIMD row kernels of filters_cpu_simd.h.
+enum class ResizeFilter
+{
+    Box,      // area average when shrinking, nearest neighbour when enlarging
+    Bilinear, // triangle, support 1
+    Bicubic,  // Keys cubic, a = -0.5, support 2
+    Lanczos3  // windowed sinc, support 3
+};
+
+const char* resize_filter_name(ResizeFilter filter); // "box", "bilinear", "bicubic", "lanczos3"
+// Accepts the names above, plus "area", "linear", "cubic" and "lanczos". Throws std::invalid_argument.
+ResizeFilter parse_resize_filter(const std::string& name);
+
+// A target size: either an exact width x height, or a thumbnail bound that fits the frame into
+// max_dim x max_dim, keeping its aspect ratio and never enlarging it.
+struct ResizeSpec
+{
+    int width = 0;
+    int height = 0;
+    int max_dim = 0; // thumbnail bound; used when width and height are 0
+    ResizeFilter filter = ResizeFilter::Lanczos3;
+    // Shrinks by 4x or more first average whole blocks of pixels down to 2-3x the target size, so the
+    // resampling kernels stay a few taps wide however large the input is. Ignored by Box.
+    bool prereduce = true;
+
+    bool active() const { return max_dim > 0 || (width > 0 && height > 0); }
+    // Output size for a width x height input (at least 1x1).
+    void target(int in_width, int in_height, int& out_width, int& out_height) const;
+};
+
+// Parses "thumbnail:<max_dim>[:<filter>]" or "resize:<width>x<height>[:<filter>]". Throws
+// std::invalid_argument.
+ResizeSpec parse_resize_spec(const std::string& spec);
+// Inverse of parse_resize_spec(); "" for an inactive spec.
+std::string format_resize_spec(const ResizeSpec& spec);
+// Splits a leading thumbnail or resize step off a chain spec ("thumbnail:256,sharpen" leaves
+// "sharpen" in `chain_spec`). Returns an inactive spec, leaving `chain_spec` alone, when the chain
+// does not start with one.
+ResizeSpec take_resize_step(std::string& chain_spec);
+
+// Resamples src to width x height with the given kernel. The result has src's channel count and
+// allocate_image() rows. Throws std::invalid_argument for an empty source or target.
+Image resize_image(const ConstImageView& src, int width, int height, ResizeFilter filter = ResizeFilter::Lanczos3,
+                   bool prereduce = true);
+Image resize_image(const ConstImageView& src, const ResizeSpec& spec);
+
+// Replaces img with its resized copy; does nothing for an inactive spec or when the size would
+// not change.
+void apply_resize(Image& img, const ResizeSpec& spec);
@@ -0,0 +1,348 @@
+// src/core/result_cache.cpp
+#include "result_cache.h"
+
+#include "codecs.h"
+#include "thread_pool.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+namespace
+{
+constexpr uint64_t kPrime1 = 0x9e3779b185ebca87ULL;
+constexpr uint64_t kPrime2 = 0xc2b2ae3d27d4eb4fULL;
+constexpr int kHashBandRows = 64;
+constexpr char kRawMagic[4] = { 'C', 'P', 'X', 'R' };
+
+inline uint64_t rotl(uint64_t x, int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+inline uint64_t load64(const uint8_t* p)
+{
+    uint64_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+// Final avalanche (MurmurHash3's fmix64).
+inline uint64_t fmix(uint64_t h)
+{
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+inline uint64_t combine(uint64_t a, uint64_t b)
+{
+    return fmix(a ^ (b + kPrime1 + (a << 6) + (a >> 2)));
+}
+
+// xxHash64-style: four independent lanes over 32-byte blocks keep the multipliers busy, so hashing
+// runs at several bytes per cycle.
+struct Hasher
+{
+    uint64_t lanes[4];
+    uint8_t tail[32];
+    size_t tail_bytes = 0;
+    uint64_t total = 0;
+
+    explicit Hasher(uint64_t seed) : lanes{ seed + kPrime1 + kPrime2, seed + kPrime2, seed, seed - kPrime1 } {}
+
+    void block(const uint8_t* p)
+    {
+        for (int i = 0; i < 4; ++i)
+        {
+            lanes[i] = rotl(lanes[i] + load64(p + 8 * i) * kPrime2, 31) * kPrime1;
+        }
+    }
+
+    void update(const uint8_t* p, size_t n)
+    {
+        total += n;
+        if (tail_bytes > 0)
+        {
+            const size_t take = std::min(n, sizeof(tail) - tail_bytes);
+            std::memcpy(tail + tail_bytes, p, take);
+            tail_bytes += take;
+            p += take;
+            n -= take;
+            if (tail_bytes < sizeof(tail)) return;
+            block(tail);
+            tail_bytes = 0;
+        }
+        for (; n >= 32; p += 32, n -= 32) block(p);
+        std::memcpy(tail, p, n);
+        tail_bytes = n;
+    }
+
+    uint64_t finish() const
+    {
+        uint64_t h = rotl(lanes[0], 1) + rotl(lanes[1], 7) + rotl(lanes[2], 12) + rotl(lanes[3], 18);
+        h ^= total;
+        for (size_t i = 0; i < tail_bytes; ++i) h = rotl(h ^ (tail[i] * kPrime1), 11) * kPrime2;
+        return fmix(h);
+    }
+};
+
+std::shared_ptr<const Image> read_blob(const std::string& path)
+{
+    std::unique_ptr<FILE, int (*)(FILE*)> file(std::fopen(path.c_str(), "rb"), std::fclose);
+    if (!file) return nullptr;
+    std::vector<uint8_t> data;
+    uint8_t buf[1 << 16];
+    for (size_t n; (n = std::fread(buf, 1, sizeof(buf), file.get())) > 0;) data.insert(data.end(), buf, buf + n);
+
+    auto img = std::make_shared<Image>();
+    if (is_qoi(data.data(), data.size()))
+    {
+        // A trailing byte after the QOI data records whether the entry was gray, which QOI stores as RGB.
+        if (data.back() != 1 && data.back() != 3) return nullptr;
+        const int channels = data.back();
+        data.pop_back();
+        *img = decode_qoi(data.data(), data.size());
+        if (channels == 1) *img = convert_channels(*img, 1);
+        return img;
+    }
+    uint32_t header[3]; // width, height, channels after the magic; the pixels follow packed
+    if (data.size() < 16 || std::memcmp(data.data(), kRawMagic, sizeof(kRawMagic)) != 0) return nullptr;
+    std::memcpy(header, data.data() + 4, sizeof(header));
+    img->width = static_cast<int>(header[0]);
+    img->height = static_cast<int>(header[1]);
+    img->channels = static_cast<int>(header[2]);
+    const size_t bytes = static_cast<size_t>(header[0]) * header[1] * header[2];
+    if (img->channels < 1 || img->channels > 4 || data.size() != 16 + bytes) return nullptr;
+    img->pixels.assign(data.data() + 16, data.data() + data.size());
+    return img;
+}
+
+// Written to a temporary name and renamed, so concurrent readers never see half a file.
+void write_blob(const std::string& path, const ConstImageView& img, bool qoi)
+{
+    std::vector<uint8_t> data;
+    if (qoi && img.channels != 4)
+    {
+        data = encode_qoi(img);
+        data.push_back(static_cast<uint8_t>(img.channels));
+    }
+    else
+    {
+        const uint32_t header[3] = { static_cast<uint32_t>(img.width), static_cast<uint32_t>(img.height),
+                                     static_cast<uint32_t>(img.channels) };
+        data.resize(16 + img.row_bytes() * img.height);
+        std::memcpy(data.data(), kRawMagic, 4);
+        std::memcpy(data.data() + 4, header, sizeof(header));
+        for (int y = 0; y < img.height; ++y)
+        {
+            std::memcpy(data.data() + 16 + y * img.row_bytes(), img.row(y), img.row_bytes());
+        }
+    }
+    // Unique across processes sharing the directory as well as across threads of this one.
+    const std::string temp = path + ".tmp" + std::to_string(::getpid()) + "_" +
+                             std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id()));
+    std::unique_ptr<FILE, int (*)(FILE*)> file(std::fopen(temp.c_str(), "wb"), std::fclose);
+    if (!file) throw std::runtime_error("Failed to write cache entry " + temp);
+    const bool ok = std::fwrite(data.data(), 1, data.size(), file.get()) == data.size();
+    if (std::fclose(file.release()) != 0 || !ok)
+    {
+        std::remove(temp.c_str());
+        throw std::runtime_error("Failed to write cache entry " + temp);
+    }
+    std::filesystem::rename(temp, path);
+}
+
+// False when the entry cannot be the result for img (a hash collision); the caller treats that as a miss.
+bool copy_into(const Image& cached, const ImageView& img)
+{
+    if (cached.width != img.width || cached.height != img.height || cached.channels != img.channels) return false;
+    TraceSpan span("cache copy", "copy");
+    const ConstImageView src(cached);
+    parallel_for_rows(img.height, img.row_bytes(), [&](int y0, int y1) {
+        for (int y = y0; y < y1; ++y) std::memcpy(img.row(y), src.row(y), img.row_bytes());
+    });
+    return true;
+}
+} // namespace
+
+uint64_t hash_pixels(const ConstImageView& img)
+{
+    TraceSpan span("hash", "cache");
+    const int bands = (img.height + kHashBandRows - 1) / kHashBandRows;
+    std::vector<uint64_t> band_hashes(static_cast<size_t>(std::max(bands, 0)));
+    cpu_thread_pool().parallel_for(band_hashes.size(), 1, [&](size_t begin, size_t end) {
+        for (size_t b = begin; b < end; ++b)
+        {
+            Hasher hasher(b);
+            const int y1 = std::min(img.height, static_cast<int>(b + 1) * kHashBandRows);
+            for (int y = static_cast<int>(b) * kHashBandRows; y < y1; ++y) hasher.update(img.row(y), img.row_bytes());
+            band_hashes[b] = hasher.finish();
+        }
+    });
+    uint64_t h = combine(combine(static_cast<uint64_t>(img.width), static_cast<uint64_t>(img.height)),
+                         static_cast<uint64_t>(img.channels));
+    for (const uint64_t band : band_hashes) h = combine(h, band);
+    return h;
+}
+
+uint64_t hash_chain(const FilterChain& chain, size_t steps)
+{
+    uint64_t h = kPrime2;
+    for (size_t i = 0; i < std::min(steps, chain.size()); ++i)
+    {
+        Hasher hasher(i);
+        const int32_t kind = static_cast<int32_t>(chain[i].kind);
+        hasher.update(reinterpret_cast<const uint8_t*>(&kind), sizeof(kind));
+        hasher.update(reinterpret_cast<const uint8_t*>(chain[i].params.data()), sizeof(chain[i].params));
+        h = combine(h, hasher.finish());
+    }
+    return h;
+}
+
+uint64_t cache_key(uint64_t source_hash, uint64_t chain_hash)
+{
+    return combine(source_hash, chain_hash);
+}
+
+ResultCache::ResultCache(ResultCacheOptions options) : options_(std::move(options))
+{
+    if (!options_.disk_dir.empty()) std::filesystem::create_directories(options_.disk_dir);
+}
+
+CachedRun ResultCache::run(ImageView img, const FilterChain& chain, Backend requested)
+{
+    return run(img, hash_pixels(img), chain, requested);
+}
+
+CachedRun ResultCache::run(ImageView img, uint64_t source_hash, const FilterChain& chain, Backend requested)
+{
+    CachedRun result;
+    result.backend = resolve_backend(requested, img);
+    const size_t n = chain.size();
+    if (n == 0) return result;
+
+    // Longest cached prefix; the input itself is the empty prefix.
+    size_t done = 0;
+    for (size_t k = n; k > 0 && done == 0; --k)
+    {
+        const std::shared_ptr<const Image> cached = find(cache_key(source_hash, hash_chain(chain, k)));
+        if (cached && copy_into(*cached, img)) done = k;
+    }
+    result.cached_steps = done;
+    if (done == 0)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++stats_.misses;
+    }
+
+    // Stop once before the last step so the next run can swap only that one.
+    for (const size_t stop : { n - 1, n })
+    {
+        if (stop <= done) continue;
+        const FilterChain part(chain.begin() + static_cast<std::ptrdiff_t>(done),
+                               chain.begin() + static_cast<std::ptrdiff_t>(stop));
+        result.backend = run_pipeline(img, part, requested);
+        insert(cache_key(source_hash, hash_chain(chain, stop)), img);
+        done = stop;
+    }
+    return result;
+}
+
+std::shared_ptr<const Image> ResultCache::find(uint64_t key)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        const auto it = index_.find(key);
+        if (it != index_.end())
+        {
+            lru_.splice(lru_.begin(), lru_, it->second);
+            ++stats_.memory_hits;
+            return it->second->image;
+        }
+    }
+    if (options_.disk_dir.empty()) return nullptr;
+
+    TraceSpan span("cache read", "io");
+    // Entries written with the other disk_qoi setting are just as good.
+    std::shared_ptr<const Image> image = read_blob(disk_path(key, options_.disk_qoi));
+    if (!image) image = read_blob(disk_path(key, !options_.disk_qoi));
+    if (!image) return nullptr;
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++stats_.disk_hits;
+    insert_memory(key, image);
+    return image;
+}
+
+void ResultCache::insert(uint64_t key, const ConstImageView& img)
+{
+    const bool to_memory = img.row_bytes() * img.height <= options_.memory_bytes;
+    if (!to_memory && options_.disk_dir.empty()) return;
+
+    TraceSpan span("cache store", "copy");
+    std::shared_ptr<const Image> image = std::make_shared<Image>(to_image(img));
+    if (to_memory)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        insert_memory(key, image);
+    }
+    if (!options_.disk_dir.empty()) write_blob(disk_path(key, options_.disk_qoi), img, options_.disk_qoi);
+}
+
+void ResultCache::insert_memory(uint64_t key, std::shared_ptr<const Image> image)
+{
+    const size_t bytes = image->pixels.size();
+    if (bytes > options_.memory_bytes) return;
+    const auto it = index_.find(key);
+    if (it != index_.end())
+    {
+        stats_.bytes -= it->second->image->pixels.size();
+        lru_.erase(it->second);
+        index_.erase(it);
+    }
+    while (!lru_.empty() && stats_.bytes + bytes > options_.memory_bytes)
+    {
+        stats_.bytes -= lru_.back().image->pixels.size();
+        index_.erase(lru_.back().key);
+        lru_.pop_back();
+        ++stats_.evictions;
+    }
+    lru_.push_front({ key, std::move(image) });
+    index_[key] = lru_.begin();
+    stats_.bytes += bytes;
+}
+
+std::string ResultCache::disk_path(uint64_t key, bool qoi) const
+{
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.%s", static_cast<unsigned long long>(key),
+                  qoi ? "qoi" : "raw");
+    return (std::filesystem::path(options_.disk_dir) / name).string();
+}
+
+ResultCacheStats ResultCache::stats() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    ResultCacheStats stats = stats_;
+    stats.entries = lru_.size();
+    return stats;
+}
+
+void ResultCache::clear_memory()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    lru_.clear();
+    index_.clear();
+    stats_.bytes = 0;
+}
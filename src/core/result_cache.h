@@ -0,0 +1,89 @@
+// src/core/result_cache.h
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "backend.h"
+#include "filter_chain.h"
+#include "image.h"
+
+// 64-bit content hash of a view's pixels and shape; strides and padding bytes do not affect it.
+// Rows are hashed in fixed bands on the thread pool and combined in order, so the value is the same
+// for any thread count.
+uint64_t hash_pixels(const ConstImageView& img);
+
+// Hash of the first `steps` steps of a chain (kinds and exact parameter values).
+uint64_t hash_chain(const FilterChain& chain, size_t steps);
+
+struct ResultCacheOptions
+{
+    size_t memory_bytes = size_t(256) << 20; // LRU budget for the in-memory tier; 0 disables it
+    std::string disk_dir;                    // on-disk tier, created if missing; empty disables it
+    bool disk_qoi = false;                   // QOI blobs instead of raw pixels (smaller, slower; raw for RGBA)
+};
+
+struct ResultCacheStats
+{
+    uint64_t memory_hits = 0;
+    uint64_t disk_hits = 0;
+    uint64_t misses = 0;    // runs that found no cached prefix at all
+    uint64_t evictions = 0; // from the memory tier
+    size_t entries = 0;
+    size_t bytes = 0;       // held by the memory tier
+};
+
+// What ResultCache::run() did.
+struct CachedRun
+{
+    Backend backend = Backend::Cpu; // of the steps that ran; meaningless when nothing ran
+    size_t cached_steps = 0;        // leading steps served from the cache; chain.size() on a full hit
+};
+
+// Content-addressed cache of filter results, keyed by hash_pixels() of the input and hash_chain()
+// of a chain prefix. Besides each full result, run() keeps the result of the chain without its last
+// step, so editing only the final stage reuses everything before it. Entries live in a memory LRU
+// bounded by bytes and optionally in a directory (one file per key, never evicted: delete the
+// directory to clear it); disk hits are promoted to memory. Thread-safe.
+class ResultCache
+{
+public:
+    explicit ResultCache(ResultCacheOptions options = {});
+
+    // Filters img in place like run_pipeline(), starting from the longest cached prefix of `chain`.
+    // Results are stored only once their steps have completed, so a Cancelled or failed run leaves
+    // nothing behind. The second form takes hash_pixels(img) from a caller that already knows it.
+    CachedRun run(ImageView img, const FilterChain& chain, Backend requested = Backend::Auto);
+    CachedRun run(ImageView img, uint64_t source_hash, const FilterChain& chain, Backend requested = Backend::Auto);
+
+    // Raw access by key (see hash_pixels() and hash_chain(); run() combines them with cache_key()).
+    std::shared_ptr<const Image> find(uint64_t key);
+    void insert(uint64_t key, const ConstImageView& img);
+
+    ResultCacheStats stats() const;
+    void clear_memory();
+
+private:
+    struct Entry
+    {
+        uint64_t key;
+        std::shared_ptr<const Image> image;
+    };
+
+    void insert_memory(uint64_t key, std::shared_ptr<const Image> image); // caller holds mutex_
+    std::string disk_path(uint64_t key, bool qoi) const;
+
+    ResultCacheOptions options_;
+    mutable std::mutex mutex_;
+    std::list<Entry> lru_; // most recently used first
+    std::unordered_map<uint64_t, std::list<Entry>::iterator> index_;
+    ResultCacheStats stats_;
+};
+
+// Key of a chain prefix applied to an input.
+uint64_t cache_key(uint64_t source_hash, uint64_t chain_hash);
@@ -0,0 +1,352 @@
+// src/core/row_io.cpp
+#include "row_io.h"
+
+#include "codecs.h"
+
+#define ZLIB_CONST // z_stream::next_in is a const Bytef*
+#include <zlib.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+namespace
+{
+struct FileCloser
+{
+    void operator()(std::FILE* f) const { std::fclose(f); }
+};
+using FilePtr = std::unique_ptr<std::FILE, FileCloser>;
+
+constexpr size_t kIoBufferBytes = 1 << 20;
+
+FilePtr open_file(const std::string& path, const char* mode)
+{
+    FilePtr file(std::fopen(path.c_str(), mode));
+    if (!file)
+    {
+        throw std::runtime_error("Failed to open " + path);
+    }
+    std::setvbuf(file.get(), nullptr, _IOFBF, kIoBufferBytes);
+    return file;
+}
+
+// ---------------------------------------------------------------------------------------------------
+// PNM input
+
+// Next whitespace-separated header token, skipping '#' comments (P5/P6 headers).
+std::string pnm_token(std::FILE* f)
+{
+    int c = std::fgetc(f);
+    for (;;)
+    {
+        while (c != EOF && std::isspace(c)) c = std::fgetc(f);
+        if (c != '#') break;
+        while (c != EOF && c != '\n') c = std::fgetc(f);
+    }
+    std::string token;
+    while (c != EOF && !std::isspace(c))
+    {
+        token.push_back(static_cast<char>(c));
+        c = std::fgetc(f);
+    }
+    // The single whitespace byte after the last header field has been consumed, as the format requires.
+    return token;
+}
+
+int parse_header_int(const std::string& token, const std::string& path)
+{
+    char* end = nullptr;
+    const long v = std::strtol(token.c_str(), &end, 10);
+    if (token.empty() || *end != '\0' || v <= 0 || v > (1 << 30))
+    {
+        throw std::runtime_error("Bad PNM header field '" + token + "' in " + path);
+    }
+    return static_cast<int>(v);
+}
+
+PnmHeader parse_pnm_header(std::FILE* f, const std::string& path)
+{
+    PnmHeader header;
+    const std::string magic = pnm_token(f);
+    int maxval = 0;
+    if (magic == "P5" || magic == "P6")
+    {
+        header.width = parse_header_int(pnm_token(f), path);
+        header.height = parse_header_int(pnm_token(f), path);
+        maxval = parse_header_int(pnm_token(f), path);
+        header.depth = magic == "P5" ? 1 : 3;
+    }
+    else if (magic == "P7")
+    {
+        for (std::string key = pnm_token(f); key != "ENDHDR"; key = pnm_token(f))
+        {
+            if (key.empty()) throw std::runtime_error("Truncated PAM header in " + path);
+            const std::string value = pnm_token(f);
+            if (key == "WIDTH") header.width = parse_header_int(value, path);
+            else if (key == "HEIGHT") header.height = parse_header_int(value, path);
+            else if (key == "DEPTH") header.depth = parse_header_int(value, path);
+            else if (key == "MAXVAL") maxval = parse_header_int(value, path);
+            // TUPLTYPE is implied by DEPTH here; anything else is ignored.
+        }
+    }
+    else
+    {
+        throw std::runtime_error("Not a binary PNM/PAM file: " + path);
+    }
+
+    if (header.width <= 0 || header.height <= 0 || header.depth < 1 || header.depth > 4 || maxval != 255)
+    {
+        throw std::runtime_error("Unsupported PNM/PAM layout (need 8-bit, 1-4 channels): " + path);
+    }
+    header.data_offset = static_cast<size_t>(std::ftell(f));
+    return header;
+}
+
+class PnmReader : public RowReader
+{
+public:
+    explicit PnmReader(const std::string& path) : file_(open_file(path, "rb")), path_(path)
+    {
+        const PnmHeader header = parse_pnm_header(file_.get(), path);
+        width_ = header.width;
+        height_ = header.height;
+        depth_ = header.depth;
+    }
+
+    void read_rows(uint8_t* dst, int count) override
+    {
+        if (depth_ == 3)
+        {
+            read_exact(dst, row_bytes() * count);
+            return;
+        }
+        scratch_.resize(static_cast<size_t>(width_) * depth_);
+        for (int r = 0; r < count; ++r)
+        {
+            read_exact(scratch_.data(), scratch_.size());
+            uint8_t* out = dst + r * row_bytes();
+            for (int x = 0; x < width_; ++x)
+            {
+                const uint8_t* in = scratch_.data() + static_cast<size_t>(x) * depth_;
+                if (depth_ <= 2)
+                {
+                    out[3 * x] = out[3 * x + 1] = out[3 * x + 2] = in[0];
+                }
+                else
+                {
+                    std::memcpy(out + 3 * x, in, 3);
+                }
+            }
+        }
+    }
+
+private:
+    void read_exact(uint8_t* dst, size_t bytes)
+    {
+        if (std::fread(dst, 1, bytes, file_.get()) != bytes)
+        {
+            throw std::runtime_error("Unexpected end of image data in " + path_);
+        }
+    }
+
+    FilePtr file_;
+    std::string path_;
+    int depth_ = 3;
+    std::vector<uint8_t> scratch_;
+};
+
+// ---------------------------------------------------------------------------------------------------
+// Output
+
+class PnmWriter : public RowWriter
+{
+public:
+    PnmWriter(const std::string& path, int width, int height, bool pam)
+        : file_(open_file(path, "wb")), path_(path), width_(width), height_(height)
+    {
+        if (pam)
+            std::fprintf(file_.get(), "P7\nWIDTH %d\nHEIGHT %d\nDEPTH 3\nMAXVAL 255\nTUPLTYPE RGB\nENDHDR\n", width,
+                         height);
+        else
+            std::fprintf(file_.get(), "P6\n%d %d\n255\n", width, height);
+    }
+
+    void write_rows(const uint8_t* src, int count) override
+    {
+        const size_t bytes = static_cast<size_t>(width_) * 3 * count;
+        if (std::fwrite(src, 1, bytes, file_.get()) != bytes)
+        {
+            throw std::runtime_error("Failed to write " + path_);
+        }
+        rows_ += count;
+    }
+
+    void finish() override
+    {
+        if (rows_ != height_) throw std::runtime_error("Incomplete image written to " + path_);
+        if (std::fclose(file_.release()) != 0) throw std::runtime_error("Failed to write " + path_);
+    }
+
+private:
+    FilePtr file_;
+    std::string path_;
+    int width_;
+    int height_;
+    int rows_ = 0;
+};
+
+// RGB8 PNG whose rows are filtered and deflated as they arrive, so only the previous row and zlib's
+// window are kept. IDAT chunks are written each time the output buffer fills.
+class PngWriter : public RowWriter
+{
+public:
+    PngWriter(const std::string& path, int width, int height, int level)
+        : file_(open_file(path, "wb")), path_(path), width_(width), height_(height),
+          stride_(static_cast<size_t>(width) * 3), previous_(stride_), filtered_(stride_ + 1), out_(kIoBufferBytes)
+    {
+        if (level < 0 || level > 9) throw std::invalid_argument("PNG compression level must be in [0, 9]");
+        if (deflateInit(&zs_, level) != Z_OK) throw std::runtime_error("deflateInit failed");
+        zs_.next_out = out_.data();
+        zs_.avail_out = static_cast<uInt>(out_.size());
+
+        static const uint8_t kSignature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+        write_bytes(kSignature, sizeof(kSignature));
+        uint8_t ihdr[13] = {};
+        put_u32(ihdr, static_cast<uint32_t>(width));
+        put_u32(ihdr + 4, static_cast<uint32_t>(height));
+        ihdr[8] = 8; // bit depth
+        ihdr[9] = 2; // colour type: truecolour
+        write_chunk("IHDR", ihdr, sizeof(ihdr));
+    }
+
+    ~PngWriter() override { deflateEnd(&zs_); }
+
+    void write_rows(const uint8_t* src, int count) override
+    {
+        for (int r = 0; r < count; ++r)
+        {
+            const uint8_t* row = src + r * stride_;
+            png_filter_row(row, rows_ + r > 0 ? previous_.data() : nullptr, stride_, 3, filtered_.data());
+            deflate_bytes(filtered_.data(), filtered_.size(), Z_NO_FLUSH);
+            std::memcpy(previous_.data(), row, stride_);
+        }
+        rows_ += count;
+    }
+
+    void finish() override
+    {
+        if (rows_ != height_) throw std::runtime_error("Incomplete image written to " + path_);
+        deflate_bytes(nullptr, 0, Z_FINISH);
+        flush_idat();
+        write_chunk("IEND", nullptr, 0);
+        if (std::fclose(file_.release()) != 0) throw std::runtime_error("Failed to write " + path_);
+    }
+
+private:
+    static void put_u32(uint8_t* p, uint32_t v)
+    {
+        p[0] = static_cast<uint8_t>(v >> 24);
+        p[1] = static_cast<uint8_t>(v >> 16);
+        p[2] = static_cast<uint8_t>(v >> 8);
+        p[3] = static_cast<uint8_t>(v);
+    }
+
+    void write_bytes(const void* data, size_t bytes)
+    {
+        if (bytes && std::fwrite(data, 1, bytes, file_.get()) != bytes)
+        {
+            throw std::runtime_error("Failed to write " + path_);
+        }
+    }
+
+    void write_chunk(const char* type, const uint8_t* data, size_t bytes)
+    {
+        uint8_t header[8];
+        put_u32(header, static_cast<uint32_t>(bytes));
+        std::memcpy(header + 4, type, 4);
+        uLong crc = crc32(0L, header + 4, 4);
+        if (bytes) crc = crc32(crc, data, static_cast<uInt>(bytes));
+        uint8_t trailer[4];
+        put_u32(trailer, static_cast<uint32_t>(crc));
+        write_bytes(header, 8);
+        write_bytes(data, bytes);
+        write_bytes(trailer, 4);
+    }
+
+    void flush_idat()
+    {
+        const size_t used = out_.size() - zs_.avail_out;
+        if (used) write_chunk("IDAT", out_.data(), used);
+        zs_.next_out = out_.data();
+        zs_.avail_out = static_cast<uInt>(out_.size());
+    }
+
+    void deflate_bytes(const uint8_t* data, size_t bytes, int flush)
+    {
+        zs_.next_in = data;
+        zs_.avail_in = static_cast<uInt>(bytes);
+        for (;;)
+        {
+            const int status = deflate(&zs_, flush);
+            if (status == Z_STREAM_ERROR) throw std::runtime_error("deflate failed for " + path_);
+            if (zs_.avail_out == 0)
+            {
+                flush_idat();
+                continue;
+            }
+            if (flush == Z_FINISH ? status == Z_STREAM_END : zs_.avail_in == 0) break;
+        }
+    }
+
+    FilePtr file_;
+    std::string path_;
+    int width_;
+    int height_;
+    size_t stride_;
+    int rows_ = 0;
+    z_stream zs_{};
+    std::vector<uint8_t> previous_;        // unfiltered row above
+    std::vector<uint8_t> filtered_;        // filter type byte + filtered row
+    std::vector<uint8_t> out_;             // deflate output, flushed as one IDAT chunk when full
+};
+} // namespace
+
+PnmHeader read_pnm_header(const std::string& path)
+{
+    FilePtr file = open_file(path, "rb");
+    return parse_pnm_header(file.get(), path);
+}
+
+std::unique_ptr<RowReader> open_row_reader(const std::string& path)
+{
+    if (!is_streamable_input(path))
+    {
+        throw std::runtime_error("Streaming input must be PPM/PGM/PAM: " + path);
+    }
+    return std::make_unique<PnmReader>(path);
+}
+
+std::unique_ptr<RowWriter> open_row_writer(const std::string& path, int width, int height, int png_level)
+{
+    const std::string ext = lower_extension(path);
+    if (ext == ".ppm" || ext == ".pam") return std::make_unique<PnmWriter>(path, width, height, ext == ".pam");
+    if (ext == ".png") return std::make_unique<PngWriter>(path, width, height, png_level);
+    throw std::runtime_error("Streaming output must be PPM, PAM or PNG: " + path);
+}
+
+bool is_streamable_input(const std::string& path)
+{
+    const std::string ext = lower_extension(path);
+    return ext == ".ppm" || ext == ".pgm" || ext == ".pnm" || ext == ".pam";
+}
+
+bool is_streamable_output(const std::string& path)
+{
+    const std::string ext = lower_extension(path);
+    return ext == ".ppm" || ext == ".pam" || ext == ".png";
+}
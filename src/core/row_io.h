@@ -0,0 +1,63 @@
+// src/core/row_io.h
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// Sequential row-at-a-time image I/O for frames that do not fit in memory. Readers and writers only
+// ever hold the rows handed to them, so peak memory is set by the caller's band size.
+// All of them deal in interleaved 8-bit RGB rows, like Image.
+class RowReader
+{
+public:
+    virtual ~RowReader() = default;
+
+    int width() const { return width_; }
+    int height() const { return height_; }
+    int channels() const { return 3; }
+    size_t row_bytes() const { return static_cast<size_t>(width_) * 3; }
+
+    // Reads the next `count` rows into dst (row_bytes() apart). Throws std::runtime_error on
+    // truncated or unreadable input.
+    virtual void read_rows(uint8_t* dst, int count) = 0;
+
+protected:
+    int width_ = 0;
+    int height_ = 0;
+};
+
+class RowWriter
+{
+public:
+    virtual ~RowWriter() = default;
+
+    // Appends `count` rows (width * 3 bytes each, packed). Rows must arrive top to bottom.
+    virtual void write_rows(const uint8_t* src, int count) = 0;
+    // Flushes trailing data; throws if fewer rows than the declared height were written.
+    virtual void finish() = 0;
+};
+
+// Layout of a binary PNM/PAM file; data_offset is where the pixel rows start.
+struct PnmHeader
+{
+    int width = 0;
+    int height = 0;
+    int depth = 3; // channels per pixel
+    size_t data_offset = 0;
+};
+// Throws std::runtime_error for anything but 8-bit P5/P6/P7 with 1-4 channels.
+PnmHeader read_pnm_header(const std::string& path);
+
+// Binary PNM input: P5 (gray), P6 (RGB) or P7 PAM with depth 1-4, maxval 255. Gray is expanded to RGB
+// and alpha dropped, as load_image() does.
+std::unique_ptr<RowReader> open_row_reader(const std::string& path);
+
+// Output format by extension: .ppm (P6), .pam (P7, TUPLTYPE RGB) or .png (rows deflated at zlib level
+// png_level as they arrive, one IDAT chunk per filled buffer).
+std::unique_ptr<RowWriter> open_row_writer(const std::string& path, int width, int height, int png_level = 6);
+
+// True if open_row_reader() / open_row_writer() handle this path's extension.
+bool is_streamable_input(const std::string& path);
+bool is_streamable_output(const std::string& path);
@@ -0,0 +1,192 @@
+// src/core/stencil.h
+#pragma once
+
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+
+#include "filter_chain.h"
+
+// Fixed convolution kernels as compile-time data, shared by the CPU filters and the CUDA kernels.
+// A Stencil's size and taps are template arguments, so every tap loop below is expanded at compile
+// time (zero taps vanish) and separable kernels are detected and split into a row and a column pass
+// without any runtime analysis. Sums are exact integers and both paths round the same way, so the
+// separable and direct forms, and the two backends, produce identical bytes.
+
+#if defined(__CUDACC__)
+#define CUDAPIX_HD __host__ __device__ __forceinline__
+#else
+#define CUDAPIX_HD inline
+#endif
+
+// Index of sample i in a line of n samples under `mode`; -1 means "outside" (Constant border).
+// Mirror reflects about the edge sample without repeating it (-1 -> 1), Wrap is periodic.
+CUDAPIX_HD int border_index(int i, int n, BorderMode mode)
+{
+    if (i >= 0 && i < n) return i;
+    switch (mode)
+    {
+    case BorderMode::Clamp: return i < 0 ? 0 : n - 1;
+    case BorderMode::Mirror:
+    {
+        if (n == 1) return 0;
+        const int period = 2 * n - 2;
+        i %= period;
+        if (i < 0) i += period;
+        return i < n ? i : period - i;
+    }
+    case BorderMode::Wrap:
+        i %= n;
+        return i < 0 ? i + n : i;
+    case BorderMode::Constant: break;
+    }
+    return -1;
+}
+
+// Size x Size taps in row-major order (dy outer, dx inner). The output is
+// clamp(round(sum / Divisor) + Bias, 0, 255), with |sum| instead of sum when Absolute is set;
+// rounding is to nearest, halves away from zero.
+template <int Size, int Divisor, int Bias, bool Absolute, int... Taps>
+struct Stencil
+{
+    static_assert(Size % 2 == 1, "stencils have a centre tap");
+    static_assert(sizeof...(Taps) == Size * Size, "one tap per sample");
+    static_assert(Divisor > 0, "divisor must be positive");
+
+    static constexpr int kSize = Size;
+    static constexpr int kRadius = Size / 2;
+
+    CUDAPIX_HD static constexpr int tap(int i)
+    {
+        constexpr int taps[] = { Taps... };
+        return taps[i];
+    }
+
+    // Rank-1 test against the first non-zero tap p at (pr, pc): the kernel is col x row / p with
+    // col = column pc and row = row pr exactly when every tap satisfies t(i, j) * p == t(i, pc) * t(pr, j).
+    static constexpr int pivot_index()
+    {
+        for (int i = 0; i < Size * Size; ++i)
+        {
+            if (tap(i) != 0) return i;
+        }
+        return 0;
+    }
+    static constexpr bool separable()
+    {
+        const int p = pivot_index();
+        if (tap(p) == 0) return false;
+        const int pr = p / Size;
+        const int pc = p % Size;
+        for (int i = 0; i < Size; ++i)
+        {
+            for (int j = 0; j < Size; ++j)
+            {
+                if (tap(i * Size + j) * tap(p) != tap(i * Size + pc) * tap(pr * Size + j)) return false;
+            }
+        }
+        return true;
+    }
+
+    static constexpr bool kSeparable = separable();
+    static constexpr int kPivotIndex = pivot_index();
+    static constexpr int kPivot = tap(kPivotIndex); // column pass sums are kPivot times the 2D sum
+
+    CUDAPIX_HD static constexpr int row_tap(int j) { return tap(kPivotIndex / Size * Size + j); }
+    CUDAPIX_HD static constexpr int col_tap(int i) { return tap(i * Size + kPivotIndex % Size); }
+
+    CUDAPIX_HD static uint8_t finish(int sum)
+    {
+        if (Absolute && sum < 0) sum = -sum;
+        const int q = sum >= 0 ? (sum + Divisor / 2) / Divisor : -((-sum + Divisor / 2) / Divisor);
+        const int v = q + Bias;
+        return static_cast<uint8_t>(v < 0 ? 0 : (v > 255 ? 255 : v));
+    }
+};
+
+namespace stencil_detail
+{
+template <typename K, typename Sample, int... I>
+CUDAPIX_HD int sum_2d(const Sample& sample, std::integer_sequence<int, I...>)
+{
+    return (0 + ... + (K::tap(I) == 0 ? 0 : K::tap(I) * sample(I % K::kSize - K::kRadius, I / K::kSize - K::kRadius)));
+}
+
+template <typename K, typename Sample, int... I>
+CUDAPIX_HD int sum_row(const Sample& sample, std::integer_sequence<int, I...>)
+{
+    return (0 + ... + (K::row_tap(I) == 0 ? 0 : K::row_tap(I) * sample(I - K::kRadius)));
+}
+
+template <typename K, typename Sample, int... I>
+CUDAPIX_HD int sum_col(const Sample& sample, std::integer_sequence<int, I...>)
+{
+    return (0 + ... + (K::col_tap(I) == 0 ? 0 : K::col_tap(I) * sample(I - K::kRadius)));
+}
+} // namespace stencil_detail
+
+// Weighted sum of the window; sample(dx, dy) returns the input at offset (dx, dy) from the centre.
+template <typename K, typename Sample>
+CUDAPIX_HD int stencil_sum(const Sample& sample)
+{
+    return stencil_detail::sum_2d<K>(sample, std::make_integer_sequence<int, K::kSize * K::kSize>{});
+}
+
+// The two halves of a separable kernel: stencil_row_sum() over sample(dx) along a row, then
+// stencil_col_sum() over those row sums at sample(dy); the result is K::kPivot * stencil_sum().
+template <typename K, typename Sample>
+CUDAPIX_HD int stencil_row_sum(const Sample& sample)
+{
+    return stencil_detail::sum_row<K>(sample, std::make_integer_sequence<int, K::kSize>{});
+}
+template <typename K, typename Sample>
+CUDAPIX_HD int stencil_col_sum(const Sample& sample)
+{
+    return stencil_detail::sum_col<K>(sample, std::make_integer_sequence<int, K::kSize>{}) / K::kPivot;
+}
+
+// Kernels of the convolution filters (FilterKind::Sharpen .. Gaussian5) and of the Sobel gradients.
+using SharpenStencil = Stencil<3, 1, 0, false,
+                               0, -1, 0,
+                               -1, 5, -1,
+                               0, -1, 0>;
+using LaplacianStencil = Stencil<3, 1, 0, true,
+                                 0, 1, 0,
+                                 1, -4, 1,
+                                 0, 1, 0>;
+using EmbossStencil = Stencil<3, 1, 128, false,
+                              -2, -1, 0,
+                              -1, 0, 1,
+                              0, 1, 2>;
+using Gaussian5Stencil = Stencil<5, 256, 0, false,
+                                 1, 4, 6, 4, 1,
+                                 4, 16, 24, 16, 4,
+                                 6, 24, 36, 24, 6,
+                                 4, 16, 24, 16, 4,
+                                 1, 4, 6, 4, 1>;
+using SobelXStencil = Stencil<3, 1, 0, false,
+                              -1, 0, 1,
+                              -2, 0, 2,
+                              -1, 0, 1>;
+using SobelYStencil = Stencil<3, 1, 0, false,
+                              1, 2, 1,
+                              0, 0, 0,
+                              -1, -2, -1>;
+
+static_assert(!SharpenStencil::kSeparable && !LaplacianStencil::kSeparable && !EmbossStencil::kSeparable);
+static_assert(Gaussian5Stencil::kSeparable && SobelXStencil::kSeparable && SobelYStencil::kSeparable);
+
+// Calls fn(K{}) with the Stencil type of a convolution filter (is_convolution(kind)).
+template <typename Fn>
+decltype(auto) visit_stencil(FilterKind kind, Fn&& fn)
+{
+    switch (kind)
+    {
+    case FilterKind::Sharpen: return fn(SharpenStencil{});
+    case FilterKind::Laplacian: return fn(LaplacianStencil{});
+    case FilterKind::Emboss: return fn(EmbossStencil{});
+    case FilterKind::Gaussian5: return fn(Gaussian5Stencil{});
+    default: break;
+    }
+    throw std::invalid_argument(std::string(filter_kind_name(kind)) + " is not a convolution");
+}
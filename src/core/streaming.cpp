@@ -0,0 +1,94 @@
+// src/core/streaming.cpp
+#include "streaming.h"
+
+#include "image.h"
+#include "row_io.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+StreamStats stream_pipeline(RowReader& reader, RowWriter& writer, const FilterChain& chain,
+                            const StreamOptions& options)
+{
+    StreamStats stats;
+    stats.width = reader.width();
+    stats.height = reader.height();
+    for (const FilterStep& step : chain)
+    {
+        if (is_global_op(step))
+        {
+            throw std::invalid_argument(format_filter_chain({ step }) + " needs the whole frame and cannot be streamed");
+        }
+        stats.halo += filter_halo(step);
+    }
+
+    const int height = reader.height();
+    const int band = std::max(options.band_rows, 1);
+    const int halo = stats.halo;
+    const size_t row_bytes = reader.row_bytes();
+
+    // `source` holds input rows [s0, s1): the band plus up to `halo` rows on either side. Rows past
+    // the frame edges are not materialized; the filters clamp at the buffer edges, which coincide
+    // with the frame edges there. Away from them, clamping artifacts reach at most `halo` rows into
+    // the buffer, so the band itself comes out exact.
+    Image source;
+    source.width = reader.width();
+    source.channels = reader.channels();
+    int s0 = 0;
+    int s1 = 0;
+    Image work;
+
+    for (int y0 = 0; y0 < height; y0 += band)
+    {
+        const int y1 = std::min(y0 + band, height);
+        const int want0 = std::max(y0 - halo, 0);
+        const int want1 = std::min(y1 + halo, height);
+
+        // Keep the rows shared with the previous window, read the rest; every new row is read in full.
+        const int keep = std::max(s1 - want0, 0);
+        if (keep > 0 && want0 > s0)
+        {
+            std::memmove(source.pixels.data(), source.pixels.data() + (want0 - s0) * row_bytes, keep * row_bytes);
+        }
+        source.pixels.resize_uninitialized(static_cast<size_t>(want1 - want0) * row_bytes);
+        {
+            TraceSpan span("read rows", "io");
+            reader.read_rows(source.pixels.data() + keep * row_bytes, want1 - want0 - keep);
+        }
+        s0 = want0;
+        s1 = want1;
+        source.height = s1 - s0;
+
+        // Without a halo nothing is shared between bands, so the band is filtered in place.
+        Image& target = halo > 0 ? work : source;
+        if (halo > 0)
+        {
+            TraceSpan span("copy band", "copy");
+            work.width = source.width;
+            work.height = source.height;
+            work.channels = source.channels;
+            work.pixels.assign(source.pixels.begin(), source.pixels.end());
+        }
+        run_pipeline(target, chain, options.backend);
+
+        {
+            TraceSpan span("write rows", "io");
+            writer.write_rows(target.pixels.data() + (y0 - s0) * row_bytes, y1 - y0);
+        }
+        stats.peak_bytes = std::max(stats.peak_bytes, source.pixels.capacity() + work.pixels.capacity());
+        ++stats.bands;
+    }
+
+    writer.finish();
+    return stats;
+}
+
+StreamStats stream_pipeline(const std::string& input_path, const std::string& output_path, const FilterChain& chain,
+                            const StreamOptions& options)
+{
+    std::unique_ptr<RowReader> reader = open_row_reader(input_path);
+    std::unique_ptr<RowWriter> writer = open_row_writer(output_path, reader->width(), reader->height(), options.png_level);
+    return stream_pipeline(*reader, *writer, chain, options);
+}
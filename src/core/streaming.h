@@ -0,0 +1,39 @@
+// src/core/streaming.h
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "backend.h"
+#include "filter_chain.h"
+
+class RowReader;
+class RowWriter;
+
+// Strip-wise processing of frames larger than memory. Rows are read in bands; each band is filtered
+// together with filter_halo() rows of context on either side (carried over from the previous band
+// rather than re-read) and written out before the next band is read. Output matches filtering the
+// whole frame at once; peak memory is O(width * (band_rows + 2 * halo)).
+struct StreamOptions
+{
+    int band_rows = 256;
+    Backend backend = Backend::Auto; // run_pipeline() routing, per band
+    int png_level = 6;               // zlib level for .png output
+};
+
+struct StreamStats
+{
+    int width = 0;
+    int height = 0;
+    int bands = 0;
+    int halo = 0;             // context rows on each side of a band
+    size_t peak_bytes = 0;    // largest band buffer, including halo rows
+};
+
+// Throws std::invalid_argument for chains containing global ops (canny), which cannot be split.
+StreamStats stream_pipeline(RowReader& reader, RowWriter& writer, const FilterChain& chain,
+                            const StreamOptions& options = {});
+
+// Convenience wrapper opening the files with open_row_reader() / open_row_writer().
+StreamStats stream_pipeline(const std::string& input_path, const std::string& output_path, const FilterChain& chain,
+                            const StreamOptions& options = {});
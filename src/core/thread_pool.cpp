@@ -0,0 +1,300 @@
+// src/core/thread_pool.cpp
+#include "thread_pool.h"
+
+#include "tuning.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+
+namespace
+{
+thread_local const ThreadPool* t_pool = nullptr;
+thread_local int t_worker_index = -1;
+thread_local int t_serial_depth = 0; // open SerialScopes on this thread
+thread_local const std::atomic<bool>* t_cancel = nullptr; // innermost CancelScope's flag
+
+bool is_set(const std::atomic<bool>* flag)
+{
+    return flag && flag->load(std::memory_order_relaxed);
+}
+
+// Gives a chunk the cancel flag of the parallel_for that queued it, whichever thread runs it; a
+// caller helping out with someone else's chunks must not lend them its own flag.
+class CancelBinding
+{
+public:
+    explicit CancelBinding(const std::atomic<bool>* flag) : previous_(t_cancel) { t_cancel = flag; }
+    ~CancelBinding() { t_cancel = previous_; }
+
+private:
+    const std::atomic<bool>* previous_;
+};
+
+std::mutex g_pool_mutex;
+std::unique_ptr<ThreadPool> g_pool;
+
+int default_thread_count()
+{
+    unsigned hw = std::thread::hardware_concurrency();
+    return hw == 0 ? 1 : static_cast<int>(hw);
+}
+} // namespace
+
+ThreadPool::ThreadPool(int num_threads)
+{
+    const int extra = std::max(num_threads, 1) - 1;
+    queues_.reserve(extra);
+    for (int i = 0; i < extra; ++i)
+    {
+        queues_.push_back(std::make_unique<Worker>());
+    }
+    workers_.reserve(extra);
+    for (int i = 0; i < extra; ++i)
+    {
+        workers_.emplace_back([this, i] { worker_loop(i); });
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+        stopping_ = true;
+    }
+    sleep_cv_.notify_all();
+    for (auto& t : workers_)
+    {
+        t.join();
+    }
+}
+
+void ThreadPool::push(Task task)
+{
+    size_t target = 0;
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+        // Tasks spawned by a worker stay on its own deque; external submissions are spread round-robin
+        // so the workers start on distinct deques and only steal once the load becomes uneven.
+        target = (t_pool == this && t_worker_index >= 0) ? static_cast<size_t>(t_worker_index)
+                                                         : next_queue_++ % queues_.size();
+        // Counted before the task is visible: a thief may pop it (and decrement) as soon as it is.
+        ++pending_;
+    }
+    try
+    {
+        std::lock_guard<std::mutex> lock(queues_[target]->mutex);
+        queues_[target]->tasks.push_back(std::move(task));
+    }
+    catch (...)
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+        --pending_;
+        throw;
+    }
+    sleep_cv_.notify_one();
+}
+
+bool ThreadPool::try_pop(int self, Task& task)
+{
+    const int n = static_cast<int>(queues_.size());
+    bool found = false;
+
+    if (self >= 0)
+    {
+        Worker& own = *queues_[self];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty())
+        {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            found = true;
+        }
+    }
+
+    for (int i = 1; !found && i <= n; ++i)
+    {
+        const int victim = ((self < 0 ? 0 : self) + i) % n;
+        if (victim == self) continue;
+        Worker& other = *queues_[victim];
+        std::lock_guard<std::mutex> lock(other.mutex);
+        if (!other.tasks.empty())
+        {
+            task = std::move(other.tasks.front());
+            other.tasks.pop_front();
+            found = true;
+        }
+    }
+
+    if (found)
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+        --pending_;
+    }
+    return found;
+}
+
+void ThreadPool::worker_loop(int index)
+{
+    t_pool = this;
+    t_worker_index = index;
+
+    Task task;
+    while (true)
+    {
+        if (try_pop(index, task))
+        {
+            task();
+            task = nullptr;
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleep_mutex_);
+        sleep_cv_.wait(lock, [this] { return stopping_ || pending_ > 0; });
+        if (stopping_ && pending_ == 0) return;
+    }
+}
+
+void ThreadPool::parallel_for(int count, int grain, const std::function<void(int, int)>& body)
+{
+    if (count <= 0) return;
+    grain = std::max(grain, 1);
+    const int chunks = (count + grain - 1) / grain;
+    const std::atomic<bool>* cancel = t_cancel;
+    if (chunks == 1 || workers_.empty() || t_serial_depth > 0)
+    {
+        if (!cancel)
+        {
+            body(0, count);
+            return;
+        }
+        for (int begin = 0; begin < count; begin += grain)
+        {
+            if (is_set(cancel)) throw Cancelled();
+            body(begin, std::min(begin + grain, count));
+        }
+        return;
+    }
+
+    struct State
+    {
+        std::atomic<int> remaining{ 0 };
+        std::mutex mutex;
+        std::condition_variable done_cv;
+        std::exception_ptr error;
+        std::atomic<bool> skipped{ false };
+    };
+    auto state = std::make_shared<State>();
+    state->remaining = chunks;
+
+    for (int begin = 0; begin < count; begin += grain)
+    {
+        const int end = std::min(begin + grain, count);
+        push([state, &body, cancel, begin, end] {
+            try
+            {
+                if (is_set(cancel))
+                {
+                    state->skipped = true;
+                }
+                else
+                {
+                    CancelBinding binding(cancel);
+                    body(begin, end);
+                }
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                if (!state->error) state->error = std::current_exception();
+            }
+            if (state->remaining.fetch_sub(1) == 1)
+            {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                state->done_cv.notify_all();
+            }
+        });
+    }
+
+    // Help out instead of blocking; once nothing is left to steal our chunks are all in flight.
+    const int self = (t_pool == this) ? t_worker_index : -1;
+    Task task;
+    while (state->remaining.load() > 0)
+    {
+        if (try_pop(self, task))
+        {
+            task();
+            task = nullptr;
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(state->mutex);
+        state->done_cv.wait(lock, [&] { return state->remaining.load() == 0; });
+    }
+
+    if (state->error) std::rethrow_exception(state->error);
+    if (state->skipped) throw Cancelled();
+}
+
+SerialScope::SerialScope()
+{
+    ++t_serial_depth;
+}
+
+SerialScope::~SerialScope()
+{
+    --t_serial_depth;
+}
+
+CancelScope::CancelScope(const std::atomic<bool>& flag) : previous_(t_cancel)
+{
+    t_cancel = &flag;
+}
+
+CancelScope::~CancelScope()
+{
+    t_cancel = previous_;
+}
+
+bool cancel_requested()
+{
+    return is_set(t_cancel);
+}
+
+ThreadPool& cpu_thread_pool()
+{
+    std::lock_guard<std::mutex> lock(g_pool_mutex);
+    if (!g_pool)
+    {
+        g_pool = std::make_unique<ThreadPool>(default_thread_count());
+    }
+    return *g_pool;
+}
+
+void set_cpu_thread_count(int count)
+{
+    if (count <= 0) count = default_thread_count();
+    std::lock_guard<std::mutex> lock(g_pool_mutex);
+    if (g_pool && g_pool->thread_count() == count) return;
+    g_pool.reset();
+    g_pool = std::make_unique<ThreadPool>(count);
+}
+
+int cpu_thread_count()
+{
+    return cpu_thread_pool().thread_count();
+}
+
+void parallel_for_rows(int height, size_t row_bytes, const std::function<void(int, int)>& body, size_t target_bytes)
+{
+    const TuneParams& tuning = current_tuning();
+    if (target_bytes == 0) target_bytes = tuning.chunk_bytes;
+    const size_t rows = row_bytes == 0 ? 1 : target_bytes / row_bytes;
+    int grain = static_cast<int>(std::clamp<size_t>(rows, 1, static_cast<size_t>(std::max(height, 1))));
+    // A task limit merges bands, so at most that many pool threads work on this call.
+    if (tuning.cpu_tasks > 0) grain = std::max(grain, (height + tuning.cpu_tasks - 1) / tuning.cpu_tasks);
+    // TuneScope is per thread: bands on pool workers get the caller's settings reinstalled.
+    cpu_thread_pool().parallel_for(height, grain, [&](int y0, int y1) {
+        TuneScope scope(tuning);
+        body(y0, y1);
+    });
+}
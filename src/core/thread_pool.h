@@ -0,0 +1,110 @@
+// src/core/thread_pool.h
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+// Work-stealing thread pool shared by the CPU filters. Every worker owns a task deque: it pops its
+// own tasks LIFO (cache-warm) and steals from the other workers FIFO once its deque runs dry.
+class ThreadPool
+{
+public:
+    // num_threads counts the calling thread too, so ThreadPool(1) spawns no workers at all.
+    explicit ThreadPool(int num_threads);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    int thread_count() const { return static_cast<int>(workers_.size()) + 1; }
+
+    // Runs body(begin, end) over [0, count) in chunks of at most `grain` items and blocks until
+    // every chunk is done. The caller executes chunks as well, so nested calls cannot deadlock.
+    // The first exception thrown by a chunk is rethrown here after the remaining chunks finish.
+    // Under a CancelScope, chunks not yet started when the flag is set are skipped and Cancelled is
+    // thrown instead.
+    void parallel_for(int count, int grain, const std::function<void(int, int)>& body);
+
+private:
+    using Task = std::function<void()>;
+
+    struct Worker
+    {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    void push(Task task);
+    bool try_pop(int self, Task& task);
+    void worker_loop(int index);
+
+    std::vector<std::unique_ptr<Worker>> queues_; // one per worker; external pushes go round-robin
+    std::vector<std::thread> workers_;
+    std::mutex sleep_mutex_;
+    std::condition_variable sleep_cv_;
+    size_t pending_ = 0; // guarded by sleep_mutex_
+    size_t next_queue_ = 0; // round-robin cursor for pushes from outside the pool
+    bool stopping_ = false;
+};
+
+// While alive, every parallel_for() issued from the constructing thread runs inline on that thread,
+// on any pool. Lets one caller run the cpu_* filters single-threaded without resizing the shared
+// pool under everyone else. Scopes nest.
+class SerialScope
+{
+public:
+    SerialScope();
+    ~SerialScope();
+
+    SerialScope(const SerialScope&) = delete;
+    SerialScope& operator=(const SerialScope&) = delete;
+};
+
+// Thrown by filter calls abandoned through a CancelScope.
+class Cancelled : public std::runtime_error
+{
+public:
+    Cancelled() : std::runtime_error("cancelled") {}
+};
+
+// While alive, parallel_for() calls issued from the constructing thread (and nested ones inside their
+// chunks) check `flag` before every chunk, so setting it from another thread abandons a long filter
+// call at the next chunk boundary; single-threaded runs still go chunk by chunk for that. The flag
+// must outlive the scope. Scopes nest; the innermost one applies.
+class CancelScope
+{
+public:
+    explicit CancelScope(const std::atomic<bool>& flag);
+    ~CancelScope();
+
+    CancelScope(const CancelScope&) = delete;
+    CancelScope& operator=(const CancelScope&) = delete;
+
+private:
+    const std::atomic<bool>* previous_;
+};
+
+// Whether the innermost CancelScope on this thread has been cancelled, for checks between stages
+// that do not go through parallel_for (e.g. GPU kernel launches).
+bool cancel_requested();
+
+// Process-wide pool used by the cpu_* filters. Sized to std::thread::hardware_concurrency() until
+// set_cpu_thread_count() is called; must not be resized while filters are running.
+ThreadPool& cpu_thread_pool();
+void set_cpu_thread_count(int count); // <= 0 restores the hardware default
+int cpu_thread_count();
+
+// Splits [0, height) into row bands of roughly `target_bytes` each (at least one row) and runs
+// body(y_begin, y_end) on the shared pool. 0 takes the band size and task limit of the current
+// TuneScope (tuning.h), 64 KiB and no limit outside one. Every band runs under the caller's
+// current_tuning(), whichever thread it lands on.
+void parallel_for_rows(int height, size_t row_bytes, const std::function<void(int, int)>& body,
+                       size_t target_bytes = 0);
@@ -0,0 +1,164 @@
+// src/core/trace.cpp
+#include "trace.h"
+
+#include "json.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace
+{
+using Clock = std::chrono::steady_clock;
+
+const Clock::time_point g_epoch = Clock::now();
+
+// One per thread that has recorded a span. The lock is only ever contended by collect/clear.
+struct ThreadTrace
+{
+    std::mutex mutex;
+    std::vector<TraceEvent> events;
+    uint32_t id = 0;
+};
+
+// Buffers outlive their threads (pool workers and batch stages come and go), so the registry owns them.
+struct TraceRegistry
+{
+    std::mutex mutex;
+    std::vector<std::shared_ptr<ThreadTrace>> threads;
+};
+
+TraceRegistry& registry()
+{
+    static TraceRegistry instance;
+    return instance;
+}
+
+ThreadTrace& this_thread_trace()
+{
+    thread_local std::shared_ptr<ThreadTrace> trace;
+    if (!trace)
+    {
+        trace = std::make_shared<ThreadTrace>();
+        TraceRegistry& reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        trace->id = static_cast<uint32_t>(reg.threads.size());
+        reg.threads.push_back(trace);
+    }
+    return *trace;
+}
+} // namespace
+
+namespace trace_detail
+{
+std::atomic<bool> enabled{ false };
+
+uint64_t now_ns()
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - g_epoch).count());
+}
+
+void record(const char* name, const char* category, std::string&& detail, uint64_t start_ns)
+{
+    const uint64_t end_ns = now_ns();
+    ThreadTrace& trace = this_thread_trace();
+    std::lock_guard<std::mutex> lock(trace.mutex);
+    TraceEvent& event = trace.events.emplace_back();
+    event.name = name;
+    event.category = category;
+    event.detail = std::move(detail);
+    event.start_ns = start_ns;
+    event.duration_ns = end_ns - start_ns;
+    event.thread = trace.id;
+}
+} // namespace trace_detail
+
+void set_tracing_enabled(bool enabled)
+{
+    trace_detail::enabled.store(enabled, std::memory_order_relaxed);
+}
+
+void clear_trace()
+{
+    TraceRegistry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    for (const std::shared_ptr<ThreadTrace>& trace : reg.threads)
+    {
+        std::lock_guard<std::mutex> thread_lock(trace->mutex);
+        trace->events.clear();
+    }
+}
+
+std::vector<TraceEvent> collect_trace()
+{
+    std::vector<TraceEvent> events;
+    {
+        TraceRegistry& reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        for (const std::shared_ptr<ThreadTrace>& trace : reg.threads)
+        {
+            std::lock_guard<std::mutex> thread_lock(trace->mutex);
+            events.insert(events.end(), trace->events.begin(), trace->events.end());
+        }
+    }
+    std::stable_sort(events.begin(), events.end(),
+                     [](const TraceEvent& a, const TraceEvent& b) { return a.start_ns < b.start_ns; });
+    return events;
+}
+
+void write_chrome_trace(const std::string& path, const std::vector<TraceEvent>& events)
+{
+    JsonValue list = JsonValue::array();
+    uint32_t threads = 0;
+    for (const TraceEvent& e : events)
+    {
+        JsonValue entry = JsonValue::object();
+        entry["name"] = e.name;
+        entry["cat"] = e.category;
+        entry["ph"] = "X";
+        entry["ts"] = static_cast<double>(e.start_ns) / 1e3; // microseconds
+        entry["dur"] = static_cast<double>(e.duration_ns) / 1e3;
+        entry["pid"] = 1;
+        entry["tid"] = e.thread;
+        if (!e.detail.empty()) entry["args"]["detail"] = e.detail;
+        list.push_back(std::move(entry));
+        threads = std::max(threads, e.thread + 1);
+    }
+    for (uint32_t t = 0; t < threads; ++t)
+    {
+        JsonValue meta = JsonValue::object();
+        meta["name"] = "thread_name";
+        meta["ph"] = "M";
+        meta["pid"] = 1;
+        meta["tid"] = t;
+        meta["args"]["name"] = "thread " + std::to_string(t);
+        list.push_back(std::move(meta));
+    }
+
+    JsonValue root = JsonValue::object();
+    root["traceEvents"] = std::move(list);
+    root["displayTimeUnit"] = "ms";
+
+    std::ofstream out(path, std::ios::binary);
+    out << root.dump() << "\n";
+    if (!out) throw std::runtime_error("Failed to write " + path);
+}
+
+std::vector<TraceTotal> summarize_trace(const std::vector<TraceEvent>& events)
+{
+    std::vector<TraceTotal> totals;
+    std::unordered_map<std::string, size_t> index; // keyed by text: equal literals need not share an address
+    for (const TraceEvent& e : events)
+    {
+        const auto [it, inserted] = index.try_emplace(std::string(e.category) + '/' + e.name, totals.size());
+        if (inserted) totals.push_back({ e.name, e.category, 0, 0.0 });
+        TraceTotal& total = totals[it->second];
+        ++total.count;
+        total.total_ms += static_cast<double>(e.duration_ns) / 1e6;
+    }
+    return totals;
+}
@@ -0,0 +1,81 @@
+// src/core/trace.h
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Scoped-span tracing: where a job spends its time across load, each filter stage, allocations,
+// host-device transfers and encode. Spans are recorded into per-thread buffers, so recording never
+// contends; while tracing is off a span is one relaxed atomic load and nothing else.
+struct TraceEvent
+{
+    const char* name = "";     // string literal
+    const char* category = ""; // "io", "codec", "filter", "alloc", "copy", "transfer", "kernel" or "cache"
+    std::string detail;        // optional, e.g. the chain or path
+    uint64_t start_ns = 0;     // since the process started
+    uint64_t duration_ns = 0;
+    uint32_t thread = 0;       // 0 for the first thread that traced, then 1, 2, ...
+};
+
+namespace trace_detail
+{
+extern std::atomic<bool> enabled;
+uint64_t now_ns();
+void record(const char* name, const char* category, std::string&& detail, uint64_t start_ns);
+} // namespace trace_detail
+
+inline bool tracing_enabled()
+{
+    return trace_detail::enabled.load(std::memory_order_relaxed);
+}
+
+void set_tracing_enabled(bool enabled);
+
+// Drops every recorded span, e.g. before the run a breakdown should cover.
+void clear_trace();
+
+// Snapshot of the spans recorded so far on every thread, ordered by start time.
+std::vector<TraceEvent> collect_trace();
+
+// Writes Chrome trace-event JSON ("X" events), viewable in chrome://tracing or Perfetto.
+void write_chrome_trace(const std::string& path, const std::vector<TraceEvent>& events);
+
+// Time per span name, in order of first appearance. Spans nest (a pipeline contains its stages) and
+// run on several threads at once, so totals are busy time and need not add up to wall time.
+struct TraceTotal
+{
+    const char* name = "";
+    const char* category = "";
+    int count = 0;
+    double total_ms = 0.0;
+};
+std::vector<TraceTotal> summarize_trace(const std::vector<TraceEvent>& events);
+
+// Records [construction, destruction) as one span when tracing was on at construction.
+class TraceSpan
+{
+public:
+    TraceSpan(const char* name, const char* category) : name_(name), category_(category), active_(tracing_enabled())
+    {
+        if (active_) start_ns_ = trace_detail::now_ns();
+    }
+    ~TraceSpan()
+    {
+        if (active_) trace_detail::record(name_, category_, std::move(detail_), start_ns_);
+    }
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+    // Check before building a detail string, so disabled tracing never formats one.
+    bool active() const { return active_; }
+    void set_detail(std::string detail) { detail_ = std::move(detail); }
+
+private:
+    const char* name_;
+    const char* category_;
+    bool active_;
+    uint64_t start_ns_ = 0;
+    std::string detail_;
+};
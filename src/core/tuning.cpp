@@ -0,0 +1,422 @@
+// src/core/tuning.cpp
+#include "tuning.h"
+
+#include "backend.h"
+#include "image.h"
+#include "json.h"
+#include "thread_pool.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+constexpr int kKindCount = static_cast<int>(FilterKind::Equalize) + 1;
+
+// Full settings per filter kind and bucket, derived from the entries. Replaced tables are never
+// freed: the filter path reads the pointer without a lock, and replacements are rare and small.
+struct TuneTable
+{
+    std::array<std::array<TuneParams, kTuneBuckets>, kKindCount> params{};
+    std::vector<TuneEntry> entries;
+};
+
+std::atomic<const TuneTable*> g_table{ nullptr };
+const TuneParams kDefaults{};
+
+thread_local const TuneParams* t_current = nullptr;
+thread_local bool t_pinned = false;
+
+const TuneTable* table()
+{
+    const TuneTable* t = g_table.load(std::memory_order_acquire);
+    if (t) return t;
+    init_tuning();
+    return g_table.load(std::memory_order_acquire);
+}
+
+bool is_plausible(const TuneParams& p)
+{
+    return p.chunk_bytes >= 1024 && p.band_bytes >= 1024 && p.cpu_tasks >= 0 && p.simd >= -1 &&
+           p.simd <= static_cast<int>(SimdLevel::AVX512) && p.block_x > 0 && p.block_y > 0 &&
+           p.block_x * p.block_y <= 1024 && p.block_1d > 0 && p.block_1d <= 1024 && p.block_1d % 32 == 0;
+}
+
+const char* const kBucketNames[kTuneBuckets] = { "<256^2", "<512^2", "<1024^2", "<2048^2", "<4096^2", ">=4096^2" };
+
+FilterKind kind_from_name(const std::string& name)
+{
+    for (int k = 0; k < kKindCount; ++k)
+    {
+        if (name == filter_kind_name(static_cast<FilterKind>(k))) return static_cast<FilterKind>(k);
+    }
+    throw std::runtime_error("Unknown filter in tuning file: " + name);
+}
+
+// ---- file format -------------------------------------------------------------------------------
+
+JsonValue entry_json(const TuneEntry& e)
+{
+    JsonValue out = JsonValue::object();
+    out["filter"] = filter_kind_name(e.kind);
+    out["bucket"] = e.bucket;
+    out["chunk_bytes"] = e.params.chunk_bytes;
+    out["band_bytes"] = e.params.band_bytes;
+    out["cpu_tasks"] = e.params.cpu_tasks;
+    out["simd"] = e.params.simd < 0 ? "any" : simd_level_name(static_cast<SimdLevel>(e.params.simd));
+    out["block_x"] = e.params.block_x;
+    out["block_y"] = e.params.block_y;
+    out["block_1d"] = e.params.block_1d;
+    out["ms"] = std::round(e.seconds * 1e6) / 1e3;
+    out["default_ms"] = std::round(e.default_seconds * 1e6) / 1e3;
+    return out;
+}
+
+int simd_from_name(const std::string& name)
+{
+    if (name == "any") return -1;
+    for (SimdLevel level : { SimdLevel::Scalar, SimdLevel::SSE41, SimdLevel::AVX2, SimdLevel::AVX512 })
+    {
+        if (name == simd_level_name(level)) return static_cast<int>(level);
+    }
+    throw std::runtime_error("Unknown SIMD level in tuning file: " + name);
+}
+
+TuneEntry entry_from_json(const JsonValue& v)
+{
+    TuneEntry e;
+    e.kind = kind_from_name(v["filter"].as_string());
+    e.bucket = static_cast<int>(v["bucket"].as_number());
+    e.params.chunk_bytes = static_cast<size_t>(v["chunk_bytes"].as_number());
+    e.params.band_bytes = static_cast<size_t>(v["band_bytes"].as_number());
+    e.params.cpu_tasks = static_cast<int>(v["cpu_tasks"].as_number());
+    e.params.simd = simd_from_name(v["simd"].as_string());
+    e.params.block_x = static_cast<int>(v["block_x"].as_number());
+    e.params.block_y = static_cast<int>(v["block_y"].as_number());
+    e.params.block_1d = static_cast<int>(v["block_1d"].as_number());
+    if (const JsonValue* ms = v.find("ms")) e.seconds = ms->as_number() / 1e3;
+    if (const JsonValue* ms = v.find("default_ms")) e.default_seconds = ms->as_number() / 1e3;
+    if (e.bucket < 0 || e.bucket >= kTuneBuckets || !is_plausible(e.params))
+        throw std::runtime_error(std::string("Bad tuning entry for ") + filter_kind_name(e.kind));
+    return e;
+}
+
+// ---- autotuner ---------------------------------------------------------------------------------
+
+// Best of several runs of `chain` with `params` pinned, each on a fresh copy of `frame`. Small frames
+// get more runs, so each measurement spans a few milliseconds at least.
+double time_params(Backend backend, const Image& frame, Image& work, const FilterChain& chain, const TuneParams& params)
+{
+    using Clock = std::chrono::steady_clock;
+    TuneScope scope(params);
+    convert_pixels(frame, work);
+    run_pipeline(work, chain, backend); // warm-up
+    double best = std::numeric_limits<double>::max();
+    double total = 0.0;
+    for (int run = 0; run < 20 && (run < 3 || total < 0.02); ++run)
+    {
+        convert_pixels(frame, work);
+        const Clock::time_point start = Clock::now();
+        run_pipeline(work, chain, backend);
+        const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        best = std::min(best, seconds);
+        total += seconds;
+    }
+    return best;
+}
+
+// Replaces `best` with `trial` if the trial is repeatably faster. A candidate has to win clearly, and
+// ties keep the earlier (default) setting. One best-of-N timing that wins by a few percent can still
+// be noise (a slow run of the incumbent, a busy core), so a candidate that wins once is timed against
+// the incumbent again, alternating, and must beat the incumbent's best time so far in every rematch.
+void take_if_faster(TuneParams& best, double& best_seconds, const TuneParams& trial,
+                    const std::function<double(const TuneParams&)>& time)
+{
+    constexpr int kRematches = 2;
+    double seconds = time(trial);
+    if (seconds >= best_seconds * 0.97) return;
+    double incumbent = best_seconds;
+    for (int round = 0; round < kRematches; ++round)
+    {
+        incumbent = std::min(incumbent, time(best));
+        const double rematch = time(trial);
+        if (rematch >= incumbent * 0.97) return;
+        seconds = std::min(seconds, rematch);
+    }
+    best = trial;
+    best_seconds = seconds;
+}
+
+// Tries each candidate for one setting on top of `best`, keeping the fastest.
+template <typename T>
+void search(TuneParams& best, double& best_seconds, const std::vector<T>& candidates, T TuneParams::*field,
+            const std::function<double(const TuneParams&)>& time)
+{
+    for (const T& value : candidates)
+    {
+        if (best.*field == value) continue;
+        TuneParams trial = best;
+        trial.*field = value;
+        take_if_faster(best, best_seconds, trial, time);
+    }
+}
+
+const std::vector<std::string> kDefaultChains = { "invert",   "blur:2",    "gaussian:3", "sobel",
+                                                  "canny",    "sharpen",   "laplacian",  "emboss",
+                                                  "gaussian5", "autolevels", "equalize" };
+} // namespace
+
+int tune_bucket(int width, int height)
+{
+    const uint64_t pixels = static_cast<uint64_t>(std::max(width, 0)) * static_cast<uint64_t>(std::max(height, 0));
+    int bucket = 0;
+    for (uint64_t limit = 256 * 256; bucket < kTuneBuckets - 1 && pixels >= limit; limit *= 4) ++bucket;
+    return bucket;
+}
+
+const char* tune_bucket_name(int bucket)
+{
+    return kBucketNames[std::clamp(bucket, 0, kTuneBuckets - 1)];
+}
+
+FilterKind tune_kind(const FilterChain& chain)
+{
+    for (const FilterStep& step : chain)
+    {
+        if (!is_point_op(step.kind)) return step.kind;
+    }
+    return FilterKind::Invert;
+}
+
+const TuneParams& tuned_params(const FilterChain& chain, int width, int height)
+{
+    const TuneTable* t = table();
+    if (!t) return kDefaults;
+    return t->params[static_cast<int>(tune_kind(chain))][tune_bucket(width, height)];
+}
+
+const TuneParams& current_tuning()
+{
+    return t_current ? *t_current : kDefaults;
+}
+
+SimdLevel tuned_simd_level()
+{
+    const SimdLevel active = active_simd_level();
+    const int cap = current_tuning().simd;
+    return cap < 0 ? active : std::min(active, static_cast<SimdLevel>(cap));
+}
+
+TuneScope::TuneScope(const TuneParams& params) : previous_(t_current), previous_pinned_(t_pinned)
+{
+    t_current = &params;
+    t_pinned = true;
+}
+
+TuneScope::TuneScope(const FilterChain& chain, int width, int height) : previous_(t_current), previous_pinned_(t_pinned)
+{
+    if (!t_pinned) t_current = &tuned_params(chain, width, height);
+}
+
+TuneScope::~TuneScope()
+{
+    t_current = previous_;
+    t_pinned = previous_pinned_;
+}
+
+void install_tuning(const std::vector<TuneEntry>& entries)
+{
+    auto t = std::make_unique<TuneTable>();
+    t->entries = entries;
+    for (int k = 0; k < kKindCount; ++k)
+    {
+        std::array<const TuneEntry*, kTuneBuckets> tuned{};
+        for (const TuneEntry& e : entries)
+        {
+            if (static_cast<int>(e.kind) == k && e.bucket >= 0 && e.bucket < kTuneBuckets) tuned[e.bucket] = &e;
+        }
+        for (int b = 0; b < kTuneBuckets; ++b)
+        {
+            // Nearest tuned bucket, preferring the smaller one on a tie.
+            const TuneEntry* nearest = nullptr;
+            for (int d = 0; d < kTuneBuckets && !nearest; ++d)
+            {
+                if (b - d >= 0 && tuned[b - d]) nearest = tuned[b - d];
+                else if (b + d < kTuneBuckets && tuned[b + d]) nearest = tuned[b + d];
+            }
+            if (nearest) t->params[k][b] = nearest->params;
+        }
+    }
+    g_table.store(t.release(), std::memory_order_release);
+}
+
+std::vector<TuneEntry> installed_tuning()
+{
+    const TuneTable* t = g_table.load(std::memory_order_acquire);
+    return t ? t->entries : std::vector<TuneEntry>{};
+}
+
+std::string default_tuning_path()
+{
+    if (const char* file = std::getenv("CUDAPIX_TUNE_FILE")) return file;
+    fs::path dir;
+    if (const char* xdg = std::getenv("XDG_CACHE_HOME"); xdg && *xdg)
+        dir = xdg;
+    else if (const char* home = std::getenv("HOME"); home && *home)
+        dir = fs::path(home) / ".cache";
+    else
+        return {};
+    char host[256] = {};
+    if (gethostname(host, sizeof(host) - 1) != 0 || !host[0]) std::snprintf(host, sizeof(host), "localhost");
+    return (dir / "cudapix" / (std::string("tune-") + host + ".json")).string();
+}
+
+std::string host_fingerprint()
+{
+    std::ostringstream out;
+    out << std::thread::hardware_concurrency() << " threads, " << simd_level_name(detect_simd_level()) << ", ";
+    const std::vector<BackendInfo> registry = backend_registry();
+    const auto cuda = std::find_if(registry.begin(), registry.end(),
+                                   [](const BackendInfo& info) { return info.backend == Backend::Cuda; });
+    out << (cuda != registry.end() && cuda->available ? cuda->description : std::string("no cuda"));
+    return out.str();
+}
+
+void save_tuning(const std::vector<TuneEntry>& entries, const std::string& path)
+{
+    if (path.empty()) throw std::runtime_error("No tuning file path (HOME unset or CUDAPIX_TUNE_FILE empty)");
+    JsonValue root = JsonValue::object();
+    root["fingerprint"] = host_fingerprint();
+    JsonValue list = JsonValue::array();
+    for (const TuneEntry& e : entries) list.push_back(entry_json(e));
+    root["entries"] = std::move(list);
+
+    const fs::path target(path);
+    if (target.has_parent_path()) fs::create_directories(target.parent_path());
+    // Written beside the target and renamed over it, so a concurrent reader never sees half a file.
+    const fs::path temp = target.string() + ".tmp";
+    {
+        std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+        out << root.dump(2) << "\n";
+        if (!out) throw std::runtime_error("Failed to write tuning file " + temp.string());
+    }
+    fs::rename(temp, target);
+}
+
+bool load_tuning(const std::string& path)
+{
+    if (path.empty()) return false;
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return false;
+    std::ostringstream text;
+    text << in.rdbuf();
+    try
+    {
+        const JsonValue root = parse_json(text.str());
+        if (root["fingerprint"].as_string() != host_fingerprint()) return false; // another machine type
+        std::vector<TuneEntry> entries;
+        for (const JsonValue& v : root["entries"].elements()) entries.push_back(entry_from_json(v));
+        install_tuning(entries);
+        return true;
+    }
+    catch (const std::exception&)
+    {
+        return false; // a damaged cache is ignored like a missing one; autotune rewrites it
+    }
+}
+
+bool init_tuning()
+{
+    static std::once_flag once;
+    static bool loaded = false;
+    std::call_once(once, [] {
+        loaded = load_tuning();
+        // Untuned hosts still get a table, so later lookups skip this call.
+        if (!loaded && !g_table.load()) install_tuning({});
+    });
+    return loaded;
+}
+
+std::vector<TuneEntry> autotune(const AutotuneOptions& options)
+{
+    TraceSpan span("autotune", "filter");
+    const bool tracing = tracing_enabled();
+    set_tracing_enabled(false); // traced kernels synchronize after every launch
+    const bool cuda = options.cuda && backend_available(Backend::Cuda);
+
+    std::vector<int> simd_levels;
+    for (int level = 0; level <= static_cast<int>(active_simd_level()); ++level) simd_levels.push_back(level);
+    const std::vector<size_t> chunk_sizes = { 16 << 10, 32 << 10, 128 << 10, 256 << 10, 1 << 20 };
+    const std::vector<size_t> band_sizes = { 128 << 10, 256 << 10, 1 << 20, 2 << 20 };
+    std::vector<int> task_limits;
+    const int threads = cpu_thread_count();
+    for (int n = threads / 2; n >= 1; n /= 2) task_limits.push_back(n);
+    const std::vector<std::pair<int, int>> blocks_2d = { { 32, 8 }, { 32, 4 }, { 64, 4 }, { 32, 16 }, { 8, 8 } };
+    const std::vector<int> blocks_1d = { 128, 512, 1024 };
+
+    std::vector<TuneEntry> entries;
+    const std::vector<std::string>& chains = options.chains.empty() ? kDefaultChains : options.chains;
+    for (const std::string& spec : chains)
+    {
+        const FilterChain chain = parse_filter_chain(spec);
+        const bool stencils = std::any_of(chain.begin(), chain.end(), [](const FilterStep& s) { return filter_halo(s) > 0; });
+        for (int side : options.sides)
+        {
+            const Image frame = noise_frame(side);
+            Image work = allocate_image(side, side, 3);
+            TuneEntry entry;
+            entry.kind = tune_kind(chain);
+            entry.bucket = tune_bucket(side, side);
+
+            auto cpu_time = [&](const TuneParams& p) { return time_params(Backend::Cpu, frame, work, chain, p); };
+            TuneParams best;
+            double best_seconds = cpu_time(best);
+            entry.default_seconds = best_seconds;
+            // The default SIMD level is the highest; trying the lower ones catches kernels that are
+            // memory-bound or down-clock the core.
+            search(best, best_seconds, simd_levels, &TuneParams::simd, cpu_time);
+            search(best, best_seconds, chunk_sizes, &TuneParams::chunk_bytes, cpu_time);
+            if (stencils) search(best, best_seconds, band_sizes, &TuneParams::band_bytes, cpu_time);
+            search(best, best_seconds, task_limits, &TuneParams::cpu_tasks, cpu_time);
+            entry.seconds = best_seconds;
+
+            if (cuda)
+            {
+                // Launch shapes only matter on the GPU path, which is timed on its own.
+                auto gpu_time = [&](const TuneParams& p) { return time_params(Backend::Cuda, frame, work, chain, p); };
+                double gpu_seconds = gpu_time(best);
+                for (const auto& [bx, by] : blocks_2d)
+                {
+                    TuneParams trial = best;
+                    trial.block_x = bx;
+                    trial.block_y = by;
+                    take_if_faster(best, gpu_seconds, trial, gpu_time);
+                }
+                search(best, gpu_seconds, blocks_1d, &TuneParams::block_1d, gpu_time);
+            }
+
+            entry.params = best;
+            entries.push_back(entry);
+            if (options.progress) options.progress(entry);
+        }
+    }
+    set_tracing_enabled(tracing);
+    return entries;
+}
@@ -0,0 +1,109 @@
+// src/core/tuning.h
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "cpu_features.h"
+#include "filter_chain.h"
+
+// Per-host tuning of the settings the filters would otherwise hard-code: how the CPU pipeline cuts a
+// frame into tasks and bands, how many pool threads one call may occupy, the SIMD level it dispatches
+// to and the CUDA launch shapes. run_pipeline() looks the settings up per filter and frame-size
+// bucket in a table that autotune() fills and a per-host cache file restores. A lookup is a plain
+// table read; nothing is ever timed on the filter path. Every setting yields the same output bytes.
+struct TuneParams
+{
+    size_t chunk_bytes = 64 * 1024; // parallel_for_rows() task size
+    size_t band_bytes = 512 * 1024; // working band of cpu_pipeline() for chains with stencils
+    int cpu_tasks = 0;              // pool tasks one call may run at once; 0: all threads
+    int simd = -1;                  // cap on the SimdLevel (cpu_features.h); -1: none
+    int block_x = 16;               // 2D CUDA kernels (those without a fixed shared-memory tile)
+    int block_y = 16;
+    int block_1d = 256; // 1D grid-stride CUDA kernels (point programs, histograms, box passes)
+};
+
+// Frame-size buckets by pixel count, each 4x the previous: < 256x256, < 512x512, < 1024x1024,
+// < 2048x2048, < 4096x4096 and larger.
+constexpr int kTuneBuckets = 6;
+int tune_bucket(int width, int height);
+const char* tune_bucket_name(int bucket); // "<256^2", ..., ">=4096^2"
+
+// Filter a chain is tuned as: its first step that is not a point op, or Invert for point-only
+// chains, which all run as the same fused table pass.
+FilterKind tune_kind(const FilterChain& chain);
+
+// Settings for `chain` on a width x height frame; defaults where nothing was tuned.
+const TuneParams& tuned_params(const FilterChain& chain, int width, int height);
+
+// Settings the CPU and CUDA filters read: the innermost TuneScope on this thread, else the defaults.
+// Pool workers do not inherit a scope; parallel_for_rows() reinstalls the caller's settings in each
+// band, and code that calls ThreadPool::parallel_for() directly must capture them itself.
+const TuneParams& current_tuning();
+// active_simd_level() lowered to current_tuning().simd.
+SimdLevel tuned_simd_level();
+
+// While alive, current_tuning() on the constructing thread returns the given settings. The
+// (chain, size) form, used by run_pipeline(), applies tuned_params() unless an enclosing scope
+// pinned explicit settings, so the autotuner's candidates are not replaced by the table. Scopes nest.
+class TuneScope
+{
+public:
+    explicit TuneScope(const TuneParams& params);
+    TuneScope(const FilterChain& chain, int width, int height);
+    ~TuneScope();
+
+    TuneScope(const TuneScope&) = delete;
+    TuneScope& operator=(const TuneScope&) = delete;
+
+private:
+    const TuneParams* previous_;
+    bool previous_pinned_;
+};
+
+struct TuneEntry
+{
+    FilterKind kind = FilterKind::Invert;
+    int bucket = 0;
+    TuneParams params;
+    double seconds = 0.0;         // best run with these settings
+    double default_seconds = 0.0; // best run with the defaults, for reporting the gain
+};
+
+// Replaces the table. Buckets without an entry take the settings of the nearest tuned bucket of the
+// same filter; filters without entries use the defaults.
+void install_tuning(const std::vector<TuneEntry>& entries);
+std::vector<TuneEntry> installed_tuning();
+
+// Cache file: $CUDAPIX_TUNE_FILE if set (empty disables the file), else
+// $XDG_CACHE_HOME/cudapix/tune-<hostname>.json, with ~/.cache when XDG_CACHE_HOME is unset.
+std::string default_tuning_path();
+// Identifies the machine type a table was measured on: hardware threads, SIMD level and CUDA device.
+std::string host_fingerprint();
+
+// Writes the entries with this host's fingerprint. Throws std::runtime_error.
+void save_tuning(const std::vector<TuneEntry>& entries, const std::string& path = default_tuning_path());
+// Reads and installs a cache file. Returns false, leaving the table alone, when the file is missing,
+// unreadable or was written for another fingerprint.
+bool load_tuning(const std::string& path = default_tuning_path());
+// Loads the default cache file once per process (later calls return the first result). The first
+// tuned_params() call does this, so a process reads the file once, before its first filter runs.
+bool init_tuning();
+
+struct AutotuneOptions
+{
+    // Chains to tune, one per filter; empty: one representative chain for every kind of pass.
+    std::vector<std::string> chains;
+    // Frame sides to time, one square noise frame per bucket.
+    std::vector<int> sides = { 128, 256, 512, 1024, 2048, 4096 };
+    bool cuda = true;                                // also tune launch shapes when a GPU is available
+    std::function<void(const TuneEntry&)> progress; // after each (filter, size)
+};
+
+// Searches the settings one at a time (SIMD level, task size, band size, tasks per call, then the
+// CUDA block shapes), keeping each winner before moving on to the next, and returns the best
+// settings per filter and bucket. Runs the filters on the CPU pool (and the GPU), so nothing else
+// should be filtering meanwhile. Does not install or save the result.
+std::vector<TuneEntry> autotune(const AutotuneOptions& options = {});
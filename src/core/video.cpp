@@ -0,0 +1,671 @@
+// src/core/video.cpp
+#include "video.h"
+
+#include "bounded_queue.h"
+#include "codecs.h"
+#include "thread_pool.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+// stdin / stdout are borrowed, not closed.
+struct FileCloser
+{
+    void operator()(std::FILE* f) const
+    {
+        if (f != stdin && f != stdout) std::fclose(f);
+    }
+};
+using FilePtr = std::unique_ptr<std::FILE, FileCloser>;
+
+// A 4K RGB frame is 24 MiB; large stdio buffers keep the number of read/write calls per frame low.
+constexpr size_t kIoBufferBytes = size_t(4) << 20;
+constexpr char kY4mSignature[] = "YUV4MPEG2";
+constexpr size_t kSignatureBytes = sizeof(kY4mSignature) - 1;
+
+FilePtr open_stream(const std::string& path, bool input)
+{
+    FilePtr file(path == "-" ? (input ? stdin : stdout) : std::fopen(path.c_str(), input ? "rb" : "wb"));
+    if (!file) throw std::runtime_error("Failed to open " + path);
+    std::setvbuf(file.get(), nullptr, _IOFBF, kIoBufferBytes); // no effect once the stream was used
+    return file;
+}
+
+bool is_numbered(const std::string& path)
+{
+    return path.find('%') != std::string::npos;
+}
+
+// Expands a numbered pattern. Exactly one conversion is allowed, %d with optional zero padding and
+// width ("%05d"), so the pattern can go to snprintf safely.
+std::string numbered_path(const std::string& pattern, int index)
+{
+    const size_t pos = pattern.find('%');
+    size_t end = pos + 1;
+    if (end < pattern.size() && pattern[end] == '0') ++end;
+    while (end < pattern.size() && std::isdigit(static_cast<unsigned char>(pattern[end]))) ++end;
+    if (end >= pattern.size() || pattern[end] != 'd' || pattern.find('%', end) != std::string::npos)
+    {
+        throw std::invalid_argument("Frame pattern needs exactly one %d (e.g. frame_%05d.png): " + pattern);
+    }
+    char buffer[4096];
+    std::snprintf(buffer, sizeof(buffer), pattern.c_str(), index);
+    return buffer;
+}
+
+// Reads exactly `bytes`, returning false on a clean end of input (nothing read) and throwing on a
+// partial frame.
+bool read_exact(std::FILE* file, void* dst, size_t bytes, const char* what)
+{
+    const size_t got = std::fread(dst, 1, bytes, file);
+    if (got == bytes) return true;
+    if (got == 0 && std::feof(file)) return false;
+    throw std::runtime_error(std::string("Truncated ") + what + " (" + std::to_string(got) + " of " +
+                             std::to_string(bytes) + " bytes)");
+}
+
+void write_exact(std::FILE* file, const void* src, size_t bytes)
+{
+    if (std::fwrite(src, 1, bytes, file) != bytes) throw std::runtime_error("Failed to write frame data");
+}
+
+// Frames are always 3-channel; a recycled buffer of the right size is kept, anything else replaced.
+void ensure_frame(Image& frame, int width, int height)
+{
+    if (frame.width == width && frame.height == height && frame.channels == 3 && !frame.pixels.empty()) return;
+    frame = allocate_image(width, height, 3);
+}
+
+// ---- YUV <-> RGB, BT.601 studio range in 8-bit fixed point --------------------------------------
+
+inline uint8_t clamp_byte(int v)
+{
+    return static_cast<uint8_t>(v < 0 ? 0 : (v > 255 ? 255 : v));
+}
+
+inline void yuv_to_rgb(int y, int u, int v, uint8_t* px)
+{
+    const int c = 298 * (y - 16) + 128;
+    const int d = u - 128;
+    const int e = v - 128;
+    px[0] = clamp_byte((c + 409 * e) >> 8);
+    px[1] = clamp_byte((c - 100 * d - 208 * e) >> 8);
+    px[2] = clamp_byte((c + 516 * d) >> 8);
+}
+
+inline uint8_t rgb_to_y(int r, int g, int b)
+{
+    return static_cast<uint8_t>(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+}
+
+// From channel sums over a 2^shift pixel block, so subsampled chroma averages its block first.
+inline uint8_t rgb_to_u(int r, int g, int b, int shift)
+{
+    return clamp_byte((((-38 * r - 74 * g + 112 * b) >> shift) + 128 + (128 << 8)) >> 8);
+}
+
+inline uint8_t rgb_to_v(int r, int g, int b, int shift)
+{
+    return clamp_byte((((112 * r - 94 * g - 18 * b) >> shift) + 128 + (128 << 8)) >> 8);
+}
+
+// Planar Y4M frame geometry: chroma planes are subsampled by 2^shift_x horizontally and 2^shift_y
+// vertically, rounding up for odd sizes.
+struct PlaneLayout
+{
+    int width = 0;
+    int height = 0;
+    int shift_x = 0;
+    int shift_y = 0;
+    bool chroma = true;
+
+    PlaneLayout(const VideoFormat& format) : width(format.width), height(format.height)
+    {
+        shift_x = format.chroma == Y4mChroma::C420 || format.chroma == Y4mChroma::C422 ? 1 : 0;
+        shift_y = format.chroma == Y4mChroma::C420 ? 1 : 0;
+        chroma = format.chroma != Y4mChroma::Mono;
+    }
+    int chroma_width() const { return (width + (1 << shift_x) - 1) >> shift_x; }
+    int chroma_height() const { return (height + (1 << shift_y) - 1) >> shift_y; }
+    size_t luma_bytes() const { return static_cast<size_t>(width) * height; }
+    size_t chroma_bytes() const { return chroma ? static_cast<size_t>(chroma_width()) * chroma_height() : 0; }
+    size_t frame_bytes() const { return luma_bytes() + 2 * chroma_bytes(); }
+};
+
+const char* chroma_tag(Y4mChroma chroma)
+{
+    switch (chroma)
+    {
+    case Y4mChroma::C420: return "420jpeg";
+    case Y4mChroma::C422: return "422";
+    case Y4mChroma::C444: return "444";
+    case Y4mChroma::Mono: return "mono";
+    }
+    return "420jpeg";
+}
+
+Y4mChroma parse_chroma(const std::string& tag)
+{
+    if (tag == "420jpeg" || tag == "420paldv" || tag == "420mpeg2" || tag == "420") return Y4mChroma::C420;
+    if (tag == "422") return Y4mChroma::C422;
+    if (tag == "444") return Y4mChroma::C444;
+    if (tag == "mono") return Y4mChroma::Mono;
+    throw std::runtime_error("Unsupported Y4M colour space C" + tag + " (8-bit 420, 422, 444 and mono only)");
+}
+
+// A header or FRAME line, without the '\n'. Empty with *eof set at a clean end of input.
+std::string read_line(std::FILE* file, bool* eof)
+{
+    std::string line;
+    for (;;)
+    {
+        const int c = std::fgetc(file);
+        if (c == EOF)
+        {
+            if (!line.empty() || !eof) throw std::runtime_error("Truncated Y4M header");
+            *eof = true;
+            return line;
+        }
+        if (c == '\n') return line;
+        line.push_back(static_cast<char>(c));
+        if (line.size() > 4096) throw std::runtime_error("Y4M header line too long");
+    }
+}
+
+// ---- Readers -------------------------------------------------------------------------------------
+
+class Y4mReader : public FrameReader
+{
+public:
+    // `file` is positioned just past the signature.
+    explicit Y4mReader(FilePtr file) : file_(std::move(file))
+    {
+        std::istringstream header(read_line(file_.get(), nullptr));
+        std::string token;
+        while (header >> token)
+        {
+            const std::string value = token.substr(1);
+            switch (token[0])
+            {
+            case 'W': format_.width = std::stoi(value); break;
+            case 'H': format_.height = std::stoi(value); break;
+            case 'C': format_.chroma = parse_chroma(value); break;
+            case 'F':
+                if (std::sscanf(value.c_str(), "%d:%d", &format_.fps_num, &format_.fps_den) != 2 ||
+                    format_.fps_num <= 0 || format_.fps_den <= 0)
+                {
+                    throw std::runtime_error("Bad Y4M frame rate: " + value);
+                }
+                break;
+            default: break; // interlacing, aspect ratio and comments do not matter here
+            }
+        }
+        if (format_.width <= 0 || format_.height <= 0) throw std::runtime_error("Y4M header without a frame size");
+        planes_.resize(PlaneLayout(format_).frame_bytes());
+    }
+
+    bool read_frame(Image& frame) override
+    {
+        bool eof = false;
+        const std::string marker = read_line(file_.get(), &eof);
+        if (eof) return false;
+        if (marker.compare(0, 5, "FRAME") != 0) throw std::runtime_error("Expected a Y4M FRAME marker");
+        {
+            TraceSpan span("read frame", "io");
+            if (!read_exact(file_.get(), planes_.data(), planes_.size(), "Y4M frame"))
+                throw std::runtime_error("Truncated Y4M frame");
+        }
+        ensure_frame(frame, format_.width, format_.height);
+
+        TraceSpan span("yuv to rgb", "codec");
+        const PlaneLayout layout(format_);
+        const uint8_t* y_plane = planes_.data();
+        const uint8_t* u_plane = y_plane + layout.luma_bytes();
+        const uint8_t* v_plane = u_plane + layout.chroma_bytes();
+        const ImageView out(frame);
+        // Locals, not layout fields: the byte stores below may alias anything, which would force the
+        // compiler to reload every field per pixel.
+        const int width = layout.width;
+        const int shift_x = layout.shift_x;
+        const int shift_y = layout.shift_y;
+        const size_t chroma_width = static_cast<size_t>(layout.chroma_width());
+        const bool chroma = layout.chroma;
+        parallel_for_rows(format_.height, static_cast<size_t>(width) * 3, [&](int y0, int y1) {
+            for (int y = y0; y < y1; ++y)
+            {
+                const uint8_t* ys = y_plane + static_cast<size_t>(y) * width;
+                uint8_t* px = out.row(y);
+                if (!chroma)
+                {
+                    for (int x = 0; x < width; ++x) yuv_to_rgb(ys[x], 128, 128, px + x * 3);
+                    continue;
+                }
+                const size_t chroma_row = static_cast<size_t>(y >> shift_y) * chroma_width;
+                const uint8_t* us = u_plane + chroma_row;
+                const uint8_t* vs = v_plane + chroma_row;
+                for (int x = 0; x < width; ++x) yuv_to_rgb(ys[x], us[x >> shift_x], vs[x >> shift_x], px + x * 3);
+            }
+        });
+        return true;
+    }
+
+private:
+    FilePtr file_;
+    std::vector<uint8_t> planes_; // one frame as read, reused
+};
+
+class RawReader : public FrameReader
+{
+public:
+    // `prefix` holds bytes already consumed while sniffing stdin.
+    RawReader(FilePtr file, const VideoInputOptions& options, std::string prefix)
+        : file_(std::move(file)), prefix_(std::move(prefix))
+    {
+        if (options.width <= 0 || options.height <= 0)
+            throw std::invalid_argument("Raw RGB24 input needs the frame size (--size WxH)");
+        format_.width = options.width;
+        format_.height = options.height;
+        format_.fps_num = options.fps_num;
+        format_.fps_den = options.fps_den;
+    }
+
+    bool read_frame(Image& frame) override
+    {
+        ensure_frame(frame, format_.width, format_.height);
+        TraceSpan span("read frame", "io");
+        const ImageView view(frame);
+        const size_t row_bytes = view.row_bytes();
+        if (view.is_packed()) return read(view.data, row_bytes * view.height, true);
+        for (int y = 0; y < view.height; ++y)
+        {
+            if (!read(view.row(y), row_bytes, y == 0)) return false;
+        }
+        return true;
+    }
+
+private:
+    // Like read_exact(), draining the sniffed prefix first; a clean end is only allowed at a frame start.
+    bool read(uint8_t* dst, size_t bytes, bool frame_start)
+    {
+        const size_t from_prefix = std::min(prefix_.size(), bytes);
+        std::memcpy(dst, prefix_.data(), from_prefix);
+        prefix_.erase(0, from_prefix);
+        if (from_prefix == bytes) return true;
+        const bool complete = read_exact(file_.get(), dst + from_prefix, bytes - from_prefix, "RGB24 frame");
+        if (!complete && (from_prefix > 0 || !frame_start)) throw std::runtime_error("Truncated RGB24 frame");
+        return complete;
+    }
+
+    FilePtr file_;
+    std::string prefix_;
+};
+
+// Image files decode into buffers of their own, so only the numbered reader allocates per frame.
+class NumberedReader : public FrameReader
+{
+public:
+    NumberedReader(const std::string& pattern, const VideoInputOptions& options) : pattern_(pattern)
+    {
+        next_ = options.first_frame;
+        if (next_ < 0) next_ = fs::exists(numbered_path(pattern_, 0)) ? 0 : 1;
+        if (!fs::exists(numbered_path(pattern_, next_)))
+            throw std::runtime_error("No frame " + numbered_path(pattern_, next_));
+        pending_ = load(next_++);
+        format_.width = pending_.width;
+        format_.height = pending_.height;
+        format_.fps_num = options.fps_num;
+        format_.fps_den = options.fps_den;
+    }
+
+    bool read_frame(Image& frame) override
+    {
+        if (!pending_.pixels.empty())
+        {
+            frame = std::move(pending_);
+            pending_ = Image{};
+            return true;
+        }
+        const std::string path = numbered_path(pattern_, next_);
+        if (!fs::exists(path)) return false;
+        frame = load(next_++);
+        if (frame.width != format_.width || frame.height != format_.height)
+            throw std::runtime_error(path + " differs in size from the first frame");
+        return true;
+    }
+
+private:
+    Image load(int index)
+    {
+        Image img = load_image(numbered_path(pattern_, index));
+        return img.channels == 3 ? std::move(img) : convert_channels(img, 3);
+    }
+
+    std::string pattern_;
+    int next_ = 0;
+    Image pending_; // the first frame, loaded up front for the size
+};
+
+// ---- Writers -------------------------------------------------------------------------------------
+
+class Y4mWriter : public FrameWriter
+{
+public:
+    Y4mWriter(FilePtr file, const VideoFormat& format) : file_(std::move(file)), format_(format)
+    {
+        planes_.resize(PlaneLayout(format_).frame_bytes());
+        const std::string header = std::string(kY4mSignature) + " W" + std::to_string(format_.width) + " H" +
+                                   std::to_string(format_.height) + " F" + std::to_string(format_.fps_num) + ":" +
+                                   std::to_string(format_.fps_den) + " Ip A1:1 C" + chroma_tag(format_.chroma) + "\n";
+        write_exact(file_.get(), header.data(), header.size());
+    }
+
+    void write_frame(const Image& frame) override
+    {
+        if (frame.width != format_.width || frame.height != format_.height || frame.channels != 3)
+            throw std::invalid_argument("Frame does not match the Y4M stream format");
+        const PlaneLayout layout(format_);
+        {
+            TraceSpan span("rgb to yuv", "codec");
+            uint8_t* y_plane = planes_.data();
+            uint8_t* u_plane = y_plane + layout.luma_bytes();
+            uint8_t* v_plane = u_plane + layout.chroma_bytes();
+            const ConstImageView in(frame);
+            const int width = layout.width;
+            const int height = layout.height;
+            const int shift_x = layout.shift_x;
+            const int shift_y = layout.shift_y;
+            const int chroma_width = layout.chroma_width();
+            const bool chroma = layout.chroma;
+            const int block_w = 1 << shift_x;
+            const int block_h = 1 << shift_y;
+            // One chroma row (block_h luma rows) per step, so every chroma sample is owned by one task.
+            // Blocks cut by an odd frame edge repeat the last row / column, so every block sums
+            // 2^(shift_x + shift_y) samples.
+            const size_t chroma_row_bytes = static_cast<size_t>(width) * 3 * block_h;
+            parallel_for_rows(layout.chroma_height(), chroma_row_bytes, [&](int c0, int c1) {
+                for (int cy = c0; cy < c1; ++cy)
+                {
+                    const int y_end = std::min((cy + 1) * block_h, height);
+                    for (int y = cy * block_h; y < y_end; ++y)
+                    {
+                        const uint8_t* px = in.row(y);
+                        uint8_t* ys = y_plane + static_cast<size_t>(y) * width;
+                        for (int x = 0; x < width; ++x, px += 3) ys[x] = rgb_to_y(px[0], px[1], px[2]);
+                    }
+                    if (!chroma) continue;
+                    uint8_t* us = u_plane + static_cast<size_t>(cy) * chroma_width;
+                    uint8_t* vs = v_plane + static_cast<size_t>(cy) * chroma_width;
+                    const uint8_t* rows[2] = { in.row(cy * block_h), in.row(std::min(cy * block_h + 1, height - 1)) };
+                    for (int cx = 0; cx < chroma_width; ++cx)
+                    {
+                        int r = 0, g = 0, b = 0;
+                        const int x0 = cx * block_w;
+                        for (int dy = 0; dy < block_h; ++dy)
+                        {
+                            for (int dx = 0; dx < block_w; ++dx)
+                            {
+                                const uint8_t* p = rows[dy] + std::min(x0 + dx, width - 1) * 3;
+                                r += p[0];
+                                g += p[1];
+                                b += p[2];
+                            }
+                        }
+                        us[cx] = rgb_to_u(r, g, b, shift_x + shift_y);
+                        vs[cx] = rgb_to_v(r, g, b, shift_x + shift_y);
+                    }
+                }
+            });
+        }
+        TraceSpan span("write frame", "io");
+        write_exact(file_.get(), "FRAME\n", 6);
+        write_exact(file_.get(), planes_.data(), planes_.size());
+    }
+
+    void finish() override
+    {
+        if (std::fflush(file_.get()) != 0) throw std::runtime_error("Failed to flush Y4M output");
+        file_.reset();
+    }
+
+private:
+    FilePtr file_;
+    VideoFormat format_;
+    std::vector<uint8_t> planes_; // one converted frame, reused
+};
+
+class RawWriter : public FrameWriter
+{
+public:
+    explicit RawWriter(FilePtr file) : file_(std::move(file)) {}
+
+    void write_frame(const Image& frame) override
+    {
+        TraceSpan span("write frame", "io");
+        const ConstImageView view(frame);
+        if (view.channels != 3) throw std::invalid_argument("RGB24 output needs 3-channel frames");
+        if (view.is_packed())
+        {
+            write_exact(file_.get(), view.data, view.row_bytes() * view.height);
+            return;
+        }
+        for (int y = 0; y < view.height; ++y) write_exact(file_.get(), view.row(y), view.row_bytes());
+    }
+
+    void finish() override
+    {
+        if (std::fflush(file_.get()) != 0) throw std::runtime_error("Failed to flush RGB24 output");
+        file_.reset();
+    }
+
+private:
+    FilePtr file_;
+};
+
+class NumberedWriter : public FrameWriter
+{
+public:
+    NumberedWriter(const std::string& pattern, const PngOptions& png) : pattern_(pattern), png_(png)
+    {
+        numbered_path(pattern_, 0); // validates the pattern up front
+    }
+
+    void write_frame(const Image& frame) override { save_image(numbered_path(pattern_, next_++), frame, png_); }
+    void finish() override {}
+
+private:
+    std::string pattern_;
+    PngOptions png_;
+    int next_ = 0;
+};
+
+using Clock = std::chrono::steady_clock;
+
+// A frame handed from decode to filter, stamped when decoding finished.
+struct DecodedFrame
+{
+    Image image;
+    Clock::time_point ready;
+};
+
+double seconds_since(Clock::time_point start)
+{
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+} // namespace
+
+std::unique_ptr<FrameReader> open_frame_reader(const std::string& path, const VideoInputOptions& options)
+{
+    if (is_numbered(path)) return std::make_unique<NumberedReader>(path, options);
+    const std::string ext = lower_extension(path);
+    if (path != "-" && ext != ".y4m" && ext != ".rgb" && ext != ".raw")
+        throw std::invalid_argument("Unsupported video input (use -, .y4m, .rgb/.raw or a %d pattern): " + path);
+
+    FilePtr file = open_stream(path, true);
+    if (ext == ".rgb" || ext == ".raw") return std::make_unique<RawReader>(std::move(file), options, std::string());
+
+    // Sniff the signature; on stdin anything else is raw RGB24 that starts with the bytes just read.
+    std::string signature(kSignatureBytes, '\0');
+    signature.resize(std::fread(signature.data(), 1, kSignatureBytes, file.get()));
+    if (signature == kY4mSignature)
+    {
+        if (std::fgetc(file.get()) != ' ') throw std::runtime_error("Bad Y4M header in " + path);
+        return std::make_unique<Y4mReader>(std::move(file));
+    }
+    if (path != "-") throw std::runtime_error("Not a Y4M stream: " + path);
+    return std::make_unique<RawReader>(std::move(file), options, signature);
+}
+
+std::unique_ptr<FrameWriter> open_frame_writer(const std::string& path, const VideoFormat& format, bool raw_output,
+                                               const PngOptions& png)
+{
+    if (is_numbered(path)) return std::make_unique<NumberedWriter>(path, png);
+    const std::string ext = lower_extension(path);
+    const bool raw = path == "-" ? raw_output : ext == ".rgb" || ext == ".raw";
+    if (raw) return std::make_unique<RawWriter>(open_stream(path, false));
+    if (path == "-" || ext == ".y4m") return std::make_unique<Y4mWriter>(open_stream(path, false), format);
+    throw std::invalid_argument("Unsupported video output (use -, .y4m, .rgb/.raw or a %d pattern): " + path);
+}
+
+VideoStats run_video(FrameReader& reader, FrameWriter& writer, const VideoOptions& options)
+{
+    VideoStats stats;
+    const Clock::time_point start = Clock::now();
+    const size_t depth = std::max<size_t>(options.queue_depth, 1);
+
+    // Every frame buffer in flight: one per queue slot plus the one each stage is working on. They
+    // are allocated by the reader on first use and then circulate through `free_frames`.
+    const size_t buffers = 2 * depth + 3;
+    BoundedQueue<Image> free_frames(buffers);
+    for (size_t i = 0; i < buffers; ++i) free_frames.push(Image{});
+    BoundedQueue<DecodedFrame> decoded(depth);
+    BoundedQueue<Image> filtered(depth);
+
+    // Read by the progress callback while the decode and filter threads update them; each busy time
+    // has a single writer, which stores its running total after every frame.
+    std::atomic<size_t> frames_in{ 0 };
+    std::atomic<size_t> dropped{ 0 };
+    std::atomic<double> decode_seconds{ 0.0 };
+    std::atomic<double> filter_seconds{ 0.0 };
+
+    std::mutex error_mutex;
+    std::exception_ptr error;
+    auto fail = [&] {
+        {
+            std::lock_guard<std::mutex> lock(error_mutex);
+            if (!error) error = std::current_exception();
+        }
+        free_frames.close();
+        decoded.close();
+        filtered.close();
+    };
+
+    std::thread decoder([&] {
+        try
+        {
+            Image frame;
+            double busy = 0.0;
+            while ((options.max_frames == 0 || frames_in < options.max_frames) && free_frames.pop(frame))
+            {
+                const Clock::time_point t = Clock::now();
+                if (!reader.read_frame(frame)) break;
+                ++frames_in;
+                busy += seconds_since(t);
+                decode_seconds = busy;
+                if (!decoded.push({ std::move(frame), Clock::now() })) break;
+            }
+        }
+        catch (...)
+        {
+            fail();
+        }
+        decoded.close();
+    });
+
+    std::thread filter([&] {
+        try
+        {
+            // Under drop_late, a frame that waited longer than one source period for this stage is
+            // stale: a live source has produced its successor by now, so it is skipped unfiltered
+            // and the stage catches up instead of holding the source back.
+            const VideoFormat& format = reader.format();
+            const std::chrono::duration<double> period(double(format.fps_den) / format.fps_num);
+            DecodedFrame decoded_frame;
+            Image& frame = decoded_frame.image;
+            double busy = 0.0;
+            while (decoded.pop(decoded_frame))
+            {
+                const Clock::time_point t = Clock::now();
+                if (options.drop_late && t - decoded_frame.ready > period)
+                {
+                    ++dropped;
+                    free_frames.push(std::move(frame));
+                    continue;
+                }
+                run_pipeline(frame, options.chain, options.backend);
+                busy += seconds_since(t);
+                filter_seconds = busy;
+                if (!filtered.push(std::move(frame))) break;
+            }
+        }
+        catch (...)
+        {
+            fail();
+        }
+        filtered.close();
+    });
+
+    // Output runs on the calling thread.
+    auto snapshot = [&] {
+        stats.frames_in = frames_in;
+        stats.dropped = dropped;
+        stats.decode_seconds = decode_seconds;
+        stats.filter_seconds = filter_seconds;
+        stats.seconds = seconds_since(start);
+        stats.fps = stats.seconds > 0.0 ? stats.frames_out / stats.seconds : 0.0;
+    };
+    try
+    {
+        Clock::time_point last_report = Clock::now();
+        Image frame;
+        while (filtered.pop(frame))
+        {
+            const Clock::time_point t = Clock::now();
+            writer.write_frame(frame);
+            ++stats.frames_out;
+            stats.encode_seconds += seconds_since(t);
+            free_frames.push(std::move(frame));
+            if (options.progress && seconds_since(last_report) >= 1.0)
+            {
+                last_report = Clock::now();
+                snapshot();
+                options.progress(stats); // stage busy times are not final; the counters are
+            }
+        }
+    }
+    catch (...)
+    {
+        fail();
+    }
+    decoder.join();
+    filter.join();
+    if (error) std::rethrow_exception(error);
+    writer.finish();
+    snapshot();
+    return stats;
+}
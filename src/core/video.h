@@ -0,0 +1,109 @@
+// src/core/video.h
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "backend.h"
+#include "filter_chain.h"
+#include "image.h"
+
+// Frame-sequence streaming: a chain applied to every frame of a Y4M stream, raw RGB24 frames or a
+// numbered series of image files, from stdin or files, to stdout or files. Decode, filter and output
+// run as concurrent stages connected by bounded queues, so while frame N is filtered, frame N+1 is
+// decoding and frame N-1 being written. Frame buffers are allocated once and recycled.
+
+// Chroma layouts of Y4M ("C" header tag). Samples are 8-bit BT.601 with studio range (16..235 luma).
+enum class Y4mChroma
+{
+    C420, // 4:2:0 in any siting (420jpeg, 420paldv, 420mpeg2, 420); written as 420jpeg
+    C422,
+    C444,
+    Mono
+};
+
+struct VideoFormat
+{
+    int width = 0;
+    int height = 0;
+    int fps_num = 25; // frame rate; Y4M "F" tag, or --fps for raw and numbered input
+    int fps_den = 1;
+    Y4mChroma chroma = Y4mChroma::C420;
+};
+
+// Delivers decoded frames as interleaved RGB8. read_frame() reuses `frame` when it already has the
+// right size, and returns false at the end of the sequence. Throws std::runtime_error on bad input.
+class FrameReader
+{
+public:
+    virtual ~FrameReader() = default;
+    const VideoFormat& format() const { return format_; }
+    virtual bool read_frame(Image& frame) = 0;
+
+protected:
+    VideoFormat format_;
+};
+
+class FrameWriter
+{
+public:
+    virtual ~FrameWriter() = default;
+    virtual void write_frame(const Image& frame) = 0;
+    virtual void finish() = 0; // flushes; the writer is unusable afterwards
+};
+
+// What a path names:
+//  "-"               stdin / stdout
+//  *.y4m             YUV4MPEG2
+//  *.rgb, *.raw      headerless RGB24 frames, back to back (input needs the frame size)
+//  a path with '%'   numbered image files through load_image() / save_image(), e.g. "in/%05d.png";
+//                    input starts at `first_frame` (or the first of 0 and 1 that exists) and ends at
+//                    the first missing number
+// stdin is Y4M when it starts with the "YUV4MPEG2" signature and raw RGB24 otherwise. Output to
+// stdout is Y4M unless `raw_output` is set.
+struct VideoInputOptions
+{
+    int width = 0; // frame size of raw input
+    int height = 0;
+    int fps_num = 25; // declared frame rate of raw and numbered input
+    int fps_den = 1;
+    int first_frame = -1; // numbered input: first number; < 0 probes 0, then 1
+};
+
+std::unique_ptr<FrameReader> open_frame_reader(const std::string& path, const VideoInputOptions& options = {});
+// `format` is the input's: Y4M output keeps its size, rate and chroma layout.
+std::unique_ptr<FrameWriter> open_frame_writer(const std::string& path, const VideoFormat& format,
+                                               bool raw_output = false, const PngOptions& png = {});
+
+struct VideoStats
+{
+    size_t frames_in = 0;        // decoded
+    size_t frames_out = 0;       // filtered and written
+    size_t dropped = 0;          // discarded under drop_late
+    double seconds = 0.0;        // wall clock from the first read to the last write
+    double fps = 0.0;            // sustained output rate, frames_out / seconds
+    double decode_seconds = 0.0; // busy time of each stage
+    double filter_seconds = 0.0;
+    double encode_seconds = 0.0;
+};
+
+struct VideoOptions
+{
+    FilterChain chain;
+    Backend backend = Backend::Auto; // run_pipeline() routing per frame
+    size_t queue_depth = 2;          // frames waiting between two stages
+    // Live sources (a camera on stdin) cannot be paused: with `drop_late`, a frame that waited longer
+    // than one source period for the filter stage is dropped unfiltered, so the stage catches up
+    // instead of stalling the reader.
+    bool drop_late = false;
+    size_t max_frames = 0; // stop after this many input frames; 0 reads to the end
+    // Called from the output stage about once a second with the counts so far.
+    std::function<void(const VideoStats&)> progress;
+};
+
+// Runs the three-stage pipeline until the reader is exhausted: decode and filter on threads of their
+// own, output on the calling thread. Stage errors are rethrown here once every thread has stopped.
+VideoStats run_video(FrameReader& reader, FrameWriter& writer, const VideoOptions& options);
@@ -1,10 +1,19 @@
 // src/gui/main_gui.cpp
+#include <algorithm>
 #include <array>
+#include <atomic>
 #include <chrono>
+#include <cmath>
+#include <condition_variable>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <optional>
 #include <stdexcept>
 #include <string>
 #include <cstring>
+#include <thread>
+#include <vector>
 
 #include <GL/glew.h> // must precede SDL_opengl.h to avoid gl.h before glew.h
 #include <SDL.h>
@@ -14,15 +23,25 @@
 #include "backends/imgui_impl_sdl2.h"
 #include "imgui.h"
 
-#include "core/filters_cpu.h"
-#include "core/filters_cuda.h"
+#include "core/backend.h"
 #include "core/image.h"
-
+#include "core/result_cache.h"
+#include "core/thread_pool.h"
+#include "core/trace.h"
+
+// Display texture fed through pixel unpack buffers. Storage is RGBA8, allocated once per image size
+// (immutable where GL 4.2 / ARB_texture_storage is available); updates write the new pixels, widened
+// to 4-byte texels, straight into a mapped PBO and then glTexSubImage2D from it. The two PBOs take
+// turns, and each is orphaned on map, so filling one never waits for the GPU to finish reading the
+// other. RGBA rows are always 4-byte aligned, which keeps the driver on its fast copy path.
 struct GLTexture
 {
     GLuint id = 0;
     int width = 0;
     int height = 0;
+    std::array<GLuint, 2> pbos{};
+    size_t pbo_bytes = 0;
+    int next_pbo = 0;
 
     void reset()
     {
@@ -31,32 +50,336 @@ struct GLTexture
             glDeleteTextures(1, &id);
             id = 0;
         }
+        if (pbos[0] != 0)
+        {
+            glDeleteBuffers(2, pbos.data());
+            pbos = {};
+        }
         width = height = 0;
+        pbo_bytes = 0;
     }
 };
 
-bool upload_image_to_texture(const Image& img, GLTexture& texture)
+// Gray, RGB or RGBA rows [y0, y1) of `img` into packed RGBA at `dst`.
+void expand_to_rgba(const Image& img, int y0, int y1, uint8_t* dst)
 {
-    if (img.pixels.empty() || img.width <= 0 || img.height <= 0) return false;
-
-    if (texture.id == 0)
+    const int c = img.channels;
+    for (int y = y0; y < y1; ++y)
     {
-        glGenTextures(1, &texture.id);
+        const uint8_t* src = img.pixels.data() + static_cast<size_t>(y) * img.row_stride();
+        uint8_t* out = dst + static_cast<size_t>(y) * img.width * 4;
+        for (int x = 0; x < img.width; ++x, src += c, out += 4)
+        {
+            out[0] = src[0];
+            out[1] = src[c >= 3 ? 1 : 0];
+            out[2] = src[c >= 3 ? 2 : 0];
+            out[3] = c == 4 ? src[3] : 255;
+        }
     }
-    texture.width = img.width;
-    texture.height = img.height;
+}
+
+void allocate_texture(GLTexture& texture, int width, int height)
+{
+    if (texture.id != 0) glDeleteTextures(1, &texture.id);
+    glGenTextures(1, &texture.id);
+    texture.width = width;
+    texture.height = height;
 
     glBindTexture(GL_TEXTURE_2D, texture.id);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, img.width, img.height, 0, GL_RGB, GL_UNSIGNED_BYTE, img.pixels.data());
+    if (GLEW_VERSION_4_2 || GLEW_ARB_texture_storage)
+        glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, width, height);
+    else
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
     glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+bool upload_image_to_texture(const Image& img, GLTexture& texture)
+{
+    if (img.pixels.empty() || img.width <= 0 || img.height <= 0) return false;
+
+    if (texture.id == 0 || texture.width != img.width || texture.height != img.height)
+    {
+        allocate_texture(texture, img.width, img.height);
+    }
+    const size_t bytes = static_cast<size_t>(img.width) * img.height * 4;
+    if (texture.pbos[0] == 0) glGenBuffers(2, texture.pbos.data());
+    if (texture.pbo_bytes != bytes)
+    {
+        for (GLuint pbo : texture.pbos)
+        {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+            glBufferData(GL_PIXEL_UNPACK_BUFFER, static_cast<GLsizeiptr>(bytes), nullptr, GL_STREAM_DRAW);
+        }
+        texture.pbo_bytes = bytes;
+    }
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, texture.pbos[texture.next_pbo]);
+    texture.next_pbo ^= 1;
+    auto* mapped = static_cast<uint8_t*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, static_cast<GLsizeiptr>(bytes),
+                                                          GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+    std::vector<uint8_t> fallback; // only if the driver refuses to map
+    uint8_t* dst = mapped;
+    if (!mapped)
+    {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        fallback.resize(bytes);
+        dst = fallback.data();
+    }
+    parallel_for_rows(img.height, static_cast<size_t>(img.width) * 4,
+                      [&](int y0, int y1) { expand_to_rgba(img, y0, y1, dst); });
+    if (mapped) glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+    // With a PBO bound the data argument is an offset into it.
+    glBindTexture(GL_TEXTURE_2D, texture.id);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, img.width, img.height, GL_RGBA, GL_UNSIGNED_BYTE,
+                    mapped ? nullptr : fallback.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
     return true;
 }
 
+// Writes `region` into the texture at (x0, y0), e.g. a viewport preview. Small enough to skip the PBOs.
+void upload_region_to_texture(const Image& region, int x0, int y0, GLTexture& texture)
+{
+    std::vector<uint8_t> rgba(static_cast<size_t>(region.width) * region.height * 4);
+    expand_to_rgba(region, 0, region.height, rgba.data());
+    glBindTexture(GL_TEXTURE_2D, texture.id);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, x0, y0, region.width, region.height, GL_RGBA, GL_UNSIGNED_BYTE, rgba.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+// Per-stage totals of the last run: span name, calls and busy time summed over threads.
+void show_stage_table(const char* id, const std::vector<TraceTotal>& stages)
+{
+    if (stages.empty()) return;
+    if (ImGui::BeginTable(id, 4, ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingFixedFit))
+    {
+        ImGui::TableSetupColumn("Stage");
+        ImGui::TableSetupColumn("Kind");
+        ImGui::TableSetupColumn("Calls");
+        ImGui::TableSetupColumn("ms");
+        ImGui::TableHeadersRow();
+        for (const TraceTotal& stage : stages)
+        {
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::TextUnformatted(stage.name);
+            ImGui::TableNextColumn();
+            ImGui::TextUnformatted(stage.category);
+            ImGui::TableNextColumn();
+            ImGui::Text("%d", stage.count);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f", stage.total_ms);
+        }
+        ImGui::EndTable();
+    }
+}
+
+// A filter run for the preview worker: `chain` over a copy of `source`.
+struct PreviewRequest
+{
+    std::shared_ptr<const Image> source;
+    FilterChain chain;
+    bool cpu_reference = false; // also time the CPU pool when the main run went to the GPU
+    bool trace = false;         // collect per-stage breakdowns
+    Rect roi;                   // non-empty: just this part first (the viewport), then the whole frame
+};
+
+struct PreviewResult
+{
+    std::shared_ptr<const Image> source; // of the request
+    Image image;
+    Backend backend = Backend::Cpu;
+    double ms = 0.0;
+    double cpu_ms = 0.0; // 0 without a reference run
+    size_t steps = 0;
+    size_t cached_steps = 0; // leading steps served from the result cache
+    Rect roi;                // non-empty: image holds only this part of the frame
+    std::vector<TraceTotal> stages;
+    std::vector<TraceTotal> cpu_stages;
+    std::string error;
+};
+
+// Runs filters off the render thread. Only the newest request matters: submitting replaces any
+// request still waiting, and with `cancel_running` also abandons the one in progress at its next
+// chunk or step boundary. Slider drags leave the running job alone, so a filter slower than a frame
+// still delivers a preview now and then instead of being restarted on every mouse move.
+class PreviewWorker
+{
+public:
+    PreviewWorker() : thread_([this] { run(); }) {}
+
+    ~PreviewWorker()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+            cancel_ = true;
+        }
+        cv_.notify_one();
+        thread_.join();
+    }
+
+    PreviewWorker(const PreviewWorker&) = delete;
+    PreviewWorker& operator=(const PreviewWorker&) = delete;
+
+    void submit(PreviewRequest request, bool cancel_running)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            pending_ = std::move(request);
+            if (cancel_running && running_) cancel_ = true;
+        }
+        cv_.notify_one();
+    }
+
+    // Takes the result of the last completed request, if one finished since the previous call.
+    bool poll(PreviewResult& out)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!finished_) return false;
+        out = std::move(*finished_);
+        finished_.reset();
+        return true;
+    }
+
+    bool busy() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return running_ || pending_.has_value();
+    }
+
+private:
+    void run()
+    {
+        for (;;)
+        {
+            PreviewRequest request;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                cv_.wait(lock, [this] { return stopping_ || pending_.has_value(); });
+                if (stopping_) return;
+                request = std::move(*pending_);
+                pending_.reset();
+                running_ = true;
+                cancel_ = false;
+            }
+
+            std::optional<PreviewResult> result;
+            try
+            {
+                result = process(request);
+            }
+            catch (const Cancelled&)
+            {
+                // superseded; the newer request is already pending
+            }
+            catch (const std::exception& ex)
+            {
+                result.emplace();
+                result->source = request.source;
+                result->error = ex.what();
+            }
+            set_tracing_enabled(false);
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            running_ = false;
+            // A viewport preview is followed by the rest of the frame unless something newer is waiting.
+            if (result && result->error.empty() && !request.roi.empty() && !pending_ && !stopping_)
+            {
+                request.roi = {};
+                pending_ = std::move(request);
+            }
+            if (result) finished_ = std::move(result);
+        }
+    }
+
+    PreviewResult process(const PreviewRequest& request)
+    {
+        using Clock = std::chrono::steady_clock;
+        CancelScope scope(cancel_);
+        set_tracing_enabled(request.trace);
+        clear_trace();
+
+        // Each source is hashed once; pressing Apply again with unchanged settings is then a cache hit,
+        // and changing only the last stage of a chain reruns just that stage.
+        PreviewResult result;
+        result.source = request.source;
+        result.steps = request.chain.size();
+        Clock::time_point start = Clock::now();
+        if (!request.roi.empty())
+        {
+            // Only the visible rectangle and the context its stencils need; no cache, no reference run.
+            result.roi = request.roi;
+            result.image = run_pipeline_region(*request.source, request.chain, request.roi,
+                                               Backend::Cuda, &result.backend);
+            result.ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+            if (request.trace) result.stages = summarize_trace(collect_trace());
+            return result;
+        }
+        if (hashed_source_.lock() != request.source)
+        {
+            source_hash_ = hash_pixels(*request.source);
+            hashed_source_ = request.source;
+        }
+        const uint64_t key = cache_key(source_hash_, hash_chain(request.chain, request.chain.size()));
+        if (const std::shared_ptr<const Image> cached = request.chain.empty() ? nullptr : cache_.find(key))
+        {
+            result.image = *cached;
+            result.backend = resolve_backend(Backend::Cuda, result.image);
+            result.cached_steps = result.steps;
+        }
+        else
+        {
+            // Backend::Cuda degrades to the CPU pool without a usable device.
+            result.image = *request.source;
+            const CachedRun run = cache_.run(result.image, source_hash_, request.chain, Backend::Cuda);
+            result.backend = run.backend;
+            result.cached_steps = run.cached_steps;
+        }
+        result.ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        if (request.trace) result.stages = summarize_trace(collect_trace());
+
+        // Only a full run is comparable with the CPU reference.
+        if (request.cpu_reference && result.backend == Backend::Cuda && result.cached_steps == 0)
+        {
+            clear_trace();
+            Image reference = *request.source;
+            start = Clock::now();
+            run_pipeline(reference, request.chain, Backend::Cpu);
+            result.cpu_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+            if (request.trace) result.cpu_stages = summarize_trace(collect_trace());
+        }
+        return result;
+    }
+
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::optional<PreviewRequest> pending_;
+    std::optional<PreviewResult> finished_;
+    std::atomic<bool> cancel_{ false }; // of the running request; reset when the next one starts
+    ResultCache cache_{ ResultCacheOptions{ size_t(512) << 20, "", false } }; // used by the worker thread only
+    std::weak_ptr<const Image> hashed_source_;
+    uint64_t source_hash_ = 0;
+    bool running_ = false;
+    bool stopping_ = false;
+    std::thread thread_; // last, so it starts after everything it uses
+};
+
+FilterStep make_step(FilterKind kind, float param = 0.0f)
+{
+    FilterStep step;
+    step.kind = kind;
+    step.params[0] = param;
+    return step;
+}
+
 ImVec2 fit_size(int img_w, int img_h, float max_w, float max_h)
 {
     float scale = std::min(max_w / static_cast<float>(img_w), max_h / static_cast<float>(img_h));
@@ -125,6 +448,8 @@ int main(int, char**)
     std::array<char, 512> save_path_buf{};
     std::strncpy(load_path_buf.data(), "input.png", load_path_buf.size() - 1);
     std::strncpy(save_path_buf.data(), "output.png", save_path_buf.size() - 1);
+    std::array<char, 256> chain_buf{};
+    std::strncpy(chain_buf.data(), "brightness:0.2,contrast:1.5,sobel", chain_buf.size() - 1);
 
     enum class FilterType
     {
@@ -133,24 +458,81 @@ int main(int, char**)
         Brightness,
         Contrast,
         Blur,
-        Sobel
+        Sobel,
+        Chain
     };
 
     FilterType current_filter = FilterType::None;
     float brightness_delta = 0.0f;
     float contrast_factor = 1.0f;
-    double last_cpu_ms = 0.0;
-    double last_gpu_ms = 0.0;
-    double last_speedup = 0.0;
+    int blur_radius = 1;
+    bool live_preview = true;
+    bool cpu_reference = false;
+    bool trace_stages = true;
     bool have_timings = false;
+    PreviewResult last_run; // timings and breakdowns; its image has moved to processed_image
+    std::string status;
 
-    Image original_image;
+    std::shared_ptr<const Image> original_image;
     Image processed_image;
     bool has_image = false;
 
     GLTexture original_tex;
     GLTexture processed_tex;
 
+    PreviewWorker worker;
+    // The chain for the current controls; throws for a malformed chain spec.
+    auto current_chain = [&]() -> FilterChain {
+        switch (current_filter)
+        {
+        case FilterType::Grayscale: return { make_step(FilterKind::Grayscale) };
+        case FilterType::Brightness: return { make_step(FilterKind::Brightness, brightness_delta) };
+        case FilterType::Contrast: return { make_step(FilterKind::Contrast, contrast_factor) };
+        case FilterType::Blur: return { make_step(FilterKind::BoxBlur, static_cast<float>(blur_radius)) };
+        case FilterType::Sobel: return { make_step(FilterKind::Sobel) };
+        case FilterType::Chain: return parse_filter_chain(chain_buf.data());
+        case FilterType::None: break;
+        }
+        return {};
+    };
+    // Zoomed in, the images show only the part of the frame around view_center.
+    float zoom = 1.0f;
+    ImVec2 view_center(0.5f, 0.5f);
+    auto view_uv = [&](ImVec2& uv0, ImVec2& uv1) {
+        const float half = 0.5f / zoom;
+        view_center.x = std::clamp(view_center.x, half, 1.0f - half);
+        view_center.y = std::clamp(view_center.y, half, 1.0f - half);
+        uv0 = ImVec2(view_center.x - half, view_center.y - half);
+        uv1 = ImVec2(view_center.x + half, view_center.y + half);
+    };
+    auto visible_rect = [&]() {
+        ImVec2 uv0, uv1;
+        view_uv(uv0, uv1);
+        const int w = original_image->width;
+        const int h = original_image->height;
+        return Rect{ static_cast<int>(std::floor(uv0.x * w)), static_cast<int>(std::floor(uv0.y * h)),
+                     static_cast<int>(std::ceil(uv1.x * w)), static_cast<int>(std::ceil(uv1.y * h)) }
+            .expanded(0, w, h);
+    };
+    // `viewport`: while interacting, filter what is visible first and the rest afterwards.
+    auto request_preview = [&](bool cancel_running, bool viewport) {
+        if (!has_image) return;
+        try
+        {
+            PreviewRequest request;
+            request.source = original_image;
+            request.chain = current_chain();
+            request.cpu_reference = cpu_reference;
+            request.trace = trace_stages;
+            if (viewport && zoom > 1.0f) request.roi = visible_rect();
+            worker.submit(std::move(request), cancel_running);
+        }
+        catch (const std::exception& ex)
+        {
+            status = ex.what();
+        }
+    };
+
     bool running = true;
     while (running)
     {
@@ -179,11 +561,14 @@ int main(int, char**)
         {
             try
             {
-                original_image = load_image(load_path_buf.data());
-                processed_image = original_image;
+                original_image = std::make_shared<const Image>(load_image(load_path_buf.data()));
+                processed_image = *original_image;
                 has_image = true;
-                upload_image_to_texture(original_image, original_tex);
+                have_timings = false;
+                status.clear();
+                upload_image_to_texture(*original_image, original_tex);
                 upload_image_to_texture(processed_image, processed_tex);
+                if (live_preview) request_preview(true, false);
             }
             catch (const std::exception& ex)
             {
@@ -191,77 +576,101 @@ int main(int, char**)
             }
         }
 
-        const char* filter_labels[] = { "None", "Grayscale", "Brightness", "Contrast", "Blur", "Sobel" };
+        // Picking another filter or editing the chain abandons the running preview; slider drags
+        // only replace the queued one (see PreviewWorker).
+        const char* filter_labels[] = { "None", "Grayscale", "Brightness", "Contrast", "Blur", "Sobel", "Chain" };
         int filter_idx = static_cast<int>(current_filter);
+        bool changed = false;
+        bool restart = false;
         if (ImGui::Combo("Filter", &filter_idx, filter_labels, IM_ARRAYSIZE(filter_labels)))
         {
             current_filter = static_cast<FilterType>(filter_idx);
+            changed = restart = true;
+        }
+
+        changed |= ImGui::SliderFloat("Brightness delta", &brightness_delta, -1.0f, 1.0f);
+        changed |= ImGui::SliderFloat("Contrast factor", &contrast_factor, 0.5f, 2.0f);
+        changed |= ImGui::SliderInt("Blur radius", &blur_radius, 1, 50);
+        if (ImGui::InputText("Chain", chain_buf.data(), chain_buf.size()))
+        {
+            changed = restart = true;
         }
+        ImGui::Checkbox("Live preview", &live_preview);
+        ImGui::Checkbox("CPU reference timing", &cpu_reference);
+        ImGui::Checkbox("Per-stage breakdown", &trace_stages);
+        ImGui::SliderFloat("Zoom", &zoom, 1.0f, 16.0f, "%.1fx");
+        ImGui::TextDisabled("Drag an image to pan. Zoomed in, live edits filter the visible part first.");
 
-        ImGui::SliderFloat("Brightness delta", &brightness_delta, -1.0f, 1.0f);
-        ImGui::SliderFloat("Contrast factor", &contrast_factor, 0.5f, 2.0f);
+        if (ImGui::Button("Apply filter"))
+        {
+            request_preview(true, false);
+        }
+        else if (changed && live_preview)
+        {
+            request_preview(restart, true);
+        }
 
-        if (ImGui::Button("Apply filter") && has_image)
+        PreviewResult result;
+        if (worker.poll(result) && result.source == original_image) // else computed for a replaced image
         {
-            Image cpu_image = original_image;
-            Image gpu_image = original_image;
-            try
+            if (result.error.empty() && !result.roi.empty())
             {
-                if (current_filter == FilterType::None)
-                {
-                    processed_image = original_image;
-                    have_timings = false;
-                    upload_image_to_texture(processed_image, processed_tex);
-                }
-                else
-                {
-                    auto start_cpu = std::chrono::high_resolution_clock::now();
-                    switch (current_filter)
-                    {
-                    case FilterType::Grayscale: cpu_grayscale(cpu_image); break;
-                    case FilterType::Brightness: cpu_brightness(cpu_image, brightness_delta); break;
-                    case FilterType::Contrast: cpu_contrast(cpu_image, contrast_factor); break;
-                    case FilterType::Blur: cpu_box_blur(cpu_image); break;
-                    case FilterType::Sobel: cpu_sobel(cpu_image); break;
-                    case FilterType::None: break;
-                    }
-                    auto end_cpu = std::chrono::high_resolution_clock::now();
-                    last_cpu_ms = std::chrono::duration<double, std::milli>(end_cpu - start_cpu).count();
-
-                    auto start_gpu = std::chrono::high_resolution_clock::now();
-                    switch (current_filter)
-                    {
-                    case FilterType::Grayscale: apply_grayscale(gpu_image); break;
-                    case FilterType::Brightness: apply_brightness(gpu_image, brightness_delta); break;
-                    case FilterType::Contrast: apply_contrast(gpu_image, contrast_factor); break;
-                    case FilterType::Blur: apply_box_blur(gpu_image); break;
-                    case FilterType::Sobel: apply_sobel(gpu_image); break;
-                    case FilterType::None: break;
-                    }
-                    auto end_gpu = std::chrono::high_resolution_clock::now();
-                    last_gpu_ms = std::chrono::duration<double, std::milli>(end_gpu - start_gpu).count();
-
-                    last_speedup = (last_gpu_ms > 0.0) ? (last_cpu_ms / last_gpu_ms) : 0.0;
-                    have_timings = true;
-
-                    processed_image = std::move(gpu_image);
-                    upload_image_to_texture(processed_image, processed_tex);
-                }
+                convert_pixels(result.image, ImageView(processed_image).crop(result.roi));
+                upload_region_to_texture(result.image, result.roi.x0, result.roi.y0, processed_tex);
+                result.image = Image();
+                last_run = std::move(result);
+                have_timings = true;
+                status.clear();
             }
-            catch (const std::exception& ex)
+            else if (result.error.empty())
+            {
+                processed_image = std::move(result.image);
+                upload_image_to_texture(processed_image, processed_tex);
+                last_run = std::move(result);
+                have_timings = true;
+                status.clear();
+            }
+            else
             {
-                std::cerr << "Filter failed: " << ex.what() << "\n";
+                status = result.error;
+                std::cerr << "Filter failed: " << status << "\n";
             }
         }
+        if (worker.busy()) ImGui::Text("Processing...");
+        if (!status.empty()) ImGui::TextWrapped("Error: %s", status.c_str());
 
         if (have_timings)
         {
             ImGui::Separator();
             ImGui::Text("Timings:");
-            ImGui::Text("CPU: %.3f ms", last_cpu_ms);
-            ImGui::Text("GPU: %.3f ms", last_gpu_ms);
-            if (last_gpu_ms > 0.0)
-                ImGui::Text("Speedup: %.2fx", last_speedup);
+            if (!last_run.roi.empty())
+            {
+                ImGui::Text("Viewport %dx%d: %.3f ms on %s", last_run.roi.width(), last_run.roi.height(), last_run.ms,
+                            last_run.backend == Backend::Cuda ? "GPU" : "CPU");
+            }
+            else if (last_run.steps > 0 && last_run.cached_steps == last_run.steps)
+            {
+                ImGui::Text("Cache: %.3f ms", last_run.ms);
+            }
+            else
+            {
+                ImGui::Text("%s: %.3f ms", last_run.backend == Backend::Cuda ? "GPU" : "CPU", last_run.ms);
+                if (last_run.cached_steps > 0)
+                {
+                    ImGui::Text("Reused %zu of %zu stages from the cache", last_run.cached_steps, last_run.steps);
+                }
+            }
+            show_stage_table("run_stages", last_run.stages);
+            if (last_run.cpu_ms > 0.0)
+            {
+                ImGui::Text("CPU reference: %.3f ms", last_run.cpu_ms);
+                show_stage_table("cpu_stages", last_run.cpu_stages);
+                ImGui::Text("Speedup: %.2fx", last_run.cpu_ms / std::max(last_run.ms, 1e-6));
+            }
+            if (last_run.backend != Backend::Cuda)
+            {
+                ImGui::Text("GPU: no CUDA device");
+            }
         }
 
         ImGui::InputText("Save path", save_path_buf.data(), save_path_buf.size());
@@ -278,25 +687,35 @@ int main(int, char**)
             }
         }
         ImGui::End();
-
-        ImGui::Begin("Images");
+        ImGui::Begin("Images", nullptr, ImGuiWindowFlags_NoMove); // drags pan instead
         if (has_image)
         {
             ImVec2 avail = ImGui::GetContentRegionAvail();
             float half_w = avail.x * 0.5f - 10.0f;
-            ImVec2 size_orig = fit_size(original_image.width, original_image.height, half_w, avail.y);
+            ImVec2 size_orig = fit_size(original_image->width, original_image->height, half_w, avail.y);
             ImVec2 size_proc = fit_size(processed_image.width, processed_image.height, half_w, avail.y);
+            ImVec2 uv0, uv1;
+            view_uv(uv0, uv1);
+            // Dragging either image pans both.
+            auto pan = [&](const ImVec2& size) {
+                if (!ImGui::IsItemHovered() || !ImGui::IsMouseDragging(ImGuiMouseButton_Left)) return;
+                const ImVec2 delta = ImGui::GetIO().MouseDelta;
+                view_center.x -= delta.x / std::max(size.x, 1.0f) / zoom;
+                view_center.y -= delta.y / std::max(size.y, 1.0f) / zoom;
+            };
 
             ImGui::BeginGroup();
             ImGui::Text("Original");
-            ImGui::Image(reinterpret_cast<ImTextureID>(static_cast<intptr_t>(original_tex.id)), size_orig);
+            ImGui::Image(reinterpret_cast<ImTextureID>(static_cast<intptr_t>(original_tex.id)), size_orig, uv0, uv1);
+            pan(size_orig);
             ImGui::EndGroup();
 
             ImGui::SameLine();
 
             ImGui::BeginGroup();
             ImGui::Text("Processed");
-            ImGui::Image(reinterpret_cast<ImTextureID>(static_cast<intptr_t>(processed_tex.id)), size_proc);
+            ImGui::Image(reinterpret_cast<ImTextureID>(static_cast<intptr_t>(processed_tex.id)), size_proc, uv0, uv1);
+            pan(size_proc);
             ImGui::EndGroup();
         }
         else
@@ -0,0 +1,81 @@
+// tests/tune_scope_test.cpp
+// A TuneScope (tuning.h) is per thread, but the settings it installs must hold for every band of a
+// parallel_for_rows() issued under it, including bands run by pool workers. Runs a SIMD-capped scope
+// on a 4-thread pool and checks what current_tuning() and tuned_simd_level() report in each band,
+// then that the workers are back on the defaults once the scope has ended.
+// Prints the first mismatches and exits non-zero if there are any.
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "core/cpu_features.h"
+#include "core/thread_pool.h"
+#include "core/tuning.h"
+
+namespace
+{
+struct BandSeen
+{
+    SimdLevel simd;
+    size_t chunk_bytes;
+    bool on_caller;
+};
+
+// One band per row; each band sleeps briefly so the workers pick up a share of them.
+std::vector<BandSeen> observe_bands(int rows)
+{
+    const std::thread::id caller = std::this_thread::get_id();
+    std::mutex mutex;
+    std::vector<BandSeen> seen;
+    parallel_for_rows(rows, 1, [&](int y0, int y1) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        const BandSeen band{ tuned_simd_level(), current_tuning().chunk_bytes,
+                             std::this_thread::get_id() == caller };
+        std::lock_guard<std::mutex> lock(mutex);
+        seen.insert(seen.end(), static_cast<size_t>(y1 - y0), band);
+    }, 1);
+    return seen;
+}
+} // namespace
+
+int main()
+{
+    set_cpu_thread_count(4);
+    constexpr int kRows = 64;
+    const SimdLevel active = active_simd_level();
+    const size_t default_chunk = TuneParams{}.chunk_bytes;
+
+    TuneParams capped;
+    capped.simd = static_cast<int>(SimdLevel::Scalar);
+    capped.chunk_bytes = default_chunk / 2;
+
+    int failures = 0;
+    int on_workers = 0;
+    {
+        TuneScope scope(capped);
+        for (const BandSeen& band : observe_bands(kRows))
+        {
+            if (!band.on_caller) ++on_workers;
+            if (band.simd == SimdLevel::Scalar && band.chunk_bytes == capped.chunk_bytes) continue;
+            if (++failures <= 10)
+            {
+                std::printf("MISMATCH under scope (%s): simd %s, chunk %zu\n", band.on_caller ? "caller" : "worker",
+                            simd_level_name(band.simd), band.chunk_bytes);
+            }
+        }
+    }
+    for (const BandSeen& band : observe_bands(kRows))
+    {
+        if (band.simd == active && band.chunk_bytes == default_chunk) continue;
+        if (++failures <= 10)
+        {
+            std::printf("MISMATCH after scope (%s): simd %s, chunk %zu\n", band.on_caller ? "caller" : "worker",
+                        simd_level_name(band.simd), band.chunk_bytes);
+        }
+    }
+    set_cpu_thread_count(0);
+    std::printf("%d bands, %d on pool workers, %d mismatches\n", kRows, on_workers, failures);
+    return failures == 0 ? 0 : 1;
+}